@@ -21,6 +21,7 @@ import android.os.Environment             // To find where the "Downloads" folde
 import android.os.Handler                 // The "Mailman" that sends messages between threads
 import android.os.Looper                  // The main message loop of the app
 import android.os.Message
+import android.os.SystemClock             // Phone uptime clock (never jumps, unlike the wall clock)
 import android.provider.MediaStore        // The system used to save files on modern Android
 import android.util.Log                   // Used to print debug messages to the developer console
 import android.view.View
@@ -38,25 +39,86 @@ import androidx.activity.result.contract.ActivityResultContracts
 import androidx.appcompat.app.AppCompatActivity
 import androidx.core.app.ActivityCompat
 import androidx.core.content.ContextCompat
-import java.io.BufferedReader
 import java.io.IOException
 import java.io.InputStream
-import java.io.InputStreamReader
 import java.io.OutputStream
 import java.text.SimpleDateFormat
 import java.util.Date
 import java.util.Locale
 import java.util.UUID
+import java.util.concurrent.ArrayBlockingQueue // A fixed-size, thread-safe waiting line
 
 // --- CONSTANTS ---
 // A secret code number. When the background thread sends data to the UI,
 // it stamps it with "0" so the UI knows "Ah, this is a read message."
 private const val MESSAGE_READ: Int = 0
+// Stamp for a decoded binary telemetry frame (see telemetry.h on the Pi).
+private const val MESSAGE_FRAME: Int = 1
+
+// --- BINARY TELEMETRY FRAME LAYOUT (must match telemetry.h) ---
+private const val TELEM_MAGIC0 = 0xA5
+private const val TELEM_MAGIC1 = 0x5A
+private const val TELEM_VERSION = 1
+private const val TELEM_HEADER_SIZE = 8
+private const val TELEM_SAMPLE_SIZE = 16
+private const val TELEM_MAX_SAMPLES = 64
+
+// --- COMMAND WRITER ---
+// Commands waiting for the writer thread. If the link stalls this many, new ones are refused.
+private const val COMMAND_QUEUE_SIZE = 64
+// How much one '+' / '-' changes the target on the Pi (process_command in parmco_server.c)
+private const val RPM_STEP = 100
+
+// --- SESSION LOG ---
+private const val LOG_RING_SIZE = 16384  // Samples buffered for the log writer (power of two, ~160 s at 100 Hz)
+private const val LOG_FLUSH_MS = 500L    // How often the log writer appends to the file
+private const val LOG_CHUNK_SIZE = 64 * 1024 // Bytes of CSV text encoded before each write
+
+// --- LIVE CHART (RpmChartView.kt) ---
+private const val CHART_RING_SIZE = 32768 // Newest samples kept for the chart (power of two, 30 s at 1 kHz)
 
 // --- DATA STRUCTURE ---
-// A simple container (like a struct in C) to hold one row of our Excel/CSV file.
-// It holds the time (in milliseconds) and the RPM value.
-data class RpmDataPoint(val timestampMs: Long, val rpm: Int)
+// The rows of our Excel/CSV file (time in milliseconds, RPM, target), kept in a FIXED-SIZE circle
+// of plain arrays instead of one object per reading. So the memory used is the same
+// after 10 seconds or 10 hours.
+// Exactly one thread adds (the socket reader) and one thread takes (the log writer), so
+// no lock is needed: 'head' and 'tail' only ever grow, and each is written by one side only.
+class SampleRing(private val capacity: Int) {
+    val session = IntArray(capacity) // Which START..STOP the sample belongs to
+    val timeMs = LongArray(capacity)
+    val rpm = IntArray(capacity)
+    val target = IntArray(capacity)  // Target RPM (-1 = not known: text telemetry)
+    @Volatile var head = 0L     // Next slot to fill (reader thread)
+    @Volatile var tail = 0L     // Next slot to take (log writer thread)
+    @Volatile var dropped = 0L  // Samples lost because the writer fell a whole circle behind
+
+    // Adds one sample. Never waits: if the circle is full, the sample is counted and dropped.
+    fun push(sessionId: Int, time: Long, value: Int, targetValue: Int) {
+        val h = head
+        if (h - tail >= capacity) { dropped = dropped + 1; return }
+        val i = index(h)
+        session[i] = sessionId
+        timeMs[i] = time
+        rpm[i] = value
+        target[i] = targetValue
+        head = h + 1 // Publishes the slot (a volatile write comes after the array stores)
+    }
+
+    fun index(pos: Long): Int = (pos and (capacity - 1).toLong()).toInt()
+}
+
+// One decoded binary frame. The samples are stored in plain arrays (one slot per sample),
+// so decoding a frame allocates a few arrays instead of a String per reading.
+class TelemetryFrame(val seq: Long, val count: Int) {
+    val tickUs = LongArray(count)    // Pi tick in microseconds (wraps every ~72 minutes)
+    val rpmRaw = IntArray(count)
+    val rpmSmooth = IntArray(count)
+    val targetRpm = IntArray(count)
+    val dutyCenti = IntArray(count)  // PWM duty in 0.01 %
+    val pidError = IntArray(count)
+    val flags = IntArray(count)
+    val motor = IntArray(count)      // Motor ID (a Pi with several motors interleaves them)
+}
 
 // @SuppressLint: We handle permissions manually in the code, so we tell Android Studio
 // not to nag us with red squiggly lines here.
@@ -83,26 +145,53 @@ class MainActivity : AppCompatActivity() {
     private val MY_UUID: UUID = UUID.fromString("00001101-0000-1000-8000-00805F9B34FB")
 
     private var connectedSocket: BluetoothSocket? = null // The active connection to the Pi
-    private var outputStream: OutputStream? = null       // The stream we write "s", "f", "x" into
+    @Volatile private var outputStream: OutputStream? = null // The stream we write "s", "f", "x" into (set by the connect thread)
     private var inputStream: InputStream? = null         // The stream we read "RPM: 500" from
     private var readDataThread: Thread? = null           // A background worker to listen for data constantly
 
+    // Every byte to the Pi goes through ONE writer thread, in the order the buttons were pressed.
+    // The buttons only drop their command into this queue (that never blocks the screen).
+    private val commandQueue = ArrayBlockingQueue<String>(COMMAND_QUEUE_SIZE)
+    private var writerThread: Thread? = null
+
     // --- APP STATE FLAGS ---
     // These are boolean switches to keep track of what the app is doing.
     private var isClockwise = true    // Are we spinning CW or CCW?
     private var isMotorStopped = true // Is the motor off?
     private var isAutoMode = false    // Are we in Manual or Auto (PID) mode?
+    @Volatile private var motorId = 0 // The motor we drive: the Pi's default motor (first ID in "MOTORS:")
 
     // --- LOGGING VARIABLES ---
-    // An ArrayList to store our data in memory before we save it to a file.
-    private val rpmDataLog = ArrayList<RpmDataPoint>()
-    // Keeps track of WHEN we hit the start button (0 means we haven't started yet).
+    // Samples travel: socket reader thread -> logRing -> log writer thread -> file in Downloads.
+    // The screen thread never touches them, and the file grows while we log instead of being
+    // built in one piece at the end.
+    private val logRing = SampleRing(LOG_RING_SIZE)
+    @Volatile private var isLogging = false   // Between START and STOP: the reader fills logRing
+    @Volatile private var logSession = 0      // Bumped at every START, so the reader restarts "Time Zero"
+    private var logWriterThread: Thread? = null
+    // Reader thread only: the session its "Time Zero" belongs to, the phone time of the first
+    // text sample, and the Pi tick of the last binary sample (-1 = none yet) with the time
+    // counted since "Time Zero" (like the chart, so the log does not wrap with the tick).
+    private var readerSession = -1
     private var loggingStartTime: Long = 0L
+    private var loggingLastTick: Long = -1L
+    private var loggingTimeUs: Long = 0L
+    // Screen thread: the next expected binary frame number.
+    private var expectedFrameSeq: Long = -1L
+
+    // --- LIVE CHART VARIABLES ---
+    // The reader thread adds every sample of our motor here and asks the chart to redraw;
+    // the chart only redraws once per screen refresh, however many samples arrived.
+    private val chartRing = ChartRing(CHART_RING_SIZE)
+    // Reader thread only: the Pi tick wraps every ~72 minutes, so the chart counts its own time.
+    private var chartLastTick: Long = -1L
+    private var chartTimeUs: Long = 0L
 
     // --- UI ELEMENTS ---
     // "lateinit var" means: "I promise I will fill this variable with a button/text view later
     // (specifically in the onCreate method). Don't crash because it's empty right now."
     private lateinit var rpmTextView: TextView
+    private lateinit var rpmChart: RpmChartView      // Live target / actual RPM and duty
     private lateinit var startButton: Button
     private lateinit var slowerButton: Button
     private lateinit var fasterButton: Button
@@ -128,30 +217,26 @@ class MainActivity : AppCompatActivity() {
                     val readMessage = msg.obj as String
 
                     if (readMessage.startsWith("RPM:")) {
-                        // 2. Update the big text on the screen
+                        // 2. Update the big text on the screen (the reader thread already logged it)
                         rpmTextView.text = readMessage.trim()
+                    } else if (readMessage.startsWith("MOTORS:")) {
+                        // Our commands have no "@<id>" prefix, so they go to the first motor listed
+                        motorId = readMessage.removePrefix("MOTORS:").split(",").first().trim().toIntOrNull() ?: 0
+                    }
+                }
 
-                        // 3. LOGGING LOGIC
-                        // If loggingStartTime is greater than 0, it means the user hit START.
-                        if (loggingStartTime > 0L) {
-                            try {
-                                // Strip off "RPM:" leaving just "1200", then convert to number (Int)
-                                val rpmValue = readMessage.removePrefix("RPM:").trim().toInt()
-                                
-                                // Get current clock time
-                                val currentTime = System.currentTimeMillis()
-                                
-                                // Calculate how many milliseconds passed since we hit start
-                                val relativeTime = currentTime - loggingStartTime
-                                
-                                // Add this data point to our memory list
-                                rpmDataLog.add(RpmDataPoint(relativeTime, rpmValue))
-                            } catch (e: NumberFormatException) {
-                                // If the Pi sent garbage data that wasn't a number, ignore it.
-                                Log.e("RPM_LOG", "Failed to parse RPM: $readMessage")
-                            }
-                        }
+                MESSAGE_FRAME -> {
+                    val frame = msg.obj as TelemetryFrame
+
+                    // A jump in the sequence number means frames were lost on the way
+                    if (expectedFrameSeq >= 0 && frame.seq != expectedFrameSeq) {
+                        Log.w("RPM_LOG", "Lost ${(frame.seq - expectedFrameSeq) and 0xFFFFFFFFL} telemetry frame(s)")
                     }
+                    expectedFrameSeq = (frame.seq + 1) and 0xFFFFFFFFL
+
+                    // Only the newest sample of our motor goes on screen (the reader thread logged them all)
+                    val newest = (frame.count - 1 downTo 0).firstOrNull { frame.motor[it] == motorId }
+                    if (newest != null) rpmTextView.text = "RPM:${frame.rpmSmooth[newest]}"
                 }
             }
         }
@@ -180,6 +265,8 @@ class MainActivity : AppCompatActivity() {
         sendRpmButton = findViewById(R.id.sendRpmButton)
         val devicesListView: ListView = findViewById(R.id.devicesListView)
         rpmTextView = findViewById(R.id.rpmTextView)
+        rpmChart = findViewById(R.id.rpmChart)
+        rpmChart.ring = chartRing
 
         // 2. SETTING UP THE LIST
         // This adapter manages the list of devices found. It puts simple text items into the list.
@@ -243,9 +330,8 @@ class MainActivity : AppCompatActivity() {
 
         // START BUTTON
         startButton.setOnClickListener {
-            // A. START LOGGING
-            rpmDataLog.clear() // Erase any old data
-            loggingStartTime = System.currentTimeMillis() // Save the current time as "Time Zero"
+            // A. START LOGGING (a new file in Downloads, written while the motor runs)
+            startLogging()
 
             // B. SEND COMMANDS
             // We send a sequence to get the motor moving immediately.
@@ -288,8 +374,7 @@ class MainActivity : AppCompatActivity() {
             Toast.makeText(this, "Stop (x) sent", LENGTH_SHORT).show()
 
             // STOP LOGGING & SAVE
-            loggingStartTime = 0L // Reset timer
-            saveDataToFile() // <--- This saves your CSV file to "Downloads"
+            stopLogging() // <--- Writes the last samples and closes the CSV file in "Downloads"
         }
 
         // DIRECTION BUTTON
@@ -323,6 +408,10 @@ class MainActivity : AppCompatActivity() {
 
         // Start the app in Manual Mode UI state
         updateUIForMode(isManualMode = true)
+
+        // Start the command writer. It sleeps until the first command is queued.
+        writerThread = Thread(this::writeCommands)
+        writerThread?.start()
     }
 
     // --- ON DESTROY ---
@@ -331,8 +420,10 @@ class MainActivity : AppCompatActivity() {
         super.onDestroy()
         // Stop listening for devices
         unregisterReceiver(discoveryReceiver)
-        // Stop the background data reading thread
+        // Finish the log file, stop the background data reading and command writing threads
+        stopLogging()
         readDataThread?.interrupt()
+        writerThread?.interrupt()
         // Close all connections
         try {
             outputStream?.close()
@@ -449,57 +540,107 @@ class MainActivity : AppCompatActivity() {
     }
 
     // --- FILE SAVING (MEDIASTORE) ---
-    // This is how we save the Excel/CSV file to the Downloads folder
-    private fun saveDataToFile() {
-        if (rpmDataLog.isEmpty()) {
-            Toast.makeText(this, "No data to save", LENGTH_SHORT).show()
-            return
+    // START opens a new CSV file in the Downloads folder and starts its log writer thread.
+    // The reader thread begins filling logRing right away, so nothing is lost while the file opens.
+    private fun startLogging() {
+        stopLogging() // A START without STOP finishes the previous file first
+        val previous = logWriterThread
+        val session = logSession + 1
+        logSession = session
+        isLogging = true
+        logWriterThread = Thread {
+            // One file at a time: let the previous writer take its last samples first
+            try { previous?.join() } catch (e: InterruptedException) { /* STOP pressed meanwhile */ }
+            writeLogFile(session)
         }
+        logWriterThread?.start()
+    }
 
-        // 1. BUILD THE TEXT CONTENT
-        // StringBuilder is a fast way to stick strings together
-        val stringBuilder = StringBuilder()
-        stringBuilder.append("time(ms),RPM\n") // Column Headers
-        
-        // Loop through our memory list and add lines like "1200,500"
-        rpmDataLog.forEach { dataPoint ->
-            stringBuilder.append("${dataPoint.timestampMs},${dataPoint.rpm}\n")
-        }
-        val fileContent = stringBuilder.toString()
+    // STOP: the writer appends what is left, closes the file and reports.
+    private fun stopLogging() {
+        if (!isLogging) return
+        isLogging = false
+        logWriterThread?.interrupt() // Wake it from its sleep so the file is finished at once
+    }
 
-        // 2. CREATE A FILENAME
+    // The log writer thread for one START..STOP session. Every LOG_FLUSH_MS it turns the new
+    // samples into CSV lines ("1200,500") and appends them to the file, so saving never builds
+    // the whole log in memory. Its one buffer is allocated once per session.
+    private fun writeLogFile(session: Int) {
+        // 1. CREATE A FILENAME
         // Uses current date/time so files don't overwrite each other
         val timeStamp = SimpleDateFormat("yyyyMMdd_HHmmss", Locale.getDefault()).format(Date())
         val fileName = "rpm_log_$timeStamp.txt"
 
-        // 3. PREPARE THE "TICKET" FOR THE SYSTEM
+        // 2. PREPARE THE "TICKET" FOR THE SYSTEM
         // In new Android, we can't just write a file. We have to create a "ContentValues"
         // object to tell the system what we plan to save.
         val contentValues = ContentValues().apply {
             put(MediaStore.MediaColumns.DISPLAY_NAME, fileName)
             put(MediaStore.MediaColumns.MIME_TYPE, "text/plain")
-            // Put it in the standard Downloads folder
+            // Put it in the standard Downloads folder, hidden from other apps until it is complete
             if (Build.VERSION.SDK_INT >= Build.VERSION_CODES.Q) {
                 put(MediaStore.MediaColumns.RELATIVE_PATH, Environment.DIRECTORY_DOWNLOADS)
+                put(MediaStore.MediaColumns.IS_PENDING, 1)
             }
         }
 
-        // 4. WRITE THE FILE
+        // 3. WRITE THE FILE, ONE CHUNK AT A TIME
         var uri: android.net.Uri? = null
+        var samples = 0L
+        val droppedBefore = logRing.dropped
         try {
             // Ask the system to create the file and give us a URI (Address)
             uri = contentResolver.insert(MediaStore.Downloads.EXTERNAL_CONTENT_URI, contentValues)
             if (uri == null) throw IOException("Failed to create new MediaStore entry")
 
-            // Open a stream to that URI and write our data
             contentResolver.openOutputStream(uri).use { outputStream ->
                 if (outputStream == null) throw IOException("Failed to open output stream")
-                outputStream.write(fileContent.toByteArray())
+                val chunk = ByteArray(LOG_CHUNK_SIZE)
+                var len = putText(chunk, 0, "time(ms),RPM,target\n") // Column Headers (parmco_step reads this file)
+
+                var finished = false
+                while (!finished) {
+                    // Checked BEFORE taking the samples, so the last ones still make it into the file
+                    finished = !isLogging || logSession != session
+                    var pos = logRing.tail
+                    val head = logRing.head
+                    while (pos < head) {
+                        val i = logRing.index(pos)
+                        if (logRing.session[i] > session) { finished = true; break } // The next START's samples
+                        if (logRing.session[i] == session) {
+                            if (len > LOG_CHUNK_SIZE - 48) { outputStream.write(chunk, 0, len); len = 0 } // 48 > one line
+                            len = putNumber(chunk, len, logRing.timeMs[i])
+                            chunk[len++] = ','.code.toByte()
+                            len = putNumber(chunk, len, logRing.rpm[i].toLong())
+                            chunk[len++] = ','.code.toByte()
+                            len = putNumber(chunk, len, logRing.target[i].toLong())
+                            chunk[len++] = '\n'.code.toByte()
+                            samples++
+                        }
+                        pos++
+                    }
+                    logRing.tail = pos // Hands the slots back to the reader
+                    if (len > 0) { outputStream.write(chunk, 0, len); len = 0 }
+                    if (!finished) {
+                        try { Thread.sleep(LOG_FLUSH_MS) } catch (e: InterruptedException) { /* STOP pressed */ }
+                    }
+                }
             }
 
-            // If successful, show a popup
+            // 4. FINISH: show the file to other apps, or remove it if nothing was logged
+            if (samples == 0L) {
+                contentResolver.delete(uri, null, null)
+                runOnUiThread { Toast.makeText(this, "No data to save", LENGTH_SHORT).show() }
+                return
+            }
+            if (Build.VERSION.SDK_INT >= Build.VERSION_CODES.Q) {
+                contentResolver.update(uri, ContentValues().apply { put(MediaStore.MediaColumns.IS_PENDING, 0) }, null, null)
+            }
+            val lost = logRing.dropped - droppedBefore
             runOnUiThread {
-                Toast.makeText(this, "Log saved to Downloads folder!", LENGTH_LONG).show()
+                val note = if (lost > 0) " ($lost samples lost)" else ""
+                Toast.makeText(this, "Log saved to Downloads folder!$note", LENGTH_LONG).show()
             }
         } catch (e: Exception) {
             e.printStackTrace()
@@ -510,23 +651,113 @@ class MainActivity : AppCompatActivity() {
         }
     }
 
+    // Writes 'value' as decimal digits into 'buf' at 'pos' (no String per number). Returns the new end.
+    private fun putNumber(buf: ByteArray, pos: Int, value: Long): Int {
+        var p = pos
+        var v = value
+        if (v < 0) { buf[p++] = '-'.code.toByte(); v = -v }
+        val start = p
+        do { buf[p++] = ('0'.code + (v % 10).toInt()).toByte(); v /= 10 } while (v > 0)
+        // The digits came out backwards: reverse them
+        var a = start
+        var b = p - 1
+        while (a < b) { val t = buf[a]; buf[a] = buf[b]; buf[b] = t; a++; b-- }
+        return p
+    }
+
+    private fun putText(buf: ByteArray, pos: Int, text: String): Int {
+        val bytes = text.toByteArray(Charsets.US_ASCII)
+        System.arraycopy(bytes, 0, buf, pos, bytes.size)
+        return pos + bytes.size
+    }
+
+    // Reader thread: adds one sample of our motor to the session log (if logging).
+    // Binary samples are timed by the Pi's clock ('tickUs'), text ones by the phone's (tickUs = -1).
+    private fun logSample(tickUs: Long, rpm: Int, target: Int) {
+        if (!isLogging) return
+        val session = logSession
+        if (session != readerSession) { // First sample after START: this is "Time Zero"
+            readerSession = session
+            loggingStartTime = System.currentTimeMillis()
+            loggingLastTick = -1L
+            loggingTimeUs = 0L
+        }
+        val relativeTime = if (tickUs >= 0) {
+            if (loggingLastTick >= 0) loggingTimeUs += (tickUs - loggingLastTick) and 0xFFFFFFFFL
+            loggingLastTick = tickUs
+            loggingTimeUs / 1000
+        } else {
+            System.currentTimeMillis() - loggingStartTime
+        }
+        logRing.push(session, relativeTime, rpm, target)
+    }
+
     // --- SENDING DATA ---
+    // Queues the command for the writer thread and returns at once, so the UI never waits on the radio.
     private fun sendBluetoothCommand(command: String) {
         if (outputStream == null) {
             Toast.makeText(this, "Not connected to a device", LENGTH_SHORT).show()
             return
         }
-        // Run this in a background thread so the UI doesn't freeze if sending is slow
-        Thread {
+        // "offer" never blocks: if the queue is full the link is stuck, so tell the user instead of waiting
+        if (!commandQueue.offer(command)) {
+            Toast.makeText(this, "Link busy: '${command.trim()}' not sent", LENGTH_SHORT).show()
+        }
+    }
+
+    // The writer thread. It waits for a command, then takes everything else that piled up
+    // meanwhile (e.g. while the previous write was on the air), and sends the whole burst
+    // as ONE write, which usually means one RFCOMM packet. Order is never changed.
+    private fun writeCommands() {
+        val batch = ArrayList<String>()
+        while (!Thread.currentThread().isInterrupted) {
+            try {
+                batch.add(commandQueue.take()) // "take" sleeps until a command arrives
+            } catch (e: InterruptedException) {
+                break // The app is closing
+            }
+            commandQueue.drainTo(batch)
+            val bytes = coalesceCommands(batch).toByteArray()
+            batch.clear()
+
             try {
-                outputStream?.write(command.toByteArray())
+                outputStream?.write(bytes)
+                outputStream?.flush()
             } catch (e: IOException) {
                 e.printStackTrace()
                 runOnUiThread {
                     Toast.makeText(this, "Failed to send command: ${e.message}", LENGTH_SHORT).show()
                 }
             }
-        }.start()
+        }
+    }
+
+    // Joins a burst of commands into one string, in order. Only commands whose result does
+    // not depend on what is in between are merged, so the Pi ends up exactly where it would
+    // have with every command sent on its own:
+    //  - "r:1000\n" then "r:1500\n"  ->  "r:1500\n"   (a new absolute target replaces the old one)
+    //  - "r:1000\n" then "+" then "+" ->  "r:1200\n"   (+ / - right after a target become a new target)
+    // Everything else ("f", "d", "s", "x", ...) is kept as is: "f" "f" "d" is not the same as
+    // "f" when the duty is at 100 %, and a stop must never be dropped.
+    private fun coalesceCommands(commands: List<String>): String {
+        val out = StringBuilder()
+        var pendingTarget = -1 // An "r:" target not written into 'out' yet (-1 = none)
+
+        for (command in commands) {
+            val target = if (command.startsWith("r:")) command.removePrefix("r:").trim().toIntOrNull() else null
+            when {
+                target != null -> pendingTarget = target
+                pendingTarget >= 0 && command == "+" -> pendingTarget += RPM_STEP
+                pendingTarget >= 0 && command == "-" -> pendingTarget = maxOf(0, pendingTarget - RPM_STEP)
+                else -> {
+                    if (pendingTarget >= 0) out.append("r:$pendingTarget\n")
+                    pendingTarget = -1
+                    out.append(command)
+                }
+            }
+        }
+        if (pendingTarget >= 0) out.append("r:$pendingTarget\n")
+        return out.toString()
     }
 
     // --- CONNECTING ---
@@ -551,6 +782,13 @@ class MainActivity : AppCompatActivity() {
                 outputStream = socket.outputStream
                 inputStream = socket.inputStream
 
+                // Ask for binary telemetry frames instead of "RPM:" text lines.
+                // (An older Pi server ignores the 'b' and keeps sending text, which still works.)
+                // Commands left over from the last connection are not replayed to this one.
+                commandQueue.clear()
+                commandQueue.offer("b")
+                expectedFrameSeq = -1L
+
                 // Start ANOTHER thread to constantly listen for incoming data
                 readDataThread = Thread(this::readDataFromSocket)
                 readDataThread?.start()
@@ -579,22 +817,126 @@ class MainActivity : AppCompatActivity() {
 
     // --- RECEIVING DATA ---
     // This function runs forever in a background thread as long as we are connected.
+    // The Pi can send two kinds of data on the same stream:
+    //  - Text lines like "RPM:1200\n" or "CTRL:1\n" (plain ASCII, always below 0x80)
+    //  - Binary frames that start with the byte 0xA5 (see telemetry.h on the Pi)
+    // So we look at the first byte to know which one is coming.
     private fun readDataFromSocket() {
-        val reader = BufferedReader(InputStreamReader(inputStream!!))
+        val stream = inputStream!!
+        val buf = ByteArray(8192) // Bytes received but not yet decoded
+        var len = 0
+
         while (true) {
             try {
-                // "readLine()" BLOCKS. This means the code stops right here and waits
-                // until the Pi sends a full line of text (ending in \n).
-                val line = reader.readLine()
-                if (line != null) {
-                    // We got a message! Send it to the "Handler" so it can update the UI.
-                    handler.obtainMessage(MESSAGE_READ, line).sendToTarget()
-                } else {
-                    break // If line is null, the connection was broken.
+                // "read()" BLOCKS until the Pi sends something
+                val n = stream.read(buf, len, buf.size - len)
+                if (n < 0) break // Connection was broken
+                len += n
+
+                // Decode everything that is complete; keep partial data for the next read
+                var pos = 0
+                while (pos < len) {
+                    val used = if ((buf[pos].toInt() and 0xFF) == TELEM_MAGIC0) {
+                        decodeFrame(buf, pos, len)
+                    } else {
+                        decodeTextLine(buf, pos, len)
+                    }
+                    if (used == 0) break // Need more bytes
+                    pos += used
                 }
+                System.arraycopy(buf, pos, buf, 0, len - pos)
+                len -= pos
+                if (len == buf.size) len = 0 // Garbage that never ends a line: start over
             } catch (e: IOException) {
                 break // Error occurred (e.g., connection lost)
             }
         }
     }
+
+    // Text line starting at 'start'. Returns bytes used (0 = the newline has not arrived yet).
+    private fun decodeTextLine(buf: ByteArray, start: Int, end: Int): Int {
+        for (i in start until end) {
+            if (buf[i] == '\n'.code.toByte()) {
+                val line = String(buf, start, i - start, Charsets.US_ASCII).trimEnd('\r')
+                if (line.startsWith("RPM:")) {
+                    // Text telemetry of the default motor: logged here, timed by the phone's clock
+                    val rpmValue = line.removePrefix("RPM:").trim().toIntOrNull()
+                    if (rpmValue != null) {
+                        logSample(-1L, rpmValue, -1)
+                        chartRing.push(SystemClock.elapsedRealtime(), rpmValue, -1, -1)
+                        rpmChart.postInvalidateOnAnimation()
+                    } else {
+                        Log.e("RPM_LOG", "Failed to parse RPM: $line")
+                    }
+                }
+                handler.obtainMessage(MESSAGE_READ, line).sendToTarget()
+                return i - start + 1
+            }
+            if ((buf[i].toInt() and 0xFF) == TELEM_MAGIC0) {
+                return i - start // A frame starts mid-line: drop the broken line
+            }
+        }
+        return 0
+    }
+
+    // Binary frame starting at 'start'. Returns bytes used (0 = frame not complete yet).
+    // A frame with a bad header or CRC costs one byte, then we look for the next 0xA5.
+    private fun decodeFrame(buf: ByteArray, start: Int, end: Int): Int {
+        if (end - start < TELEM_HEADER_SIZE) return 0
+        val count = buf[start + 3].toInt() and 0xFF
+        if ((buf[start + 1].toInt() and 0xFF) != TELEM_MAGIC1 ||
+            (buf[start + 2].toInt() and 0xFF) != TELEM_VERSION ||
+            count == 0 || count > TELEM_MAX_SAMPLES) {
+            return 1
+        }
+
+        val bodyEnd = start + TELEM_HEADER_SIZE + count * TELEM_SAMPLE_SIZE
+        if (end - bodyEnd < 2) return 0
+        if (crc16(buf, start + 2, bodyEnd) != u16(buf, bodyEnd)) return 1
+
+        val frame = TelemetryFrame(u32(buf, start + 4), count)
+        var p = start + TELEM_HEADER_SIZE
+        for (i in 0 until count) {
+            frame.tickUs[i] = u32(buf, p)
+            frame.rpmRaw[i] = u16(buf, p + 4).toShort().toInt()
+            frame.rpmSmooth[i] = u16(buf, p + 6).toShort().toInt()
+            frame.targetRpm[i] = u16(buf, p + 8).toShort().toInt()
+            frame.dutyCenti[i] = u16(buf, p + 10)
+            frame.pidError[i] = u16(buf, p + 12).toShort().toInt()
+            frame.flags[i] = buf[p + 14].toInt() and 0xFF
+            frame.motor[i] = buf[p + 15].toInt() and 0xFF
+            // Every sample of our motor is logged and charted here, before the screen thread ever sees the frame
+            if (frame.motor[i] == motorId) {
+                logSample(frame.tickUs[i], frame.rpmSmooth[i], frame.targetRpm[i])
+                chartRing.push(chartTime(frame.tickUs[i]), frame.rpmSmooth[i], frame.targetRpm[i], frame.dutyCenti[i])
+            }
+            p += TELEM_SAMPLE_SIZE
+        }
+        rpmChart.postInvalidateOnAnimation() // Merged into the next screen refresh (safe from this thread)
+        handler.obtainMessage(MESSAGE_FRAME, frame).sendToTarget()
+        return bodyEnd + 2 - start
+    }
+
+    // Reader thread: Pi tick (wraps at 2^32 us) -> chart time in ms that keeps counting up.
+    private fun chartTime(tickUs: Long): Long {
+        if (chartLastTick >= 0) chartTimeUs += (tickUs - chartLastTick) and 0xFFFFFFFFL
+        chartLastTick = tickUs
+        return chartTimeUs / 1000
+    }
+
+    // Little-endian helpers (the Pi sends the low byte first)
+    private fun u16(b: ByteArray, i: Int): Int = (b[i].toInt() and 0xFF) or ((b[i + 1].toInt() and 0xFF) shl 8)
+    private fun u32(b: ByteArray, i: Int): Long = u16(b, i).toLong() or (u16(b, i + 2).toLong() shl 16)
+
+    // CRC-16/CCITT-FALSE, same as telem_crc16() on the Pi
+    private fun crc16(b: ByteArray, from: Int, to: Int): Int {
+        var crc = 0xFFFF
+        for (i in from until to) {
+            crc = crc xor ((b[i].toInt() and 0xFF) shl 8)
+            for (bit in 0 until 8) {
+                crc = if ((crc and 0x8000) != 0) ((crc shl 1) xor 0x1021) and 0xFFFF else (crc shl 1) and 0xFFFF
+            }
+        }
+        return crc
+    }
 }
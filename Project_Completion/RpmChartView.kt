@@ -0,0 +1,156 @@
+//Live RPM chart for MainActivity: target vs actual RPM and PWM duty
+package com.example.myapplication // <-- Same "Folder" as MainActivity.kt
+
+// --- IMPORTS ---
+import android.content.Context
+import android.graphics.Canvas
+import android.graphics.Color
+import android.graphics.Paint
+import android.graphics.Path
+import android.util.AttributeSet
+import android.view.View
+
+// --- CONSTANTS ---
+private const val CHART_WINDOW_MS = 30_000L // How much history the chart shows (the newest 30 seconds)
+private const val CHART_MIN_RPM_SCALE = 1000 // The RPM axis never shrinks below this
+private const val CHART_RPM_STEP = 500       // ... and grows in steps of this
+private const val CHART_SAFE_MARGIN = 1024   // Slots next to the writer that the chart never reads
+
+// --- DATA STRUCTURE ---
+// The newest samples for the chart, in plain arrays (no object per sample), like SampleRing
+// in MainActivity.kt. The socket reader thread writes, the screen thread only looks: the writer
+// simply overwrites the oldest slot, so it never waits, and the chart stays CHART_SAFE_MARGIN
+// slots away from where the writer is.
+class ChartRing(val capacity: Int) {
+    val timeMs = LongArray(capacity) // Pi clock (binary telemetry) or phone clock (text), in ms
+    val rpm = IntArray(capacity)
+    val target = IntArray(capacity)  // -1 = unknown (text telemetry only carries the RPM)
+    val duty = IntArray(capacity)    // PWM duty in 0.01 %, -1 = unknown
+    @Volatile var head = 0L          // Samples written so far (reader thread)
+
+    fun push(time: Long, rpmValue: Int, targetValue: Int, dutyValue: Int) {
+        val h = head
+        val i = index(h)
+        timeMs[i] = time
+        rpm[i] = rpmValue
+        target[i] = targetValue
+        duty[i] = dutyValue
+        head = h + 1 // Publishes the slot (a volatile write comes after the array stores)
+    }
+
+    fun index(pos: Long): Int = (pos and (capacity - 1).toLong()).toInt()
+}
+
+// The chart itself. It never draws once per sample: MainActivity asks for a redraw with
+// postInvalidateOnAnimation(), and Android merges every request until the next screen
+// refresh into ONE onDraw. onDraw then shrinks the window to one min/max pair per pixel
+// column ("min/max decimation"), so the cost depends on the screen width, not on how many
+// samples arrive. All buffers are allocated in onSizeChanged, none while drawing.
+class RpmChartView(context: Context, attrs: AttributeSet?) : View(context, attrs) {
+
+    var ring: ChartRing? = null      // Set by MainActivity
+
+    // Per pixel column: lowest and highest value of each line (NaN = no sample in this column)
+    private var rpmMin = FloatArray(0)
+    private var rpmMax = FloatArray(0)
+    private var targetMin = FloatArray(0)
+    private var targetMax = FloatArray(0)
+    private var dutyMin = FloatArray(0)
+    private var dutyMax = FloatArray(0)
+
+    private val rpmPath = Path()
+    private val targetPath = Path()
+    private val dutyPath = Path()
+
+    private val rpmPaint = linePaint(Color.rgb(0x4F, 0xC3, 0xF7))    // Actual RPM: light blue
+    private val targetPaint = linePaint(Color.rgb(0xFF, 0xB7, 0x4D)) // Target RPM: orange
+    private val dutyPaint = linePaint(Color.rgb(0x81, 0xC7, 0x84))   // PWM duty: green
+    private val gridPaint = Paint().apply { color = Color.DKGRAY; strokeWidth = 1f }
+    private val textPaint = Paint(Paint.ANTI_ALIAS_FLAG).apply {
+        color = Color.WHITE
+        textSize = 12f * resources.displayMetrics.scaledDensity
+    }
+
+    private fun linePaint(c: Int) = Paint(Paint.ANTI_ALIAS_FLAG).apply {
+        color = c
+        style = Paint.Style.STROKE
+        strokeWidth = 1.5f * resources.displayMetrics.density
+    }
+
+    override fun onSizeChanged(w: Int, h: Int, oldw: Int, oldh: Int) {
+        super.onSizeChanged(w, h, oldw, oldh)
+        rpmMin = FloatArray(w); rpmMax = FloatArray(w)
+        targetMin = FloatArray(w); targetMax = FloatArray(w)
+        dutyMin = FloatArray(w); dutyMax = FloatArray(w)
+    }
+
+    override fun onDraw(canvas: Canvas) {
+        super.onDraw(canvas)
+        val r = ring ?: return
+        val columns = rpmMin.size
+        if (columns == 0) return
+
+        // 1. DECIMATE: one pass over the samples in the window, newest first
+        rpmMin.fill(Float.NaN); rpmMax.fill(Float.NaN)
+        targetMin.fill(Float.NaN); targetMax.fill(Float.NaN)
+        dutyMin.fill(Float.NaN); dutyMax.fill(Float.NaN)
+        val head = r.head
+        val oldest = maxOf(0L, head - (r.capacity - CHART_SAFE_MARGIN))
+        var topRpm = CHART_MIN_RPM_SCALE
+        if (head > oldest) {
+            val endMs = r.timeMs[r.index(head - 1)]
+            val startMs = endMs - CHART_WINDOW_MS
+            var pos = head - 1
+            while (pos >= oldest) {
+                val i = r.index(pos)
+                val t = r.timeMs[i]
+                if (t < startMs || t > endMs) break // Older than the window (or from before a reconnect)
+                val col = ((t - startMs) * (columns - 1) / CHART_WINDOW_MS).toInt()
+                addToColumn(rpmMin, rpmMax, col, r.rpm[i].toFloat())
+                if (r.target[i] >= 0) addToColumn(targetMin, targetMax, col, r.target[i].toFloat())
+                if (r.duty[i] >= 0) addToColumn(dutyMin, dutyMax, col, r.duty[i] / 100f)
+                topRpm = maxOf(topRpm, r.rpm[i], r.target[i])
+                pos--
+            }
+        }
+        topRpm = (topRpm + CHART_RPM_STEP - 1) / CHART_RPM_STEP * CHART_RPM_STEP // Round up to a step
+
+        // 2. DRAW: grid, the three lines (RPM on the left scale, duty 0 - 100 % over the full height), labels
+        val h = height.toFloat()
+        for (k in 1..3) canvas.drawLine(0f, h * k / 4, width.toFloat(), h * k / 4, gridPaint)
+        buildPath(dutyPath, dutyMin, dutyMax, h / 100f)
+        buildPath(targetPath, targetMin, targetMax, h / topRpm)
+        buildPath(rpmPath, rpmMin, rpmMax, h / topRpm)
+        canvas.drawPath(dutyPath, dutyPaint)
+        canvas.drawPath(targetPath, targetPaint)
+        canvas.drawPath(rpmPath, rpmPaint)
+
+        val line = textPaint.textSize * 1.2f
+        canvas.drawText("$topRpm RPM", 4f, line, textPaint)
+        textPaint.color = rpmPaint.color;    canvas.drawText("RPM", 4f, h - 4f, textPaint)
+        textPaint.color = targetPaint.color; canvas.drawText("Target", 4f + line * 3, h - 4f, textPaint)
+        textPaint.color = dutyPaint.color;   canvas.drawText("Duty %", 4f + line * 7, h - 4f, textPaint)
+        textPaint.color = Color.WHITE
+    }
+
+    private fun addToColumn(min: FloatArray, max: FloatArray, col: Int, v: Float) {
+        if (min[col].isNaN() || v < min[col]) min[col] = v
+        if (max[col].isNaN() || v > max[col]) max[col] = v
+    }
+
+    // One line through every column that has samples: down to its min and up to its max, so
+    // a spike shorter than a pixel is still visible. Empty columns (slow text telemetry has
+    // many) are bridged by a straight line to the next sample.
+    private fun buildPath(path: Path, min: FloatArray, max: FloatArray, scale: Float) {
+        path.rewind()
+        val h = height.toFloat()
+        var started = false
+        for (col in min.indices) {
+            if (min[col].isNaN()) continue
+            val x = col.toFloat()
+            if (!started) path.moveTo(x, h - min[col] * scale) else path.lineTo(x, h - min[col] * scale)
+            path.lineTo(x, h - max[col] * scale)
+            started = true
+        }
+    }
+}
@@ -7,6 +7,22 @@
 # This script runs in the background to automatically
 # accept any Bluetooth pairing request without a PIN.
 # This is required to pass the "headless" re-pairing test.
+#
+# It also gets the adapter ready at boot (this replaces fix_bluetooth.sh and its
+# "sleep 20"). Everything is driven by D-Bus events, so nothing waits longer than needed:
+#   1. Wait for bluetoothd to appear on the system bus (NameOwnerChanged)
+#   2. Wait for the adapter (InterfacesAdded) and for Powered = true (PropertiesChanged)
+#   3. Remove the stale bonds (the phone forgot the Pi, but the Pi still remembers the phone)
+#   4. Register as the pairing agent, then tell systemd we are ready (parmco-agent.service)
+# If bluetoothd restarts, steps 2 - 4 run again.
+#
+# USAGE:
+# bt_agent.py [MAC ...]   Bonds to remove at startup (default: STALE_BONDS below)
+
+import os
+import socket
+import sys
+import time
 
 import dbus
 import dbus.service
@@ -17,6 +33,18 @@ AGENT_PATH = "/parmco/agent"
 AGENT_INTERFACE = "org.bluez.Agent1"
 CAPABILITY = "NoInputNoOutput" # Auto-accept, no PIN
 
+BLUEZ = "org.bluez"
+ADAPTER_INTERFACE = "org.bluez.Adapter1"
+DEVICE_INTERFACE = "org.bluez.Device1"
+PROPERTIES_INTERFACE = "org.freedesktop.DBus.Properties"
+OBJECT_MANAGER_INTERFACE = "org.freedesktop.DBus.ObjectManager"
+
+# --- ⬇️ EDIT THIS LINE ⬇️ ---
+STALE_BONDS = ["AC:D6:18:33:BE:6A"]
+# --- ⬆️ EDIT THIS LINE ⬆️ ---
+
+START_TIME = time.monotonic()
+
 class BT_Agent(dbus.service.Object):
     @dbus.service.method(AGENT_INTERFACE, in_signature="", out_signature="")
     def Release(self):
@@ -39,22 +67,109 @@ class BT_Agent(dbus.service.Object):
         # Auto-authorize any connection
         return
 
+def sd_notify(state):
+    # The sd_notify protocol is one datagram to $NOTIFY_SOCKET; nothing to do outside systemd
+    address = os.environ.get("NOTIFY_SOCKET")
+    if not address:
+        return
+    if address.startswith("@"):
+        address = "\0" + address[1:] # Abstract namespace
+    with socket.socket(socket.AF_UNIX, socket.SOCK_DGRAM) as sock:
+        sock.connect(address)
+        sock.sendall(state.encode())
+
+class AdapterSetup:
+    """Waits for bluetoothd and its adapter, then cleans up bonds and registers the agent."""
+
+    def __init__(self, bus, stale_bonds):
+        self.bus = bus
+        self.stale_bonds = [mac.upper() for mac in stale_bonds]
+        self.agent = BT_Agent(bus, AGENT_PATH)
+        self.adapter_path = None
+        self.done = False       # Steps 3 - 4 finished for the current bluetoothd
+        self.notified = False   # READY=1 is only sent once
+
+        bus.add_signal_receiver(self.on_interfaces_added, dbus_interface=OBJECT_MANAGER_INTERFACE,
+                                signal_name="InterfacesAdded", bus_name=BLUEZ)
+        bus.add_signal_receiver(self.on_properties_changed, dbus_interface=PROPERTIES_INTERFACE,
+                                signal_name="PropertiesChanged", bus_name=BLUEZ, path_keyword="path")
+        bus.watch_name_owner(BLUEZ, self.on_bluez_owner)
+
+    def on_bluez_owner(self, owner):
+        # Called at once with the current owner ("" = bluetoothd not running yet), then on every change
+        self.adapter_path = None
+        self.done = False
+        if not owner:
+            print("Waiting for bluetoothd...")
+            return
+        manager = dbus.Interface(self.bus.get_object(BLUEZ, "/"), OBJECT_MANAGER_INTERFACE)
+        for path, interfaces in manager.GetManagedObjects().items():
+            if ADAPTER_INTERFACE in interfaces:
+                self.on_adapter(path, interfaces[ADAPTER_INTERFACE])
+                return
+        print("Waiting for a Bluetooth adapter...")
+
+    def on_interfaces_added(self, path, interfaces):
+        if self.adapter_path is None and ADAPTER_INTERFACE in interfaces:
+            self.on_adapter(path, interfaces[ADAPTER_INTERFACE])
+
+    def on_adapter(self, path, properties):
+        self.adapter_path = path
+        if properties.get("Powered", False):
+            self.on_ready()
+            return
+        # main.conf has AutoEnable=true, so bluetoothd powers it up; ask anyway in case it does not
+        print(f"Waiting for {path} to power on...")
+        adapter = dbus.Interface(self.bus.get_object(BLUEZ, path), PROPERTIES_INTERFACE)
+        try:
+            adapter.Set(ADAPTER_INTERFACE, "Powered", dbus.Boolean(True))
+        except dbus.DBusException as e:
+            print(f"Could not power on the adapter yet: {e}")
+
+    def on_properties_changed(self, interface, changed, invalidated, path=None):
+        if interface == ADAPTER_INTERFACE and path == self.adapter_path and changed.get("Powered", False):
+            self.on_ready()
+
+    def on_ready(self):
+        if self.done:
+            return
+        self.done = True
+        self.remove_stale_bonds()
+
+        manager = dbus.Interface(self.bus.get_object(BLUEZ, "/org/bluez"), "org.bluez.AgentManager1")
+        manager.RegisterAgent(AGENT_PATH, CAPABILITY)
+        manager.RequestDefaultAgent(AGENT_PATH)
+
+        with open("/proc/uptime") as f:
+            boot_s = float(f.read().split()[0])
+        elapsed = time.monotonic() - START_TIME
+        print(f"Bluetooth Pairing Agent started ({self.adapter_path} ready {elapsed:.2f} s after start, {boot_s:.1f} s after boot).")
+        if not self.notified:
+            sd_notify(f"READY=1\nSTATUS=Adapter {self.adapter_path} ready after {elapsed:.2f} s")
+            self.notified = True
+
+    def remove_stale_bonds(self):
+        manager = dbus.Interface(self.bus.get_object(BLUEZ, "/"), OBJECT_MANAGER_INTERFACE)
+        adapter = dbus.Interface(self.bus.get_object(BLUEZ, self.adapter_path), ADAPTER_INTERFACE)
+        for path, interfaces in manager.GetManagedObjects().items():
+            device = interfaces.get(DEVICE_INTERFACE)
+            if device is None or str(device.get("Adapter", "")) != self.adapter_path:
+                continue
+            if str(device.get("Address", "")).upper() in self.stale_bonds:
+                adapter.RemoveDevice(path)
+                print(f"Removed stale bond {device['Address']}")
+
 def main():
     dbus.mainloop.glib.DBusGMainLoop(set_as_default=True)
     bus = dbus.SystemBus()
-    
+
     try:
-        agent = BT_Agent(bus, AGENT_PATH)
-        
-        manager = dbus.Interface(bus.get_object("org.bluez", "/org/bluez"), "org.bluez.AgentManager1")
-        manager.RegisterAgent(AGENT_PATH, CAPABILITY)
-        manager.RequestDefaultAgent(AGENT_PATH)
-        
-        print("Bluetooth Pairing Agent started.")
+        setup = AdapterSetup(bus, sys.argv[1:] or STALE_BONDS)
         GLib.MainLoop().run()
-        
+
     except Exception as e:
         print(f"Failed to start agent: {e}")
+        sys.exit(1)
 
 if __name__ == "__main__":
     main()
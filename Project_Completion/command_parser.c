@@ -0,0 +1,214 @@
+/*
+ * ======================================================================================
+ * PROJECT:       PARMCO (Phone APP RP4 Motor Control)
+ * FILE:          command_parser.c
+ * AUTHOR:        Group 1
+ *
+ * DESCRIPTION:
+ * Table-driven command decoder (see command_parser.h).
+ * ======================================================================================
+ */
+
+#include <string.h>
+#include "command_parser.h"
+#include "latency.h"
+#include "telemetry.h"
+
+#define CMD_DIGITS_MAX 9               // Longest "r:" / "@" number (fits int32); extra digits are ignored
+#define CMD_LENGTH_DIGITS 4            // Longest '#' length; more is malformed
+
+// parse_byte() results
+#define PARSE_MORE 0
+#define PARSE_END  1                   // The batch ends after this byte (CMD_TAKE_CONTROL)
+
+static const unsigned char class_table[256] = {
+    ['s'] = CMD_CLASS_MOTOR, ['x'] = CMD_CLASS_MOTOR, ['c'] = CMD_CLASS_MOTOR, ['v'] = CMD_CLASS_MOTOR,
+    ['f'] = CMD_CLASS_MOTOR, ['d'] = CMD_CLASS_MOTOR, ['a'] = CMD_CLASS_MOTOR, ['m'] = CMD_CLASS_MOTOR,
+    ['+'] = CMD_CLASS_MOTOR, ['-'] = CMD_CLASS_MOTOR, [CMD_CALIBRATE] = CMD_CLASS_MOTOR,
+    [CMD_TARGET] = CMD_CLASS_ARG, [CMD_PROFILE] = CMD_CLASS_ARG, [CMD_TUNE] = CMD_CLASS_ARG,
+    [CMD_SELECT_MOTOR] = CMD_CLASS_SELECT,
+    [TELEM_CMD_BINARY] = CMD_CLASS_CLIENT, [TELEM_CMD_TEXT] = CMD_CLASS_CLIENT,
+    [LAT_CMD_REPORT] = CMD_CLASS_CLIENT, [CMD_STATS] = CMD_CLASS_CLIENT,
+    [CMD_TAKE_CONTROL] = CMD_CLASS_CLIENT, [TP_CMD] = CMD_CLASS_CLIENT_ARG,
+    [CMD_FRAME] = CMD_CLASS_FRAME,
+};
+
+int cmd_class(char c) {
+    return class_table[(unsigned char)c];
+}
+
+// --- BATCH ---
+
+static int add_op(CmdBatch *b, char cmd, int32_t value) {
+    CmdOp *op = &b->ops[b->count++];
+    op->cmd = cmd;
+    op->value = value;
+    op->text = -1;
+    return (cmd == CMD_TAKE_CONTROL) ? PARSE_END : PARSE_MORE;
+}
+
+static void add_text(CmdBatch *b, char cmd, const char *text, int len) {
+    CmdOp *op = &b->ops[b->count++];
+    op->cmd = cmd;
+    op->value = 0;
+    op->text = (int16_t)b->text_used;
+    memcpy(b->text + b->text_used, text, (size_t)len);
+    b->text[b->text_used + len] = '\0';
+    b->text_used += len + 1;
+}
+
+// --- DECODER ---
+
+static int is_digit(char c) { return c >= '0' && c <= '9'; }
+
+static void add_digit(CmdParser *ps, char c) {
+    if (ps->digits < CMD_DIGITS_MAX) ps->number = ps->number * 10 + (uint32_t)(c - '0');
+    ps->digits++;
+}
+
+/*
+ * FUNCTION: decode_frame
+ * ----------------------
+ * A complete '#' payload: <command><args>. Single-character commands take no
+ * args, 'r' and '@' take digits only, 'p', 'g' and 'T' take any text but NUL.
+ */
+static int decode_frame(CmdParser *ps, CmdBatch *b) {
+    if (ps->text_len <= 0) { b->rejected++; return PARSE_MORE; }
+
+    char cmd = ps->text[0];
+    const char *args = ps->text + 1;
+    int len = ps->text_len - 1;
+
+    switch (cmd_class(cmd)) {
+        case CMD_CLASS_MOTOR:
+        case CMD_CLASS_CLIENT:
+            if (len == 0) return add_op(b, cmd, 0);
+            break;
+        case CMD_CLASS_ARG:
+        case CMD_CLASS_SELECT:
+        case CMD_CLASS_CLIENT_ARG:
+            if (cmd == CMD_PROFILE || cmd == CMD_TUNE || cmd == TP_CMD) {
+                if (memchr(args, '\0', (size_t)len) == NULL) { add_text(b, cmd, args, len); return PARSE_MORE; }
+                break;
+            }
+            if (len > 0 && len <= CMD_DIGITS_MAX) {
+                uint32_t v = 0;
+                int i;
+                for (i = 0; i < len && is_digit(args[i]); i++) v = v * 10 + (uint32_t)(args[i] - '0');
+                if (i == len) return add_op(b, cmd, (int32_t)v);
+            }
+            break;
+    }
+    b->rejected++;
+    return PARSE_MORE;
+}
+
+/*
+ * FUNCTION: parse_byte
+ * --------------------
+ * One step of the state machine. A byte that ends an "r:" / "@" number or
+ * follows an 'r' / 'p' / 'g' / 'T' without ':' is a command of its own and goes
+ * through CMD_STATE_NORMAL again, as in "@2s" or "r:1500x".
+ */
+static int parse_byte(CmdParser *ps, char c, CmdBatch *b) {
+    switch (ps->state) {
+        case CMD_STATE_NORMAL:
+            switch (cmd_class(c)) {
+                case CMD_CLASS_MOTOR:
+                case CMD_CLASS_CLIENT:
+                    return add_op(b, c, 0);
+                case CMD_CLASS_ARG:
+                case CMD_CLASS_CLIENT_ARG:
+                    ps->state = CMD_STATE_WAIT_COLON;
+                    ps->pending = c;
+                    break;
+                case CMD_CLASS_SELECT:
+                    ps->state = CMD_STATE_READ_MOTOR;
+                    ps->number = 0;
+                    ps->digits = 0;
+                    break;
+                case CMD_CLASS_FRAME:
+                    ps->state = CMD_STATE_READ_LENGTH;
+                    ps->number = 0;
+                    ps->digits = 0;
+                    break;
+            }
+            return PARSE_MORE;
+
+        case CMD_STATE_WAIT_COLON:
+            if (c == ':') {
+                ps->state = (ps->pending == CMD_TARGET) ? CMD_STATE_READ_NUM : CMD_STATE_READ_TEXT;
+                ps->number = 0;
+                ps->digits = 0;
+                ps->text_len = 0;
+                return PARSE_MORE;
+            }
+            // Not a colon: treat 'r' / 'p' / 'g' / 'T' as a glitch
+            ps->state = CMD_STATE_NORMAL;
+            return parse_byte(ps, c, b);
+
+        case CMD_STATE_READ_NUM:
+        case CMD_STATE_READ_MOTOR:
+            if (is_digit(c)) { add_digit(ps, c); return PARSE_MORE; }
+            if (ps->digits > 0) add_op(b, (ps->state == CMD_STATE_READ_NUM) ? CMD_TARGET : CMD_SELECT_MOTOR, (int32_t)ps->number);
+            ps->state = CMD_STATE_NORMAL;
+            if (c == '\n' || c == '\r') return PARSE_MORE;
+            return parse_byte(ps, c, b);
+
+        case CMD_STATE_READ_TEXT:
+            if (c != '\n' && c != '\r') {
+                if (ps->text_len >= 0 && ps->text_len < CMD_TEXT_MAX) ps->text[ps->text_len++] = c;
+                else ps->text_len = -1; // Too long: swallow the rest of the line
+                return PARSE_MORE;
+            }
+            if (ps->text_len < 0) b->rejected++;
+            else add_text(b, ps->pending, ps->text, ps->text_len);
+            ps->state = CMD_STATE_NORMAL;
+            return PARSE_MORE;
+
+        case CMD_STATE_READ_LENGTH:
+            if (is_digit(c)) {
+                ps->number = (ps->digits < CMD_LENGTH_DIGITS) ? ps->number * 10 + (uint32_t)(c - '0') : UINT32_MAX;
+                ps->digits++;
+                return PARSE_MORE;
+            }
+            ps->state = CMD_STATE_NORMAL;
+            // A payload longer than CMD_TEXT_MAX would be discarded anyway: reject it here, or the frame would swallow that many bytes
+            if (c != ':' || ps->digits == 0 || ps->number == 0 || ps->digits > CMD_LENGTH_DIGITS || ps->number > CMD_TEXT_MAX) {
+                b->rejected++;
+                return (c == ':') ? PARSE_MORE : parse_byte(ps, c, b);
+            }
+            ps->state = CMD_STATE_READ_FRAME;
+            ps->frame_left = ps->number;
+            ps->text_len = 0;
+            return PARSE_MORE;
+
+        case CMD_STATE_READ_FRAME:
+            ps->text[ps->text_len++] = c; // frame_left <= CMD_TEXT_MAX (checked at the ':')
+            if (--ps->frame_left > 0) return PARSE_MORE;
+            ps->state = CMD_STATE_NORMAL;
+            return decode_frame(ps, b);
+    }
+    return PARSE_MORE;
+}
+
+int cmd_parse(CmdParser *ps, const char *data, int len, CmdBatch *batch) {
+    int i = 0;
+
+    batch->count = 0;
+    batch->text_used = 0;
+    batch->rejected = 0;
+
+    // A byte adds at most two commands, or one text; stop while both still fit
+    while (i < len && batch->count <= CMD_BATCH_MAX - 2 && CMD_BATCH_TEXT - batch->text_used >= CMD_TEXT_MAX + 1) {
+        if (parse_byte(ps, data[i++], batch) == PARSE_END) break;
+    }
+    return i;
+}
+
+void cmd_finish(CmdParser *ps, CmdBatch *batch) {
+    if ((ps->state == CMD_STATE_READ_NUM || ps->state == CMD_STATE_READ_MOTOR) && ps->digits > 0 && batch->count < CMD_BATCH_MAX) {
+        add_op(batch, (ps->state == CMD_STATE_READ_NUM) ? CMD_TARGET : CMD_SELECT_MOTOR, (int32_t)ps->number);
+    }
+    ps->state = CMD_STATE_NORMAL;
+}
@@ -0,0 +1,126 @@
+/*
+ * ======================================================================================
+ * PROJECT:       PARMCO (Phone APP RP4 Motor Control)
+ * FILE:          command_parser.h
+ * AUTHOR:        Group 1
+ *
+ * DESCRIPTION:
+ * Command decoder for parmco_server. cmd_parse() runs over a whole read()
+ * buffer in one pass and turns it into a CmdBatch of decoded commands; it
+ * never touches motor state. The server then applies the batch as one
+ * transaction (state_lock held once, outputs written once at the end), so a
+ * burst like "csr:1500\n" cannot show the control loop, or the pins, a
+ * half-applied state.
+ *
+ * GRAMMAR (unchanged from the byte-at-a-time parser):
+ *   s x c v f d a m + - C     Single-character motor commands
+ *   r:<rpm>                   Target; ends at the first non-digit (usually '\n')
+ *   p:<segments>\n            Setpoint profile (setpoint_profile.h)
+ *   g:<key>=<value>,...\n     PID tuning (pid.h); "g:\n" only reports
+ *   @<id>                     Select the motor the following commands go to
+ *   b t L ? k                 Per-client commands (format, reports, take control)
+ *   T:<key>=<value>,...\n     Per-client telemetry policy (telemetry_policy.h)
+ * plus, optionally, LENGTH-PREFIXED commands:
+ *   #<n>:<command><args>      The n bytes after ':' are one command, e.g.
+ *                             "#5:r1500", "#3:@12", "#1:s" or "#15:pl1500,2000;s0,0".
+ *                             n is 1 - CMD_TEXT_MAX; a longer prefix is rejected at
+ *                             the ':' and the bytes after it are parsed as usual.
+ *                             No terminator is needed, the text of 'p' / 'g' may
+ *                             hold newlines, and a command this server does not
+ *                             know is skipped whole instead of byte by byte.
+ * Bytes that are not part of the grammar (spaces, unknown letters) are skipped.
+ *
+ * The parser state carries over between buffers, so any command may be split
+ * across reads (or WebSocket messages) at any byte.
+ * ======================================================================================
+ */
+
+#ifndef COMMAND_PARSER_H
+#define COMMAND_PARSER_H
+
+#include <stdint.h>
+#include "setpoint_profile.h"
+#include "telemetry_policy.h"
+
+#define CMD_SELECT_MOTOR '@'
+#define CMD_TARGET 'r'
+#define CMD_PROFILE 'p'
+#define CMD_TUNE 'g'
+#define CMD_CALIBRATE 'C'
+#define CMD_TAKE_CONTROL 'k'          // Claim the control token (only if nobody holds it)
+#define CMD_STATS '?'                 // Send the counter snapshot (any client)
+#define CMD_FRAME '#'                 // Length-prefixed command
+
+#define CMD_TEXT_MAX PROFILE_TEXT_MAX // Longest "p:" / "g:" line, and longest '#' payload
+#define CMD_BATCH_MAX 32              // Commands per batch (cmd_parse() stops early when full)
+#define CMD_BATCH_TEXT (2 * (CMD_TEXT_MAX + 1)) // Room for the text of two "p:" / "g:" lines
+
+// Byte classes (cmd_class())
+#define CMD_CLASS_NONE   0            // Not a command: skipped
+#define CMD_CLASS_MOTOR  1            // Single-character motor command
+#define CMD_CLASS_ARG    2            // Takes an argument after ':' ('r', 'p', 'g')
+#define CMD_CLASS_SELECT 3            // '@'
+#define CMD_CLASS_CLIENT 4            // Handled per client, outside the motor transaction
+#define CMD_CLASS_FRAME  5            // '#'
+#define CMD_CLASS_CLIENT_ARG 6        // Per client, with a text argument after ':' ('T')
+
+typedef enum {
+    CMD_STATE_NORMAL,                 // Between commands
+    CMD_STATE_WAIT_COLON,             // Saw 'r', 'p', 'g' or 'T', waiting for ':'
+    CMD_STATE_READ_NUM,               // "r:" digits
+    CMD_STATE_READ_MOTOR,             // "@" digits
+    CMD_STATE_READ_TEXT,              // "p:" / "g:" / "T:" line until the newline
+    CMD_STATE_READ_LENGTH,            // "#" digits until ':'
+    CMD_STATE_READ_FRAME,             // The n payload bytes of a '#' command
+} CmdState;
+
+typedef struct {
+    CmdState state;
+    char pending;                     // Command waiting for its ':' ('r', 'p', 'g' or 'T')
+    uint32_t number;                  // Digits so far ("r:", "@", "#")
+    int digits;
+    char text[CMD_TEXT_MAX + 1];      // "p:" / "g:" / '#' payload so far
+    int text_len;                     // -1 = too long, discarded at the end
+    uint32_t frame_left;              // '#' payload bytes still to come
+    int motor;                        // Owned by the caller (parmco_server: index into motors[])
+} CmdParser;
+
+typedef struct {
+    char cmd;                         // Command byte: 'r' = target, '@' = select, 'p' / 'g' = text, ...
+    int32_t value;                    // 'r': RPM, '@': motor ID
+    int16_t text;                     // 'p' / 'g' / 'T': offset of the NUL-terminated payload in CmdBatch.text
+} CmdOp;
+
+typedef struct {
+    int count;
+    CmdOp ops[CMD_BATCH_MAX];
+    int text_used;
+    char text[CMD_BATCH_TEXT];
+    uint32_t rejected;                // Malformed, unknown or too long, skipped (the caller logs it)
+} CmdBatch;
+
+/*
+ * FUNCTION: cmd_class
+ * -------------------
+ * CMD_CLASS_* of a command byte (one table lookup).
+ */
+int cmd_class(char c);
+
+/*
+ * FUNCTION: cmd_parse
+ * -------------------
+ * Decodes up to 'len' bytes into 'batch' (cleared first). Returns the bytes
+ * consumed: all of them, or fewer if the batch filled up or a CMD_TAKE_CONTROL
+ * ended it (the caller applies the batch and calls again for the rest).
+ */
+int cmd_parse(CmdParser *ps, const char *data, int len, CmdBatch *batch);
+
+/*
+ * FUNCTION: cmd_finish
+ * --------------------
+ * End of a self-contained message (a shared-memory command): completes a
+ * pending "r:<digits>" or "@<digits>" that has no terminator yet.
+ */
+void cmd_finish(CmdParser *ps, CmdBatch *batch);
+
+#endif
@@ -0,0 +1,101 @@
+/*
+ * ======================================================================================
+ * PROJECT:       PARMCO (Phone APP RP4 Motor Control)
+ * FILE:          command_parser_check.c
+ * AUTHOR:        Group 1
+ *
+ * DESCRIPTION:
+ * Regression check for the command decoder (command_parser.h), no hardware
+ * needed. Each case feeds one client's byte stream through cmd_parse(), in
+ * one buffer and again one byte at a time, and compares the decoded
+ * commands and the reject count with what the grammar says. The cases
+ * focus on the '#' length prefix: an overlong or oversized prefix must be
+ * rejected at the ':' and must not swallow the commands that follow it
+ * (a stop from the controller has to get through).
+ *
+ * USAGE:
+ * make parser-check       (exit status 1 if a case fails)
+ * ======================================================================================
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "command_parser.h"
+
+#define DECODED_MAX (CMD_TEXT_MAX + 64) // Longest decoded form of a case
+
+static int failures = 0;
+
+/*
+ * FUNCTION: decode
+ * ----------------
+ * Runs 'len' bytes through a fresh parser in 'chunk'-byte reads and writes
+ * the commands as text: one character per command, "r<n>" / "@<n>" for
+ * numbers, "<cmd>{<text>}" for text commands. Returns the rejects.
+ */
+static uint32_t decode(const char *input, int len, int chunk, char *out, size_t cap) {
+    CmdParser ps;
+    CmdBatch batch;
+    uint32_t rejected = 0;
+    size_t used = 0;
+
+    memset(&ps, 0, sizeof(ps));
+    out[0] = '\0';
+    for (int pos = 0; pos < len; ) {
+        int n = (len - pos < chunk) ? len - pos : chunk;
+        int done = cmd_parse(&ps, input + pos, n, &batch);
+        pos += done;
+        rejected += batch.rejected;
+        for (int i = 0; i < batch.count && used < cap; i++) {
+            const CmdOp *op = &batch.ops[i];
+            int w;
+            if (op->text >= 0) w = snprintf(out + used, cap - used, "%c{%s}", op->cmd, batch.text + op->text);
+            else if (op->cmd == CMD_TARGET || op->cmd == CMD_SELECT_MOTOR) w = snprintf(out + used, cap - used, "%c%d", op->cmd, op->value);
+            else w = snprintf(out + used, cap - used, "%c", op->cmd);
+            used += (w > 0) ? (size_t)w : 0;
+        }
+    }
+    return rejected;
+}
+
+static void check(const char *name, const char *input, int len, const char *expect, uint32_t expect_rejected) {
+    static const int chunks[] = { 4096, 1 };
+
+    for (int k = 0; k < 2; k++) {
+        char got[DECODED_MAX];
+        uint32_t rejected = decode(input, len, chunks[k], got, sizeof(got));
+        int ok = (strcmp(got, expect) == 0 && rejected == expect_rejected);
+        printf("%-4s %-32s %-6s got \"%.40s\" rejected %u (want \"%.40s\", %u)\n", ok ? "ok" : "FAIL", name,
+               (chunks[k] == 1) ? "bytes" : "buffer", got, rejected, expect, expect_rejected);
+        if (!ok) failures++;
+    }
+}
+
+#define CHECK(name, input, expect, rejected) check(name, input, (int)sizeof(input) - 1, expect, rejected)
+
+int main(void) {
+    static char longest[CMD_TEXT_MAX + 16], too_long[CMD_TEXT_MAX + 16];
+
+    CHECK("plain commands", "scr:1500\nx", "scr1500x", 0);
+    CHECK("framed commands", "#5:r1500#3:@12#1:s", "r1500@12s", 0);
+    CHECK("framed profile with newline", "#9:pl1500,\n2", "p{l1500,\n2}", 0);
+    CHECK("overlong prefix", "#12345:ssr:100\n", "ssr100", 1);
+    CHECK("very long prefix", "#99999999999:x", "x", 1);
+    CHECK("oversized prefix", "#9999:s", "s", 1);
+    CHECK("zero length", "#0:s", "s", 1);
+    CHECK("no colon", "#5s", "s", 1);
+
+    // Exactly CMD_TEXT_MAX payload bytes is the largest frame accepted, one more is rejected
+    int n = snprintf(longest, sizeof(longest), "#%d:g", CMD_TEXT_MAX);
+    memset(longest + n, 'k', CMD_TEXT_MAX - 1);
+    longest[n + CMD_TEXT_MAX - 1] = 's';
+    char expect[DECODED_MAX];
+    snprintf(expect, sizeof(expect), "g{%.*s}s", CMD_TEXT_MAX - 1, longest + n);
+    check("largest frame, then a stop", longest, n + CMD_TEXT_MAX, expect, 0);
+
+    n = snprintf(too_long, sizeof(too_long), "#%d:x", CMD_TEXT_MAX + 1);
+    check("one byte over the largest frame", too_long, n, "x", 1);
+
+    if (failures > 0) printf("%d case(s) failed\n", failures);
+    return failures > 0 ? 1 : 0;
+}
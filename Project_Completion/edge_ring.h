@@ -0,0 +1,94 @@
+/*
+ * ======================================================================================
+ * PROJECT:       PARMCO (Phone APP RP4 Motor Control)
+ * FILE:          edge_ring.h
+ * AUTHOR:        Group 1
+ *
+ * DESCRIPTION:
+ * Lock-free single-producer / single-consumer ring of sensor edge events.
+ * The producer is the pigpio callback thread (rpm_callback); the consumer is
+ * the real-time control thread, which drains all pending edges once per tick.
+ *
+ * - No locks and no syscalls on either side (C11 acquire/release atomics only).
+ * - Nothing is lost between "read count" and "reset count" like the old
+ *   revolution_count++ / revolution_count = 0 pair.
+ * - If the consumer falls more than EDGE_RING_SIZE events behind, new edges are
+ *   dropped (never overwritten) and counted in 'dropped'.
+ * ======================================================================================
+ */
+
+#ifndef EDGE_RING_H
+#define EDGE_RING_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+
+#define EDGE_RING_SIZE 1024  // Must be a power of two (~1.7 s of edges at 12k RPM)
+#define EDGE_RING_MASK (EDGE_RING_SIZE - 1)
+#define CACHE_LINE 64
+
+// One sensor transition as reported by pigpio
+typedef struct {
+    uint32_t tick;   // pigpio tick (microseconds, wraps every ~72 minutes)
+    uint32_t level;  // 1 = rising edge, 0 = falling edge
+} EdgeEvent;
+
+// head/tail live on separate cache lines so producer and consumer do not false-share
+typedef struct {
+    _Atomic uint32_t head;               // Next slot to write (owned by producer)
+    char pad_head[CACHE_LINE - sizeof(uint32_t)];
+    _Atomic uint32_t tail;               // Next slot to read (owned by consumer)
+    char pad_tail[CACHE_LINE - sizeof(uint32_t)];
+    _Atomic uint32_t dropped;            // Edges lost because the ring was full
+    EdgeEvent events[EDGE_RING_SIZE];
+} EdgeRing;
+
+/*
+ * FUNCTION: edge_ring_push
+ * ------------------------
+ * Producer side. Returns 1 if the event was queued, 0 if the ring was full.
+ */
+static inline int edge_ring_push(EdgeRing *r, uint32_t tick, uint32_t level) {
+    uint32_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+
+    if (head - tail >= EDGE_RING_SIZE) {
+        atomic_fetch_add_explicit(&r->dropped, 1, memory_order_relaxed);
+        return 0;
+    }
+
+    r->events[head & EDGE_RING_MASK].tick = tick;
+    r->events[head & EDGE_RING_MASK].level = level;
+    atomic_store_explicit(&r->head, head + 1, memory_order_release); // Publish the slot
+    return 1;
+}
+
+/*
+ * FUNCTION: edge_ring_pop_batch
+ * -----------------------------
+ * Consumer side. Copies up to 'max' pending events into 'out' and returns
+ * how many were copied. A single tail update releases the whole batch.
+ */
+static inline int edge_ring_pop_batch(EdgeRing *r, EdgeEvent *out, int max) {
+    uint32_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&r->head, memory_order_acquire);
+    uint32_t avail = head - tail;
+    int n = (avail < (uint32_t)max) ? (int)avail : max;
+
+    for (int i = 0; i < n; i++) {
+        out[i] = r->events[(tail + i) & EDGE_RING_MASK];
+    }
+    atomic_store_explicit(&r->tail, tail + n, memory_order_release); // Hand slots back
+    return n;
+}
+
+/*
+ * FUNCTION: edge_ring_dropped
+ * ---------------------------
+ * Total number of edges dropped so far because the ring was full.
+ */
+static inline uint32_t edge_ring_dropped(EdgeRing *r) {
+    return atomic_load_explicit(&r->dropped, memory_order_relaxed);
+}
+
+#endif // EDGE_RING_H
@@ -0,0 +1,189 @@
+/*
+ * ======================================================================================
+ * PROJECT:       PARMCO (Phone APP RP4 Motor Control)
+ * FILE:          feedforward.c
+ * AUTHOR:        Group 1
+ *
+ * DESCRIPTION:
+ * Calibration sweep, table building / lookup and the table file
+ * (see feedforward.h).
+ * ======================================================================================
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <unistd.h>
+#include "feedforward.h"
+
+#define FF_LINE_MAX 128
+
+// --- CALIBRATION SWEEP ---
+
+static void begin_point(FfSweep *s) {
+    s->tick = 0;
+    s->samples = 0;
+    s->sum = 0;
+    s->windows = 0;
+    s->have_last = 0;
+}
+
+void ff_sweep_start(FfSweep *s, int rate_hz) {
+    s->state = FF_SWEEP_RUNNING;
+    s->run++;
+    s->count = 0;
+    s->settle_ticks = (uint32_t)((uint64_t)FF_SETTLE_MS * (uint32_t)rate_hz / 1000);
+    s->window_ticks = (uint32_t)((uint64_t)FF_WINDOW_MS * (uint32_t)rate_hz / 1000);
+    if (s->window_ticks == 0) s->window_ticks = 1;
+    begin_point(s);
+}
+
+double ff_sweep_duty(const FfSweep *s) {
+    double duty = s->count * FF_SWEEP_STEP_PCT;
+    return (duty > 100.0) ? 100.0 : duty;
+}
+
+int ff_sweep_step(FfSweep *s, int rpm) {
+    if (s->state != FF_SWEEP_RUNNING) return FF_STEP_HOLD;
+    if (++s->tick <= s->settle_ticks) return FF_STEP_HOLD;
+
+    s->sum += rpm;
+    if (++s->samples < s->window_ticks) return FF_STEP_HOLD;
+
+    // One window done: steady if it agrees with the previous one
+    double mean = s->sum / s->samples;
+    double tolerance = fmax(FF_STEADY_RPM, FF_STEADY_FRACTION * mean);
+    int steady = s->have_last && fabs(mean - s->last_mean) <= tolerance;
+    s->windows++;
+    if (!steady && s->windows < FF_MAX_WINDOWS) {
+        s->last_mean = mean;
+        s->have_last = 1;
+        s->samples = 0;
+        s->sum = 0;
+        return FF_STEP_HOLD;
+    }
+
+    s->duty[s->count] = (float)ff_sweep_duty(s);
+    s->rpm[s->count] = (float)mean;
+    s->count++;
+    if (ff_sweep_duty(s) <= s->duty[s->count - 1] || s->count == FF_MAX_POINTS) {
+        s->state = FF_SWEEP_DONE;
+        return FF_STEP_DONE;
+    }
+    begin_point(s);
+    return FF_STEP_POINT;
+}
+
+// --- TABLE ---
+
+int ff_build(FfTable *t, const FfSweep *s) {
+    FfTable out = { 0 };
+    float highest = 0;
+
+    for (int i = 0; i < s->count; i++) {
+        float rpm = (s->rpm[i] > highest) ? s->rpm[i] : highest; // Monotone
+        highest = rpm;
+
+        if (out.count > 0 && rpm <= out.rpm[out.count - 1]) {
+            // Same speed as the last point: keep the lowest duty for it,
+            // except in the dead band, where the highest 0 RPM duty is the breakaway point
+            if (rpm > 0) continue;
+            out.count--;
+        }
+        out.duty[out.count] = s->duty[i];
+        out.rpm[out.count] = rpm;
+        out.count++;
+    }
+    if (out.count < 2 || out.rpm[out.count - 1] <= 0) return -1;
+
+    *t = out;
+    return 0;
+}
+
+double ff_lookup(const FfTable *t, double rpm) {
+    if (t->count == 0) return -1;
+    if (rpm <= 0) return 0;
+    if (rpm >= t->rpm[t->count - 1]) return t->duty[t->count - 1];
+
+    int i = 1;
+    while (t->rpm[i] <= rpm) i++;
+    double frac = (rpm - t->rpm[i - 1]) / (t->rpm[i] - t->rpm[i - 1]);
+    return t->duty[i - 1] + frac * (t->duty[i] - t->duty[i - 1]);
+}
+
+// --- TABLE FILE ---
+
+/*
+ * FUNCTION: parse_line
+ * --------------------
+ * Splits "<motor> <duty> <rpm>". Returns 1 for a point, 0 for a comment or
+ * blank line, -1 for anything else.
+ */
+static int parse_line(const char *line, int *motor, float *duty, float *rpm) {
+    char extra;
+    const char *s = line + strspn(line, " \t");
+    if (*s == '#' || *s == '\n' || *s == '\0') return 0;
+    if (sscanf(s, "%d %f %f %c", motor, duty, rpm, &extra) != 3) return -1;
+    return 1;
+}
+
+int ff_load(const char *path, int motor_id, FfTable *t) {
+    char line[FF_LINE_MAX];
+    FfTable in = { 0 };
+    int motor, bad = 0;
+    float duty, rpm;
+
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL) return (errno == ENOENT) ? 0 : -1;
+
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        int r = parse_line(line, &motor, &duty, &rpm);
+        if (r < 0) { bad = 1; break; }
+        if (r == 0 || motor != motor_id) continue;
+        if (in.count == FF_MAX_POINTS || duty < 0 || duty > 100 || rpm < 0 ||
+            (in.count > 0 && (duty <= in.duty[in.count - 1] || rpm <= in.rpm[in.count - 1]))) { bad = 1; break; }
+        in.duty[in.count] = duty;
+        in.rpm[in.count] = rpm;
+        in.count++;
+    }
+    fclose(fp);
+
+    if (bad || in.count == 1) return -1;
+    if (in.count == 0) return 0;
+    *t = in;
+    return 1;
+}
+
+int ff_save(const char *path, const int *ids, const FfTable *tables, int count) {
+    char tmp[256], line[FF_LINE_MAX];
+    if (snprintf(tmp, sizeof(tmp), "%s.tmp", path) >= (int)sizeof(tmp)) { errno = ENAMETOOLONG; return -1; }
+
+    FILE *out = fopen(tmp, "w");
+    if (out == NULL) return -1;
+    fprintf(out, "# parmco feedforward table v1\n# motor duty_pct rpm\n");
+
+    // Keep the tables of motors that are not in this motor table
+    FILE *old = fopen(path, "r");
+    if (old != NULL) {
+        while (fgets(line, sizeof(line), old) != NULL) {
+            int motor, own = 0;
+            float duty, rpm;
+            if (parse_line(line, &motor, &duty, &rpm) != 1) continue;
+            for (int i = 0; i < count; i++) own |= (ids[i] == motor);
+            if (!own) fputs(line, out);
+        }
+        fclose(old);
+    }
+
+    for (int i = 0; i < count; i++) {
+        for (int p = 0; p < tables[i].count; p++) {
+            fprintf(out, "%d %.1f %.1f\n", ids[i], tables[i].duty[p], tables[i].rpm[p]);
+        }
+    }
+
+    if (fflush(out) != 0 || fsync(fileno(out)) != 0) { fclose(out); unlink(tmp); return -1; }
+    if (fclose(out) != 0 || rename(tmp, path) != 0) { unlink(tmp); return -1; }
+    return 0;
+}
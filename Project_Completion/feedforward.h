@@ -0,0 +1,130 @@
+/*
+ * ======================================================================================
+ * PROJECT:       PARMCO (Phone APP RP4 Motor Control)
+ * FILE:          feedforward.h
+ * AUTHOR:        Group 1
+ *
+ * DESCRIPTION:
+ * Duty-to-RPM feedforward for parmco_server. A calibration sweep ('C' command)
+ * steps the PWM duty from 0 to 100 %, waits at each step until the smoothed
+ * RPM is steady, and turns the measured points into a monotone lookup table.
+ * In Auto Mode the PID then starts from the table's duty for the target and
+ * only trims the residual, so a new target is reached in one jump instead of
+ * a long rate-limited climb.
+ *
+ * The sweep runs on the control thread, one ff_sweep_step() per loop tick.
+ * Tables are saved to and loaded from a small text file (by the I/O thread and
+ * at startup), one line per point:
+ *
+ *   # parmco feedforward table v1
+ *   # motor duty_pct rpm
+ *   0 15.0 0
+ *   0 20.0 640
+ *   ...
+ *
+ * The first point of a table is the breakaway duty (highest duty that still
+ * read 0 RPM). Points are strictly increasing in both duty and RPM.
+ * The table is only valid for the supply voltage and load it was measured with.
+ * ======================================================================================
+ */
+
+#ifndef FEEDFORWARD_H
+#define FEEDFORWARD_H
+
+#include <stdint.h>
+
+#define FF_DEFAULT_PATH "/var/lib/parmco/feedforward.tbl"
+#define FF_MAX_POINTS 32
+#define FF_SWEEP_STEP_PCT 5.0         // Duty step between points (21 points, 0 - 100 %)
+#define FF_SETTLE_MS 1500             // Wait after each duty step before measuring
+#define FF_WINDOW_MS 500              // RPM is averaged over windows of this length
+#define FF_MAX_WINDOWS 10             // Take the last window if the speed never settles
+#define FF_STEADY_RPM 15.0            // Two windows this close (or 1 %) = steady state
+#define FF_STEADY_FRACTION 0.01
+
+typedef enum { FF_SWEEP_IDLE, FF_SWEEP_RUNNING, FF_SWEEP_DONE, FF_SWEEP_FAILED, FF_SWEEP_ABORTED } FfSweepState;
+
+// ff_sweep_step() results
+#define FF_STEP_HOLD  0               // Still measuring the current point
+#define FF_STEP_POINT 1               // A point was measured; apply ff_sweep_duty()
+#define FF_STEP_DONE  2               // The last point was measured
+
+typedef struct {
+    int count;
+    float duty[FF_MAX_POINTS];        // PWM duty %, strictly increasing
+    float rpm[FF_MAX_POINTS];         // Steady-state RPM, strictly increasing
+} FfTable;
+
+typedef struct {
+    FfSweepState state;
+    uint32_t run;                     // +1 every time a sweep is started
+    int count;                        // Points measured so far
+    float duty[FF_MAX_POINTS];
+    float rpm[FF_MAX_POINTS];
+
+    // Current point (control thread)
+    uint32_t tick;                    // Ticks since the duty step
+    uint32_t settle_ticks, window_ticks;
+    uint32_t samples;
+    double sum;                       // RPM sum over the current window
+    double last_mean;
+    int windows, have_last;
+} FfSweep;
+
+/*
+ * FUNCTION: ff_sweep_start
+ * ------------------------
+ * Starts a sweep at 0 % duty, at 'rate_hz' control steps per second.
+ */
+void ff_sweep_start(FfSweep *s, int rate_hz);
+
+/*
+ * FUNCTION: ff_sweep_step
+ * -----------------------
+ * Feeds one control tick's smoothed RPM. Returns FF_STEP_*.
+ */
+int ff_sweep_step(FfSweep *s, int rpm);
+
+/*
+ * FUNCTION: ff_sweep_duty
+ * -----------------------
+ * Duty % the motor should run at for the point being measured.
+ */
+double ff_sweep_duty(const FfSweep *s);
+
+/*
+ * FUNCTION: ff_build
+ * ------------------
+ * Turns a finished sweep into a table: RPM readings are made monotone
+ * (a reading below an earlier one is raised to it) and repeated RPM values
+ * are dropped, keeping the breakaway point. Returns 0, or -1 if the RPM never
+ * rose with the duty (motor or sensor not working; the table is left unchanged).
+ */
+int ff_build(FfTable *t, const FfSweep *s);
+
+/*
+ * FUNCTION: ff_lookup
+ * -------------------
+ * Duty % for 'rpm', interpolated between points. 0 RPM gives 0 %, targets
+ * beyond the last point give its duty. Returns -1 if the table is empty.
+ */
+double ff_lookup(const FfTable *t, double rpm);
+
+/*
+ * FUNCTION: ff_load
+ * -----------------
+ * Reads the table of 'motor_id' from 'path'. Returns 1 if one was loaded,
+ * 0 if the file or the motor's lines do not exist, -1 if they are invalid.
+ */
+int ff_load(const char *path, int motor_id, FfTable *t);
+
+/*
+ * FUNCTION: ff_save
+ * -----------------
+ * Writes the tables of 'count' motors to 'path' (through a temporary file and
+ * rename, so a crash never leaves half a file). Lines of motors not in 'ids'
+ * are kept. Empty tables are written as no lines. Returns 0, or -1 (errno set).
+ */
+int ff_save(const char *path, const int *ids, const FfTable *tables, int count);
+
+#endif // FEEDFORWARD_H
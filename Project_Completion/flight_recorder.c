@@ -0,0 +1,192 @@
+/*
+ * ======================================================================================
+ * PROJECT:       PARMCO (Phone APP RP4 Motor Control)
+ * FILE:          flight_recorder.c
+ * AUTHOR:        Group 1
+ *
+ * DESCRIPTION:
+ * Implementation of the memory-mapped flight recorder (see flight_recorder.h).
+ * ======================================================================================
+ */
+
+#define _GNU_SOURCE       // gettid
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include "flight_recorder.h"
+#include "parmco_log.h"
+
+#define FR_SYNC_NICE 10                    // Same as the log writer: below the I/O thread
+
+static int fr_fd = -1;
+static uint8_t *fr_map = NULL;
+static size_t fr_map_size = 0;
+static FrHeader *fr_hdr = NULL;
+static FrRecord *fr_records = NULL;
+static uint32_t fr_capacity = 0;
+static uint64_t fr_next = 0;               // seq of the next record (control thread only)
+static int fr_first = 1;                   // Next record starts a session
+
+static pthread_t sync_tid;
+static pthread_mutex_t sync_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t sync_cond = PTHREAD_COND_INITIALIZER;
+static int sync_running = 0;
+static int sync_resumed = 0;               // fr_wake() since the sync thread last looked (sync_lock)
+
+/*
+ * FUNCTION: sync_thread
+ * ---------------------
+ * Writes dirty pages back to storage once per FR_SYNC_INTERVAL_S, so a power
+ * cut loses at most about that much history. Runs at low priority; the
+ * control thread never waits for it. If nothing was recorded in an interval
+ * (the server is idle), it sleeps without a timeout until fr_wake().
+ */
+static void *sync_thread(void *arg) {
+    uint64_t synced = atomic_load(&fr_hdr->head);
+
+    setpriority(PRIO_PROCESS, gettid(), FR_SYNC_NICE);
+
+    pthread_mutex_lock(&sync_lock);
+    while (sync_running) {
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        ts.tv_sec += FR_SYNC_INTERVAL_S;
+        pthread_cond_timedwait(&sync_cond, &sync_lock, &ts);
+
+        uint64_t head = atomic_load_explicit(&fr_hdr->head, memory_order_acquire);
+        if (head == synced && !sync_resumed) {
+            if (sync_running) pthread_cond_wait(&sync_cond, &sync_lock);
+            continue;
+        }
+        sync_resumed = 0;
+        synced = head;
+        pthread_mutex_unlock(&sync_lock);
+        msync(fr_map, fr_map_size, MS_SYNC);
+        pthread_mutex_lock(&sync_lock);
+    }
+    pthread_mutex_unlock(&sync_lock);
+    return NULL;
+}
+
+/*
+ * FUNCTION: header_matches
+ * ------------------------
+ * An existing file is reused (and appended to) only if it was written with
+ * the same layout and capacity; anything else is reinitialized.
+ */
+static int header_matches(const FrHeader *h, uint32_t capacity) {
+    return memcmp(h->magic, FR_MAGIC, sizeof(h->magic)) == 0 &&
+           h->version == FR_VERSION &&
+           h->record_size == sizeof(FrRecord) &&
+           h->capacity == capacity;
+}
+
+int fr_open(const char *path, uint32_t capacity) {
+    struct stat st;
+    size_t size = FR_HEADER_SIZE + (size_t)capacity * sizeof(FrRecord);
+
+    fr_fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fr_fd < 0) { perror("Flight recorder open"); return -1; }
+
+    // Reserve the blocks up front so a full disk fails here, not as SIGBUS later
+    int fresh = (fstat(fr_fd, &st) != 0 || (size_t)st.st_size != size);
+    if (fresh && (ftruncate(fr_fd, 0) != 0 || posix_fallocate(fr_fd, 0, (off_t)size) != 0)) {
+        perror("Flight recorder allocate");
+        close(fr_fd);
+        fr_fd = -1;
+        return -1;
+    }
+
+    // MAP_POPULATE (and mlockall in the server) keep page faults off the control path
+    fr_map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fr_fd, 0);
+    if (fr_map == MAP_FAILED) {
+        perror("Flight recorder mmap");
+        fr_map = NULL;
+        close(fr_fd);
+        fr_fd = -1;
+        return -1;
+    }
+    fr_map_size = size;
+    fr_hdr = (FrHeader *)fr_map;
+    fr_records = (FrRecord *)(fr_map + FR_HEADER_SIZE);
+    fr_capacity = capacity;
+
+    if (fresh || !header_matches(fr_hdr, capacity)) {
+        memset(fr_map, 0, size);
+        memcpy(fr_hdr->magic, FR_MAGIC, sizeof(fr_hdr->magic));
+        fr_hdr->version = FR_VERSION;
+        fr_hdr->record_size = sizeof(FrRecord);
+        fr_hdr->capacity = capacity;
+        atomic_store(&fr_hdr->head, 0);
+    }
+    fr_hdr->sessions++;
+    fr_next = atomic_load(&fr_hdr->head) + 1;
+    fr_first = 1;
+    msync(fr_map, FR_HEADER_SIZE, MS_SYNC);
+
+    sync_running = 1;
+    if (pthread_create(&sync_tid, NULL, sync_thread, NULL) != 0) sync_running = 0;
+
+    log_text(LOG_LVL_INFO, "Flight recorder: %s\n", path);
+    log_info("Flight recorder: %u records (%.1f MB), session %u\n",
+             capacity, size / 1048576.0, fr_hdr->sessions);
+    return 0;
+}
+
+void fr_close(void) {
+    if (fr_map == NULL) return;
+
+    pthread_mutex_lock(&sync_lock);
+    int was_running = sync_running;
+    sync_running = 0;
+    pthread_cond_signal(&sync_cond);
+    pthread_mutex_unlock(&sync_lock);
+    if (was_running) pthread_join(sync_tid, NULL);
+
+    msync(fr_map, fr_map_size, MS_SYNC);
+    munmap(fr_map, fr_map_size);
+    close(fr_fd);
+    fr_map = NULL;
+    fr_hdr = NULL;
+    fr_records = NULL;
+    fr_fd = -1;
+}
+
+void fr_wake(void) {
+    if (fr_map == NULL) return;
+    pthread_mutex_lock(&sync_lock);
+    sync_resumed = 1;
+    pthread_cond_signal(&sync_cond);
+    pthread_mutex_unlock(&sync_lock);
+}
+
+int fr_active(void) {
+    return fr_map != NULL;
+}
+
+/*
+ * FUNCTION: fr_begin
+ * ------------------
+ * Returns the slot for the next record. Its seq is cleared first, so if power
+ * is lost while the slot is half rewritten the old contents are not mistaken
+ * for a valid record.
+ */
+FrRecord *fr_begin(void) {
+    FrRecord *r = &fr_records[(fr_next - 1) % fr_capacity];
+    atomic_store_explicit(&r->seq, 0, memory_order_relaxed);
+    r->flags = fr_first ? FR_FLAG_SESSION_START : 0;
+    fr_first = 0;
+    return r;
+}
+
+void fr_commit(FrRecord *r) {
+    atomic_store_explicit(&r->seq, fr_next, memory_order_release);
+    atomic_store_explicit(&fr_hdr->head, fr_next, memory_order_release);
+    fr_next++;
+}
@@ -0,0 +1,81 @@
+/*
+ * ======================================================================================
+ * PROJECT:       PARMCO (Phone APP RP4 Motor Control)
+ * FILE:          flight_recorder.h
+ * AUTHOR:        Group 1
+ *
+ * DESCRIPTION:
+ * On-device flight recorder. parmco_server writes every control-loop sample
+ * into a fixed-size circular file that is memory-mapped MAP_SHARED, so a
+ * sample is just a handful of plain stores into the page cache (no syscall).
+ * The kernel owns the dirty pages, so the data survives a crash of the server;
+ * a low-priority thread msync()s the file every FR_SYNC_INTERVAL_S to bound
+ * what a power cut can lose (and sleeps while nothing is being recorded).
+ *
+ * FILE LAYOUT:
+ *   [FrHeader, padded to FR_HEADER_SIZE][FrRecord x capacity]
+ * Record n (1-based, counting every sample ever written to this file) lives
+ * in slot (n - 1) % capacity. Its 'seq' field is written last, so a record
+ * whose seq does not match its slot was torn by a power cut and is skipped.
+ *
+ * The dump tool (parmco_frdump.c) reads the same file with these definitions.
+ * ======================================================================================
+ */
+
+#ifndef FLIGHT_RECORDER_H
+#define FLIGHT_RECORDER_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+
+#define FR_MAGIC "PARMCOFR"
+#define FR_VERSION 1
+#define FR_HEADER_SIZE 4096             // One page, so records never share the header's page
+#define FR_DEFAULT_PATH "/var/lib/parmco/flight.rec"
+#define FR_DEFAULT_RECORDS (1u << 20)   // 64 MB: ~2.9 hours at 100 Hz
+#define FR_SYNC_INTERVAL_S 1
+
+#define FR_FLAG_SESSION_START (1u << 0) // First record after parmco_server started
+#define FR_FLAG_RUNNING       (1u << 1) // Motor master power on
+#define FR_FLAG_AUTO          (1u << 2) // PID (Auto) mode
+#define FR_FLAG_REVERSE       (1u << 3) // Counter-clockwise
+#define FR_FLAG_PROFILE       (1u << 4) // Target comes from a running setpoint profile
+
+typedef struct {
+    char magic[8];                      // FR_MAGIC (no terminator)
+    uint32_t version;
+    uint32_t record_size;               // sizeof(FrRecord)
+    uint32_t capacity;                  // Number of record slots
+    uint32_t sessions;                  // Incremented every time the server opens the file
+    _Atomic uint64_t head;              // Records written so far (newest = head)
+} FrHeader;
+
+// 64 bytes: one record per cache line
+typedef struct {
+    _Atomic uint64_t seq;               // 1-based record number, 0 = never written
+    int64_t  time_us;                   // CLOCK_REALTIME (microseconds since 1970)
+    uint32_t tick;                      // Pi tick (same clock as sensor edges)
+    uint32_t edges;                     // Sensor edges counted since start
+    int32_t  rpm_raw;
+    int32_t  rpm_smooth;
+    int32_t  target;
+    uint32_t duty;                      // PWM duty, 0 - 1,000,000
+    float    error;                     // PID error (target - rpm_smooth)
+    float    integral;                  // PID integral term
+    float    pid_duty;                  // PID output (duty %, fractional)
+    uint8_t  mode;                      // ControlMode
+    uint8_t  flags;                     // FR_FLAG_*
+    uint8_t  motor;                     // Motor ID (0 in files from single-motor builds)
+    uint8_t  pad[5];
+} FrRecord;
+
+int  fr_open(const char *path, uint32_t capacity); // 0 on success; starts the sync thread
+void fr_close(void);                               // Final msync + unmap
+int  fr_active(void);
+void fr_wake(void);                                // Recording resumes after a pause (the sync thread sleeps while nothing is recorded)
+
+// Fills a record in place and publishes it. Control thread only.
+FrRecord *fr_begin(void);
+void fr_commit(FrRecord *r);
+
+#endif // FLIGHT_RECORDER_H
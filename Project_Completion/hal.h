@@ -0,0 +1,119 @@
+/*
+ * ======================================================================================
+ * PROJECT:       PARMCO (Phone APP RP4 Motor Control)
+ * FILE:          hal.h
+ * AUTHOR:        Group 1
+ *
+ * DESCRIPTION:
+ * Hardware Abstraction Layer used by parmco_server. Every GPIO, PWM, tick and
+ * sensor-edge operation goes through a HalBackend so the control code does not
+ * care how the pins are reached.
+ *
+ * BACKENDS:
+ * - hal_pigpiod (hal_pigpiod.c): The original pigpiod_if2 socket calls.
+ * - hal_direct  (hal_direct.c):  Register-level access. GPIO through /dev/gpiomem,
+ *                                PWM + clock manager through /dev/mem, sensor edges
+ *                                through the kernel GPIO character device. Does not
+ *                                need the pigpio daemon (must run as root).
+ * - hal_sim     (hal_sim.c):     No hardware. Each motor is a simulated first-order
+ *                                plant with synthetic sensor edges, optionally faster
+ *                                than real time (see hal_sim.c for the model and options).
+ *
+ * PWM:
+ * hw_pwm drives the two BCM PWM channels (GPIO 12/18 = channel 0, 13/19 = channel 1).
+ * sw_pwm is timed in software (pigpio DMA sampling) and works on any GPIO, so
+ * more than two motors can be driven; hal_direct does not provide it.
+ *
+ * SENSORS:
+ * sensor_start() takes every sensor pin at once (up to HAL_MAX_SENSORS) and
+ * reports each edge with the ctx of the pin it came from.
+ *
+ * TICKS:
+ * All backends report time as a 32-bit microsecond tick (like pigpio), so edge
+ * timestamps and tick() can be subtracted with unsigned math across the wrap.
+ * A backend with time_scale() > 1 (hal_sim) runs its ticks faster than real
+ * time; the control thread divides its period by the scale to keep up.
+ * ======================================================================================
+ */
+
+#ifndef HAL_H
+#define HAL_H
+
+#include <stdint.h>
+#include <time.h>
+
+#define HAL_MAX_SENSORS 8
+
+// Called for each sensor edge, from a backend-owned thread (hal_sim: from tick()).
+// level: 1 = rising, 0 = falling.
+// 'ctx' is the pointer registered with that sensor's pin.
+typedef void (*HalEdgeFunc)(void *ctx, uint32_t tick, uint32_t level);
+
+// One sensor input for sensor_start()
+typedef struct {
+    unsigned gpio;
+    void *ctx;
+} HalSensor;
+
+typedef struct {
+    const char *name;
+    int      (*init)(void);                                       // 0 on success
+    void     (*shutdown)(void);
+    int      (*set_output)(unsigned gpio);
+    int      (*write)(unsigned gpio, unsigned level);
+    int      (*read)(unsigned gpio);
+    int      (*write_bank)(uint32_t set_mask, uint32_t clear_mask); // GPIO 0-31, clears applied first
+    int      (*hw_pwm)(unsigned gpio, unsigned freq, uint32_t duty); // duty 0 - 1,000,000
+    int      (*sw_pwm)(unsigned gpio, unsigned freq, uint32_t duty); // Any GPIO, same duty scale (NULL = not supported)
+    uint32_t (*tick)(void);                                       // Current time in microseconds (control thread only)
+    int      (*sensor_start)(const HalSensor *sensors, int count, unsigned glitch_us, HalEdgeFunc on_edge);
+    void     (*sensor_stop)(void);                                // Stops every sensor
+    unsigned (*time_scale)(void);                                 // Ticks per real microsecond (NULL = 1)
+} HalBackend;
+
+extern const HalBackend hal_pigpiod;
+extern const HalBackend hal_direct;
+extern const HalBackend hal_sim;
+
+/*
+ * hal_sim setup (before init / sensor_start):
+ * hal_sim_configure: "key=value,..." plant and noise options; 0 or -1 (message printed).
+ * hal_sim_bind:      the pins of one simulated motor, identified by its sensor pin.
+ */
+int hal_sim_configure(const char *opts);
+int hal_sim_bind(unsigned sensor_gpio, unsigned master, unsigned dir_a, unsigned dir_b,
+                 unsigned pwm, int edges_per_rev);
+
+/*
+ * Edge ingestion for hal_pigpiod (set before sensor_start):
+ * HAL_INGEST_CALLBACK: pigpiod calls back once per edge.
+ * HAL_INGEST_NOTIFY:   pigpiod writes gpioReport_t records to /dev/pigpio<handle>;
+ *                      a reader thread pulls them in blocks.
+ */
+#define HAL_INGEST_CALLBACK 0
+#define HAL_INGEST_NOTIFY   1
+extern int hal_ingest_mode;
+
+/*
+ * FUNCTION: monotonic_us
+ * ----------------------
+ * Current CLOCK_MONOTONIC time in microseconds.
+ */
+static inline int64_t monotonic_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/*
+ * FUNCTION: monotonic_ns
+ * ----------------------
+ * Current CLOCK_MONOTONIC time in nanoseconds (for sub-microsecond durations).
+ */
+static inline int64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+#endif // HAL_H
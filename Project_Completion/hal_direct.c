@@ -0,0 +1,347 @@
+/*
+ * ======================================================================================
+ * PROJECT:       PARMCO (Phone APP RP4 Motor Control)
+ * FILE:          hal_direct.c
+ * AUTHOR:        Group 1
+ *
+ * DESCRIPTION:
+ * HAL backend that drives the BCM2711 (Pi 4) / BCM2835-7 peripherals directly,
+ * without the pigpio daemon:
+ * - GPIO function select / set / clear / level: registers mapped from /dev/gpiomem.
+ * - Hardware PWM (GPIO 12/13/18/19) and its clock: PWM0 and the clock manager
+ *   mapped from /dev/mem (these are not exposed by /dev/gpiomem, so root is needed).
+ *   There is no software PWM, so at most two motors (one per PWM channel).
+ * - Sensor edges: kernel GPIO character device (/dev/gpiochip0, uAPI v2) with
+ *   pull-up bias and kernel debounce, timestamped by the kernel on CLOCK_MONOTONIC.
+ *
+ * A pin write is a single store to GPSET0/GPCLR0, so command-to-pin latency
+ * is well under a microsecond instead of a pigpiod socket round-trip.
+ * ======================================================================================
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/ioctl.h>
+#include <sys/eventfd.h>
+#include <linux/gpio.h>
+#include "hal.h"
+#include "parmco_log.h"
+
+// --- PERIPHERAL OFFSETS (from the peripheral base) ---
+#define CLK_OFFSET  0x101000
+#define PWM_OFFSET  0x20C000
+#define BLOCK_SIZE  4096
+
+// GPIO register word indices
+#define GPFSEL0 0
+#define GPSET0  7
+#define GPCLR0  10
+#define GPLEV0  13
+
+// PWM register word indices and control bits
+#define PWM_CTL  0
+#define PWM_RNG1 4
+#define PWM_DAT1 5
+#define PWM_RNG2 8
+#define PWM_DAT2 9
+#define PWM_CTL_PWEN1 (1 << 0)
+#define PWM_CTL_MSEN1 (1 << 7)
+#define PWM_CTL_PWEN2 (1 << 8)
+#define PWM_CTL_MSEN2 (1 << 15)
+
+// Clock manager (PWM clock) word indices and bits
+#define CM_PWMCTL 40
+#define CM_PWMDIV 41
+#define CM_PASSWD (0x5A << 24)
+#define CM_ENAB   (1 << 4)
+#define CM_KILL   (1 << 5)
+#define CM_BUSY   (1 << 7)
+#define CM_SRC_OSC 1
+
+// GPIO function select values
+#define FSEL_INPUT  0
+#define FSEL_OUTPUT 1
+#define FSEL_ALT0   4
+#define FSEL_ALT5   2
+
+#define PWM_CLOCK_TARGET_HZ 10000000 // ~10 MHz PWM clock: 10,000 duty steps at 1 kHz
+
+static volatile uint32_t *gpio_reg = MAP_FAILED;
+static volatile uint32_t *pwm_reg = MAP_FAILED;
+static volatile uint32_t *clk_reg = MAP_FAILED;
+static uint32_t pwm_clock_hz = 0;          // Actual PWM clock after the integer divider
+static uint32_t pwm_range[2] = { 0, 0 };   // Current range (counts per period) per channel
+static unsigned pwm_freq[2] = { 0, 0 };
+
+// Sensor ingestion state
+static HalEdgeFunc edge_sink = NULL;
+static HalSensor sensors[HAL_MAX_SENSORS];
+static int num_sensors = 0;
+static int line_fd = -1;                   // GPIO character-device line request (all sensor pins)
+static int stop_fd = -1;                   // eventfd used to wake and stop edge_thread
+static pthread_t edge_tid;
+
+/*
+ * FUNCTION: peripheral_base
+ * -------------------------
+ * Reads the SoC peripheral base from the device tree (0xFE000000 on a Pi 4,
+ * 0x3F000000 on a Pi 2/3). Returns 0 if it cannot be determined.
+ */
+static uint32_t peripheral_base(void) {
+    unsigned char buf[12];
+    uint32_t base = 0;
+    FILE *fp = fopen("/proc/device-tree/soc/ranges", "rb");
+
+    if (fp == NULL) return 0;
+    if (fread(buf, 1, sizeof(buf), fp) == sizeof(buf)) {
+        base = ((uint32_t)buf[4] << 24) | (buf[5] << 16) | (buf[6] << 8) | buf[7];
+        if (base == 0) base = ((uint32_t)buf[8] << 24) | (buf[9] << 16) | (buf[10] << 8) | buf[11];
+    }
+    fclose(fp);
+    return base;
+}
+
+/*
+ * FUNCTION: map_block
+ * -------------------
+ * Maps one 4 KB register block from 'dev' at physical offset 'offset'.
+ */
+static volatile uint32_t *map_block(const char *dev, off_t offset) {
+    int fd = open(dev, O_RDWR | O_SYNC);
+    if (fd < 0) { perror(dev); return MAP_FAILED; }
+    void *p = mmap(NULL, BLOCK_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, offset);
+    close(fd); // The mapping stays valid after close
+    if (p == MAP_FAILED) perror("mmap");
+    return (volatile uint32_t *)p;
+}
+
+static void set_function(unsigned gpio, unsigned fsel) {
+    unsigned reg = GPFSEL0 + gpio / 10;
+    unsigned shift = (gpio % 10) * 3;
+    gpio_reg[reg] = (gpio_reg[reg] & ~(7u << shift)) | (fsel << shift);
+}
+
+/*
+ * FUNCTION: start_pwm_clock
+ * -------------------------
+ * Runs the PWM clock from the crystal oscillator (54 MHz on a Pi 4,
+ * 19.2 MHz on older boards) divided down to roughly PWM_CLOCK_TARGET_HZ.
+ */
+static void start_pwm_clock(uint32_t osc_hz) {
+    uint32_t divi = osc_hz / PWM_CLOCK_TARGET_HZ;
+    if (divi < 2) divi = 2;
+
+    uint32_t saved_ctl = pwm_reg[PWM_CTL];
+    pwm_reg[PWM_CTL] = 0; // PWM must be off while its clock changes
+
+    clk_reg[CM_PWMCTL] = CM_PASSWD | CM_KILL;
+    while (clk_reg[CM_PWMCTL] & CM_BUSY) usleep(10);
+    clk_reg[CM_PWMDIV] = CM_PASSWD | (divi << 12);
+    clk_reg[CM_PWMCTL] = CM_PASSWD | CM_SRC_OSC | CM_ENAB;
+    while (!(clk_reg[CM_PWMCTL] & CM_BUSY)) usleep(10);
+
+    pwm_reg[PWM_CTL] = saved_ctl;
+    pwm_clock_hz = osc_hz / divi;
+}
+
+static int direct_init(void) {
+    uint32_t base = peripheral_base();
+    if (base == 0) {
+        fprintf(stderr, "Direct HAL: cannot read peripheral base from device tree\n");
+        return -1;
+    }
+
+    gpio_reg = map_block("/dev/gpiomem", 0);
+    pwm_reg = map_block("/dev/mem", base + PWM_OFFSET);
+    clk_reg = map_block("/dev/mem", base + CLK_OFFSET);
+    if (gpio_reg == MAP_FAILED || pwm_reg == MAP_FAILED || clk_reg == MAP_FAILED) {
+        fprintf(stderr, "Direct HAL: register mapping failed (run as root)\n");
+        return -1;
+    }
+
+    start_pwm_clock(base == 0xFE000000 ? 54000000 : 19200000);
+    log_info("Direct HAL: peripherals at 0x%08X, PWM clock %u Hz\n", base, pwm_clock_hz);
+    return 0;
+}
+
+static void direct_shutdown(void) {
+    if (gpio_reg != MAP_FAILED) munmap((void *)gpio_reg, BLOCK_SIZE);
+    if (pwm_reg != MAP_FAILED) munmap((void *)pwm_reg, BLOCK_SIZE);
+    if (clk_reg != MAP_FAILED) munmap((void *)clk_reg, BLOCK_SIZE);
+    gpio_reg = pwm_reg = clk_reg = MAP_FAILED;
+}
+
+static int direct_set_output(unsigned gpio) {
+    if (gpio > 53) return -1;
+    set_function(gpio, FSEL_OUTPUT);
+    return 0;
+}
+
+static int direct_write(unsigned gpio, unsigned level) {
+    if (gpio > 31) return -1;
+    if (level) gpio_reg[GPSET0] = 1u << gpio;
+    else       gpio_reg[GPCLR0] = 1u << gpio;
+    return 0;
+}
+
+static int direct_read(unsigned gpio) {
+    if (gpio > 31) return -1;
+    return (gpio_reg[GPLEV0] >> gpio) & 1;
+}
+
+static int direct_write_bank(uint32_t set_mask, uint32_t clear_mask) {
+    if (clear_mask) gpio_reg[GPCLR0] = clear_mask;
+    if (set_mask) gpio_reg[GPSET0] = set_mask;
+    return 0;
+}
+
+/*
+ * FUNCTION: direct_hw_pwm
+ * -----------------------
+ * Same contract as pigpio hardware_PWM(): mark-space PWM at 'freq' Hz with
+ * 'duty' in 0 - 1,000,000. Only the range register is rewritten when the
+ * frequency changes; a plain duty change is one store to DATn.
+ */
+static int direct_hw_pwm(unsigned gpio, unsigned freq, uint32_t duty) {
+    int ch;
+    unsigned alt;
+
+    switch (gpio) {
+        case 12: ch = 0; alt = FSEL_ALT0; break;
+        case 13: ch = 1; alt = FSEL_ALT0; break;
+        case 18: ch = 0; alt = FSEL_ALT5; break;
+        case 19: ch = 1; alt = FSEL_ALT5; break;
+        default: return -1; // Not a hardware PWM pin
+    }
+    if (freq == 0 || duty > 1000000) return -1;
+
+    if (freq != pwm_freq[ch]) {
+        set_function(gpio, alt);
+        pwm_range[ch] = pwm_clock_hz / freq;
+        pwm_reg[ch ? PWM_RNG2 : PWM_RNG1] = pwm_range[ch];
+        pwm_reg[PWM_CTL] |= ch ? (PWM_CTL_PWEN2 | PWM_CTL_MSEN2) : (PWM_CTL_PWEN1 | PWM_CTL_MSEN1);
+        pwm_freq[ch] = freq;
+    }
+
+    pwm_reg[ch ? PWM_DAT2 : PWM_DAT1] = (uint32_t)(((uint64_t)duty * pwm_range[ch]) / 1000000);
+    return 0;
+}
+
+static uint32_t direct_tick(void) {
+    return (uint32_t)monotonic_us();
+}
+
+/*
+ * FUNCTION: edge_thread
+ * ---------------------
+ * Blocks on the line request fd and forwards kernel edge events in batches.
+ * Kernel timestamps are CLOCK_MONOTONIC nanoseconds, converted to the same
+ * 32-bit microsecond tick as direct_tick(). Each event names its line
+ * offset (= GPIO number), which selects the sensor's ctx.
+ */
+static void *edge_thread(void *arg) {
+    struct gpio_v2_line_event events[64];
+    struct pollfd fds[2] = { { .fd = line_fd, .events = POLLIN }, { .fd = stop_fd, .events = POLLIN } };
+
+    while (1) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (fds[1].revents) break; // sensor_stop()
+
+        ssize_t got = read(line_fd, events, sizeof(events));
+        if (got < 0) {
+            if (errno == EINTR || errno == EAGAIN) continue;
+            break;
+        }
+        int n = (int)(got / sizeof(events[0]));
+        for (int i = 0; i < n; i++) {
+            uint32_t level = (events[i].id == GPIO_V2_LINE_EVENT_RISING_EDGE) ? 1 : 0;
+            for (int s = 0; s < num_sensors; s++) {
+                if (sensors[s].gpio == events[i].offset) {
+                    edge_sink(sensors[s].ctx, (uint32_t)(events[i].timestamp_ns / 1000), level);
+                    break;
+                }
+            }
+        }
+    }
+    return NULL;
+}
+
+/*
+ * FUNCTION: direct_sensor_start
+ * -----------------------------
+ * Requests every sensor line from /dev/gpiochip0 in one line request, as
+ * pulled-up inputs with rising-edge events and a kernel debounce of
+ * 'glitch_us', then starts the edge reader thread (one thread for all sensors).
+ */
+static int direct_sensor_start(const HalSensor *list, int count, unsigned glitch_us, HalEdgeFunc on_edge) {
+    struct gpio_v2_line_request req;
+
+    if (count < 1 || count > HAL_MAX_SENSORS) return -1;
+    int chip_fd = open("/dev/gpiochip0", O_RDONLY);
+    if (chip_fd < 0) { perror("/dev/gpiochip0"); return -1; }
+
+    memset(&req, 0, sizeof(req));
+    for (int s = 0; s < count; s++) req.offsets[s] = list[s].gpio;
+    req.num_lines = (uint32_t)count;
+    req.event_buffer_size = 256 * (uint32_t)count;
+    strncpy(req.consumer, "parmco_sensor", sizeof(req.consumer) - 1);
+    req.config.flags = GPIO_V2_LINE_FLAG_INPUT | GPIO_V2_LINE_FLAG_EDGE_RISING |
+                       GPIO_V2_LINE_FLAG_BIAS_PULL_UP;
+    if (glitch_us > 0) {
+        req.config.num_attrs = 1;
+        req.config.attrs[0].attr.id = GPIO_V2_LINE_ATTR_ID_DEBOUNCE;
+        req.config.attrs[0].attr.debounce_period_us = glitch_us;
+        req.config.attrs[0].mask = (1ull << count) - 1; // Every requested line
+    }
+
+    int ret = ioctl(chip_fd, GPIO_V2_GET_LINE_IOCTL, &req);
+    close(chip_fd);
+    if (ret < 0) { perror("GPIO_V2_GET_LINE_IOCTL"); return -1; }
+
+    line_fd = req.fd;
+    stop_fd = eventfd(0, 0);
+    edge_sink = on_edge;
+    num_sensors = count;
+    memcpy(sensors, list, sizeof(HalSensor) * (size_t)count);
+    if (stop_fd < 0 || pthread_create(&edge_tid, NULL, edge_thread, NULL) != 0) {
+        close(line_fd);
+        if (stop_fd >= 0) close(stop_fd);
+        line_fd = stop_fd = -1;
+        return -1;
+    }
+    log_info("Edge ingestion: gpiochip line events (%d sensors)\n", count);
+    return 0;
+}
+
+static void direct_sensor_stop(void) {
+    if (line_fd < 0) return;
+    uint64_t one = 1;
+    if (write(stop_fd, &one, sizeof(one)) < 0) perror("eventfd write");
+    pthread_join(edge_tid, NULL);
+    close(line_fd);
+    close(stop_fd);
+    line_fd = stop_fd = -1;
+}
+
+const HalBackend hal_direct = {
+    .name         = "direct",
+    .init         = direct_init,
+    .shutdown     = direct_shutdown,
+    .set_output   = direct_set_output,
+    .write        = direct_write,
+    .read         = direct_read,
+    .write_bank   = direct_write_bank,
+    .hw_pwm       = direct_hw_pwm,
+    .tick         = direct_tick,
+    .sensor_start = direct_sensor_start,
+    .sensor_stop  = direct_sensor_stop,
+};
@@ -0,0 +1,282 @@
+/*
+ * ======================================================================================
+ * PROJECT:       PARMCO (Phone APP RP4 Motor Control)
+ * FILE:          hal_pigpiod.c
+ * AUTHOR:        Group 1
+ *
+ * DESCRIPTION:
+ * HAL backend built on the pigpio daemon interface (pigpiod_if2).
+ * Every call is a socket round-trip to pigpiod, so the daemon must be running.
+ * Sensor edges arrive either through per-edge callbacks or a notification pipe
+ * (see hal_ingest_mode in hal.h).
+ * ======================================================================================
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <pthread.h>
+#include <pigpiod_if2.h>  // Uses the pigpio daemon interface
+#include "hal.h"
+#include "parmco_log.h"
+
+#ifndef DEFAULT_INGEST_MODE
+#define DEFAULT_INGEST_MODE HAL_INGEST_CALLBACK
+#endif
+#define NOTIFY_BATCH_REPORTS 256    // 256 x 12 bytes = 3 KB per read()
+#define TICK_RESYNC_US 1000000      // How often the pigpio tick offset is re-measured
+
+int hal_ingest_mode = DEFAULT_INGEST_MODE;
+
+static int pi = -1;                        // Pigpio Daemon Handle
+static int64_t tick_offset_us = 0;         // pigpio tick minus CLOCK_MONOTONIC (microseconds)
+static int64_t last_resync_us = 0;
+
+#define SW_PWM_RANGE 10000             // pigpio soft PWM range: duty 0 - 1,000,000 / 100
+
+// Sensor ingestion state
+static HalEdgeFunc edge_sink = NULL;
+static HalSensor sensors[HAL_MAX_SENSORS];
+static int num_sensors = 0;
+static int callback_ids[HAL_MAX_SENSORS];  // pigpio callback ids (HAL_INGEST_CALLBACK)
+static unsigned sw_pwm_freq[32];           // Soft PWM frequency set per GPIO (0 = not started)
+static int notify_handle = -1;             // pigpio notification handle (HAL_INGEST_NOTIFY)
+static int notify_fd = -1;                 // Read end of /dev/pigpio<notify_handle>
+static pthread_t notify_tid;
+
+/*
+ * FUNCTION: resync_tick_offset
+ * ----------------------------
+ * Measures the offset between the pigpio tick (used for sensor edge
+ * timestamps) and CLOCK_MONOTONIC. The midpoint of the round-trip is used
+ * so the error is at most half the pigpiod socket latency.
+ */
+static void resync_tick_offset(void) {
+    int64_t before = monotonic_us();
+    uint32_t tick = get_current_tick(pi);
+    int64_t after = monotonic_us();
+    tick_offset_us = (int64_t)tick - (before + after) / 2;
+    last_resync_us = after;
+}
+
+static int pigpiod_init(void) {
+    pi = pigpio_start(NULL, NULL);
+    if (pi < 0) {
+        fprintf(stderr, "Failed to connect to pigpio daemon. Is it running?\n");
+        return -1;
+    }
+    resync_tick_offset();
+    return 0;
+}
+
+static void pigpiod_shutdown(void) {
+    if (pi >= 0) pigpio_stop(pi);
+    pi = -1;
+}
+
+static int pigpiod_set_output(unsigned gpio) {
+    return set_mode(pi, gpio, PI_OUTPUT);
+}
+
+static int pigpiod_write(unsigned gpio, unsigned level) {
+    return gpio_write(pi, gpio, level);
+}
+
+static int pigpiod_read(unsigned gpio) {
+    return gpio_read(pi, gpio);
+}
+
+static int pigpiod_write_bank(uint32_t set_mask, uint32_t clear_mask) {
+    int ret = 0;
+    if (clear_mask && clear_bank_1(pi, clear_mask) < 0) ret = -1;
+    if (set_mask && set_bank_1(pi, set_mask) < 0) ret = -1;
+    return ret;
+}
+
+static int pigpiod_hw_pwm(unsigned gpio, unsigned freq, uint32_t duty) {
+    return hardware_PWM(pi, gpio, freq, duty);
+}
+
+/*
+ * FUNCTION: pigpiod_sw_pwm
+ * ------------------------
+ * pigpio DMA-timed PWM on any GPIO. Frequency and range are only sent the
+ * first time (or when the frequency changes); a duty change is one call.
+ * pigpio picks the nearest frequency its sample rate allows (1 kHz is exact at 5 us).
+ */
+static int pigpiod_sw_pwm(unsigned gpio, unsigned freq, uint32_t duty) {
+    if (gpio > 31 || freq == 0 || duty > 1000000) return -1;
+    if (sw_pwm_freq[gpio] != freq) {
+        if (set_PWM_frequency(pi, gpio, freq) < 0 || set_PWM_range(pi, gpio, SW_PWM_RANGE) < 0) return -1;
+        sw_pwm_freq[gpio] = freq;
+    }
+    return set_PWM_dutycycle(pi, gpio, duty / (1000000 / SW_PWM_RANGE));
+}
+
+/*
+ * FUNCTION: pigpiod_tick
+ * ----------------------
+ * Estimates the current pigpio tick from CLOCK_MONOTONIC without a
+ * pigpiod round-trip. The offset is re-measured every TICK_RESYNC_US.
+ * Truncation to 32 bits reproduces the tick wrap.
+ */
+static uint32_t pigpiod_tick(void) {
+    int64_t now_us = monotonic_us();
+    if (now_us - last_resync_us >= TICK_RESYNC_US) {
+        resync_tick_offset();
+        now_us = monotonic_us();
+    }
+    return (uint32_t)(now_us + tick_offset_us);
+}
+
+/*
+ * FUNCTION: pigpiod_edge_callback
+ * -------------------------------
+ * Executed by the pigpio client thread every time a sensor pin goes High.
+ * 'user' is that pin's HalSensor.
+ */
+static void pigpiod_edge_callback(int pi, unsigned gpio, unsigned level, uint32_t tick, void *user) {
+    edge_sink(((HalSensor *)user)->ctx, tick, level);
+}
+
+/*
+ * FUNCTION: notify_thread
+ * -----------------------
+ * Alternative to per-edge callbacks (HAL_INGEST_NOTIFY). Reads gpioReport_t
+ * records from the pigpio notification pipe in large blocks. Each record is a
+ * snapshot of GPIO bank 1, so an edge is any change of a sensor bit; both
+ * edges are forwarded, just like a callback would report them.
+ * Exits when the pipe is closed (notify_close in sensor_stop).
+ */
+static void *notify_thread(void *arg) {
+    gpioReport_t reports[NOTIFY_BATCH_REPORTS];
+    size_t carry = 0; // Bytes of a partial record left over from the last read
+    int last_level[HAL_MAX_SENSORS];
+
+    for (int s = 0; s < num_sensors; s++) last_level[s] = -1;
+
+    while (1) {
+        ssize_t got = read(notify_fd, (char *)reports + carry, sizeof(reports) - carry);
+        if (got <= 0) {
+            if (got < 0 && errno == EINTR) continue;
+            break;
+        }
+
+        size_t total = carry + (size_t)got;
+        size_t count = total / sizeof(gpioReport_t);
+
+        for (size_t i = 0; i < count; i++) {
+            // Skip watchdog / keep-alive / event records, they carry no level change
+            if (reports[i].flags & (PI_NTFY_FLAGS_WDOG | PI_NTFY_FLAGS_ALIVE | PI_NTFY_FLAGS_EVENT)) continue;
+
+            for (int s = 0; s < num_sensors; s++) {
+                int level = (reports[i].level >> sensors[s].gpio) & 1;
+                if (level != last_level[s]) {
+                    if (last_level[s] >= 0) edge_sink(sensors[s].ctx, reports[i].tick, (uint32_t)level);
+                    last_level[s] = level;
+                }
+            }
+        }
+
+        carry = total - count * sizeof(gpioReport_t);
+        if (carry) memmove(reports, (char *)reports + count * sizeof(gpioReport_t), carry);
+    }
+    return NULL;
+}
+
+/*
+ * FUNCTION: start_notify_ingest
+ * -----------------------------
+ * Opens a pigpio notification pipe filtered to the sensor pins and starts the
+ * reader thread. The pipe is created by pigpiod, so this mode requires
+ * the daemon to run on this Pi. Returns 0 on success.
+ */
+static int start_notify_ingest(void) {
+    char path[32];
+
+    notify_handle = notify_open(pi);
+    if (notify_handle < 0) return -1;
+
+    snprintf(path, sizeof(path), "/dev/pigpio%d", notify_handle);
+    notify_fd = open(path, O_RDONLY);
+    if (notify_fd < 0) {
+        notify_close(pi, notify_handle);
+        return -1;
+    }
+
+    uint32_t mask = 0;
+    for (int s = 0; s < num_sensors; s++) mask |= 1u << sensors[s].gpio;
+    notify_begin(pi, notify_handle, mask);
+    if (pthread_create(&notify_tid, NULL, notify_thread, NULL) != 0) {
+        notify_close(pi, notify_handle);
+        close(notify_fd);
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * FUNCTION: pigpiod_sensor_start
+ * ------------------------------
+ * Configures every sensor pin (input, pull-up, glitch filter) and attaches
+ * edge ingestion: one notification pipe for all pins if requested, otherwise
+ * a Rising Edge callback per pin. Falls back to callbacks if the pipe cannot be opened.
+ */
+static int pigpiod_sensor_start(const HalSensor *list, int count, unsigned glitch_us, HalEdgeFunc on_edge) {
+    if (count < 1 || count > HAL_MAX_SENSORS) return -1;
+    edge_sink = on_edge;
+    num_sensors = count;
+    memcpy(sensors, list, sizeof(HalSensor) * (size_t)count);
+
+    for (int s = 0; s < num_sensors; s++) {
+        if (sensors[s].gpio > 31) return -1;
+        set_mode(pi, sensors[s].gpio, PI_INPUT);
+        set_pull_up_down(pi, sensors[s].gpio, PI_PUD_UP); // Internal Pull-Up
+        set_glitch_filter(pi, sensors[s].gpio, glitch_us); // Hardware debouncing
+        callback_ids[s] = -1;
+    }
+
+    if (hal_ingest_mode == HAL_INGEST_NOTIFY && start_notify_ingest() != 0) {
+        log_warn("Notification pipe unavailable, falling back to callbacks\n");
+        hal_ingest_mode = HAL_INGEST_CALLBACK;
+    }
+    if (hal_ingest_mode == HAL_INGEST_CALLBACK) {
+        for (int s = 0; s < num_sensors; s++) {
+            callback_ids[s] = callback_ex(pi, sensors[s].gpio, RISING_EDGE, pigpiod_edge_callback, &sensors[s]);
+            if (callback_ids[s] < 0) return -1;
+        }
+    }
+    log_text(LOG_LVL_INFO, "Edge ingestion: %s\n", hal_ingest_mode == HAL_INGEST_NOTIFY ? "notification pipe" : "callback");
+    return 0;
+}
+
+static void pigpiod_sensor_stop(void) {
+    for (int s = 0; s < num_sensors; s++) {
+        if (callback_ids[s] >= 0) callback_cancel(callback_ids[s]);
+        callback_ids[s] = -1;
+    }
+    if (notify_handle >= 0) {
+        notify_close(pi, notify_handle); // Closes the pipe, which ends notify_thread
+        pthread_join(notify_tid, NULL);
+        close(notify_fd);
+        notify_handle = -1;
+        notify_fd = -1;
+    }
+}
+
+const HalBackend hal_pigpiod = {
+    .name         = "pigpiod",
+    .init         = pigpiod_init,
+    .shutdown     = pigpiod_shutdown,
+    .set_output   = pigpiod_set_output,
+    .write        = pigpiod_write,
+    .read         = pigpiod_read,
+    .write_bank   = pigpiod_write_bank,
+    .hw_pwm       = pigpiod_hw_pwm,
+    .sw_pwm       = pigpiod_sw_pwm,
+    .tick         = pigpiod_tick,
+    .sensor_start = pigpiod_sensor_start,
+    .sensor_stop  = pigpiod_sensor_stop,
+};
@@ -0,0 +1,364 @@
+/*
+ * ======================================================================================
+ * PROJECT:       PARMCO (Phone APP RP4 Motor Control)
+ * FILE:          hal_sim.c
+ * AUTHOR:        Group 1
+ *
+ * DESCRIPTION:
+ * HAL backend with no hardware at all: every motor is a simulated plant and
+ * its IR sensor edges are synthesized, so the whole server (PID, profiles,
+ * calibration, transports) can be run, regression-tested and benchmarked on
+ * any Linux machine.
+ *
+ * PLANT (one per motor, first order):
+ *   drive   = (duty - dead) / (1 - dead)     when master is on and DIR_A != DIR_B, else 0
+ *   target  = gain * (drive - load - disturbance)   (RPM, never below 0)
+ *   dRPM/dt = (target - RPM) / tau           tau = time constant (inertia)
+ * The disturbance is a square wave of amplitude 'dist' and period 'distper'.
+ *
+ * SENSOR:
+ * The shaft angle is integrated from the RPM; each 1/edges_per_rev of a turn
+ * gives a rising edge and half way between a falling edge, timed to the
+ * microsecond inside the integration step. Optional noise: Gaussian timing
+ * jitter on every edge, and spurious pulses (random width, 10 - 300 us) at a
+ * mean rate per second. Pulses shorter than the sensor glitch filter are
+ * dropped, as the hardware backends' filters would.
+ *
+ * TIME:
+ * The tick runs 'speed' times faster than CLOCK_MONOTONIC and the control
+ * thread shortens its period to match (time_scale()), so the control loop
+ * still sees control_rate_hz steps per simulated second. The plant is
+ * advanced inside tick(), in SIM_STEP_US steps, and the edges of each step are
+ * handed to on_edge (rpm_callback) right there, before control_step() drains
+ * them: the control thread is both producer and consumer of the edge ring.
+ * Timers on the I/O side (telemetry, frames) stay in real time.
+ *
+ * OPTIONS (-b sim:key=value,...):
+ *   gain=<rpm>     RPM at 100 % duty, no load (default 6000)
+ *   tau=<s>        Time constant (default 0.3)
+ *   dead=<frac>    Duty below which the motor does not turn (default 0.08)
+ *   load=<frac>    Constant load, as a fraction of full drive (default 0)
+ *   dist=<frac>    Load disturbance amplitude (default 0, off)
+ *   distper=<s>    Disturbance period (default 4)
+ *   jitter=<us>    Edge timing noise, standard deviation (default 0)
+ *   glitch=<n>     Spurious sensor pulses per second (default 0)
+ *   speed=<x>      Simulated seconds per real second, 1 - 1000 (default 1)
+ *   seed=<n>       Noise generator seed (default 1)
+ * ======================================================================================
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdatomic.h>
+#include "hal.h"
+#include "parmco_log.h"
+
+#define SIM_MAX_GPIO 64
+#define SIM_STEP_US 100             // Plant integration step (simulated time)
+#define SIM_GLITCH_MIN_US 10        // Spurious pulse width range
+#define SIM_GLITCH_MAX_US 300
+#define SIM_MAX_SPEED 1000
+#define SIM_TEXT_MAX 32
+
+typedef struct {
+    double gain, tau, dead, load, dist, dist_period;
+    double jitter_us, glitch_rate;
+    unsigned speed;
+    uint64_t seed;
+} SimConfig;
+
+typedef struct {
+    unsigned sensor_gpio, master, dir_a, dir_b, pwm;
+    int edges_per_rev;
+    void *ctx;                      // Sensor ctx, set by sensor_start()
+    double rpm;
+    double half_edges;              // Shaft angle in half edge periods
+    int64_t half_count;             // Whole half periods already emitted
+    uint32_t last_edge;             // Last tick handed to on_edge (kept increasing)
+    int have_edge;
+} SimMotor;
+
+static SimConfig cfg = {
+    .gain = 6000, .tau = 0.3, .dead = 0.08, .dist_period = 4, .speed = 1, .seed = 1,
+};
+
+// Pin state, written by whichever thread drives the pins, read by tick()
+static atomic_uint pin_level[SIM_MAX_GPIO];
+static atomic_uint pin_duty[SIM_MAX_GPIO];
+
+static SimMotor sim_motors[HAL_MAX_SENSORS];
+static int num_sim_motors = 0;
+static HalEdgeFunc edge_sink = NULL;
+static unsigned glitch_filter_us = 0;
+
+// Simulated clock
+static int64_t start_real_us, start_sim_us;
+static int64_t plant_us;            // Time the plant has been advanced to
+static double step_alpha;           // 1 - exp(-SIM_STEP_US / tau)
+static uint64_t rng_state;
+
+// --- NOISE ---
+
+static uint64_t rng_next(void) {
+    // xorshift64*
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return rng_state * 0x2545F4914F6CDD1DULL;
+}
+
+static double rng_uniform(void) {
+    return (rng_next() >> 11) * (1.0 / 9007199254740992.0); // [0, 1)
+}
+
+static double rng_gauss(void) {
+    // Box-Muller
+    double u = rng_uniform(), v = rng_uniform();
+    return sqrt(-2.0 * log(1.0 - u)) * cos(2 * M_PI * v);
+}
+
+// --- OPTIONS ---
+
+/*
+ * FUNCTION: hal_sim_configure
+ * ---------------------------
+ * Parses the "-b sim:" options (see OPTIONS). Returns 0, or -1 (message printed).
+ */
+int hal_sim_configure(const char *opts) {
+    SimConfig next = cfg;
+    const char *s = opts;
+
+    while (*s != '\0') {
+        char key[SIM_TEXT_MAX], *stop;
+        size_t len = strcspn(s, ",");
+        const char *eq = memchr(s, '=', len);
+        if (eq == NULL || (size_t)(eq - s) >= sizeof(key)) {
+            fprintf(stderr, "sim: expected key=value in '%.*s'\n", (int)len, s);
+            return -1;
+        }
+        memcpy(key, s, (size_t)(eq - s));
+        key[eq - s] = '\0';
+        double v = strtod(eq + 1, &stop);
+        if (stop != s + len || stop == eq + 1 || !isfinite(v)) {
+            fprintf(stderr, "sim: bad value for '%s'\n", key);
+            return -1;
+        }
+
+        int ok;
+        if (strcmp(key, "gain") == 0) ok = (v > 0 && v <= 100000) && (next.gain = v, 1);
+        else if (strcmp(key, "tau") == 0) ok = (v >= 0.001 && v <= 100) && (next.tau = v, 1);
+        else if (strcmp(key, "dead") == 0) ok = (v >= 0 && v < 1) && (next.dead = v, 1);
+        else if (strcmp(key, "load") == 0) ok = (v >= 0 && v <= 1) && (next.load = v, 1);
+        else if (strcmp(key, "dist") == 0) ok = (v >= 0 && v <= 1) && (next.dist = v, 1);
+        else if (strcmp(key, "distper") == 0) ok = (v >= 0.01 && v <= 3600) && (next.dist_period = v, 1);
+        else if (strcmp(key, "jitter") == 0) ok = (v >= 0 && v <= 10000) && (next.jitter_us = v, 1);
+        else if (strcmp(key, "glitch") == 0) ok = (v >= 0 && v <= 10000) && (next.glitch_rate = v, 1);
+        else if (strcmp(key, "speed") == 0) ok = (v >= 1 && v <= SIM_MAX_SPEED && v == floor(v)) && (next.speed = (unsigned)v, 1);
+        else if (strcmp(key, "seed") == 0) ok = (v >= 1 && v == floor(v)) && (next.seed = (uint64_t)v, 1);
+        else { fprintf(stderr, "sim: unknown option '%s'\n", key); return -1; }
+        if (!ok) { fprintf(stderr, "sim: '%s' out of range\n", key); return -1; }
+
+        s += len;
+        if (*s == ',') s++;
+    }
+    cfg = next;
+    return 0;
+}
+
+/*
+ * FUNCTION: hal_sim_bind
+ * ----------------------
+ * Tells the simulator which pins make up one motor (called once per motor,
+ * before sensor_start). The sensor pin identifies the motor.
+ */
+int hal_sim_bind(unsigned sensor_gpio, unsigned master, unsigned dir_a, unsigned dir_b,
+                 unsigned pwm, int edges_per_rev) {
+    if (num_sim_motors == HAL_MAX_SENSORS || edges_per_rev < 1 || sensor_gpio >= SIM_MAX_GPIO ||
+        master >= SIM_MAX_GPIO || dir_a >= SIM_MAX_GPIO || dir_b >= SIM_MAX_GPIO || pwm >= SIM_MAX_GPIO) return -1;
+    SimMotor *sm = &sim_motors[num_sim_motors++];
+    memset(sm, 0, sizeof(*sm));
+    sm->sensor_gpio = sensor_gpio;
+    sm->master = master;
+    sm->dir_a = dir_a;
+    sm->dir_b = dir_b;
+    sm->pwm = pwm;
+    sm->edges_per_rev = edges_per_rev;
+    return 0;
+}
+
+// --- PLANT ---
+
+static int64_t sim_now_us(void) {
+    return start_sim_us + (monotonic_us() - start_real_us) * (int64_t)cfg.speed;
+}
+
+static void emit_edge(SimMotor *sm, double t_us, uint32_t level) {
+    uint32_t tick = (uint32_t)(int64_t)t_us;
+    if (sm->have_edge && (int32_t)(tick - sm->last_edge) <= 0) tick = sm->last_edge + 1;
+    sm->last_edge = tick;
+    sm->have_edge = 1;
+    edge_sink(sm->ctx, tick, level);
+}
+
+/*
+ * FUNCTION: plant_step
+ * --------------------
+ * Advances one motor by SIM_STEP_US ending at 't_end' and emits the sensor
+ * edges that fall inside the step.
+ */
+static void plant_step(SimMotor *sm, int64_t t_end, double disturbance) {
+    unsigned level = atomic_load_explicit(&pin_level[sm->master], memory_order_relaxed);
+    unsigned a = atomic_load_explicit(&pin_level[sm->dir_a], memory_order_relaxed);
+    unsigned b = atomic_load_explicit(&pin_level[sm->dir_b], memory_order_relaxed);
+    double duty = atomic_load_explicit(&pin_duty[sm->pwm], memory_order_relaxed) / 1000000.0;
+
+    double drive = (level && a != b && duty > cfg.dead) ? (duty - cfg.dead) / (1.0 - cfg.dead) : 0;
+    double target = cfg.gain * (drive - cfg.load - disturbance);
+    if (target < 0) target = 0;
+
+    double rpm_start = sm->rpm;
+    sm->rpm += (target - sm->rpm) * step_alpha;
+
+    // Angle advanced over the step (trapezoidal), in half edge periods
+    double half_per_us = sm->edges_per_rev * 2 / 60e6;
+    double h0 = sm->half_edges;
+    double h1 = h0 + (rpm_start + sm->rpm) * 0.5 * half_per_us * SIM_STEP_US;
+    sm->half_edges = h1;
+    if (sm->ctx == NULL) { sm->half_count = (int64_t)h1; return; }
+
+    double t0 = (double)(t_end - SIM_STEP_US);
+    while (sm->half_count + 1 <= h1) {
+        sm->half_count++;
+        double t = t0 + SIM_STEP_US * (sm->half_count - h0) / (h1 - h0);
+        if (cfg.jitter_us > 0) t += rng_gauss() * cfg.jitter_us;
+        emit_edge(sm, t, (sm->half_count % 2 == 0) ? 1 : 0);
+    }
+
+    if (cfg.glitch_rate > 0 && rng_uniform() < cfg.glitch_rate * SIM_STEP_US / 1e6) {
+        double width = SIM_GLITCH_MIN_US + rng_uniform() * (SIM_GLITCH_MAX_US - SIM_GLITCH_MIN_US);
+        if (width >= glitch_filter_us) {
+            double t = t0 + rng_uniform() * SIM_STEP_US;
+            emit_edge(sm, t, 1);
+            emit_edge(sm, t + width, 0);
+        }
+    }
+}
+
+/*
+ * FUNCTION: sim_tick
+ * ------------------
+ * Current simulated time. Advances every plant up to it first, so the edges
+ * up to "now" are already in the edge rings when control_step() runs.
+ */
+static uint32_t sim_tick(void) {
+    int64_t now = sim_now_us();
+
+    while (plant_us + SIM_STEP_US <= now) {
+        plant_us += SIM_STEP_US;
+        double disturbance = 0;
+        if (cfg.dist > 0 && fmod(plant_us / 1e6, cfg.dist_period) >= cfg.dist_period / 2) disturbance = cfg.dist;
+        for (int i = 0; i < num_sim_motors; i++) plant_step(&sim_motors[i], plant_us, disturbance);
+    }
+    return (uint32_t)now;
+}
+
+static unsigned sim_time_scale(void) {
+    return cfg.speed;
+}
+
+// --- PINS ---
+
+static int sim_init(void) {
+    start_real_us = monotonic_us();
+    start_sim_us = start_real_us;
+    plant_us = start_sim_us;
+    step_alpha = 1.0 - exp(-SIM_STEP_US / (cfg.tau * 1e6));
+    rng_state = cfg.seed;
+    log_info("Simulated plant: %.0f RPM at 100%%, tau %.3f s, dead band %.0f%%, load %.0f%%, speed x%d\n",
+             cfg.gain, cfg.tau, cfg.dead * 100, cfg.load * 100, cfg.speed);
+    if (cfg.dist > 0 || cfg.jitter_us > 0 || cfg.glitch_rate > 0) {
+        log_info("Simulated noise: disturbance %.0f%% every %.2f s, edge jitter %.1f us, %.1f glitches/s\n",
+                 cfg.dist * 100, cfg.dist_period, cfg.jitter_us, cfg.glitch_rate);
+    }
+    return 0;
+}
+
+static void sim_shutdown(void) {
+    num_sim_motors = 0;
+}
+
+static int sim_set_output(unsigned gpio) {
+    return (gpio < SIM_MAX_GPIO) ? 0 : -1;
+}
+
+static int sim_write(unsigned gpio, unsigned level) {
+    if (gpio >= SIM_MAX_GPIO) return -1;
+    atomic_store_explicit(&pin_level[gpio], level ? 1 : 0, memory_order_relaxed);
+    return 0;
+}
+
+static int sim_read(unsigned gpio) {
+    if (gpio >= SIM_MAX_GPIO) return -1;
+    return (int)atomic_load_explicit(&pin_level[gpio], memory_order_relaxed);
+}
+
+static int sim_write_bank(uint32_t set_mask, uint32_t clear_mask) {
+    for (unsigned gpio = 0; gpio < 32; gpio++) {
+        if (clear_mask & (1u << gpio)) atomic_store_explicit(&pin_level[gpio], 0, memory_order_relaxed);
+    }
+    for (unsigned gpio = 0; gpio < 32; gpio++) {
+        if (set_mask & (1u << gpio)) atomic_store_explicit(&pin_level[gpio], 1, memory_order_relaxed);
+    }
+    return 0;
+}
+
+static int sim_pwm(unsigned gpio, unsigned freq, uint32_t duty) {
+    if (gpio >= SIM_MAX_GPIO || freq == 0 || duty > 1000000) return -1;
+    atomic_store_explicit(&pin_duty[gpio], duty, memory_order_relaxed);
+    return 0;
+}
+
+// --- SENSORS ---
+
+static int sim_sensor_start(const HalSensor *list, int count, unsigned glitch_us, HalEdgeFunc on_edge) {
+    for (int s = 0; s < count; s++) {
+        int found = 0;
+        for (int i = 0; i < num_sim_motors; i++) {
+            if (sim_motors[i].sensor_gpio == list[s].gpio) { sim_motors[i].ctx = list[s].ctx; found = 1; }
+        }
+        if (!found) {
+            log_error("sim: no motor bound to sensor GPIO %d\n", list[s].gpio);
+            return -1;
+        }
+    }
+    glitch_filter_us = glitch_us;
+    edge_sink = on_edge;
+
+    // Restarted after the server idled: the motors were stopped, so skip that time instead of replaying it
+    int64_t behind = sim_now_us() - plant_us;
+    if (behind > SIM_STEP_US) plant_us += behind - behind % SIM_STEP_US;
+    log_info("Edge ingestion: simulated (%d sensors)\n", count);
+    return 0;
+}
+
+static void sim_sensor_stop(void) {
+    for (int i = 0; i < num_sim_motors; i++) sim_motors[i].ctx = NULL;
+}
+
+const HalBackend hal_sim = {
+    .name = "sim",
+    .init = sim_init,
+    .shutdown = sim_shutdown,
+    .set_output = sim_set_output,
+    .write = sim_write,
+    .read = sim_read,
+    .write_bank = sim_write_bank,
+    .hw_pwm = sim_pwm,
+    .sw_pwm = sim_pwm,
+    .tick = sim_tick,
+    .sensor_start = sim_sensor_start,
+    .sensor_stop = sim_sensor_stop,
+    .time_scale = sim_time_scale,
+};
@@ -0,0 +1,56 @@
+/*
+ * ======================================================================================
+ * PROJECT:       PARMCO (Phone APP RP4 Motor Control)
+ * FILE:          latency.c
+ * AUTHOR:        Group 1
+ *
+ * DESCRIPTION:
+ * Histogram percentiles and report formatting (see latency.h).
+ * ======================================================================================
+ */
+
+#include <stdio.h>
+#include "latency.h"
+
+static const char *stage_names[LAT_STAGES] = {
+    "read", "parse", "apply", "pid", "hw_write", "cmd_to_pwm",
+    "edge_to_pid", "edge_to_telem", "telem_send",
+};
+
+/*
+ * FUNCTION: bucket_floor
+ * ----------------------
+ * Smallest value that lands in bucket 'b' (inverse of lat_bucket).
+ */
+static uint32_t bucket_floor(int b) {
+    if (b < LAT_LINEAR) return (uint32_t)b;
+    int e = 6 + (b - LAT_LINEAR) / (1 << LAT_SUB_BITS);
+    uint32_t sub = (uint32_t)((b - LAT_LINEAR) % (1 << LAT_SUB_BITS));
+    return (1u << e) + (sub << (e - LAT_SUB_BITS));
+}
+
+uint32_t lat_percentile(const LatHist *h, int permille) {
+    if (h->count == 0) return 0;
+    uint64_t rank = ((uint64_t)h->count * (uint64_t)permille + 999) / 1000; // 1-based, rounded up
+    if (rank == 0) rank = 1;
+
+    uint64_t seen = 0;
+    for (int b = 0; b < LAT_BUCKETS; b++) {
+        seen += h->buckets[b];
+        if (seen >= rank) {
+            uint32_t v = bucket_floor(b);
+            return (v < h->max) ? v : h->max;
+        }
+    }
+    return h->max;
+}
+
+const char *lat_stage_name(LatStage stage) {
+    return (stage >= 0 && stage < LAT_STAGES) ? stage_names[stage] : "?";
+}
+
+int lat_format(const LatHist *h, const char *name, char *out, int cap) {
+    int len = snprintf(out, (size_t)cap, "%s,%u,%u,%u,%u", name, h->count,
+                       lat_percentile(h, 500), lat_percentile(h, 990), h->max);
+    return (len < cap) ? len : cap - 1;
+}
@@ -0,0 +1,102 @@
+/*
+ * ======================================================================================
+ * PROJECT:       PARMCO (Phone APP RP4 Motor Control)
+ * FILE:          latency.h
+ * AUTHOR:        Group 1
+ *
+ * DESCRIPTION:
+ * Pipeline latency histograms for benchmarking parmco_server (-L). Each
+ * stage of the command and sensor paths is timestamped with monotonic_us()
+ * and its latency added to a histogram; the 'L' command returns
+ * count / p50 / p99 / max per stage and starts a new measurement.
+ *
+ * STAGES:
+ *   read          epoll wake-up -> read() returned the bytes
+ *   parse         read() returned -> command about to run (decode and lock wait included)
+ *   apply         first command of a batch -> whole batch applied and its pins written
+ *   pid           one PID update (control thread)
+ *   hw_write      one PWM write through the HAL (either thread)
+ *   cmd_to_pwm    read() returned -> first PWM write after the command
+ *                 (Manual: inside 'apply'; Auto: at the next PID update)
+ *   edge_to_pid   sensor edge timestamp -> edge drained by the control thread
+ *   edge_to_telem newest edge in a telemetry message -> message written to the sockets
+ *   telem_send    one telemetry fan-out (encode + write to every client)
+ *
+ * HISTOGRAM:
+ * Log-linear buckets: 1 unit wide up to 64, then 32 buckets per power of two
+ * (about 3 % resolution) up to 2^LAT_MAX_POW. Percentiles report the bucket's
+ * lower bound; max is exact. Recording is a few adds, no locks, no syscalls.
+ * The unit is the caller's: the -L stages are in microseconds, the always-on
+ * loop counters ('?') use nanoseconds for the short durations.
+ * A histogram has one writer at a time: parmco_server records every stage
+ * either on the I/O thread or with state_lock held, and reports under the lock.
+ * ======================================================================================
+ */
+
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <stdint.h>
+
+#define LAT_LINEAR 64                 // 1-unit buckets below this
+#define LAT_SUB_BITS 5                // 32 buckets per power of two above it
+#define LAT_MAX_POW 26                // Values up to 2^26 (67 s in us, 67 ms in ns); larger ones land in the top bucket
+#define LAT_BUCKETS (LAT_LINEAR + (LAT_MAX_POW - 6) * (1 << LAT_SUB_BITS))
+#define LAT_REPORT_MAX 64             // Longest lat_format() line
+
+#define LAT_CMD_REPORT 'L'            // Protocol: send the report and reset (any client)
+
+typedef enum {
+    LAT_READ, LAT_PARSE, LAT_APPLY, LAT_PID, LAT_HW_WRITE, LAT_CMD_TO_PWM,
+    LAT_EDGE_TO_PID, LAT_EDGE_TO_TELEM, LAT_TELEM_SEND, LAT_STAGES
+} LatStage;
+
+typedef struct {
+    uint32_t count;
+    uint32_t max;
+    uint64_t sum;
+    uint32_t buckets[LAT_BUCKETS];
+} LatHist;
+
+/*
+ * FUNCTION: lat_bucket
+ * --------------------
+ * Bucket index of a value.
+ */
+static inline int lat_bucket(uint32_t v) {
+    if (v < LAT_LINEAR) return (int)v;
+    int e = 31 - __builtin_clz(v);    // v >= 64, so e >= 6
+    if (e >= LAT_MAX_POW) return LAT_BUCKETS - 1;
+    return LAT_LINEAR + (e - 6) * (1 << LAT_SUB_BITS) + (int)((v >> (e - LAT_SUB_BITS)) & ((1 << LAT_SUB_BITS) - 1));
+}
+
+static inline void lat_record(LatHist *h, int64_t value) {
+    uint32_t v = (value < 0) ? 0 : (value > UINT32_MAX) ? UINT32_MAX : (uint32_t)value;
+    h->count++;
+    h->sum += v;
+    if (v > h->max) h->max = v;
+    h->buckets[lat_bucket(v)]++;
+}
+
+/*
+ * FUNCTION: lat_percentile
+ * ------------------------
+ * Value below which 'permille' / 1000 of the samples fall. 0 if empty.
+ */
+uint32_t lat_percentile(const LatHist *h, int permille);
+
+/*
+ * FUNCTION: lat_stage_name
+ * ------------------------
+ * Short name used in reports ("read", "cmd_to_pwm", ...).
+ */
+const char *lat_stage_name(LatStage stage);
+
+/*
+ * FUNCTION: lat_format
+ * --------------------
+ * "<name>,<count>,<p50>,<p99>,<max>" into 'out'. Returns the length.
+ */
+int lat_format(const LatHist *h, const char *name, char *out, int cap);
+
+#endif // LATENCY_H
@@ -0,0 +1,194 @@
+/*
+ * ======================================================================================
+ * PROJECT:       PARMCO (Phone APP RP4 Motor Control)
+ * FILE:          motor_config.c
+ * AUTHOR:        Group 1
+ *
+ * DESCRIPTION:
+ * Motor table file parser and checks (see motor_config.h). Runs once at
+ * startup, before any pin is touched, so errors go straight to stderr.
+ * ======================================================================================
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "motor_config.h"
+
+#define MAX_GPIO 27                 // Highest GPIO on the 40-pin header
+
+void motor_config_default(MotorConfig *cfg) {
+    cfg->id = 0;
+    cfg->master_pin = DEFAULT_MASTER_ON_PIN;
+    cfg->dir_a_pin = DEFAULT_DIR_A_PIN;
+    cfg->dir_b_pin = DEFAULT_DIR_B_PIN;
+    cfg->pwm_pin = DEFAULT_SPEED_PIN;
+    cfg->pwm_mode = PWM_HARDWARE;
+    cfg->pwm_freq = DEFAULT_PWM_FREQ;
+    cfg->sensor_pin = DEFAULT_SENSOR_PIN;
+    cfg->edges_per_rev = DEFAULT_EDGES_PER_REV;
+}
+
+static char *trim(char *s) {
+    while (isspace((unsigned char)*s)) s++;
+    char *end = s + strlen(s);
+    while (end > s && isspace((unsigned char)end[-1])) end--;
+    *end = '\0';
+    return s;
+}
+
+/*
+ * FUNCTION: parse_uint
+ * --------------------
+ * Strict decimal parse (no sign, no trailing junk). Returns 0 on success.
+ */
+static int parse_uint(const char *s, unsigned *out) {
+    char *end;
+    if (!isdigit((unsigned char)*s)) return -1;
+    unsigned long v = strtoul(s, &end, 10);
+    if (*end != '\0' || v > 1000000) return -1;
+    *out = (unsigned)v;
+    return 0;
+}
+
+/*
+ * FUNCTION: set_key
+ * -----------------
+ * Applies one "key = value" line to a motor. Returns 0 if the key is known
+ * and the value valid.
+ */
+static int set_key(MotorConfig *m, const char *key, const char *value) {
+    unsigned v;
+
+    if (strcmp(key, "pwm_mode") == 0) {
+        if (strcmp(value, "hardware") == 0) m->pwm_mode = PWM_HARDWARE;
+        else if (strcmp(value, "software") == 0) m->pwm_mode = PWM_SOFTWARE;
+        else return -1;
+        return 0;
+    }
+    if (parse_uint(value, &v) != 0) return -1;
+
+    if (strcmp(key, "master") == 0) m->master_pin = v;
+    else if (strcmp(key, "dir_a") == 0) m->dir_a_pin = v;
+    else if (strcmp(key, "dir_b") == 0) m->dir_b_pin = v;
+    else if (strcmp(key, "pwm") == 0) m->pwm_pin = v;
+    else if (strcmp(key, "pwm_freq") == 0) m->pwm_freq = v;
+    else if (strcmp(key, "sensor") == 0) m->sensor_pin = v;
+    else if (strcmp(key, "edges_per_rev") == 0) m->edges_per_rev = (int)v;
+    else return -1;
+    return 0;
+}
+
+int motor_config_load(const char *path, MotorConfig *out, int max) {
+    char line[256];
+    int count = 0, line_no = 0;
+    MotorConfig *cur = NULL;
+
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL) { perror(path); return -1; }
+
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        line_no++;
+        char *comment = strpbrk(line, "#;");
+        if (comment) *comment = '\0';
+        char *s = trim(line);
+        if (*s == '\0') continue;
+
+        if (*s == '[') {
+            unsigned id;
+            char *close = strchr(s, ']');
+            if (close == NULL || close[1] != '\0') goto bad_line;
+            *close = '\0';
+            char *name = trim(s + 1);
+            if (strncmp(name, "motor", 5) != 0 || parse_uint(trim(name + 5), &id) != 0 || id > MAX_MOTOR_ID) goto bad_line;
+            if (count == max) {
+                fprintf(stderr, "%s:%d: more than %d motors\n", path, line_no, max);
+                fclose(fp);
+                return -1;
+            }
+            cur = &out[count++];
+            motor_config_default(cur);
+            cur->id = (int)id;
+            continue;
+        }
+
+        char *eq = strchr(s, '=');
+        if (cur == NULL || eq == NULL) goto bad_line;
+        *eq = '\0';
+        if (set_key(cur, trim(s), trim(eq + 1)) != 0) {
+            fprintf(stderr, "%s:%d: bad key or value '%s'\n", path, line_no, trim(s));
+            fclose(fp);
+            return -1;
+        }
+    }
+    fclose(fp);
+
+    if (count == 0) fprintf(stderr, "%s: no [motor <id>] sections\n", path);
+    return count ? count : -1;
+
+bad_line:
+    fprintf(stderr, "%s:%d: expected '[motor <id>]' or 'key = value'\n", path, line_no);
+    fclose(fp);
+    return -1;
+}
+
+/*
+ * FUNCTION: pwm_channel
+ * ---------------------
+ * BCM PWM channel of a hardware PWM pin, or -1 if the pin has none.
+ */
+static int pwm_channel(unsigned gpio) {
+    switch (gpio) {
+        case 12: case 18: return 0;
+        case 13: case 19: return 1;
+        default: return -1;
+    }
+}
+
+int motor_config_validate(const MotorConfig *cfg, int count, int have_sw_pwm) {
+    int pin_owner[MAX_GPIO + 1];
+    int channel_owner[2] = { -1, -1 };
+
+    for (int p = 0; p <= MAX_GPIO; p++) pin_owner[p] = -1;
+
+    for (int i = 0; i < count; i++) {
+        const MotorConfig *m = &cfg[i];
+        unsigned pins[5] = { m->master_pin, m->dir_a_pin, m->dir_b_pin, m->pwm_pin, m->sensor_pin };
+
+        for (int j = 0; j < i; j++) {
+            if (cfg[j].id == m->id) { fprintf(stderr, "Motor %d: duplicate ID\n", m->id); return -1; }
+        }
+        for (int k = 0; k < 5; k++) {
+            if (pins[k] > MAX_GPIO) { fprintf(stderr, "Motor %d: GPIO %u is not on the header\n", m->id, pins[k]); return -1; }
+            if (pin_owner[pins[k]] >= 0) {
+                fprintf(stderr, "Motor %d: GPIO %u already used by motor %d\n", m->id, pins[k], pin_owner[pins[k]]);
+                return -1;
+            }
+            pin_owner[pins[k]] = m->id;
+        }
+        if (m->pwm_freq == 0 || m->edges_per_rev < 1) {
+            fprintf(stderr, "Motor %d: pwm_freq and edges_per_rev must be at least 1\n", m->id);
+            return -1;
+        }
+
+        if (m->pwm_mode == PWM_HARDWARE) {
+            int ch = pwm_channel(m->pwm_pin);
+            if (ch < 0) {
+                fprintf(stderr, "Motor %d: GPIO %u has no hardware PWM (use 12, 13, 18 or 19, or pwm_mode = software)\n",
+                        m->id, m->pwm_pin);
+                return -1;
+            }
+            if (channel_owner[ch] >= 0) {
+                fprintf(stderr, "Motor %d: PWM channel %d already used by motor %d (use pwm_mode = software)\n",
+                        m->id, ch, channel_owner[ch]);
+                return -1;
+            }
+            channel_owner[ch] = m->id;
+        } else if (!have_sw_pwm) {
+            fprintf(stderr, "Motor %d: software PWM needs the pigpiod backend\n", m->id);
+            return -1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,80 @@
+/*
+ * ======================================================================================
+ * PROJECT:       PARMCO (Phone APP RP4 Motor Control)
+ * FILE:          motor_config.h
+ * AUTHOR:        Group 1
+ *
+ * DESCRIPTION:
+ * Motor table for parmco_server. One process drives up to MAX_MOTORS motors,
+ * each with its own H-Bridge pins, PWM output and speed sensor. The table is
+ * read from a small INI-style file (parmco_server -m <file>, see motors.conf):
+ *
+ *   [motor 0]              ; ID used to address the motor ("@0" on the wire)
+ *   master = 17            ; Master enable pin
+ *   dir_a = 27             ; H-Bridge input 1
+ *   dir_b = 22             ; H-Bridge input 2
+ *   pwm = 18               ; Speed pin
+ *   pwm_mode = hardware    ; hardware (GPIO 12/13/18/19) or software (any pin, pigpiod only)
+ *   pwm_freq = 1000        ; Hz
+ *   sensor = 23            ; IR speed sensor input
+ *   edges_per_rev = 3      ; Rising edges per revolution (fan blades)
+ *
+ * Keys that are left out keep the defaults below. Without a file, the server
+ * runs the single built-in motor above (the original wiring).
+ * ======================================================================================
+ */
+
+#ifndef MOTOR_CONFIG_H
+#define MOTOR_CONFIG_H
+
+#define MAX_MOTORS 8
+#define MAX_MOTOR_ID 99             // IDs are 0 - 99 so "@<id>" stays short
+
+// Defaults (the original single-motor wiring, BCM numbering)
+#define DEFAULT_MASTER_ON_PIN 17
+#define DEFAULT_DIR_A_PIN     27
+#define DEFAULT_DIR_B_PIN     22
+#define DEFAULT_SPEED_PIN     18
+#define DEFAULT_SENSOR_PIN    23
+#define DEFAULT_PWM_FREQ      1000
+#define DEFAULT_EDGES_PER_REV 3
+
+typedef enum { PWM_HARDWARE, PWM_SOFTWARE } PwmMode;
+
+typedef struct {
+    int id;
+    unsigned master_pin;
+    unsigned dir_a_pin;
+    unsigned dir_b_pin;
+    unsigned pwm_pin;
+    PwmMode pwm_mode;
+    unsigned pwm_freq;
+    unsigned sensor_pin;
+    int edges_per_rev;
+} MotorConfig;
+
+/*
+ * FUNCTION: motor_config_default
+ * ------------------------------
+ * Fills 'cfg' with the built-in single motor (ID 0).
+ */
+void motor_config_default(MotorConfig *cfg);
+
+/*
+ * FUNCTION: motor_config_load
+ * ---------------------------
+ * Reads up to 'max' motors from 'path' into 'out'. Returns the number of
+ * motors, or -1 (with the file name and line printed to stderr) on error.
+ */
+int motor_config_load(const char *path, MotorConfig *out, int max);
+
+/*
+ * FUNCTION: motor_config_validate
+ * -------------------------------
+ * Checks a motor table against the Pi: unique IDs, pins in GPIO 0 - 27 and
+ * used once, hardware PWM only on a PWM pin with one motor per channel, and
+ * software PWM only if the backend has it. Returns 0 if the table is usable.
+ */
+int motor_config_validate(const MotorConfig *cfg, int count, int have_sw_pwm);
+
+#endif // MOTOR_CONFIG_H
@@ -0,0 +1,361 @@
+/*
+ * ======================================================================================
+ * PROJECT:       PARMCO (Phone APP RP4 Motor Control)
+ * FILE:          parmco_bench.c
+ * AUTHOR:        Group 1
+ *
+ * DESCRIPTION:
+ * End-to-end latency benchmark for parmco_server. Connects over TCP as the
+ * controller, puts the default motor in Manual mode at 40 % and then toggles
+ * it between 40 % and 50 % ('f' / 'd') every interval. Then it switches to
+ * Auto mode and alternates the target between 2000 and 2500 RPM ('r:'), so
+ * the server's PID update and edge-to-PID stages get samples too. For each
+ * step it measures:
+ * - cmd_to_frame: command written -> first binary telemetry sample showing the
+ *   new duty arrives back (includes the server's -t frame period).
+ * - target_to_frame: the same for an Auto-mode 'r:' step, up to the first
+ *   sample carrying the new target.
+ * - cmd_to_pin (hardware-in-the-loop, -g): command written -> first PWM period
+ *   with the new duty on a GPIO wired to the motor's PWM pin. Edges are
+ *   timestamped by the kernel (GPIO character device), so this is the real
+ *   command-to-pin time, quantized to the PWM period.
+ * At the end it fetches the server's own stage histograms ('L', needs -L)
+ * and prints everything as count / p50 / p99 / max in microseconds.
+ *
+ * MODES:
+ * - Simulated:  make bench-sim (parmco_sim -b sim -L, any Linux machine)
+ * - HIL:        make bench-hil on the Pi, with a jumper from the PWM pin
+ *               (GPIO 18) to the -g input (GPIO 24 by default). The motor
+ *               supply can stay off.
+ *
+ * COMPILE INSTRUCTIONS:
+ * gcc -o parmco_bench parmco_bench.c latency.c -Wall
+ *
+ * USAGE:
+ * parmco_bench [-H <host>] [-p <tcp_port>] [-n <steps>] [-i <interval_ms>] [-g <gpio>]
+ *   -H  Server address (default 127.0.0.1)
+ *   -p  Server TCP port (parmco_server -p, default 5000)
+ *   -n  Number of duty steps, and of target steps (default 200 each)
+ *   -i  Time between steps in ms (default 50)
+ *   -g  HIL: GPIO (gpiochip0 line) the PWM pin is looped back to
+ * ======================================================================================
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <netdb.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/ioctl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <linux/gpio.h>
+#include "telemetry.h"
+#include "latency.h"
+
+#define RX_BUF 16384
+#define STEP_TIMEOUT_MS 1000       // A step that shows no effect by then counts as a timeout
+#define LOW_DUTY 4000              // 40 % in telemetry units (0.01 %)
+#define HIGH_DUTY 5000
+#define LOW_TARGET 2000            // Auto-mode phase, RPM
+#define HIGH_TARGET 2500
+#define DUTY_TOLERANCE 0.05        // Measured pin duty within 5 % of the expected one
+
+typedef struct {
+    int sock;
+    uint8_t rx[RX_BUF];
+    size_t rx_len;
+    int controller;                // CTRL:1 received
+    int motor_id;                  // Default motor (first in MOTORS:), -1 until known
+    int lat_done;                  // LAT:END received
+    char lat_lines[LAT_STAGES + 1][LAT_REPORT_MAX + 8];
+    int lat_count;
+
+    // Current step
+    int64_t sent_ns;               // 0 = no step in flight
+    uint16_t expect_duty;
+    int16_t expect_target;         // Auto-mode phase: wait for this target instead (0 = duty step)
+    int frame_seen, pin_seen;
+
+    // HIL line
+    int line_fd;
+    int64_t last_rise_ns, period_ns;
+
+    LatHist frame_hist, pin_hist, target_hist;
+} Bench;
+
+static int64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// --- SERVER CONNECTION ---
+
+static int connect_server(const char *host, const char *port) {
+    struct addrinfo hints = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM }, *res;
+    int err = getaddrinfo(host, port, &hints, &res);
+    if (err != 0) { fprintf(stderr, "%s: %s\n", host, gai_strerror(err)); return -1; }
+
+    int sock = -1;
+    for (struct addrinfo *ai = res; ai != NULL && sock < 0; ai = ai->ai_next) {
+        sock = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (sock >= 0 && connect(sock, ai->ai_addr, ai->ai_addrlen) != 0) { close(sock); sock = -1; }
+    }
+    freeaddrinfo(res);
+    if (sock < 0) { perror("connect"); return -1; }
+
+    int one = 1;
+    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)); // One command, one segment
+    return sock;
+}
+
+static int send_cmd(Bench *b, const char *cmd) {
+    size_t len = strlen(cmd);
+    return (write(b->sock, cmd, len) == (ssize_t)len) ? 0 : -1;
+}
+
+static void on_line(Bench *b, char *line) {
+    if (strncmp(line, "CTRL:", 5) == 0) b->controller = (line[5] == '1');
+    else if (strncmp(line, "MOTORS:", 7) == 0) b->motor_id = atoi(line + 7);
+    else if (strcmp(line, "LAT:END") == 0) b->lat_done = 1;
+    else if (strcmp(line, "LAT:OFF") == 0) b->lat_done = -1;
+    else if (strncmp(line, "LAT:", 4) == 0 && b->lat_count < LAT_STAGES + 1) {
+        snprintf(b->lat_lines[b->lat_count++], sizeof(b->lat_lines[0]), "%s", line + 4);
+    }
+}
+
+static void on_sample(Bench *b, const TelemetrySample *s, int64_t rx_ns) {
+    if (b->sent_ns == 0 || b->frame_seen || s->motor != b->motor_id) return;
+    if (b->expect_target != 0 ? s->target != b->expect_target : s->duty != b->expect_duty) return;
+    lat_record(b->expect_target != 0 ? &b->target_hist : &b->frame_hist, (rx_ns - b->sent_ns) / 1000);
+    b->frame_seen = 1;
+}
+
+/*
+ * FUNCTION: parse_rx
+ * ------------------
+ * Splits the receive buffer into binary frames (CRC checked) and text lines,
+ * the same way the phone app does.
+ */
+static void parse_rx(Bench *b, int64_t rx_ns) {
+    size_t pos = 0;
+    while (pos < b->rx_len) {
+        uint8_t *p = b->rx + pos;
+        size_t avail = b->rx_len - pos;
+
+        if (p[0] == TELEM_MAGIC0) {
+            if (avail < TELEM_HEADER_SIZE) break;
+            size_t len = TELEM_HEADER_SIZE + (size_t)p[3] * TELEM_SAMPLE_SIZE + TELEM_CRC_SIZE;
+            if (p[1] != TELEM_MAGIC1 || p[3] == 0 || p[3] > TELEM_MAX_SAMPLES) { pos++; continue; }
+            if (avail < len) break;
+            if (telem_crc16(p + 2, len - 2 - TELEM_CRC_SIZE) == telem_get16(p + len - TELEM_CRC_SIZE)) {
+                for (int i = 0; i < p[3]; i++) {
+                    TelemetrySample s;
+                    telem_decode_sample(p, i, &s);
+                    on_sample(b, &s, rx_ns);
+                }
+                pos += len;
+            } else {
+                pos++; // Resynchronize
+            }
+            continue;
+        }
+
+        uint8_t *nl = memchr(p, '\n', avail);
+        if (nl == NULL) break;
+        *nl = '\0';
+        on_line(b, (char *)p);
+        pos += (size_t)(nl - p) + 1;
+    }
+    memmove(b->rx, b->rx + pos, b->rx_len - pos);
+    b->rx_len -= pos;
+    if (b->rx_len == RX_BUF) b->rx_len = 0; // Garbage without a newline: drop it
+}
+
+// --- HIL LOOPBACK PIN ---
+
+static int open_line(unsigned gpio) {
+    struct gpio_v2_line_request req;
+    int chip_fd = open("/dev/gpiochip0", O_RDONLY);
+    if (chip_fd < 0) { perror("/dev/gpiochip0"); return -1; }
+
+    memset(&req, 0, sizeof(req));
+    req.offsets[0] = gpio;
+    req.num_lines = 1;
+    req.event_buffer_size = 1024;
+    strncpy(req.consumer, "parmco_bench", sizeof(req.consumer) - 1);
+    req.config.flags = GPIO_V2_LINE_FLAG_INPUT | GPIO_V2_LINE_FLAG_EDGE_RISING | GPIO_V2_LINE_FLAG_EDGE_FALLING;
+
+    int ret = ioctl(chip_fd, GPIO_V2_GET_LINE_IOCTL, &req);
+    close(chip_fd);
+    if (ret < 0) { perror("GPIO_V2_GET_LINE_IOCTL"); return -1; }
+    return req.fd;
+}
+
+/*
+ * FUNCTION: read_line_events
+ * --------------------------
+ * Tracks the loopback PWM waveform: the period from rising to rising edge and
+ * the duty of each pulse at its falling edge. The first pulse that starts after
+ * the command and has the expected duty ends the step's cmd_to_pin measurement.
+ */
+static void read_line_events(Bench *b) {
+    struct gpio_v2_line_event events[64];
+    ssize_t got = read(b->line_fd, events, sizeof(events));
+    if (got <= 0) return;
+
+    for (int i = 0; i < (int)(got / sizeof(events[0])); i++) {
+        int64_t t = (int64_t)events[i].timestamp_ns; // CLOCK_MONOTONIC
+        if (events[i].id == GPIO_V2_LINE_EVENT_RISING_EDGE) {
+            if (b->last_rise_ns) b->period_ns = t - b->last_rise_ns;
+            b->last_rise_ns = t;
+            continue;
+        }
+        if (b->sent_ns == 0 || b->pin_seen || b->expect_target != 0 || b->period_ns <= 0 || b->last_rise_ns < b->sent_ns) continue;
+        double duty = (double)(t - b->last_rise_ns) / b->period_ns;
+        if (duty > b->expect_duty / 10000.0 - DUTY_TOLERANCE && duty < b->expect_duty / 10000.0 + DUTY_TOLERANCE) {
+            lat_record(&b->pin_hist, (b->last_rise_ns - b->sent_ns) / 1000);
+            b->pin_seen = 1;
+        }
+    }
+}
+
+// --- EVENT PUMP ---
+
+/*
+ * FUNCTION: pump
+ * --------------
+ * Handles socket and line input for up to 'ms' milliseconds, or until 'done'
+ * (when given) becomes true. Returns -1 if the server hung up.
+ */
+static int pump(Bench *b, int ms, int (*done)(const Bench *)) {
+    int64_t deadline = now_ns() + (int64_t)ms * 1000000;
+    struct pollfd fds[2] = { { .fd = b->sock, .events = POLLIN }, { .fd = b->line_fd, .events = POLLIN } };
+    int nfds = (b->line_fd >= 0) ? 2 : 1;
+
+    while (done == NULL || !done(b)) {
+        int64_t left_ms = (deadline - now_ns()) / 1000000;
+        if (left_ms <= 0) break;
+        if (poll(fds, (nfds_t)nfds, (int)left_ms) < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        if (fds[0].revents) {
+            ssize_t n = read(b->sock, b->rx + b->rx_len, RX_BUF - b->rx_len);
+            if (n <= 0) { fprintf(stderr, "Server closed the connection\n"); return -1; }
+            b->rx_len += (size_t)n;
+            parse_rx(b, now_ns());
+        }
+        if (nfds == 2 && fds[1].revents) read_line_events(b);
+    }
+    return 0;
+}
+
+static int have_role(const Bench *b) { return b->controller && b->motor_id >= 0; }
+static int step_done(const Bench *b) { return b->frame_seen && (b->line_fd < 0 || b->expect_target != 0 || b->pin_seen); }
+static int report_done(const Bench *b) { return b->lat_done != 0; }
+
+// --- REPORT ---
+
+static void print_row(const char *name, uint32_t count, uint32_t p50, uint32_t p99, uint32_t max) {
+    printf("  %-16s %8u %8u %8u %8u\n", name, count, p50, p99, max);
+}
+
+static void print_hist(const char *name, const LatHist *h) {
+    print_row(name, h->count, lat_percentile(h, 500), lat_percentile(h, 990), h->max);
+}
+
+int main(int argc, char **argv) {
+    const char *host = "127.0.0.1", *port = "5000";
+    int steps = 200, interval_ms = 50, gpio = -1, opt_c;
+
+    while ((opt_c = getopt(argc, argv, "H:p:n:i:g:")) != -1) {
+        switch (opt_c) {
+            case 'H': host = optarg; break;
+            case 'p': port = optarg; break;
+            case 'n': steps = atoi(optarg); break;
+            case 'i': interval_ms = atoi(optarg); break;
+            case 'g': gpio = atoi(optarg); break;
+            default:
+                fprintf(stderr, "Usage: %s [-H host] [-p tcp_port] [-n steps] [-i interval_ms] [-g gpio]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (steps < 1) steps = 1;
+    if (interval_ms < 1) interval_ms = 1;
+
+    static Bench b;
+    b.motor_id = -1;
+    b.line_fd = -1;
+    b.sock = connect_server(host, port);
+    if (b.sock < 0) return 1;
+    if (gpio >= 0 && (b.line_fd = open_line((unsigned)gpio)) < 0) return 1;
+
+    if (pump(&b, 2000, have_role) != 0 || !have_role(&b)) {
+        fprintf(stderr, "No control token (another client is the controller?)\n");
+        return 1;
+    }
+
+    // Manual mode, clockwise, 40 %
+    if (send_cmd(&b, "bxmcsffff") != 0 || pump(&b, 500, NULL) != 0) return 1;
+
+    int timeouts = 0;
+    for (int k = 0; k < steps; k++) {
+        b.expect_duty = (k % 2 == 0) ? HIGH_DUTY : LOW_DUTY;
+        b.frame_seen = b.pin_seen = 0;
+        b.sent_ns = now_ns();
+        if (send_cmd(&b, (k % 2 == 0) ? "f" : "d") != 0) { perror("write"); return 1; }
+
+        if (pump(&b, STEP_TIMEOUT_MS, step_done) != 0) return 1;
+        if (!step_done(&b)) timeouts++;
+        b.sent_ns = 0;
+        if (pump(&b, interval_ms, NULL) != 0) return 1;
+    }
+
+    // Auto mode: the PID now runs every tick and each 'r:' goes through it to the PWM
+    if (send_cmd(&b, "a") != 0 || pump(&b, 500, NULL) != 0) return 1;
+    for (int k = 0; k < steps; k++) {
+        char cmd[16];
+        b.expect_target = (k % 2 == 0) ? HIGH_TARGET : LOW_TARGET;
+        b.frame_seen = 0;
+        snprintf(cmd, sizeof(cmd), "r:%d\n", b.expect_target);
+        b.sent_ns = now_ns();
+        if (send_cmd(&b, cmd) != 0) { perror("write"); return 1; }
+
+        if (pump(&b, STEP_TIMEOUT_MS, step_done) != 0) return 1;
+        if (!step_done(&b)) timeouts++;
+        b.sent_ns = 0;
+        if (pump(&b, interval_ms, NULL) != 0) return 1;
+    }
+
+    send_cmd(&b, "x");
+    send_cmd(&b, "L");
+    if (pump(&b, 2000, report_done) != 0) return 1;
+
+    printf("parmco_bench: %d duty + %d target steps, %d ms apart, %s mode (latencies in us)\n",
+           steps, steps, interval_ms, (b.line_fd >= 0) ? "HIL" : "protocol-only");
+    printf("  %-16s %8s %8s %8s %8s\n", "stage", "count", "p50", "p99", "max");
+    if (b.lat_done > 0) {
+        for (int i = 0; i < b.lat_count; i++) {
+            char name[32];
+            unsigned count, p50, p99, max;
+            if (sscanf(b.lat_lines[i], "%31[^,],%u,%u,%u,%u", name, &count, &p50, &p99, &max) == 5) {
+                print_row(name, count, p50, p99, max);
+            }
+        }
+    } else {
+        printf("  (server stages unavailable: start parmco_server with -L)\n");
+    }
+    print_hist("cmd_to_frame", &b.frame_hist);
+    print_hist("target_to_frame", &b.target_hist);
+    if (b.line_fd >= 0) print_hist("cmd_to_pin", &b.pin_hist);
+    printf("  timeouts: %d\n", timeouts);
+    close(b.sock);
+    return 0;
+}
@@ -0,0 +1,178 @@
+/*
+ * ======================================================================================
+ * PROJECT:       PARMCO (Phone APP RP4 Motor Control)
+ * FILE:          parmco_frdump.c
+ * AUTHOR:        Group 1
+ *
+ * DESCRIPTION:
+ * Reads the parmco_server flight recorder (see flight_recorder.h) and prints
+ * a time window of it as CSV. Safe to run while the server is writing: the
+ * file is mapped read-only and every record is checked against its sequence
+ * number, so records being overwritten (or torn by a power cut) are skipped.
+ *
+ * COMPILE INSTRUCTIONS:
+ * gcc -o parmco_frdump parmco_frdump.c -Wall
+ *
+ * USAGE:
+ * parmco_frdump [-f <file>] [-i] [-l <seconds>] [-s <start>] [-e <end>] [-S] [-m <motor_id>]
+ *   -f  Recorder file (default FR_DEFAULT_PATH)
+ *   -i  Print the header and the time range covered, then exit
+ *   -l  Only the last <seconds> of history
+ *   -s  Start of window, -e End of window. Either epoch seconds or local time
+ *       "YYYY-MM-DD HH:MM:SS"
+ *   -S  Only the most recent server session
+ *   -m  Only this motor (every motor is recorded each loop tick, interleaved)
+ *
+ * EXAMPLE:
+ * parmco_frdump -s "2025-11-20 02:00:00" -e "2025-11-20 02:05:00" > night.csv
+ * ======================================================================================
+ */
+
+#define _XOPEN_SOURCE 700 // strptime
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "flight_recorder.h"
+
+/*
+ * FUNCTION: parse_time
+ * --------------------
+ * Accepts epoch seconds or local "YYYY-MM-DD HH:MM:SS". Returns microseconds
+ * since 1970, or -1 if the text is neither.
+ */
+static int64_t parse_time(const char *text) {
+    struct tm tm = { 0 };
+    char *end;
+
+    long long secs = strtoll(text, &end, 10);
+    if (*end == '\0') return (int64_t)secs * 1000000;
+
+    end = strptime(text, "%Y-%m-%d %H:%M:%S", &tm);
+    if (end == NULL || *end != '\0') return -1;
+    tm.tm_isdst = -1;
+    return (int64_t)mktime(&tm) * 1000000;
+}
+
+static void format_time(int64_t time_us, char *out, size_t cap) {
+    time_t secs = (time_t)(time_us / 1000000);
+    struct tm tm;
+    localtime_r(&secs, &tm);
+    size_t n = strftime(out, cap, "%Y-%m-%d %H:%M:%S", &tm);
+    snprintf(out + n, cap - n, ".%06lld", (long long)(time_us % 1000000));
+}
+
+/*
+ * FUNCTION: read_record
+ * ---------------------
+ * Copies record 'seq' out of the mapping. Returns 0 if the slot does not hold
+ * that record (never written, overwritten, or torn) before or after the copy.
+ */
+static int read_record(const FrRecord *records, uint32_t capacity, uint64_t seq, FrRecord *out) {
+    const FrRecord *slot = &records[(seq - 1) % capacity];
+
+    if (atomic_load_explicit(&slot->seq, memory_order_acquire) != seq) return 0;
+    memcpy(out, (const void *)slot, sizeof(*out));
+    atomic_thread_fence(memory_order_acquire);
+    return atomic_load_explicit(&slot->seq, memory_order_relaxed) == seq;
+}
+
+int main(int argc, char **argv) {
+    const char *path = FR_DEFAULT_PATH;
+    int info_only = 0, last_session = 0, motor_id = -1;
+    int64_t start_us = INT64_MIN, end_us = INT64_MAX, last_s = -1;
+    int opt_c;
+
+    while ((opt_c = getopt(argc, argv, "f:il:s:e:Sm:")) != -1) {
+        switch (opt_c) {
+            case 'f': path = optarg; break;
+            case 'i': info_only = 1; break;
+            case 'l': last_s = atoll(optarg); break;
+            case 's': start_us = parse_time(optarg); break;
+            case 'e': end_us = parse_time(optarg); break;
+            case 'S': last_session = 1; break;
+            case 'm': motor_id = atoi(optarg); break;
+            default:
+                fprintf(stderr, "Usage: %s [-f file] [-i] [-l seconds] [-s start] [-e end] [-S] [-m motor_id]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (start_us == -1 || end_us == -1) {
+        fprintf(stderr, "Times must be epoch seconds or \"YYYY-MM-DD HH:MM:SS\"\n");
+        return 1;
+    }
+
+    // --- MAP THE FILE (read-only) ---
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) { perror(path); return 1; }
+    if ((size_t)st.st_size < FR_HEADER_SIZE) { fprintf(stderr, "%s: too small\n", path); return 1; }
+
+    const uint8_t *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) { perror("mmap"); return 1; }
+
+    const FrHeader *hdr = (const FrHeader *)map;
+    const FrRecord *records = (const FrRecord *)(map + FR_HEADER_SIZE);
+    if (memcmp(hdr->magic, FR_MAGIC, sizeof(hdr->magic)) != 0 || hdr->version != FR_VERSION ||
+        hdr->record_size != sizeof(FrRecord) ||
+        (size_t)st.st_size < FR_HEADER_SIZE + (size_t)hdr->capacity * sizeof(FrRecord)) {
+        fprintf(stderr, "%s: not a flight recorder file (or a different version)\n", path);
+        return 1;
+    }
+
+    uint32_t capacity = hdr->capacity;
+    uint64_t head = atomic_load_explicit(&hdr->head, memory_order_acquire);
+    uint64_t oldest = (head > capacity) ? head - capacity + 1 : 1;
+    FrRecord r;
+
+    // Skip records at the tail that the writer may already be replacing
+    while (oldest <= head && !read_record(records, capacity, oldest, &r)) oldest++;
+
+    if (info_only) {
+        char first[40] = "-", last[40] = "-";
+        FrRecord newest;
+        if (oldest <= head) format_time(r.time_us, first, sizeof(first));
+        if (head > 0 && read_record(records, capacity, head, &newest)) format_time(newest.time_us, last, sizeof(last));
+        printf("file:      %s\n", path);
+        printf("capacity:  %u records\n", capacity);
+        printf("written:   %llu records\n", (unsigned long long)head);
+        printf("sessions:  %u\n", hdr->sessions);
+        printf("available: %llu records, %s .. %s\n",
+               (unsigned long long)(head >= oldest ? head - oldest + 1 : 0), first, last);
+        return 0;
+    }
+
+    // --- RESOLVE THE WINDOW ---
+    if (last_s >= 0 && head > 0 && read_record(records, capacity, head, &r)) {
+        start_us = r.time_us - last_s * 1000000;
+    }
+    uint64_t first_seq = oldest;
+    if (last_session) {
+        // Walk back from the newest record to the most recent session marker
+        for (uint64_t n = head; n >= oldest && n > 0; n--) {
+            if (read_record(records, capacity, n, &r) && (r.flags & FR_FLAG_SESSION_START)) { first_seq = n; break; }
+        }
+    }
+
+    // --- PRINT CSV ---
+    printf("seq,time,motor,tick,edges,rpm_raw,rpm_smooth,target,duty_pct,error,integral,pid_duty,mode,running,reverse,profile,session_start\n");
+    for (uint64_t n = first_seq; n <= head; n++) {
+        char when[40];
+        if (!read_record(records, capacity, n, &r)) continue;
+        // Wall-clock time can step back (NTP, a new session before the clock was set), so no early exit
+        if (r.time_us < start_us || r.time_us > end_us) continue;
+        if (motor_id >= 0 && r.motor != motor_id) continue;
+
+        format_time(r.time_us, when, sizeof(when));
+        printf("%llu,%s,%u,%u,%u,%d,%d,%d,%.2f,%.1f,%.3f,%.3f,%u,%d,%d,%d,%d\n",
+               (unsigned long long)r.seq, when, r.motor, r.tick, r.edges, r.rpm_raw, r.rpm_smooth, r.target,
+               r.duty / 10000.0, r.error, r.integral, r.pid_duty, r.mode,
+               (r.flags & FR_FLAG_RUNNING) != 0, (r.flags & FR_FLAG_REVERSE) != 0,
+               (r.flags & FR_FLAG_PROFILE) != 0, (r.flags & FR_FLAG_SESSION_START) != 0);
+    }
+    return 0;
+}
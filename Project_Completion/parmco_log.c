@@ -0,0 +1,291 @@
+/*
+ * ======================================================================================
+ * PROJECT:       PARMCO (Phone APP RP4 Motor Control)
+ * FILE:          parmco_log.c
+ * AUTHOR:        Group 1
+ *
+ * DESCRIPTION:
+ * Implementation of the asynchronous log ring (see parmco_log.h).
+ * The ring is a bounded multi-producer / single-consumer queue: each slot
+ * carries a sequence number, producers claim slots with a CAS on 'head',
+ * and the writer thread is the only consumer. Once the log has been quiet
+ * for a while the writer sleeps on a futex, and the next producer wakes it.
+ * ======================================================================================
+ */
+
+#define _GNU_SOURCE       // gettid
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include "parmco_log.h"
+
+#define LOG_RING_SIZE 1024       // Must be a power of two (~110 KB preallocated)
+#define LOG_RING_MASK (LOG_RING_SIZE - 1)
+#define LOG_IDLE_MIN_US 10000    // Writer poll interval right after activity
+#define LOG_IDLE_MAX_US 200000   // Writer poll interval when the log is quiet, before it sleeps on writer_bell
+#define LOG_WRITER_NICE 10       // Keep the writer below the I/O thread
+
+typedef struct {
+    _Atomic uint32_t seq;        // Slot state: == pos free for producer, == pos+1 ready for writer
+    uint8_t level;
+    uint8_t nargs;
+    uint8_t has_text;
+    const char *fmt;
+    int64_t time_us;
+    double args[LOG_MAX_ARGS];
+    char text[LOG_TEXT_MAX];
+} LogRecord;
+
+static LogRecord ring[LOG_RING_SIZE];
+static _Atomic uint32_t ring_head = 0;       // Next slot to claim (producers)
+static uint32_t ring_tail = 0;               // Next slot to print (writer only)
+static _Atomic uint32_t dropped = 0;
+static uint32_t dropped_reported = 0;        // Drops already announced by the writer
+static _Atomic int current_level = LOG_LVL_INFO;
+static _Atomic int writer_running = 0;
+static _Atomic int writer_sleeping = 0;      // Writer is (about to be) blocked on writer_bell
+static _Atomic uint32_t writer_bell = 0;     // Futex word: bumped to wake a sleeping writer
+static pthread_t writer_tid;
+static int journal_prefix = 0;               // Prefix lines with <N> syslog priority for journald
+
+/*
+ * FUNCTION: log_claim
+ * -------------------
+ * Claims a free slot for a producer. Returns NULL (and counts a drop) if
+ * the ring is full; the caller fills the record and calls log_publish().
+ */
+static LogRecord *log_claim(uint32_t *pos_out) {
+    uint32_t pos = atomic_load_explicit(&ring_head, memory_order_relaxed);
+
+    while (1) {
+        LogRecord *r = &ring[pos & LOG_RING_MASK];
+        uint32_t seq = atomic_load_explicit(&r->seq, memory_order_acquire);
+        int32_t diff = (int32_t)(seq - pos);
+
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&ring_head, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                *pos_out = pos;
+                return r;
+            }
+        } else if (diff < 0) {
+            atomic_fetch_add_explicit(&dropped, 1, memory_order_relaxed);
+            return NULL;
+        } else {
+            pos = atomic_load_explicit(&ring_head, memory_order_relaxed);
+        }
+    }
+}
+
+static void wake_writer(void) {
+    atomic_fetch_add(&writer_bell, 1);
+    syscall(SYS_futex, (uint32_t *)&writer_bell, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+}
+
+static void log_publish(LogRecord *r, uint32_t pos) {
+    atomic_store_explicit(&r->seq, pos + 1, memory_order_release);
+    // Pairs with the fence in writer_thread(): either the writer sees this record, or we see it asleep
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&writer_sleeping, memory_order_relaxed)) wake_writer();
+}
+
+static int64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts); // vDSO: no syscall
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+void log_write(int level, const char *fmt, int nargs, const double *args) {
+    uint32_t pos;
+    if (level < atomic_load_explicit(&current_level, memory_order_relaxed)) return;
+
+    LogRecord *r = log_claim(&pos);
+    if (r == NULL) return;
+
+    if (nargs > LOG_MAX_ARGS) nargs = LOG_MAX_ARGS;
+    r->level = (uint8_t)level;
+    r->nargs = (uint8_t)nargs;
+    r->has_text = 0;
+    r->fmt = fmt;
+    r->time_us = now_us();
+    for (int i = 0; i < nargs; i++) r->args[i] = args[i];
+    log_publish(r, pos);
+}
+
+void log_text(int level, const char *fmt, const char *text) {
+    uint32_t pos;
+    if (level < atomic_load_explicit(&current_level, memory_order_relaxed)) return;
+
+    LogRecord *r = log_claim(&pos);
+    if (r == NULL) return;
+
+    r->level = (uint8_t)level;
+    r->nargs = 0;
+    r->has_text = 1;
+    r->fmt = fmt;
+    r->time_us = now_us();
+    strncpy(r->text, text, LOG_TEXT_MAX - 1);
+    r->text[LOG_TEXT_MAX - 1] = '\0';
+    log_publish(r, pos);
+}
+
+/*
+ * FUNCTION: format_record
+ * -----------------------
+ * Expands one record into 'out'. Walks the format string and re-issues each
+ * conversion to snprintf with the stored argument converted to the type the
+ * conversion expects (long long for integer conversions, int for %c,
+ * double for floating point, the copied text for %s).
+ */
+static int format_record(const LogRecord *r, char *out, size_t cap) {
+    size_t len = 0;
+    int arg = 0;
+    const char *p = r->fmt;
+
+    while (*p && len + 1 < cap) {
+        if (*p != '%') { out[len++] = *p++; continue; }
+        if (p[1] == '%') { out[len++] = '%'; p += 2; continue; }
+
+        // Copy flags / width / precision, skip any length modifiers
+        char spec[24];
+        size_t sl = 0;
+        spec[sl++] = *p++;
+        while (*p && strchr("-+ #0123456789.", *p) && sl < sizeof(spec) - 4) spec[sl++] = *p++;
+        while (*p && strchr("hlLqjzt", *p)) p++;
+        char conv = *p ? *p++ : '\0';
+
+        int n = 0;
+        size_t room = cap - len;
+        if (conv == 's') {
+            spec[sl++] = 's'; spec[sl] = '\0';
+            n = snprintf(out + len, room, spec, r->has_text ? r->text : "");
+        } else if (arg >= r->nargs) {
+            n = snprintf(out + len, room, "%%%c", conv); // Missing argument: print the spec
+        } else if (strchr("diouxX", conv)) {
+            spec[sl++] = 'l'; spec[sl++] = 'l'; spec[sl++] = conv; spec[sl] = '\0';
+            if (conv == 'd' || conv == 'i') n = snprintf(out + len, room, spec, (long long)r->args[arg++]);
+            else n = snprintf(out + len, room, spec, (unsigned long long)(long long)r->args[arg++]);
+        } else if (conv == 'c') {
+            spec[sl++] = 'c'; spec[sl] = '\0';
+            n = snprintf(out + len, room, spec, (int)r->args[arg++]);
+        } else {
+            spec[sl++] = conv; spec[sl] = '\0';
+            n = snprintf(out + len, room, spec, r->args[arg++]);
+        }
+        if (n < 0) break;
+        len += ((size_t)n < room) ? (size_t)n : room - 1;
+    }
+    out[len] = '\0';
+    return (int)len;
+}
+
+/*
+ * FUNCTION: drain_ring
+ * --------------------
+ * Prints every ready record. Returns how many were printed.
+ */
+static int drain_ring(void) {
+    static const char *journal_levels[] = { "<7>", "<6>", "<4>", "<3>" };
+    char line[256];
+    int count = 0;
+
+    while (1) {
+        LogRecord *r = &ring[ring_tail & LOG_RING_MASK];
+        uint32_t seq = atomic_load_explicit(&r->seq, memory_order_acquire);
+        if ((int32_t)(seq - (ring_tail + 1)) < 0) break; // Not published yet
+
+        format_record(r, line, sizeof(line));
+        if (journal_prefix) fputs(journal_levels[r->level & 3], stdout);
+        printf("[%6lld.%06lld] %s", (long long)(r->time_us / 1000000), (long long)(r->time_us % 1000000), line);
+
+        atomic_store_explicit(&r->seq, ring_tail + LOG_RING_SIZE, memory_order_release); // Free the slot
+        ring_tail++;
+        count++;
+    }
+
+    uint32_t total_dropped = atomic_load_explicit(&dropped, memory_order_relaxed);
+    uint32_t lost = total_dropped - dropped_reported;
+    dropped_reported = total_dropped;
+    if (lost) printf("LOG: %u records dropped (ring full)\n", lost);
+    if (count || lost) fflush(stdout);
+    return count;
+}
+
+/*
+ * FUNCTION: writer_thread
+ * -----------------------
+ * Low-priority consumer. Polls fast while messages are flowing and backs off
+ * to LOG_IDLE_MAX_US when the log is quiet, so busy producers never need a
+ * syscall. After that it sleeps until a producer wakes it (an idle server
+ * logs nothing, and then this thread does not wake at all).
+ */
+static void *writer_thread(void *arg) {
+    useconds_t idle_us = LOG_IDLE_MIN_US;
+
+    setpriority(PRIO_PROCESS, gettid(), LOG_WRITER_NICE);
+
+    while (atomic_load(&writer_running)) {
+        if (drain_ring() > 0) {
+            idle_us = LOG_IDLE_MIN_US;
+        } else if (idle_us < LOG_IDLE_MAX_US) {
+            idle_us *= 2;
+            if (idle_us > LOG_IDLE_MAX_US) idle_us = LOG_IDLE_MAX_US;
+        } else {
+            uint32_t seen = atomic_load(&writer_bell);
+            atomic_store(&writer_sleeping, 1);
+            atomic_thread_fence(memory_order_seq_cst);
+            if (drain_ring() == 0 && atomic_load(&writer_running)) {
+                syscall(SYS_futex, (uint32_t *)&writer_bell, FUTEX_WAIT_PRIVATE, seen, NULL, NULL, 0);
+            }
+            atomic_store(&writer_sleeping, 0);
+            idle_us = LOG_IDLE_MIN_US;
+            continue;
+        }
+        usleep(idle_us);
+    }
+    drain_ring(); // Flush whatever was queued before shutdown
+    return NULL;
+}
+
+int log_init(LogLevel level) {
+    for (uint32_t i = 0; i < LOG_RING_SIZE; i++) atomic_store(&ring[i].seq, i);
+    atomic_store(&current_level, level);
+
+    // systemd sets JOURNAL_STREAM when stdout goes to the journal
+    journal_prefix = (getenv("JOURNAL_STREAM") != NULL);
+    setvbuf(stdout, NULL, _IOFBF, 16384); // Only the writer thread prints now
+
+    atomic_store(&writer_running, 1);
+    if (pthread_create(&writer_tid, NULL, writer_thread, NULL) != 0) {
+        atomic_store(&writer_running, 0);
+        return -1;
+    }
+    return 0;
+}
+
+void log_shutdown(void) {
+    if (!atomic_exchange(&writer_running, 0)) return;
+    wake_writer();
+    pthread_join(writer_tid, NULL);
+}
+
+void log_set_level(int level) {
+    if (level < LOG_LVL_DEBUG) level = LOG_LVL_DEBUG;
+    if (level > LOG_LVL_ERROR) level = LOG_LVL_ERROR;
+    atomic_store_explicit(&current_level, level, memory_order_relaxed);
+}
+
+int log_get_level(void) {
+    return atomic_load_explicit(&current_level, memory_order_relaxed);
+}
+
+uint32_t log_dropped(void) {
+    return atomic_load_explicit(&dropped, memory_order_relaxed);
+}
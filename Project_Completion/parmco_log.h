@@ -0,0 +1,65 @@
+/*
+ * ======================================================================================
+ * PROJECT:       PARMCO (Phone APP RP4 Motor Control)
+ * FILE:          parmco_log.h
+ * AUTHOR:        Group 1
+ *
+ * DESCRIPTION:
+ * Asynchronous logging for parmco_server. log_info() & co. copy a fixed-size
+ * binary record (format pointer + numeric arguments) into a preallocated
+ * lock-free ring; a low-priority thread formats and writes the records.
+ * The calling thread never formats text and never makes a syscall.
+ * Each line is printed with the monotonic time at which it was logged, so
+ * the writer's delay does not skew timestamps.
+ *
+ * RULES:
+ * - 'fmt' must be a string literal (only the pointer is stored).
+ * - Up to LOG_MAX_ARGS numeric arguments. Integers and doubles are both
+ *   carried as double, so %d/%u/%x/%c and %f/%e/%g all work.
+ * - For text that is built at runtime (e.g. a Bluetooth address) use
+ *   log_text(), which copies up to LOG_TEXT_MAX bytes into the record.
+ * - If the ring is full, the record is dropped and counted (log_dropped()).
+ *
+ * LEVEL FILTERING:
+ * Records below the current level are discarded before touching the ring.
+ * The level is set with log_set_level() (parmco_server: -l option, SIGUSR1 =
+ * more verbose, SIGUSR2 = less verbose).
+ * ======================================================================================
+ */
+
+#ifndef PARMCO_LOG_H
+#define PARMCO_LOG_H
+
+#include <stdint.h>
+
+#define LOG_MAX_ARGS 6
+#define LOG_TEXT_MAX 48
+
+typedef enum { LOG_LVL_DEBUG, LOG_LVL_INFO, LOG_LVL_WARN, LOG_LVL_ERROR } LogLevel;
+
+int  log_init(LogLevel level);   // Starts the writer thread, 0 on success
+void log_shutdown(void);         // Flushes everything queued, then stops the writer
+void log_set_level(int level);   // Clamped to DEBUG..ERROR; safe from a signal handler
+int  log_get_level(void);
+uint32_t log_dropped(void);      // Records lost because the ring was full
+
+void log_write(int level, const char *fmt, int nargs, const double *args);
+void log_text(int level, const char *fmt, const char *text); // fmt holds one %s
+
+// Numeric arguments are collected into a double[] (the leading 0 is a placeholder
+// so an empty argument list still compiles).
+#define LOG_AT(level, fmt, ...)                                                        \
+    do {                                                                               \
+        if ((level) >= log_get_level()) {                                              \
+            const double log_args_[] = { 0, ##__VA_ARGS__ };                           \
+            log_write((level), (fmt), (int)(sizeof(log_args_) / sizeof(double)) - 1,   \
+                      log_args_ + 1);                                                  \
+        }                                                                              \
+    } while (0)
+
+#define log_debug(fmt, ...) LOG_AT(LOG_LVL_DEBUG, fmt, ##__VA_ARGS__)
+#define log_info(fmt, ...)  LOG_AT(LOG_LVL_INFO, fmt, ##__VA_ARGS__)
+#define log_warn(fmt, ...)  LOG_AT(LOG_LVL_WARN, fmt, ##__VA_ARGS__)
+#define log_error(fmt, ...) LOG_AT(LOG_LVL_ERROR, fmt, ##__VA_ARGS__)
+
+#endif // PARMCO_LOG_H
@@ -9,142 +9,660 @@
  * This program acts as the central control server for the PARMCO system.
  * It runs on a Raspberry Pi 4 and performs the following tasks:
  * 1. Establishes a Bluetooth RFCOMM server to communicate with an Android App.
- * 2. Drives a DC Motor via an L298N H-Bridge (PWM speed control + Direction).
- * 3. Reads an IR Speed Sensor via GPIO interrupts to calculate RPM.
+ * 2. Drives up to MAX_MOTORS DC Motors via L298N H-Bridges (PWM speed control + Direction).
+ * 3. Reads one IR Speed Sensor per motor via GPIO interrupts to calculate RPM.
  * 4. Implements a PID Closed-Loop Control system to maintain target RPM automatically.
  * 5. Parses incoming commands (Manual/Auto modes) and transmits telemetry data.
  *
  * DEPENDENCIES:
- * - pigpiod (GPIO Daemon)
+ * - pigpiod (GPIO Daemon) - only for the 'pigpiod' HAL backend
  * - libbluetooth (BlueZ development headers)
  *
  * COMPILE INSTRUCTIONS:
- * gcc -o parmco_server parmco_server.c -lpigpiod_if2 -lbluetooth -pthread -Wall
+ * gcc -o parmco_server parmco_server.c hal_pigpiod.c hal_direct.c hal_sim.c parmco_log.c flight_recorder.c websocket.c motor_config.c setpoint_profile.c feedforward.c pid.c latency.c rpm_filter.c command_parser.c telemetry_policy.c -lpigpiod_if2 -lbluetooth -pthread -lrt -lm -Wall
+ * Off the Pi ("make sim"): -DPARMCO_NO_PIGPIOD -DPARMCO_NO_BLUETOOTH leave out the
+ * pigpiod backend and the RFCOMM transport, so neither library is needed, and the
+ * default backend becomes the simulator (TCP / WebSocket only).
+ *
+ * SYSTEMD:
+ * parmco.service is Type=notify: READY=1 is sent the moment every listener is
+ * bound, so units ordered after it start without fixed sleeps. The time from
+ * process start (and from boot) to listening is logged and put in the unit's STATUS.
+ *
+ * LOCAL API:
+ * Live state, a command queue and the loop / I/O counters are published in shared
+ * memory (parmco_shm.h); parmco_state is a command-line client for it.
+ *
+ * USAGE:
+ * parmco_server [-b pigpiod|direct|sim[:opts]] [-L] [-r <control_rate_hz>] [-c <control_cpu>] [-i callback|notify] [-l <level>] [-t <frame_hz>] [-f <file>|none] [-p <tcp_port>] [-w <ws_port>] [-m <motor_table>] [-F <file>|none] [-P float|fixed] [-S <filter_opts>] [-I <seconds>]
+ *   -b  Hardware backend: pigpiod daemon (default) or direct register access (see hal.h),
+ *       or "sim" for simulated motors, e.g. -b sim:speed=20,load=0.1 (see hal_sim.c)
+ *   -L  Trace pipeline latencies (command-to-PWM, edge-to-telemetry); the 'L' command
+ *       returns the histograms (see latency.h, parmco_bench)
+ *   -r  PID/RPM control loop rate, 10 - 1000 Hz (default 100)
+ *   -c  CPU core the real-time control thread is pinned to (default 3, -1 = any)
+ *   -i  Sensor edge ingestion for the pigpiod backend: per-edge callback, or
+ *       batched reads from a pigpio notification pipe (default DEFAULT_INGEST_MODE)
+ *   -l  Log level: 0 = debug, 1 = info (default), 2 = warn, 3 = error.
+ *       At runtime, SIGUSR1 = more verbose, SIGUSR2 = less verbose.
+ *   -t  Binary telemetry frame rate, 1 - 100 Hz (default 20). Each frame carries
+ *       every control-loop sample since the previous one (see telemetry.h).
+ *   -f  Flight recorder file (default FR_DEFAULT_PATH), or "none" to disable.
+ *       Every control-loop sample is kept in this circular file (see flight_recorder.h);
+ *       read it with parmco_frdump.
+ *   -p  Also serve the phone protocol over TCP on this port (default off)
+ *   -w  Also serve it over WebSocket on this port, for browser dashboards (default off).
+ *       Both listen on all interfaces and have no authentication: use on trusted networks.
+ *   -m  Motor table file (see motor_config.h and motors.conf). Default: one motor on the
+ *       original pins. Commands go to the first motor unless prefixed with "@<id>".
+ *   -F  Feedforward table file (default FF_DEFAULT_PATH), or "none" to neither load
+ *       nor save one. Loaded at startup, rewritten after each 'C' calibration sweep.
+ *   -P  PID arithmetic: floating point (default) or the integer fixed-point path (see pid.h)
+ *   -S  Edge filter options, key=value,... e.g. -S glitch=150,accel=20000 (see rpm_filter.h)
+ *   -I  Go idle after this many seconds with no client connected and every motor
+ *       stopped (default 10, 0 = never). See IDLE MODE.
  * ======================================================================================
  */
 
+#define _GNU_SOURCE       // pthread_setaffinity_np, CPU_SET
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
 #include <signal.h>
 #include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
 #include <fcntl.h>
-#include <pigpiod_if2.h>  // Uses the pigpio daemon interface
+#ifndef PARMCO_NO_BLUETOOTH
 #include <bluetooth/bluetooth.h>
 #include <bluetooth/rfcomm.h>
+#endif
 #include <errno.h>
-#include <ctype.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/un.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include "edge_ring.h"     // Lock-free edge queue between pigpio and control threads
+#include "hal.h"           // GPIO / PWM / sensor backends (pigpiod or direct registers)
+#include "parmco_log.h"    // Asynchronous logging (no printf on the control path)
+#include "telemetry.h"      // Binary telemetry frames + control -> I/O sample ring
+#include "flight_recorder.h" // Memory-mapped circular history of every control-loop sample
+#include "parmco_shm.h"     // Seqlock state snapshot + command ring for local processes
+#include "websocket.h"      // RFC 6455 codec for the WebSocket transport
+#include "motor_config.h"   // Motor table (pins, PWM mode) loaded with -m
+#include "setpoint_profile.h" // Uploaded setpoint profiles walked by the control thread
+#include "feedforward.h"      // Calibrated duty-to-RPM table the PID starts from
+#include "pid.h"              // Runtime-tunable controller (float and fixed-point paths)
+#include "latency.h"          // Pipeline latency histograms for benchmarking (-L)
+#include "rpm_filter.h"       // Per-edge interval gate, median and RPM estimator (-S)
+#include "command_parser.h"   // Protocol decoder: read() buffer -> batch of commands
+#include "telemetry_policy.h" // Per-client "RPM:" policy: heartbeat, deadband, events ('T')
 
 // --- GPIO PIN MAPPING (BCM Numbering) ---
-#define MASTER_ON_PIN 17  // Master Enable for L298N
-#define DIR_A_PIN     27  // Input 1 for H-Bridge
-#define DIR_B_PIN     22  // Input 2 for H-Bridge
-#define SPEED_PIN     18  // PWM Pin for Speed Control
-#define SENSOR_PIN    23  // Input from IR Speed Sensor
+// Pins are per motor (MotorConfig). Without -m the built-in motor uses the
+// original wiring: MASTER_ON 17, DIR_A 27, DIR_B 22, SPEED (PWM) 18, SENSOR 23.
 
 // --- SYSTEM CONSTANTS ---
-#define PWM_FREQ 1000           // 1 kHz PWM frequency for smooth motor operation
 #define RFCOMM_CHANNEL 22       // Bluetooth Port (Must match Android App)
-#define LOOP_PERIOD 1000000     // Main Control Loop Duration in Microseconds (1.0s)
+
+// --- REAL-TIME CONTROL THREAD ---
+#define DEFAULT_CONTROL_RATE_HZ 100 // PID/RPM loop rate when -r is not given
+#define MIN_CONTROL_RATE_HZ 10
+#define MAX_CONTROL_RATE_HZ 1000
+#define DEFAULT_CONTROL_CPU 3       // Pi 4 core reserved for the control thread
+#define CONTROL_RT_PRIORITY 80      // SCHED_FIFO priority (pigpio callbacks stay below this)
+#define DEFAULT_IDLE_DELAY_S 10     // -I: quiet time before the control thread idles
+#define MAX_IDLE_DELAY_S 3600
+#define PID_LOG_INTERVAL_US 1000000 // PID LOG is printed at most once per second (per motor)
+#define TELEMETRY_PERIOD_US 500000  // Default RPM telemetry interval (500ms, a client may change it with 'T')
+#define DEFAULT_FRAME_RATE_HZ 20    // Binary telemetry frames per second when -t is not given
+#define MIN_FRAME_RATE_HZ 1
+#define MAX_FRAME_RATE_HZ 100
+
+// --- I/O EVENT LOOP ---
+#define MAX_EPOLL_EVENTS 16
+#define MAX_CLIENTS 16              // 1 controller + 15 telemetry subscribers (all transports)
+#define MAX_LISTENERS 3             // RFCOMM, TCP, WebSocket
+#define CLIENT_IN_BUF 2048          // Undecoded WebSocket input (handshake or partial frame)
+#define CLIENT_OUT_BUF 8192         // Per-client backlog of unsent telemetry (several binary frames)
+#define LISTEN_BACKLOG 4
+#define IO_EVT_PUSH_TELEMETRY (1u << 0) // Control thread: send telemetry now (telemetry_events())
+#define IO_EVT_PROFILE        (1u << 1) // A setpoint profile started, changed segment, finished or was aborted
+#define IO_EVT_CALIBRATION    (1u << 2) // A calibration sweep started, measured a point, finished or was aborted
+#define IO_EVT_GAINS          (1u << 3) // A motor's PID tuning was changed or queried ("g:")
+#define IO_EVT_IDLE           (1u << 4) // The control thread went idle or woke up (stats timer off / on)
+#define STATS_PERIOD_US 1000000     // Counters to shared memory, and the window of the per-second rates
 
 // --- TUNING PARAMETERS ---
 /*
  * GLITCH_FILTER_US: Ignores signal changes shorter than 100us.
  * Prevents electrical noise from registering as false RPM counts.
  * Valid for signals up to ~5kHz (well above our 12k RPM target).
+ * Default for "-S glitch=": the FILTER lines show how many pulses still get through.
  */
 #define GLITCH_FILTER_US 100
 
 /*
- * RPM_SMOOTHING: Low-pass filter factor (0.0 - 1.0).
- * 0.5 means new value is 50% previous average + 50% new reading.
+ * MAX_PHYSICS_RPM: Hard cap for noise rejection.
+ * An edge interval faster than 12,000 RPM is always dropped as a glitch
+ * (default for "-S maxrpm="; also the limit for "r:", '+' and profile targets).
  */
-#define RPM_SMOOTHING 0.5
+#define MAX_PHYSICS_RPM 12000
 
 /*
- * MAX_PHYSICS_RPM: Hard cap for noise rejection.
- * If the sensor calculates > 12,000 RPM, we assume it's an error/glitch.
+ * EDGE FILTER (rpm_filter.h): RPM is computed from the time between sensor
+ * edges instead of counting edges per LOOP_PERIOD. Each interval is checked
+ * against the last estimate and the motor's possible acceleration, then goes
+ * through a short median and an alpha-beta estimator; "-S" tunes all three.
+ * Edges per revolution come from the motor table (3 blades on the fan -> 3).
  */
-#define MAX_PHYSICS_RPM 12000
 
 // --- PID CONTROLLER GAINS ---
-#define PID_KP 0.01           // Proportional Gain (Reaction to current error)
-#define PID_KI 0.005          // Integral Gain (Reaction to accumulated error)
-#define PID_KD 0.0            // Derivative Gain (Reaction to rate of change - not used here)
-#define PID_MAX_INTEGRAL 50.0 // Anti-Windup: Max accumulated error positive
-#define PID_MIN_INTEGRAL -50.0// Anti-Windup: Max accumulated error negative
-#define MAX_CHANGE_PER_LOOP 5 // Safety: Max PWM % change allowed per second
-
-// --- GLOBAL STATE VARIABLES (Volatile for ISR safety) ---
+// Defaults are PID_KP / PID_KI / PID_KD etc. in pid.h; each motor's copy can be
+// retuned at runtime with "g:" (gains, clamps, slew limit, gain schedule).
+
+/*
+ * NOTE: The PID terms are expressed per second and scaled by the loop period
+ * (dt), so the gains behave the same at any control rate as they did
+ * with the original 1.0s loop.
+ */
+
+// --- GLOBAL STATE VARIABLES ---
 static volatile int keep_running = 1;      // Program termination flag
-static volatile int revolution_count = 0;  // Raw ticks from sensor
-static volatile int rpm = 0;               // Instantaneous RPM
-static volatile int rpm_smooth = 0;        // Averaged RPM for stability
-static int speed_percent = 0;              // Current PWM Duty Cycle (0-100)
-static int pi;                             // Pigpio Daemon Handle
+#ifndef PARMCO_NO_PIGPIOD
+static const HalBackend *hal = &hal_pigpiod; // Hardware backend (selected with -b)
+#else
+static const HalBackend *hal = &hal_sim;
+#endif
+static int hal_ready = 0;                  // Set once hal->init() succeeded
+
+// Control thread configuration and shared-state lock
+static int control_rate_hz = DEFAULT_CONTROL_RATE_HZ;
+static int control_cpu = DEFAULT_CONTROL_CPU;
+static int pid_fixed = 0;                  // -P fixed: integer controller path
+static RpmFilterConfig rpm_filter_cfg;     // -S: edge filter settings (set before the control thread starts)
+static unsigned tick_scale = 1;            // Backend ticks per real microsecond (hal->time_scale)
+static pthread_mutex_t state_lock;         // Guards motor/PID state between I/O and control threads
+
+// -L latency tracing (latency.h): histograms are written on the I/O thread or under state_lock
+static int lat_enabled = 0;
+static LatHist lat_hist[LAT_STAGES];
+static int64_t lat_step_us = 0;            // Control thread: monotonic time of this tick's hal->tick()
+static int64_t lat_input_us = 0;           // read() time of the bytes being parsed (0 = not from a client)
+static int64_t lat_noted_us = 0;           // When the byte being parsed completed a command
+
+// Always-on loop counters ('?', PshmCounters). Written with state_lock held:
+// the control thread's own figures, and HAL writes and commands from either thread.
+typedef struct {
+    uint32_t loops;
+    uint32_t overruns;                     // Step finished after the next deadline (schedule re-based)
+    uint32_t commands;
+    LatHist period;                        // us, wake-up to wake-up
+    LatHist late;                          // us, wake-up behind the deadline
+    LatHist step;                          // ns, control_step
+    LatHist pid;                           // ns, one PID update
+    LatHist hal;                           // ns, one HAL output write
+    int idle;                              // Control thread is idle (idle_wait())
+    uint32_t idle_entries;
+    int64_t idle_enter_us;                 // Start of the current idle spell
+    int64_t idle_us;                       // Idle time of the finished spells
+    LatHist wake;                          // us, wake-up request to sensors and real-time restored
+} LoopStats;
+static LoopStats loop_stats;
+static int64_t start_us = 0;               // Server start, for the uptime
+
+// Idle mode (idle_wait()): the I/O thread and shared-memory producers wake the control thread through idle_bell
+static int idle_delay_s = DEFAULT_IDLE_DELAY_S;
+static _Atomic uint32_t idle_bell_local = 0;
+static _Atomic uint32_t *idle_bell = &idle_bell_local; // Futex word: shm->cmd_bell once the segment exists
+static int64_t idle_wake_us = 0;           // state_lock: when the wake-up was requested (0 = none yet)
+static int64_t idle_quiet_ns = 0;          // Control thread: since when the idle conditions hold (0 = not now)
+static int realtime_ok = 0;                // setup_realtime() got SCHED_FIFO
+
+// Control thread -> I/O thread doorbell: event bits plus an eventfd to wake epoll
+static int io_event_fd = -1;
+static _Atomic uint32_t io_events = 0;
+
+// Binary telemetry: the control thread only records samples while someone subscribes
+static TelemetryRing telem_ring;
+static _Atomic int binary_subscribers = 0;
+static int frame_rate_hz = DEFAULT_FRAME_RATE_HZ;
 
 // Control Modes
-typedef enum { MANUAL_MODE, AUTO_MODE } ControlMode;
-static ControlMode current_mode = MANUAL_MODE;
+typedef enum { MANUAL_MODE, AUTO_MODE, CALIBRATE_MODE } ControlMode;
+
+/*
+ * MOTOR STATE:
+ * Everything the server keeps about one motor. motors[] follows the motor
+ * table (motor_config.h); the control thread steps every motor in one pass
+ * per tick. Fields are guarded by state_lock, except edge_ring (lock-free,
+ * fed by the HAL's sensor thread) and the estimator (control thread only).
+ */
+typedef struct {
+    MotorConfig cfg;                       // ID, pins, PWM mode, edges per revolution
+
+    // Edge ingestion and RPM estimate
+    EdgeRing edge_ring;                    // rpm_callback -> control thread edge queue
+    int revolution_count;                  // Raw ticks from sensor (counted as edges are drained)
+    RpmFilter filter;                      // Interval gate, median and estimator (rpm_filter.h)
+
+    // Speed and control
+    volatile int rpm;                      // Median-filtered RPM at the last good edge
+    volatile int rpm_smooth;               // Estimator output (what the PID and "RPM:" use)
+    int speed_percent;                     // Current PWM Duty Cycle (0-100)
+    double pid_duty;                       // Fractional duty accumulated by the PID (0-100)
+    double pid_trim;                       // With a feedforward table: PID correction on top of ff_duty
+    double ff_duty;                        // Feedforward duty for desired_rpm (0 without a table)
+    FfTable ff;                            // Calibrated duty-to-RPM table (count 0 = none)
+    FfSweep sweep;                         // Calibration sweep ('C') in progress
+    ControlMode current_mode;
+    volatile int motor_running;            // Motor State Flag
+    volatile int desired_rpm;              // Target RPM for PID
+    PidTuning tuning;                      // Gains, clamps, gain schedule ("g:")
+    uint32_t tuning_gen;                   // +1 on every "g:" (coefficient cache, GAINS reports)
+    PidState pid;                          // Integral, derivative filter, last contributions
+    PidFixedCoeffs pid_coeffs;             // -P fixed: per-tick coefficients for tuning_gen (and the target, with a schedule)
+    int64_t pid_acc_q32;                   // -P fixed: pid_duty (or pid_trim with a table), ppm Q32
+    int64_t ff_q32;                        // -P fixed: ff_duty in ppm Q32
+    int ff_target;                         // -P fixed: desired_rpm that ff_duty / ff_q32 belong to (-1 = none)
+    uint32_t pid_out_ppm;                  // -P fixed: the last PID duty (0 - 1,000,000)
+    int pid_floats_stale;                  // -P fixed: pid_duty, pid_trim and pid's floats lag (export_pid_floats())
+    int64_t last_pid_log_us;
+    Profile profile;                       // Uploaded setpoint profile ("p:"), drives desired_rpm while running
 
-static volatile int motor_running = 0;     // Motor State Flag
-static volatile int desired_rpm = 0;       // Target RPM for PID
-static double pid_integral = 0;            // Accumulator for I-term
-static double pid_last_error = 0;          // Previous error for D-term
+    // -L latency tracing
+    int64_t lat_cmd_us;                    // read() time of the last command, until the next PWM write
+    _Atomic int64_t lat_edge_us;           // Monotonic time of the newest drained edge (for the I/O thread)
+    int64_t lat_reported_edge_us;          // I/O thread: newest edge already counted in edge_to_telem
 
-// --- COMMAND PARSER STATE MACHINE ---
-// Used to handle fragmented Bluetooth packets (e.g., "r:1", "50", "0")
-typedef enum { STATE_NORMAL, STATE_WAIT_COLON, STATE_READ_NUM } ParseState;
-static ParseState p_state = STATE_NORMAL;
-static char num_buffer[16];
-static int num_buf_idx = 0;
+    // Output shadow state: last value written to each output; -1 = unknown,
+    // which forces the next write out. Only writes that change a value reach
+    // the hardware, and reads never do.
+    int shadow_master;                     // Master enable level
+    int shadow_dir_a;                      // H-Bridge input 1 level
+    int shadow_dir_b;                      // H-Bridge input 2 level
+    int64_t shadow_duty;                   // PWM duty (0 - 1,000,000)
+
+    // Outputs staged while a command batch is applied (commit_outputs)
+    unsigned staged;                       // OUT_* bits
+    int staged_master, staged_dir_a, staged_dir_b;
+    uint32_t staged_duty;
+    uint32_t output_faults;                // HAL writes that failed (the shadow is then unknown)
+
+    // Telemetry events (telemetry_events(), control thread): last seen state
+    ControlMode ev_mode;
+    int ev_running;
+    int ev_at_target;
+    uint32_t ev_rejected;                  // rf_rejected() at the last tick
+    int ev_quiet;                          // Ticks without a rejected interval (capped)
+    uint32_t ev_faults;
+} Motor;
+
+static Motor motors[MAX_MOTORS];
+static int num_motors = 0;
+static HalSensor sensors[MAX_MOTORS];      // Sensor pins for hal->sensor_start (also after idling)
+
+// Motor.staged
+#define OUT_MASTER (1u << 0)
+#define OUT_DIR    (1u << 1)
+#define OUT_DUTY   (1u << 2)
+static int outputs_held = 0;               // state_lock: a batch is being applied, set_* only stage
+
+// --- COMMAND PARSER (command_parser.h) ---
+// Each client has its own parser so interleaved streams cannot corrupt each other.
+// CmdParser.motor is the index into motors[] that "@<id>" selected (-1 = unknown
+// ID); a new parser starts on motors[0], so single-motor clients never need it.
+void apply_batch(CmdParser *ps, const CmdBatch *b);
+
+// --- SHARED-MEMORY STATE (parmco_shm.h) ---
+static ParmcoShm *shm = NULL;              // NULL if the segment could not be created
+static CmdParser shm_parser;               // Commands from the shared-memory ring (control thread)
+static _Atomic int num_clients = 0;        // Connected clients (I/O thread writes, snapshot reads)
 
 /*
  * FUNCTION: rpm_callback
  * ----------------------
- * Interrupt Service Routine (ISR) triggered by the IR Sensor.
- * Executed every time the sensor pin goes High (Rising Edge).
- * logic: Increments the revolution counter. We assume 3 ticks = 1 full rotation.
+ * Interrupt Service Routine (ISR) triggered by an IR Sensor.
+ * Executed (on a HAL backend thread) every time a sensor pin changes;
+ * 'ctx' is the Motor that sensor belongs to.
+ * logic: Queues the edge (tick + level) on that motor's lock-free edge ring.
+ * All processing happens on the control thread when it drains the ring.
+ */
+void rpm_callback(void *ctx, uint32_t tick, uint32_t level) {
+    edge_ring_push(&((Motor *)ctx)->edge_ring, tick, level);
+}
+
+/*
+ * FUNCTION: find_motor
+ * --------------------
+ * Index in motors[] of the motor with this ID, or -1.
+ */
+int find_motor(int id) {
+    for (int i = 0; i < num_motors; i++) {
+        if (motors[i].cfg.id == id) return i;
+    }
+    return -1;
+}
+
+/*
+ * FUNCTION: set_master_power
+ * --------------------------
+ * Writes the motor's master enable pin through the shadow cache.
+ */
+void set_master_power(Motor *m, int on) {
+    if (outputs_held) { m->staged |= OUT_MASTER; m->staged_master = on; return; }
+    if (m->shadow_master == on) return;
+    int64_t start_ns = monotonic_ns();
+    m->shadow_master = (hal->write(m->cfg.master_pin, on) == 0) ? on : -1;
+    if (m->shadow_master < 0) m->output_faults++;
+    lat_record(&loop_stats.hal, monotonic_ns() - start_ns);
+}
+
+/*
+ * FUNCTION: set_direction
+ * -----------------------
+ * Writes both H-Bridge inputs through the shadow cache. The changed pins go
+ * out as one bank write (clears first, so both inputs are never high at once).
+ */
+void set_direction(Motor *m, int a, int b) {
+    if (outputs_held) { m->staged |= OUT_DIR; m->staged_dir_a = a; m->staged_dir_b = b; return; }
+    uint32_t set_mask = 0, clear_mask = 0;
+    uint32_t a_bit = 1u << m->cfg.dir_a_pin, b_bit = 1u << m->cfg.dir_b_pin;
+
+    if (m->shadow_dir_a != a) { if (a) set_mask |= a_bit; else clear_mask |= a_bit; }
+    if (m->shadow_dir_b != b) { if (b) set_mask |= b_bit; else clear_mask |= b_bit; }
+    if (!set_mask && !clear_mask) return;
+
+    int64_t start_ns = monotonic_ns();
+    if (hal->write_bank(set_mask, clear_mask) == 0) {
+        m->shadow_dir_a = a;
+        m->shadow_dir_b = b;
+    } else {
+        m->shadow_dir_a = m->shadow_dir_b = -1;
+        m->output_faults++;
+    }
+    lat_record(&loop_stats.hal, monotonic_ns() - start_ns);
+}
+
+/*
+ * FUNCTION: set_duty
+ * ------------------
+ * Writes the motor's PWM duty (0 - 1,000,000) through the shadow cache,
+ * on its hardware PWM channel or as software PWM.
+ */
+void set_duty(Motor *m, uint32_t duty) {
+    if (outputs_held) { m->staged |= OUT_DUTY; m->staged_duty = duty; return; }
+    if (m->shadow_duty == (int64_t)duty) return;
+    int64_t start_ns = monotonic_ns();
+    int ret = (m->cfg.pwm_mode == PWM_HARDWARE) ? hal->hw_pwm(m->cfg.pwm_pin, m->cfg.pwm_freq, duty)
+                                               : hal->sw_pwm(m->cfg.pwm_pin, m->cfg.pwm_freq, duty);
+    m->shadow_duty = (ret == 0) ? (int64_t)duty : -1;
+    if (ret != 0) m->output_faults++;
+    int64_t end_ns = monotonic_ns();
+    lat_record(&loop_stats.hal, end_ns - start_ns);
+
+    if (lat_enabled) {
+        int64_t now_us = end_ns / 1000;
+        lat_record(&lat_hist[LAT_HW_WRITE], now_us - start_ns / 1000);
+        if (m->lat_cmd_us != 0) {
+            lat_record(&lat_hist[LAT_CMD_TO_PWM], now_us - m->lat_cmd_us);
+            m->lat_cmd_us = 0;
+        }
+    }
+}
+
+/*
+ * FUNCTION: direction_is_set
+ * --------------------------
+ * True if a direction was last written (served from the shadow cache, or
+ * the staged value inside a batch).
+ */
+int direction_is_set(const Motor *m) {
+    if (m->staged & OUT_DIR) return m->staged_dir_a == 1 || m->staged_dir_b == 1;
+    return m->shadow_dir_a == 1 || m->shadow_dir_b == 1;
+}
+
+/*
+ * FUNCTION: commit_outputs
+ * ------------------------
+ * Ends a batch: writes what the batch staged, only the final value of each
+ * output. All master and direction pins of all motors go out as one bank
+ * write (clears first, so a motor that is switched off or reversed is never
+ * driven both ways), then the duties.
+ */
+void commit_outputs() {
+    uint32_t set_mask = 0, clear_mask = 0;
+
+    outputs_held = 0;
+    for (int i = 0; i < num_motors; i++) {
+        Motor *m = &motors[i];
+        if ((m->staged & OUT_MASTER) && m->shadow_master != m->staged_master) {
+            if (m->staged_master) set_mask |= 1u << m->cfg.master_pin; else clear_mask |= 1u << m->cfg.master_pin;
+        }
+        if (m->staged & OUT_DIR) {
+            uint32_t a_bit = 1u << m->cfg.dir_a_pin, b_bit = 1u << m->cfg.dir_b_pin;
+            if (m->shadow_dir_a != m->staged_dir_a) { if (m->staged_dir_a) set_mask |= a_bit; else clear_mask |= a_bit; }
+            if (m->shadow_dir_b != m->staged_dir_b) { if (m->staged_dir_b) set_mask |= b_bit; else clear_mask |= b_bit; }
+        }
+    }
+
+    if (set_mask || clear_mask) {
+        int64_t start_ns = monotonic_ns();
+        int ok = (hal->write_bank(set_mask, clear_mask) == 0);
+        lat_record(&loop_stats.hal, monotonic_ns() - start_ns);
+        for (int i = 0; i < num_motors; i++) {
+            Motor *m = &motors[i];
+            if (!ok && (m->staged & (OUT_MASTER | OUT_DIR))) m->output_faults++;
+            if (m->staged & OUT_MASTER) m->shadow_master = ok ? m->staged_master : -1;
+            if (m->staged & OUT_DIR) {
+                m->shadow_dir_a = ok ? m->staged_dir_a : -1;
+                m->shadow_dir_b = ok ? m->staged_dir_b : -1;
+            }
+        }
+    }
+
+    for (int i = 0; i < num_motors; i++) {
+        Motor *m = &motors[i];
+        if (m->staged & OUT_DUTY) set_duty(m, m->staged_duty);
+        m->staged = 0;
+    }
+}
+
+void raise_io_event(uint32_t bits);
+
+/*
+ * FUNCTION: cancel_profile
+ * ------------------------
+ * Ends a running setpoint profile (the current target is kept). Any command
+ * that sets the target or leaves Auto mode by hand calls this first.
+ */
+void cancel_profile(Motor *m) {
+    if (m->profile.state != PROFILE_RUNNING) return;
+    m->profile.state = PROFILE_ABORTED;
+    raise_io_event(IO_EVT_PROFILE);
+    log_info("Profile aborted (motor %d)\n", m->cfg.id);
+}
+
+/*
+ * FUNCTION: cancel_calibration
+ * ----------------------------
+ * Ends a running calibration sweep without touching the table, and leaves
+ * the motor in Manual Mode at the sweep's current duty.
+ */
+void cancel_calibration(Motor *m) {
+    if (m->sweep.state != FF_SWEEP_RUNNING) return;
+    m->sweep.state = FF_SWEEP_ABORTED;
+    m->current_mode = MANUAL_MODE;
+    raise_io_event(IO_EVT_CALIBRATION);
+    log_info("Calibration aborted (motor %d)\n", m->cfg.id);
+}
+
+/*
+ * FUNCTION: load_pid_duty
+ * -----------------------
+ * Sets where the PID continues from: 'percent' duty without a feedforward
+ * table, the table's duty for the target (no trim) with one.
+ */
+void load_pid_duty(Motor *m, int percent) {
+    m->pid_duty = percent;
+    m->pid_trim = 0;
+    m->pid_acc_q32 = (m->ff.count > 0) ? 0 : ((int64_t)percent * 10000) << 32;
+    m->ff_target = -1;          // -P fixed: look the table up again (it may have changed)
+    m->pid_floats_stale = 0;
+}
+
+/*
+ * FUNCTION: stop_motor
+ * --------------------
+ * Safety Function. Immediately stops one motor, kills its PWM,
+ * and resets its state variables (RPM, PID errors, etc.).
+ * Called for the 'x' command.
  */
-void rpm_callback(int pi, unsigned gpio, unsigned level, uint32_t tick) {
-    revolution_count++;
+void stop_motor(Motor *m) {
+    cancel_profile(m);
+    cancel_calibration(m);
+    if (hal_ready) {
+        set_duty(m, 0); // 0% Duty Cycle
+        set_direction(m, 0, 0);
+        set_master_power(m, 0);
+    }
+    m->speed_percent = 0;
+    load_pid_duty(m, 0);
+    m->ff_duty = 0;
+    m->revolution_count = 0;
+    m->rpm = 0;
+    m->rpm_smooth = 0;
+    m->motor_running = 0;
+    m->desired_rpm = 0;
+    pid_reset(&m->pid);
 }
 
 /*
  * FUNCTION: stop_all_activity
  * ---------------------------
- * Safety Function. Immediately stops the motor, kills PWM,
- * and resets all state variables (RPM, PID errors, etc.).
- * Called on program exit or 'x' command.
+ * stop_motor() for every motor. Called on program exit, a new controller,
+ * and a controller disconnect.
  */
 void stop_all_activity() {
-    if (pi >= 0) {
-        hardware_PWM(pi, SPEED_PIN, PWM_FREQ, 0); // 0% Duty Cycle
-        gpio_write(pi, DIR_A_PIN, 0);
-        gpio_write(pi, DIR_B_PIN, 0);
-        gpio_write(pi, MASTER_ON_PIN, 0);
+    for (int i = 0; i < num_motors; i++) stop_motor(&motors[i]);
+}
+
+/*
+ * FUNCTION: handle_signal
+ * -----------------------
+ * Called from the event loop when the signalfd becomes readable.
+ * SIGINT / SIGTERM: Allows the main loop to exit gracefully and clean up GPIOs.
+ * SIGUSR1 makes the log more verbose, SIGUSR2 less verbose.
+ */
+void handle_signal(int sig) {
+    switch (sig) {
+        case SIGINT:
+        case SIGTERM:
+            keep_running = 0;
+            log_info("Termination signal received. Shutting down...\n");
+            break;
+        case SIGUSR1: log_set_level(log_get_level() - 1); break;
+        case SIGUSR2: log_set_level(log_get_level() + 1); break;
     }
-    speed_percent = 0;
-    revolution_count = 0;
-    rpm = 0;
-    rpm_smooth = 0;
-    motor_running = 0;
-    desired_rpm = 0;
-    pid_integral = 0;
-    pid_last_error = 0;
-    p_state = STATE_NORMAL;
 }
 
 /*
- * FUNCTION: int_handler
- * ---------------------
- * Signal handler for Ctrl+C (SIGINT) or Termination (SIGTERM).
- * Allows the main loop to exit gracefully and clean up GPIOs.
+ * FUNCTION: raise_io_event
+ * ------------------------
+ * Lets the control thread hand work to the I/O thread without blocking:
+ * sets the event bit(s) and rings the eventfd so epoll_wait returns.
+ */
+void raise_io_event(uint32_t bits) {
+    uint64_t one = 1;
+    atomic_fetch_or_explicit(&io_events, bits, memory_order_release);
+    if (write(io_event_fd, &one, sizeof(one)) < 0) { /* Counter saturated: already pending */ }
+}
+
+/*
+ * FUNCTION: update_pid_float
+ * --------------------------
+ * Floating-point controller step (pid.h) and duty accumulator.
+ * Returns the new duty (0 - 1,000,000); 'change' gets this tick's adjustment in %.
+ */
+uint32_t update_pid_float(Motor *m, double dt, double *change) {
+    *change = pid_step_float(&m->pid, &m->tuning, m->desired_rpm, m->rpm_smooth, dt);
+
+    // Apply to the motor's speed (fractional so small per-loop steps are not lost).
+    // With a feedforward table the duty follows the table for the target at once
+    // and the rate-limited PID output only trims the residual.
+    if (m->ff.count > 0) {
+        m->ff_duty = ff_lookup(&m->ff, m->desired_rpm);
+        m->pid_trim += *change;
+        if (m->ff_duty + m->pid_trim > 100) m->pid_trim = 100 - m->ff_duty; // No windup past the duty range
+        if (m->ff_duty + m->pid_trim < 0) m->pid_trim = -m->ff_duty;
+        m->pid_duty = m->ff_duty + m->pid_trim;
+    } else {
+        m->pid_duty += *change;
+        if (m->pid_duty > 100) m->pid_duty = 100;
+        if (m->pid_duty < 0) m->pid_duty = 0;
+    }
+    return (uint32_t)(m->pid_duty * 10000);
+}
+
+/*
+ * FUNCTION: update_pid_fixed
+ * --------------------------
+ * The same step in integer math (-P fixed). The coefficients are recomputed
+ * (in floating point) when the tuning changes, and with a gain schedule also
+ * when the target does; the feedforward duty is looked up again when the
+ * target changes and there is a table. So a target that moves every tick
+ * (a profile ramp) still costs a recompute per tick with a schedule or a
+ * table; otherwise the step is integer only. The floating-point copies for
+ * the readers are left to export_pid_floats().
+ * Returns the new duty (0 - 1,000,000); 'change_q32' gets this tick's adjustment.
+ */
+uint32_t update_pid_fixed(Motor *m, int64_t *change_q32) {
+    const int64_t full_q32 = (int64_t)1000000 << 32;
+
+    // The gains only depend on the target through the schedule
+    if (!m->pid_coeffs.valid || m->pid_coeffs.tuning_gen != m->tuning_gen ||
+        (m->tuning.schedule_count > 0 && m->pid_coeffs.target_rpm != m->desired_rpm)) {
+        pid_fixed_coeffs(&m->tuning, m->tuning_gen, m->desired_rpm, control_rate_hz, &m->pid_coeffs);
+    }
+    if (m->ff.count > 0 && m->ff_target != m->desired_rpm) {
+        m->ff_duty = ff_lookup(&m->ff, m->desired_rpm);
+        m->ff_q32 = (int64_t)(m->ff_duty * 10000.0 * 4294967296.0 + 0.5);
+        m->ff_target = m->desired_rpm;
+    }
+
+    *change_q32 = pid_step_fixed(&m->pid, &m->pid_coeffs, m->desired_rpm, m->rpm_smooth);
+    m->pid_acc_q32 += *change_q32;
+    int64_t lo = (m->ff.count > 0) ? -m->ff_q32 : 0;
+    int64_t hi = (m->ff.count > 0) ? full_q32 - m->ff_q32 : full_q32; // No windup past the duty range
+    if (m->pid_acc_q32 > hi) m->pid_acc_q32 = hi;
+    if (m->pid_acc_q32 < lo) m->pid_acc_q32 = lo;
+    return (uint32_t)(((m->ff.count > 0) ? m->ff_q32 + m->pid_acc_q32 : m->pid_acc_q32) >> 32);
+}
+
+/*
+ * FUNCTION: export_pid_floats
+ * ---------------------------
+ * -P fixed: brings pid_duty, pid_trim and the floating-point fields of
+ * m->pid up to date with the integer state. Called by the readers (flight
+ * recorder, shared-memory snapshot, PID LOG) instead of after every step,
+ * at most once per tick however many of them there are. Nothing to do on
+ * the floating-point path.
  */
-void int_handler(int sig) {
-    keep_running = 0;
-    printf("\nTermination signal received. Shutting down...\n");
+void export_pid_floats(Motor *m) {
+    if (!m->pid_floats_stale) return;
+    m->pid_duty = m->pid_out_ppm / 10000.0;
+    pid_export_fixed(&m->pid, control_rate_hz);
+    m->pid_trim = m->pid_duty - m->ff_duty;
+    m->pid_floats_stale = 0;
 }
 
 /*
@@ -153,49 +671,535 @@ void int_handler(int sig) {
  * The "Brain" of the automatic mode.
  * Calculates the difference between Target RPM and Actual RPM,
  * then adjusts the motor speed (PWM) to minimize that error.
+ * dt: Time since the previous update in seconds (1 / control_rate_hz).
  */
-void update_pid_controller() {
+void update_pid_controller(Motor *m, double dt) {
     // Only run logic if we are in Auto Mode and the motor is actually on
-    if (current_mode != AUTO_MODE || !motor_running) return;
+    if (m->current_mode != AUTO_MODE || !m->motor_running) return;
+
+    double change = 0;
+    int64_t change_q32 = 0;
+    uint32_t duty = pid_fixed ? update_pid_fixed(m, &change_q32) : update_pid_float(m, dt, &change);
+
+    // Write to Hardware (Duty Cycle range 0 - 1,000,000)
+    m->speed_percent = (int)((duty + 5000) / 10000);
+    set_duty(m, duty);
+
+    int64_t now_us = monotonic_us();
+    int log_due = (now_us - m->last_pid_log_us >= PID_LOG_INTERVAL_US);
+    if (pid_fixed) {
+        m->pid_out_ppm = duty;
+        m->pid_floats_stale = 1;
+        if (log_due) {
+            export_pid_floats(m);
+            change = change_q32 / (10000.0 * 4294967296.0);
+        }
+    }
+
+    if (log_due) {
+        if (m->ff.count > 0) {
+            log_info("PID LOG [%d]: Target=%d | Actual=%d | Error=%.1f | FF=%.2f%% | Trim=%.3f%%\n",
+                   m->cfg.id, m->desired_rpm, m->rpm_smooth, m->pid.error, m->ff_duty, m->pid_trim);
+        } else {
+            log_info("PID LOG [%d]: Target=%d | Actual=%d | Error=%.1f | PWM Adj=%.3f | New Speed=%.2f%%\n",
+                   m->cfg.id, m->desired_rpm, m->rpm_smooth, m->pid.error, change, m->pid_duty);
+        }
+        m->last_pid_log_us = now_us;
+    }
+}
+
+/*
+ * FUNCTION: drain_edges
+ * ---------------------
+ * Pulls every edge queued since the last tick off the motor's edge ring in
+ * batches, counts the rising edges (edges_per_rev ticks = 1 full rotation)
+ * and feeds them into the motor's edge filter.
+ * With -L, each rising edge's age is converted from backend ticks to real
+ * microseconds against this tick's monotonic time.
+ */
+void drain_edges(Motor *m, uint32_t now_tick) {
+    EdgeEvent batch[64];
+    int n;
+
+    while ((n = edge_ring_pop_batch(&m->edge_ring, batch, 64)) > 0) {
+        int64_t now_us = lat_enabled ? monotonic_us() : 0;
+        for (int i = 0; i < n; i++) {
+            if (batch[i].level != 1) continue;
+            m->revolution_count++;
+            rf_add_edge(&m->filter, &rpm_filter_cfg, batch[i].tick, m->cfg.edges_per_rev);
+            if (lat_enabled) {
+                int64_t edge_us = lat_step_us - (int32_t)(now_tick - batch[i].tick) / (int32_t)tick_scale;
+                lat_record(&lat_hist[LAT_EDGE_TO_PID], now_us - edge_us);
+                atomic_store_explicit(&m->lat_edge_us, edge_us, memory_order_relaxed);
+            }
+        }
+    }
+}
+
+/*
+ * FUNCTION: record_sample
+ * -----------------------
+ * Queues one TelemetrySample for the binary frame encoder. Never blocks:
+ * if the I/O thread falls behind, the sample is dropped and counted.
+ */
+void record_sample(const Motor *m, uint32_t now_tick, int raw_rpm) {
+    TelemetrySample s = { 0 };
+    s.tick = now_tick;
+    s.rpm_raw = (int16_t)raw_rpm;
+    s.rpm_smooth = (int16_t)m->rpm_smooth;
+    s.target = (int16_t)m->desired_rpm;
+    s.duty = (m->shadow_duty > 0) ? (uint16_t)(m->shadow_duty / 100) : 0;
+    if (m->current_mode == AUTO_MODE && m->motor_running) s.error = (int16_t)(m->desired_rpm - m->rpm_smooth);
+    if (m->motor_running) s.flags |= TELEM_FLAG_RUNNING;
+    if (m->current_mode == AUTO_MODE) s.flags |= TELEM_FLAG_AUTO;
+    if (m->shadow_dir_a == 1) s.flags |= TELEM_FLAG_REVERSE;
+    if (m->profile.state == PROFILE_RUNNING) s.flags |= TELEM_FLAG_PROFILE;
+    s.motor = (uint8_t)m->cfg.id;
+    telem_ring_push(&telem_ring, &s);
+}
+
+/*
+ * FUNCTION: record_flight
+ * -----------------------
+ * Appends the motor's current loop state to the flight recorder: plain stores
+ * into the mapped file, no syscall (CLOCK_REALTIME is read through the vDSO).
+ */
+void record_flight(Motor *m, uint32_t now_tick, int raw_rpm) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    export_pid_floats(m);
+
+    FrRecord *r = fr_begin();
+    r->time_us = (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+    r->tick = now_tick;
+    r->edges = (uint32_t)m->revolution_count;
+    r->rpm_raw = raw_rpm;
+    r->rpm_smooth = m->rpm_smooth;
+    r->target = m->desired_rpm;
+    r->duty = (m->shadow_duty > 0) ? (uint32_t)m->shadow_duty : 0;
+    r->error = (float)(m->desired_rpm - m->rpm_smooth);
+    r->integral = (float)m->pid.integral;
+    r->pid_duty = (float)m->pid_duty;
+    r->mode = (uint8_t)m->current_mode;
+    r->motor = (uint8_t)m->cfg.id;
+    if (m->motor_running) r->flags |= FR_FLAG_RUNNING;
+    if (m->current_mode == AUTO_MODE) r->flags |= FR_FLAG_AUTO;
+    if (m->shadow_dir_a == 1) r->flags |= FR_FLAG_REVERSE;
+    if (m->profile.state == PROFILE_RUNNING) r->flags |= FR_FLAG_PROFILE;
+    fr_commit(r);
+}
+
+/*
+ * FUNCTION: drain_shm_commands
+ * ----------------------------
+ * Applies every command queued by local processes, through the same parser
+ * as the phone. Runs on the control thread (state_lock held), so a command
+ * takes effect within one loop period without waking the I/O thread.
+ * Each command starts with a fresh parser: a "@<id>" only applies to its own
+ * command, never to one queued later by another process.
+ */
+void drain_shm_commands() {
+    const char *text;
+    CmdBatch batch;
+    while ((text = pshm_next_command(shm)) != NULL) {
+        int left = (int)strlen(text);
+        memset(&shm_parser, 0, sizeof(shm_parser));
+        while (left > 0) {
+            int used = cmd_parse(&shm_parser, text, left, &batch);
+            text += used;
+            left -= used;
+            if (left == 0) cmd_finish(&shm_parser, &batch); // "r:1500" needs no newline here
+            apply_batch(&shm_parser, &batch);
+        }
+        pshm_release_command(shm);
+    }
+}
+
+/*
+ * FUNCTION: publish_state
+ * -----------------------
+ * Writes the shared-memory snapshot of every motor under the seqlock
+ * (memcpy + two stores).
+ */
+void publish_state(uint32_t now_tick) {
+    PshmState st;
+    memset(&st, 0, sizeof(st));
+    st.tick = now_tick;
+    st.num_motors = (uint32_t)num_motors;
+    for (int i = 0; i < num_motors && i < PSHM_MAX_MOTORS; i++) {
+        Motor *m = &motors[i];
+        PshmMotor *pm = &st.motors[i];
+        export_pid_floats(m);
+        pm->id = m->cfg.id;
+        pm->edges = (uint32_t)m->revolution_count;
+        pm->rpm = m->rpm;
+        pm->rpm_smooth = m->rpm_smooth;
+        pm->desired_rpm = m->desired_rpm;
+        pm->speed_percent = m->speed_percent;
+        pm->current_mode = m->current_mode;
+        pm->motor_running = m->motor_running;
+        pm->direction = (m->shadow_dir_b == 1) ? 1 : (m->shadow_dir_a == 1) ? -1 : 0;
+        pm->duty = (m->shadow_duty > 0) ? (uint32_t)m->shadow_duty : 0;
+        pm->pid_duty = m->pid_duty;
+        pm->pid_error = m->pid.error;
+        pm->pid_integral = m->pid.integral;
+        pm->pid_p_term = m->pid.p_term;
+        pm->pid_i_term = m->pid.i_term;
+        pm->pid_d_term = m->pid.d_term;
+        pm->profile_state = m->profile.state;
+        pm->profile_segment = m->profile.index;
+        pm->profile_segments = m->profile.count;
+        pm->profile_progress = profile_progress(&m->profile);
+        pm->ff_duty = m->ff_duty;
+        pm->ff_points = m->ff.count;
+        pm->calibration_state = m->sweep.state;
+        pm->calibration_points = m->sweep.count;
+        pm->filter_accepted = m->filter.accepted;
+        pm->filter_short = m->filter.rejected_short;
+        pm->filter_long = m->filter.rejected_long;
+        pm->filter_relocks = m->filter.relocks;
+    }
+    st.clients = (uint32_t)atomic_load_explicit(&num_clients, memory_order_relaxed);
+    st.updates = shm->state.updates + 1;
+    pshm_write_state(shm, &st);
+}
+
+/*
+ * FUNCTION: calibrate_step
+ * ------------------------
+ * One tick of a calibration sweep: feeds the smoothed RPM to the sweep and
+ * applies the next duty step. When the last point is measured, the new table
+ * takes effect at once (the I/O thread saves it) and the motor is stopped.
+ */
+void calibrate_step(Motor *m) {
+    int r = ff_sweep_step(&m->sweep, m->rpm_smooth);
+    if (r == FF_STEP_HOLD) return;
+
+    raise_io_event(IO_EVT_CALIBRATION);
+    if (r == FF_STEP_POINT) {
+        m->speed_percent = (int)(ff_sweep_duty(&m->sweep) + 0.5);
+        set_duty(m, (uint32_t)(ff_sweep_duty(&m->sweep) * 10000));
+        return;
+    }
+
+    if (ff_build(&m->ff, &m->sweep) != 0) {
+        m->sweep.state = FF_SWEEP_FAILED;
+        log_warn("Calibration failed: RPM did not rise with the duty (motor %d), table unchanged\n", m->cfg.id);
+    } else {
+        log_info("Calibration done: %d points, breakaway %.1f%% (motor %d)\n",
+                 m->ff.count, m->ff.duty[0], m->cfg.id);
+    }
+    m->current_mode = MANUAL_MODE;
+    stop_motor(m);
+}
+
+/*
+ * FUNCTION: telemetry_events
+ * --------------------------
+ * Pushes text telemetry at once (subscribers with events=1, telemetry_policy.h)
+ * when something happened this tick: the motor started or stopped spinning,
+ * was started or stopped, changed mode, an output write failed, it reached its
+ * target (within max(20 RPM, 2%); it must leave twice that before it can
+ * reach it again), or rejected edges came back after a quiet second.
+ */
+void telemetry_events(Motor *m, int was_spinning) {
+    int event = ((m->rpm_smooth != 0) != was_spinning);
+
+    if (m->current_mode != m->ev_mode || m->motor_running != m->ev_running || m->output_faults != m->ev_faults) event = 1;
+    m->ev_mode = m->current_mode;
+    m->ev_running = m->motor_running;
+    m->ev_faults = m->output_faults;
+
+    int band = m->desired_rpm / 50;
+    if (band < 20) band = 20;
+    int err = abs(m->rpm_smooth - m->desired_rpm);
+    if (m->current_mode != AUTO_MODE || !m->motor_running || m->desired_rpm == 0 || err > 2 * band) {
+        m->ev_at_target = 0;
+    } else if (!m->ev_at_target && err <= band) {
+        m->ev_at_target = 1;
+        event = 1;
+    }
+
+    uint32_t rejected = rf_rejected(&m->filter);
+    if (rejected != m->ev_rejected) {
+        if (m->ev_quiet >= control_rate_hz) event = 1;
+        m->ev_rejected = rejected;
+        m->ev_quiet = 0;
+    } else if (m->ev_quiet < control_rate_hz) {
+        m->ev_quiet++;
+    }
+
+    if (event) raise_io_event(IO_EVT_PUSH_TELEMETRY);
+}
+
+/*
+ * FUNCTION: control_motor
+ * -----------------------
+ * One motor's share of a loop iteration: edge ingestion through the edge
+ * filter, the RPM estimate, the setpoint profile, then the PID update (or the
+ * calibration sweep), then the recorders.
+ */
+void control_motor(Motor *m, uint32_t now_tick, double dt) {
+    int was_spinning = (m->rpm_smooth != 0);
+
+    drain_edges(m, now_tick);
+
+    // RPM from the filtered edge intervals (impossible intervals were already dropped per edge)
+    int raw_rpm = rf_raw_rpm(&m->filter, now_tick, m->cfg.edges_per_rev);
+    m->rpm = raw_rpm;
+    m->rpm_smooth = rf_rpm(&m->filter, now_tick, m->cfg.edges_per_rev);
+
+    // Walk the setpoint profile first, so this tick's PID already uses the new target
+    if (m->profile.state == PROFILE_RUNNING) {
+        if (profile_step(&m->profile, control_rate_hz) != PROFILE_STEP_HOLD) raise_io_event(IO_EVT_PROFILE);
+        m->desired_rpm = (int)(m->profile.setpoint + 0.5);
+    }
+
+    // Run PID calculation
+    if (m->current_mode == AUTO_MODE && m->motor_running) {
+        int64_t pid_start_ns = monotonic_ns();
+        update_pid_controller(m, dt);
+        int64_t pid_ns = monotonic_ns() - pid_start_ns;
+        lat_record(&loop_stats.pid, pid_ns);
+        if (lat_enabled) lat_record(&lat_hist[LAT_PID], pid_ns / 1000);
+    }
+    if (m->current_mode == CALIBRATE_MODE) calibrate_step(m);
+
+    if (atomic_load_explicit(&binary_subscribers, memory_order_relaxed) > 0) record_sample(m, now_tick, raw_rpm);
+    if (fr_active()) record_flight(m, now_tick, raw_rpm);
+    telemetry_events(m, was_spinning);
+}
+
+/*
+ * FUNCTION: control_step
+ * ----------------------
+ * One iteration of the control loop: local commands, then every motor in
+ * table order with the same 'now_tick', then the shared-memory snapshot.
+ * Called with state_lock held.
+ */
+void control_step(uint32_t now_tick, double dt) {
+    if (shm) drain_shm_commands();
+    for (int i = 0; i < num_motors; i++) control_motor(&motors[i], now_tick, dt);
+    if (shm) publish_state(now_tick);
+}
+
+/*
+ * FUNCTION: setup_realtime
+ * ------------------------
+ * Moves the calling thread to SCHED_FIFO and pins it to control_cpu.
+ * Failure is not fatal (e.g. not running as root): the loop still runs,
+ * just with normal scheduling.
+ */
+void setup_realtime() {
+    struct sched_param sp = { .sched_priority = CONTROL_RT_PRIORITY };
+    int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp);
+    if (err != 0) log_warn("Warning: SCHED_FIFO unavailable (error %d)\n", err);
+    realtime_ok = (err == 0);
+
+    if (control_cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(control_cpu, &set);
+        err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if (err != 0) log_warn("Warning: Could not pin control thread to CPU %d (error %d)\n",
+                               control_cpu, err);
+    }
+}
+
+/*
+ * FUNCTION: set_realtime
+ * ----------------------
+ * Drops the control thread to normal scheduling (on = 0) or puts it back on
+ * SCHED_FIFO, if setup_realtime() got it in the first place.
+ */
+void set_realtime(int on) {
+    if (!realtime_ok) return;
+    struct sched_param sp = { .sched_priority = on ? CONTROL_RT_PRIORITY : 0 };
+    pthread_setschedparam(pthread_self(), on ? SCHED_FIFO : SCHED_OTHER, &sp);
+}
+
+/*
+ * IDLE MODE:
+ * With nobody connected and every motor stopped there is nothing to control.
+ * After idle_delay_s of that, the control thread stops the sensor ingestion
+ * (pigpiod callbacks or notification pipe, gpiochip events), gives up
+ * SCHED_FIFO and sleeps on idle_bell, a futex that a connection
+ * (wake_control()) or a queued shared-memory command (pshm_send_command())
+ * rings. The I/O thread publishes one last counter snapshot and disarms its
+ * stats timer (IO_EVT_IDLE); the log writer and the flight recorder's sync
+ * thread block once they have nothing to do. An idle server therefore has
+ * no periodic wake-ups at all. On a wake-up, real-time scheduling and the
+ * sensors are restored first, then the loop runs again. The time from the
+ * wake-up request to that point goes into loop_stats.wake.
+ *
+ * FUNCTION: idle_due
+ * ------------------
+ * Checks the idle conditions after a control step (state_lock held).
+ * Returns 1 once they have held for idle_delay_s.
+ */
+int idle_due(int64_t now_ns) {
+    int quiet = idle_delay_s > 0 && atomic_load(&num_clients) == 0 && !(shm && pshm_next_command(shm) != NULL);
+    for (int i = 0; i < num_motors && quiet; i++) {
+        const Motor *m = &motors[i];
+        if (m->motor_running || m->rpm_smooth != 0 || m->profile.state == PROFILE_RUNNING) quiet = 0;
+    }
+    if (!quiet) {
+        idle_quiet_ns = 0;
+        return 0;
+    }
+    if (idle_quiet_ns == 0) idle_quiet_ns = now_ns;
+    return now_ns - idle_quiet_ns >= (int64_t)idle_delay_s * 1000000000;
+}
+
+/*
+ * FUNCTION: wake_control
+ * ----------------------
+ * I/O thread: asks an idle control thread to resume (a client connected, or
+ * the server is shutting down). Does nothing while it is running.
+ */
+void wake_control() {
+    pthread_mutex_lock(&state_lock);
+    int ring = (loop_stats.idle && idle_wake_us == 0);
+    if (ring) idle_wake_us = monotonic_us();
+    pthread_mutex_unlock(&state_lock);
+    if (ring) pshm_ring_bell(idle_bell);
+}
+
+/*
+ * FUNCTION: idle_wait
+ * -------------------
+ * Control thread: the idle spell, from switching the sensors off until they
+ * are back on (see IDLE MODE).
+ */
+void idle_wait() {
+    log_info("Idle: no clients and every motor stopped, sensors off\n");
+    pthread_mutex_lock(&state_lock);
+    hal->sensor_stop();
+    loop_stats.idle = 1;
+    loop_stats.idle_entries++;
+    loop_stats.idle_enter_us = monotonic_us();
+    idle_wake_us = 0;
+    pthread_mutex_unlock(&state_lock);
+    raise_io_event(IO_EVT_IDLE);
+    set_realtime(0);
+
+    while (1) {
+        uint32_t seen = atomic_load(idle_bell); // Before the checks, so a ring after them is not lost
+        pthread_mutex_lock(&state_lock);
+        // A client that connected before the idle flag was set, or a local command
+        if (idle_wake_us == 0 && (atomic_load(&num_clients) > 0 || (shm && pshm_next_command(shm) != NULL))) {
+            idle_wake_us = monotonic_us();
+        }
+        int wake = !keep_running || idle_wake_us != 0;
+        pthread_mutex_unlock(&state_lock);
+        if (wake) break;
+        pshm_wait_bell(idle_bell, seen);
+    }
+    if (!keep_running) return; // Shutting down: main() does the rest
 
-    // 1. Calculate Error
-    double error = (double)desired_rpm - (double)rpm_smooth;
+    fr_wake();
+    set_realtime(1);
+    pthread_mutex_lock(&state_lock);
+    int ok = (hal->sensor_start(sensors, num_motors, rpm_filter_cfg.glitch_us, rpm_callback) == 0);
+    int64_t now_us = monotonic_us();
+    int64_t wake_us = now_us - idle_wake_us;
+    lat_record(&loop_stats.wake, wake_us);
+    loop_stats.idle_us += now_us - loop_stats.idle_enter_us;
+    loop_stats.idle = 0;
+    idle_quiet_ns = 0;
+    pthread_mutex_unlock(&state_lock);
+
+    raise_io_event(IO_EVT_IDLE);
+    if (!ok) log_error("Sensor edge ingestion did not restart after idle\n");
+    log_info("Active again: woke in %d us\n", (double)wake_us);
+}
+
+/*
+ * FUNCTION: control_thread
+ * ------------------------
+ * Real-time control loop. Sleeps to absolute deadlines on CLOCK_MONOTONIC
+ * so the period does not drift with the time spent in each step.
+ * If a deadline is badly missed (more than one full period), the schedule
+ * is re-based on the current time instead of running several steps back to back.
+ * Every iteration feeds the loop counters: period and wake-up lateness, step
+ * time, and an overrun for each re-base. Between clients it idles (IDLE MODE).
+ */
+void *control_thread(void *arg) {
+    setup_realtime();
 
-    // 2. Calculate Integral (Accumulated Error) with Anti-Windup Clamping
-    pid_integral += error;
-    if (pid_integral > PID_MAX_INTEGRAL) pid_integral = PID_MAX_INTEGRAL;
-    if (pid_integral < PID_MIN_INTEGRAL) pid_integral = PID_MIN_INTEGRAL;
+    // dt is in backend ticks; a simulated backend may run them faster than real time
+    long period_ns = 1000000000L / control_rate_hz / tick_scale;
+    double dt = 1.0 / control_rate_hz;
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    int64_t last_wake_ns = 0;
 
-    // 3. Calculate Derivative (Rate of change of error)
-    double derivative = error - pid_last_error;
+    log_info("Control thread running at %d Hz (%d motors)\n", control_rate_hz, num_motors);
+    if (tick_scale > 1) log_info("Control period %.1f us real time (x%d)\n", period_ns / 1000.0, tick_scale);
 
-    // 4. Compute Output (P + I + D)
-    double output = (PID_KP * error) + (PID_KI * pid_integral) + (PID_KD * derivative);
+    while (keep_running) {
+        deadline.tv_nsec += period_ns;
+        while (deadline.tv_nsec >= 1000000000L) { deadline.tv_nsec -= 1000000000L; deadline.tv_sec++; }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL);
+        int64_t wake_ns = monotonic_ns();
+        int64_t deadline_ns = (int64_t)deadline.tv_sec * 1000000000 + deadline.tv_nsec;
 
-    // 5. Limit the rate of change (prevents motor jerking)
-    int change = (int)output;
-    if (change > MAX_CHANGE_PER_LOOP) change = MAX_CHANGE_PER_LOOP;
-    if (change < -MAX_CHANGE_PER_LOOP) change = -MAX_CHANGE_PER_LOOP;
+        pthread_mutex_lock(&state_lock);
+        uint32_t now_tick = hal->tick();
+        if (lat_enabled) lat_step_us = monotonic_us();
+        int64_t step_start_ns = monotonic_ns();
+        control_step(now_tick, dt);
+        int64_t end_ns = monotonic_ns();
 
-    // 6. Apply to global speed
-    speed_percent += change;
-    if (speed_percent > 100) speed_percent = 100;
-    if (speed_percent < 0) speed_percent = 0;
+        loop_stats.loops++;
+        if (last_wake_ns != 0) lat_record(&loop_stats.period, (wake_ns - last_wake_ns) / 1000);
+        lat_record(&loop_stats.late, (wake_ns - deadline_ns) / 1000);
+        lat_record(&loop_stats.step, end_ns - step_start_ns);
+        int overrun = (end_ns - deadline_ns > period_ns);
+        if (overrun) loop_stats.overruns++;
+        int idle = idle_due(end_ns);
+        pthread_mutex_unlock(&state_lock);
 
-    // 7. Write to Hardware (Duty Cycle range 0 - 1,000,000)
-    hardware_PWM(pi, SPEED_PIN, PWM_FREQ, speed_percent * 10000);
+        if (idle) {
+            idle_wait();
+            last_wake_ns = 0; // The idle spell is not a loop period
+            clock_gettime(CLOCK_MONOTONIC, &deadline);
+            continue;
+        }
 
-    // 8. Store error for next loop
-    pid_last_error = error;
+        // Re-base the schedule after a large overrun
+        last_wake_ns = wake_ns;
+        if (overrun) clock_gettime(CLOCK_MONOTONIC, &deadline);
+    }
+    return NULL;
+}
 
-    printf("PID LOG: Target=%d | Actual=%d | Error=%.1f | PWM Adj=%d | New Speed=%d%%\n",
-           desired_rpm, rpm_smooth, error, change, speed_percent);
+/*
+ * FUNCTION: start_calibration
+ * ---------------------------
+ * Starts a feedforward calibration sweep on motor 'm' (see feedforward.h):
+ * power on, default direction if none is set, 0 % duty. The PID is off until
+ * the sweep ends; any mode or direction command aborts it.
+ */
+void start_calibration(Motor *m) {
+    if (m->sweep.state == FF_SWEEP_RUNNING) return;
+    cancel_profile(m);
+    m->current_mode = CALIBRATE_MODE;
+    m->motor_running = 1;
+    pid_reset(&m->pid);
+    set_master_power(m, 1);
+    if (!direction_is_set(m)) set_direction(m, 0, 1);
+    ff_sweep_start(&m->sweep, control_rate_hz);
+    m->speed_percent = 0;
+    set_duty(m, 0);
+    raise_io_event(IO_EVT_CALIBRATION);
+    log_info("Calibration started (motor %d)\n", m->cfg.id);
 }
 
 /*
  * FUNCTION: process_command
  * -------------------------
- * Executes a single character command received via Bluetooth.
+ * Executes a single character command for motor 'm'.
  * s = Start Motor
  * x = Stop Motor
  * c = Clockwise
@@ -205,264 +1209,1672 @@ void update_pid_controller() {
  * a = Auto Mode
  * m = Manual Mode
  * + / - = Increment/Decrement Target RPM
+ * C = Calibrate the feedforward table (duty sweep, motor spins up to full speed)
  */
-void process_command(char cmd) {
-    printf("CMD RECEIVED: '%c'\n", cmd);
+void process_command(Motor *m, char cmd) {
+    log_info("CMD RECEIVED: '%c' (motor %d)\n", cmd, m->cfg.id);
     switch (cmd) {
         case 's': // START
-            gpio_write(pi, MASTER_ON_PIN, 1);
-            motor_running = 1;
-            pid_integral = 0; pid_last_error = 0; // Reset PID memory
+            set_master_power(m, 1);
+            m->motor_running = 1;
+            pid_reset(&m->pid); // Reset PID memory
             break;
         case 'x': // STOP (Emergency)
-            stop_all_activity();
+            stop_motor(m);
             break;
         case 'c': // CLOCKWISE
-            gpio_write(pi, DIR_A_PIN, 0); gpio_write(pi, DIR_B_PIN, 1);
+            cancel_calibration(m);
+            set_direction(m, 0, 1);
             break;
         case 'v': // COUNTER-CLOCKWISE
-            gpio_write(pi, DIR_A_PIN, 1); gpio_write(pi, DIR_B_PIN, 0);
+            cancel_calibration(m);
+            set_direction(m, 1, 0);
             break;
         case 'f': // FASTER (Manual only)
-            if (current_mode == MANUAL_MODE) {
-                speed_percent += 10;
-                if (speed_percent > 100) speed_percent = 100;
-                hardware_PWM(pi, SPEED_PIN, PWM_FREQ, speed_percent * 10000);
+            if (m->current_mode == MANUAL_MODE) {
+                m->speed_percent += 10;
+                if (m->speed_percent > 100) m->speed_percent = 100;
+                set_duty(m, m->speed_percent * 10000);
             }
             break;
         case 'd': // SLOWER (Manual only)
-            if (current_mode == MANUAL_MODE) {
-                speed_percent -= 10;
-                if (speed_percent < 0) speed_percent = 0;
-                hardware_PWM(pi, SPEED_PIN, PWM_FREQ, speed_percent * 10000);
+            if (m->current_mode == MANUAL_MODE) {
+                m->speed_percent -= 10;
+                if (m->speed_percent < 0) m->speed_percent = 0;
+                set_duty(m, m->speed_percent * 10000);
             }
             break;
         case 'a': // SWITCH TO AUTO
-            current_mode = AUTO_MODE;
-            motor_running = 1;
-            gpio_write(pi, MASTER_ON_PIN, 1);
+            cancel_calibration(m);
+            m->current_mode = AUTO_MODE;
+            m->motor_running = 1;
+            set_master_power(m, 1);
             // Ensure a direction is set if currently stopped
-            if (gpio_read(pi, DIR_A_PIN) == 0 && gpio_read(pi, DIR_B_PIN) == 0) {
-                 gpio_write(pi, DIR_A_PIN, 0); gpio_write(pi, DIR_B_PIN, 1);
-            }
-            if (desired_rpm == 0) desired_rpm = 500; // Default start speed
-            pid_integral = 0; pid_last_error = 0;
-            printf("Switched to AUTO_MODE (Target: %d)\n", desired_rpm);
+            if (!direction_is_set(m)) set_direction(m, 0, 1);
+            if (m->desired_rpm == 0) m->desired_rpm = 500; // Default start speed
+            pid_reset(&m->pid);
+            load_pid_duty(m, m->speed_percent); // PID continues from the current manual duty (or the feedforward duty)
+            log_info("Switched to AUTO_MODE (Target: %d, motor %d)\n", m->desired_rpm, m->cfg.id);
             break;
         case 'm': // SWITCH TO MANUAL
-            current_mode = MANUAL_MODE;
-            printf("Switched to MANUAL_MODE\n");
+            cancel_profile(m);
+            cancel_calibration(m);
+            m->current_mode = MANUAL_MODE;
+            log_info("Switched to MANUAL_MODE (motor %d)\n", m->cfg.id);
             break;
         case '+': // INC TARGET
-            if (current_mode == AUTO_MODE) desired_rpm += 100;
-            printf("Target RPM: %d\n", desired_rpm);
+            cancel_profile(m);
+            if (m->current_mode == AUTO_MODE) m->desired_rpm += 100;
+            if (m->desired_rpm > MAX_PHYSICS_RPM) m->desired_rpm = MAX_PHYSICS_RPM;
+            log_info("Target RPM: %d (motor %d)\n", m->desired_rpm, m->cfg.id);
             break;
         case '-': // DEC TARGET
-            if (current_mode == AUTO_MODE) {
-                desired_rpm -= 100;
-                if(desired_rpm < 0) desired_rpm=0;
+            cancel_profile(m);
+            if (m->current_mode == AUTO_MODE) {
+                m->desired_rpm -= 100;
+                if(m->desired_rpm < 0) m->desired_rpm=0;
             }
-            printf("Target RPM: %d\n", desired_rpm);
+            log_info("Target RPM: %d (motor %d)\n", m->desired_rpm, m->cfg.id);
+            break;
+        case CMD_CALIBRATE:
+            start_calibration(m);
             break;
     }
 }
 
 /*
- * FUNCTION: parse_input_byte
- * --------------------------
- * State machine to parse specific RPM commands in the format "r:1500"
- * STATE_NORMAL: Processing single char commands.
- * STATE_WAIT_COLON: Saw 'r', waiting for ':'
- * STATE_READ_NUM: Reading digits until non-digit.
- */
-void parse_input_byte(char c) {
-    switch (p_state) {
-        case STATE_NORMAL:
-            if (c == 'r') { p_state = STATE_WAIT_COLON; }
-            else { process_command(c); }
-            break;
+ * FUNCTION: enter_auto_mode
+ * -------------------------
+ * Switches to Auto Mode for a command that brings its own target ("r:", "p:"):
+ * power on, default direction if none is set, PID continues from the current duty
+ * (with a feedforward table: from the table's duty for the target).
+ */
+void enter_auto_mode(Motor *m) {
+    if (m->current_mode == AUTO_MODE) return;
+    cancel_calibration(m);
+    m->current_mode = AUTO_MODE;
+    m->motor_running = 1;
+    load_pid_duty(m, m->speed_percent);
+    set_master_power(m, 1);
+    if (!direction_is_set(m)) set_direction(m, 0, 1);
+}
 
-        case STATE_WAIT_COLON:
-            if (c == ':') {
-                p_state = STATE_READ_NUM;
-                num_buf_idx = 0;
-                memset(num_buffer, 0, sizeof(num_buffer));
-            }
-            else {
-                // If not a colon, treat 'r' as a glitch and process this char normally
-                p_state = STATE_NORMAL;
-                process_command(c);
-            }
-            break;
+/*
+ * FUNCTION: start_profile
+ * -----------------------
+ * Parses an uploaded profile and starts it on motor 'm'. It starts from the
+ * current target if the motor is already in Auto Mode, otherwise from the
+ * measured speed. An invalid profile is ignored and a running one keeps going.
+ */
+void start_profile(Motor *m, const char *text) {
+    Profile parsed;
+    if (profile_parse(text, MAX_PHYSICS_RPM, &parsed) != 0) {
+        log_warn("Invalid profile ignored (motor %d)\n", m->cfg.id);
+        return;
+    }
+    double from = (m->current_mode == AUTO_MODE) ? m->desired_rpm : m->rpm_smooth;
 
-        case STATE_READ_NUM:
-            if (isdigit(c)) {
-                if (num_buf_idx < 15) num_buffer[num_buf_idx++] = c;
-            } else {
-                // End of number reached
-                if (num_buf_idx > 0) {
-                    desired_rpm = atoi(num_buffer);
-                    printf("PARSED SPECIFIC RPM TARGET: %d\n", desired_rpm);
-
-                    // Auto-switch to Auto Mode if we receive a target
-                    if (current_mode != AUTO_MODE) {
-                        current_mode = AUTO_MODE;
-                        motor_running = 1;
-                        gpio_write(pi, MASTER_ON_PIN, 1);
-                        if (gpio_read(pi, DIR_A_PIN) == 0 && gpio_read(pi, DIR_B_PIN) == 0) {
-                             gpio_write(pi, DIR_A_PIN, 0); gpio_write(pi, DIR_B_PIN, 1);
-                        }
-                    }
-                }
-                p_state = STATE_NORMAL;
-                // If the delimiter wasn't a newline, it might be a new command
-                if (c != '\n' && c != '\r') process_command(c);
-            }
-            break;
+    cancel_profile(m);
+    memcpy(m->profile.seg, parsed.seg, sizeof(parsed.seg[0]) * (size_t)parsed.count);
+    m->profile.count = parsed.count;
+    enter_auto_mode(m);
+    profile_start(&m->profile, from, control_rate_hz);
+    m->desired_rpm = (int)(m->profile.setpoint + 0.5);
+    raise_io_event(IO_EVT_PROFILE);
+    log_info("Profile started: %d segments, %.1f s (motor %d)\n",
+             parsed.count, m->profile.total_ticks / (double)control_rate_hz, m->cfg.id);
+}
+
+/*
+ * FUNCTION: apply_tuning
+ * ----------------------
+ * Applies a "g:" line to motor 'm' (all assignments or none, see pid.h) and
+ * has the I/O thread report the resulting tuning. An empty line only reports.
+ * The new gains take effect on the next control step; the integral is kept.
+ */
+void apply_tuning(Motor *m, const char *text) {
+    if (*text != '\0') {
+        if (pid_tuning_set(&m->tuning, text) != 0) {
+            log_warn("Invalid tuning ignored (motor %d)\n", m->cfg.id);
+            return;
+        }
+        log_info("PID tuning changed (motor %d)\n", m->cfg.id);
     }
+    m->tuning_gen++;
+    raise_io_event(IO_EVT_GAINS);
 }
 
+/*
+ * FUNCTION: note_command
+ * ----------------------
+ * A decoded command is about to run on 'm': counts it and, with -L, records
+ * read-to-parse and arms cmd_to_pwm for the motor's next PWM write.
+ * The latency part is only for client bytes (deliver_input sets lat_input_us),
+ * not for the shared-memory ring; read-to-apply is timed from the batch's
+ * first command.
+ */
+void note_command(Motor *m) {
+    loop_stats.commands++;
+    if (!lat_enabled || lat_input_us == 0) return;
+    int64_t now_us = monotonic_us();
+    if (lat_noted_us == 0) lat_noted_us = now_us;
+    lat_record(&lat_hist[LAT_PARSE], now_us - lat_input_us);
+    m->lat_cmd_us = lat_input_us;
+}
+
+/*
+ * FUNCTION: apply_batch
+ * ---------------------
+ * Runs the motor commands of a decoded batch in order, as one transaction:
+ * the set_* calls only stage outputs, and commit_outputs() writes them once
+ * at the end. The control step takes state_lock too, so it never sees a
+ * half-applied batch, and the pins never show one.
+ * "@<id>" switches the parser's motor; commands after an unknown ID are
+ * dropped. Per-client commands (CMD_CLASS_CLIENT, _CLIENT_ARG) are the caller's.
+ * Called with state_lock held.
+ */
+void apply_batch(CmdParser *ps, const CmdBatch *b) {
+    outputs_held = 1;
+    for (int i = 0; i < b->count; i++) {
+        const CmdOp *op = &b->ops[i];
+        if (op->cmd == CMD_SELECT_MOTOR) {
+            ps->motor = find_motor(op->value);
+            if (ps->motor < 0) log_warn("Unknown motor ID %d: commands ignored until the next '@'\n", op->value);
+            continue;
+        }
+        int cls = cmd_class(op->cmd);
+        if (ps->motor < 0 || cls == CMD_CLASS_CLIENT || cls == CMD_CLASS_CLIENT_ARG) continue;
+
+        Motor *m = &motors[ps->motor];
+        note_command(m);
+        switch (op->cmd) {
+            case CMD_TARGET:
+                cancel_profile(m);
+                // Clamped like profile targets: the PID, the fixed-point path and the int16 telemetry fields assume a physical target
+                m->desired_rpm = (op->value > MAX_PHYSICS_RPM) ? MAX_PHYSICS_RPM : op->value;
+                log_info("PARSED SPECIFIC RPM TARGET: %d (motor %d)\n", m->desired_rpm, m->cfg.id);
+                // Auto-switch to Auto Mode if we receive a target
+                enter_auto_mode(m);
+                break;
+            case CMD_PROFILE:
+                start_profile(m, b->text + op->text);
+                break;
+            case CMD_TUNE:
+                apply_tuning(m, b->text + op->text);
+                break;
+            default:
+                process_command(m, op->cmd);
+                break;
+        }
+    }
+    commit_outputs();
+    if (b->rejected > 0) log_warn("%u malformed, unknown or over-long (> %d bytes) commands skipped\n", b->rejected, CMD_TEXT_MAX);
+}
+
+// ======================================================================================
+// I/O EVENT LOOP
 // ======================================================================================
-// MAIN FUNCTION
-// ======================================================================================
-int main() {
-    setbuf(stdout, NULL); // Disable stdout buffering so printf shows up immediately
+static int epoll_fd = -1;
+static int telemetry_timer_fd = -1;        // timerfd, armed only while a text client is ready
+static long telem_tick_us = 0;             // Its period: the shortest 'min' of those clients (0 = off)
+static int frame_timer_fd = -1;            // timerfd, armed only while a binary subscriber is connected
+static uint32_t frame_seq = 0;             // Sequence number of the next binary frame
 
-    // Register signal handlers for clean exit
-    signal(SIGINT, int_handler);
-    signal(SIGTERM, int_handler);
+/*
+ * CLIENTS:
+ * Any number of clients (up to MAX_CLIENTS) can be attached, over any transport.
+ * At most one holds the control token and may send commands; the rest only
+ * receive telemetry. Every client has a small output backlog so a slow reader
+ * never blocks the loop: frames that do not fit are dropped for that client only.
+ */
+typedef struct Client Client;
 
-    // Initialize connection to pigpio daemon
-    pi = pigpio_start(NULL, NULL);
-    if (pi < 0) {
-        fprintf(stderr, "Failed to connect to pigpio daemon. Is it running?\n");
-        return 1;
+/*
+ * TRANSPORTS:
+ * A transport only moves bytes; the protocol (command parser, control token,
+ * telemetry encoding) is shared. Each listening socket is tagged with one:
+ * - accept:       Takes a pending connection, returns the client fd and its address.
+ * - on_input:     Raw bytes from the socket. Byte-stream transports pass them straight
+ *                 to deliver_input(); WebSocket first removes its framing. -1 = drop.
+ * - frame_header: Optional header put in front of every outgoing message.
+ * - handshake:    1 if the client is not ready (no role, no telemetry) until
+ *                 on_input calls client_ready().
+ */
+typedef struct {
+    const char *name;
+    int    (*accept)(int listen_fd, char *addr, size_t addr_cap);
+    int    (*on_input)(Client *c, char *data, int len);
+    size_t (*frame_header)(uint8_t *out, int binary, size_t len);
+    int    handshake;
+} Transport;
+
+struct Client {
+    int fd;                                // -1 = free slot
+    const Transport *transport;
+    char addr[48];
+    int ready;                             // Handshake finished; receives role and telemetry
+    CmdParser parser;
+    char in_buf[CLIENT_IN_BUF];            // Transport framing not yet decoded (WebSocket)
+    size_t in_len;
+    char out_buf[CLIENT_OUT_BUF];          // Bytes accepted but not yet written to the socket
+    size_t out_len;
+    int watching_out;                      // EPOLLOUT currently requested
+    int binary;                            // 1 = binary frames (telemetry.h), 0 = "RPM:" text
+    TelemPolicy telem;                     // When "RPM:" text goes out ('T')
+    int64_t telem_sent_us;                 // Last scheduled "RPM:" message (events do not count)
+    int telem_rpm[MAX_MOTORS];             // RPMs in the last message (deadband reference)
+    uint32_t frames_dropped;
+    int64_t read_us;                       // -L: when the bytes being delivered were read
+};
+
+static Client clients[MAX_CLIENTS];
+static Client *controller = NULL;          // Holder of the control token (NULL = free)
+
+typedef struct {
+    int fd;
+    const Transport *transport;
+} Listener;
+
+static Listener listeners[MAX_LISTENERS];
+static int num_listeners = 0;
+static int64_t lat_wake_us = 0;            // -L: when epoll_wait last returned
+
+// I/O thread traffic counters (the control side is in LoopStats)
+typedef struct {
+    uint64_t bytes_in;
+    uint64_t bytes_out;
+    uint32_t write_eagain;
+    uint32_t messages_dropped;
+} IoStats;
+static IoStats io_stats;
+static int stats_timer_fd = -1;            // timerfd, STATS_PERIOD_US, disarmed while the control thread idles
+
+/*
+ * FUNCTION: arm_timer
+ * -------------------
+ * Starts (period_us > 0) or stops (period_us == 0) a periodic timerfd.
+ */
+void arm_timer(int timer_fd, long period_us) {
+    struct itimerspec its = { 0 };
+    its.it_interval.tv_sec = period_us / 1000000;
+    its.it_interval.tv_nsec = (period_us % 1000000) * 1000;
+    its.it_value = its.it_interval;
+    timerfd_settime(timer_fd, 0, &its, NULL);
+}
+
+Client *find_client(int fd) {
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        if (clients[i].fd == fd) return &clients[i];
     }
+    return NULL;
+}
 
-    // --- GPIO SETUP ---
-    set_mode(pi, MASTER_ON_PIN, PI_OUTPUT);
-    set_mode(pi, DIR_A_PIN, PI_OUTPUT);
-    set_mode(pi, DIR_B_PIN, PI_OUTPUT);
-    set_mode(pi, SPEED_PIN, PI_OUTPUT);
+/*
+ * FUNCTION: watch_client_output
+ * -----------------------------
+ * Asks epoll for EPOLLOUT only while the client has a backlog to flush.
+ * epoll_ctl is only called when that changes, not once per frame.
+ */
+void watch_client_output(Client *c, int enable) {
+    if (c->watching_out == enable) return;
+    c->watching_out = enable;
+    struct epoll_event ev = { .events = EPOLLIN | EPOLLRDHUP | (enable ? EPOLLOUT : 0), .data.fd = c->fd };
+    epoll_ctl(epoll_fd, EPOLL_CTL_MOD, c->fd, &ev);
+}
 
-    // --- SENSOR CONFIGURATION ---
-    set_mode(pi, SENSOR_PIN, PI_INPUT);
-    set_pull_up_down(pi, SENSOR_PIN, PI_PUD_UP); // Internal Pull-Up
-    set_glitch_filter(pi, SENSOR_PIN, GLITCH_FILTER_US); // Hardware debouncing
+void drop_client(Client *c, const char *reason);
 
-    stop_all_activity(); // Ensure motor is off at start
+/*
+ * FUNCTION: update_telemetry_timer
+ * --------------------------------
+ * Runs the text telemetry timer at the shortest 'min' among the ready text
+ * clients, so every policy is evaluated often enough (send_telemetry()
+ * decides per client), and stops it while there are none.
+ */
+void update_telemetry_timer() {
+    long tick_us = 0;
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        const Client *c = &clients[i];
+        if (c->fd < 0 || !c->ready || c->binary) continue;
+        long min_us = (long)c->telem.min_ms * 1000;
+        if (tick_us == 0 || min_us < tick_us) tick_us = min_us;
+    }
+    if (tick_us == telem_tick_us) return;
+    telem_tick_us = tick_us;
+    arm_timer(telemetry_timer_fd, tick_us);
+}
+
+/*
+ * FUNCTION: set_client_binary
+ * ---------------------------
+ * Switches a client between text and binary telemetry. The frame timer and
+ * the control thread's sample recording only run while binary subscribers exist.
+ */
+void set_client_binary(Client *c, int binary) {
+    if (c->binary == binary) return;
+    c->binary = binary;
 
-    // Attach Interrupt: Trigger rpm_callback on Rising Edge
-    callback(pi, SENSOR_PIN, RISING_EDGE, rpm_callback);
+    int subscribers = atomic_load(&binary_subscribers) + (binary ? 1 : -1);
+    if (binary && subscribers == 1) {
+        TelemetrySample stale[TELEM_MAX_SAMPLES];
+        while (telem_ring_pop_batch(&telem_ring, stale, TELEM_MAX_SAMPLES) > 0) {} // Left over from the last session
+        arm_timer(frame_timer_fd, 1000000L / frame_rate_hz);
+    } else if (subscribers == 0) {
+        arm_timer(frame_timer_fd, 0);
+    }
+    atomic_store(&binary_subscribers, subscribers);
+    update_telemetry_timer();
+}
 
-    // --- BLUETOOTH SOCKET SETUP ---
-    struct sockaddr_rc loc_addr = { 0 }, rem_addr = { 0 };
-    char buf[1024] = { 0 };
-    char data_str[64];
-    int server_sock, client_sock;
-    socklen_t opt = sizeof(rem_addr);
+/*
+ * FUNCTION: flush_client
+ * ----------------------
+ * Writes as much of the client's backlog as the socket will take.
+ * Returns -1 if the client was dropped.
+ */
+int flush_client(Client *c) {
+    while (c->out_len > 0) {
+        ssize_t n = write(c->fd, c->out_buf, c->out_len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) { io_stats.write_eagain++; break; }
+            drop_client(c, "Write Error"); // Detect Disconnection
+            return -1;
+        }
+        io_stats.bytes_out += (uint64_t)n;
+        c->out_len -= (size_t)n;
+        if (c->out_len) memmove(c->out_buf, c->out_buf + n, c->out_len);
+    }
+    watch_client_output(c, c->out_len > 0);
+    return 0;
+}
+
+/*
+ * FUNCTION: queue_message
+ * -----------------------
+ * Queues one complete message, with the transport's frame header if it has
+ * one. If the backlog cannot hold the whole message it is dropped for this
+ * client (messages are never split), so a stalled subscriber costs a memcpy
+ * at most and never delays anyone else. 'binary' marks telemetry frames.
+ */
+void queue_message(Client *c, const char *data, size_t len, int binary) {
+    uint8_t header[WS_MAX_HEADER];
+    size_t hlen = c->transport->frame_header ? c->transport->frame_header(header, binary, len) : 0;
+
+    if (hlen + len > CLIENT_OUT_BUF - c->out_len) {
+        c->frames_dropped++;
+        io_stats.messages_dropped++;
+        return;
+    }
+    memcpy(c->out_buf + c->out_len, header, hlen);
+    memcpy(c->out_buf + c->out_len + hlen, data, len);
+    c->out_len += hlen + len;
+    flush_client(c);
+}
+
+/*
+ * FUNCTION: queue_raw
+ * -------------------
+ * Queues bytes exactly as given (transport handshakes and control frames).
+ */
+void queue_raw(Client *c, const void *data, size_t len) {
+    if (len > CLIENT_OUT_BUF - c->out_len) return;
+    memcpy(c->out_buf + c->out_len, data, len);
+    c->out_len += len;
+    flush_client(c);
+}
+
+/*
+ * FUNCTION: send_role
+ * -------------------
+ * Tells a client whether it holds the control token ("CTRL:1") or is a
+ * read-only subscriber ("CTRL:0"). Older app builds ignore unknown lines.
+ */
+void send_role(Client *c) {
+    const char *msg = (c == controller) ? "CTRL:1\n" : "CTRL:0\n";
+    queue_message(c, msg, strlen(msg), 0);
+}
+
+/*
+ * FUNCTION: grant_control
+ * -----------------------
+ * Gives the free control token to 'c' and resets every motor to a known state,
+ * as a new phone connection always did.
+ */
+void grant_control(Client *c) {
+    controller = c;
+    memset(&c->parser, 0, sizeof(c->parser));
+
+    pthread_mutex_lock(&state_lock);
+    for (int i = 0; i < num_motors; i++) motors[i].current_mode = MANUAL_MODE;
+    stop_all_activity();
+    pthread_mutex_unlock(&state_lock);
+
+    log_text(LOG_LVL_INFO, "Control token -> %s\n", c->addr);
+    send_role(c);
+}
+
+/*
+ * FUNCTION: drop_client
+ * ---------------------
+ * Closes a client connection. If it held the control token every motor is made
+ * safe and the token becomes free for another client to claim.
+ */
+void drop_client(Client *c, const char *reason) {
+    char msg[96]; // log_text keeps the first LOG_TEXT_MAX bytes
+    snprintf(msg, sizeof(msg), "%s client disconnected (%s)", c->transport->name, reason);
+    log_text(LOG_LVL_INFO, "%s.\n", msg);
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, c->fd, NULL);
+    close(c->fd);
+    c->fd = -1;
+    c->out_len = 0;
+    num_clients--;
+    set_client_binary(c, 0);
+
+    if (c == controller) {
+        controller = NULL;
+        pthread_mutex_lock(&state_lock);
+        stop_all_activity(); // Safety stop on disconnect
+        pthread_mutex_unlock(&state_lock);
+    }
+    update_telemetry_timer();
+}
+
+/*
+ * FUNCTION: send_motor_list
+ * -------------------------
+ * Tells a client which motor IDs exist, default motor first: "MOTORS:0,1,2\n".
+ * Binary samples carry these IDs; "@<id>" addresses commands to them.
+ */
+void send_motor_list(Client *c) {
+    char msg[8 + MAX_MOTORS * 4];
+    int len = snprintf(msg, sizeof(msg), "MOTORS:");
+    for (int i = 0; i < num_motors; i++) {
+        len += snprintf(msg + len, sizeof(msg) - (size_t)len, i ? ",%d" : "%d", motors[i].cfg.id);
+    }
+    msg[len++] = '\n';
+    queue_message(c, msg, (size_t)len, 0);
+}
+
+/*
+ * FUNCTION: client_ready
+ * ----------------------
+ * The client can now take part in the protocol. The first client (or any
+ * client while the token is free) becomes the controller; everyone else is read-only.
+ */
+void client_ready(Client *c) {
+    c->ready = 1;
+    update_telemetry_timer();
+    send_motor_list(c);
+    if (controller == NULL) grant_control(c);
+    else send_role(c);
+}
+
+/*
+ * FUNCTION: accept_client
+ * -----------------------
+ * Accepts a pending connection on a listener of any transport.
+ */
+void accept_client(const Listener *l) {
+    char addr[48] = "?";
+
+    int sock = l->transport->accept(l->fd, addr, sizeof(addr));
+    if (sock < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK && keep_running) perror("Accept failed");
+        return;
+    }
+
+    Client *c = find_client(-1);
+    if (c == NULL) {
+        log_warn("Client limit (%d) reached, connection refused\n", MAX_CLIENTS);
+        close(sock);
+        return;
+    }
+
+    // Connection Established
+    memset(c, 0, sizeof(*c));
+    c->fd = sock;
+    c->transport = l->transport;
+    tp_default(&c->telem, TELEMETRY_PERIOD_US / 1000);
+    snprintf(c->addr, sizeof(c->addr), "%s", addr);
+    char msg[96]; // log_text keeps the first LOG_TEXT_MAX bytes
+    snprintf(msg, sizeof(msg), "%s Connected: %s", l->transport->name, c->addr);
+    log_text(LOG_LVL_INFO, "%s\n", msg);
+    fcntl(sock, F_SETFL, O_NONBLOCK); // Set Client socket to non-blocking
+
+    struct epoll_event ev = { .events = EPOLLIN | EPOLLRDHUP, .data.fd = sock };
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, sock, &ev);
+    num_clients++;
+    wake_control();
+
+    if (!c->transport->handshake) client_ready(c);
+}
+
+// --- SETPOINT PROFILE REPORTS ---
+typedef struct {
+    uint32_t run;
+    int index, count, progress;
+    ProfileState state;
+} ProfileReport;
+
+static ProfileReport profile_reported[MAX_MOTORS]; // Last state sent to the clients
+
+/*
+ * FUNCTION: snapshot_profiles
+ * ---------------------------
+ * Copies every motor's profile run state under state_lock (the control
+ * thread advances it mid-step).
+ */
+void snapshot_profiles(ProfileReport *out) {
+    pthread_mutex_lock(&state_lock);
+    for (int i = 0; i < num_motors; i++) {
+        const Profile *p = &motors[i].profile;
+        out[i].run = p->run;
+        out[i].index = p->index;
+        out[i].count = p->count;
+        out[i].progress = profile_progress(p);
+        out[i].state = p->state;
+    }
+    pthread_mutex_unlock(&state_lock);
+}
+
+/*
+ * FUNCTION: send_profile_events
+ * -----------------------------
+ * Reports what changed since the last IO_EVT_PROFILE to every client, in one message:
+ * "PROFILE:<id>,START,<segments>", "PROFILE:<id>,SEG,<index>",
+ * "PROFILE:<id>,DONE" or "PROFILE:<id>,ABORT". Changes that happen between two
+ * wakeups are folded together; the last one wins.
+ */
+void send_profile_events() {
+    ProfileReport now[MAX_MOTORS];
+    char data_str[MAX_MOTORS * 72];
+    int len = 0;
+
+    snapshot_profiles(now);
+    for (int i = 0; i < num_motors; i++) {
+        ProfileReport *last = &profile_reported[i];
+        int id = motors[i].cfg.id;
+
+        if (now[i].run != last->run) {
+            len += snprintf(data_str + len, sizeof(data_str) - (size_t)len, "PROFILE:%d,START,%d\n", id, now[i].count);
+            last->index = -1;
+        }
+        if (now[i].state == PROFILE_RUNNING && now[i].index != last->index) {
+            len += snprintf(data_str + len, sizeof(data_str) - (size_t)len, "PROFILE:%d,SEG,%d\n", id, now[i].index);
+        }
+        if (now[i].state != last->state && now[i].state == PROFILE_DONE) {
+            len += snprintf(data_str + len, sizeof(data_str) - (size_t)len, "PROFILE:%d,DONE\n", id);
+        }
+        if (now[i].state != last->state && now[i].state == PROFILE_ABORTED) {
+            len += snprintf(data_str + len, sizeof(data_str) - (size_t)len, "PROFILE:%d,ABORT\n", id);
+        }
+        *last = now[i];
+    }
+    if (len == 0 || num_clients == 0) return;
+
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        if (clients[i].fd >= 0 && clients[i].ready) queue_message(&clients[i], data_str, (size_t)len, 0);
+    }
+}
+
+// --- CALIBRATION REPORTS ---
+static const char *ff_path = FF_DEFAULT_PATH; // Feedforward table file (NULL = -F none)
+static FfSweep sweep_reported[MAX_MOTORS];    // Last sweep state sent to the clients
+
+/*
+ * FUNCTION: save_feedforward
+ * --------------------------
+ * Copies every motor's table under state_lock and rewrites the table file
+ * (outside the lock: the control thread never waits for the disk).
+ */
+void save_feedforward() {
+    int ids[MAX_MOTORS];
+    FfTable tables[MAX_MOTORS];
+    if (ff_path == NULL) return;
+
+    pthread_mutex_lock(&state_lock);
+    for (int i = 0; i < num_motors; i++) {
+        ids[i] = motors[i].cfg.id;
+        tables[i] = motors[i].ff;
+    }
+    pthread_mutex_unlock(&state_lock);
+
+    if (ff_save(ff_path, ids, tables, num_motors) != 0) log_error("Feedforward table not saved (errno %d)\n", errno);
+    else log_info("Feedforward table saved (%d motors)\n", num_motors);
+}
+
+/*
+ * FUNCTION: send_calibration_events
+ * ---------------------------------
+ * Reports calibration progress to every client, in one message:
+ * "CAL:<id>,START", "CAL:<id>,POINT,<duty>,<rpm>" per measured point, then
+ * "CAL:<id>,DONE,<table_points>", "CAL:<id>,FAIL" or "CAL:<id>,ABORT".
+ * A finished sweep also saves the table file.
+ */
+void send_calibration_events() {
+    FfSweep now[MAX_MOTORS];
+    int points[MAX_MOTORS];
+    char data_str[MAX_MOTORS * (32 + FF_MAX_POINTS * 32)];
+    int len = 0, save = 0;
+
+    pthread_mutex_lock(&state_lock);
+    for (int i = 0; i < num_motors; i++) {
+        now[i] = motors[i].sweep;
+        points[i] = motors[i].ff.count;
+    }
+    pthread_mutex_unlock(&state_lock);
+
+    for (int i = 0; i < num_motors; i++) {
+        FfSweep *last = &sweep_reported[i];
+        int id = motors[i].cfg.id;
+
+        if (now[i].run != last->run) {
+            len += snprintf(data_str + len, sizeof(data_str) - (size_t)len, "CAL:%d,START\n", id);
+            last->count = 0;
+        }
+        for (int p = last->count; p < now[i].count; p++) {
+            len += snprintf(data_str + len, sizeof(data_str) - (size_t)len, "CAL:%d,POINT,%.0f,%.0f\n",
+                            id, now[i].duty[p], now[i].rpm[p]);
+        }
+        if (now[i].state != last->state) {
+            if (now[i].state == FF_SWEEP_DONE) {
+                len += snprintf(data_str + len, sizeof(data_str) - (size_t)len, "CAL:%d,DONE,%d\n", id, points[i]);
+                save = 1;
+            }
+            if (now[i].state == FF_SWEEP_FAILED) len += snprintf(data_str + len, sizeof(data_str) - (size_t)len, "CAL:%d,FAIL\n", id);
+            if (now[i].state == FF_SWEEP_ABORTED) len += snprintf(data_str + len, sizeof(data_str) - (size_t)len, "CAL:%d,ABORT\n", id);
+        }
+        *last = now[i];
+    }
+    if (save) save_feedforward();
+    if (len == 0 || num_clients == 0) return;
+
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        if (clients[i].fd >= 0 && clients[i].ready) queue_message(&clients[i], data_str, (size_t)len, 0);
+    }
+}
+
+// --- TUNING REPORTS ---
+static uint32_t tuning_reported[MAX_MOTORS]; // tuning_gen last sent to the clients
+
+/*
+ * FUNCTION: send_gains_events
+ * ---------------------------
+ * Sends "GAINS:<id>,<tuning>\n" (pid_tuning_set() syntax) to every client for
+ * each motor whose tuning was changed or queried since the last report.
+ */
+void send_gains_events() {
+    char line[16 + PID_TEXT_MAX];
+
+    for (int i = 0; i < num_motors; i++) {
+        int len = 0;
+        pthread_mutex_lock(&state_lock);
+        if (motors[i].tuning_gen != tuning_reported[i]) {
+            tuning_reported[i] = motors[i].tuning_gen;
+            len = snprintf(line, sizeof(line), "GAINS:%d,", motors[i].cfg.id);
+            len += pid_tuning_format(&motors[i].tuning, line + len, sizeof(line) - (size_t)len - 1);
+            line[len++] = '\n';
+        }
+        pthread_mutex_unlock(&state_lock);
+        if (len == 0) continue;
+
+        for (int k = 0; k < MAX_CLIENTS; k++) {
+            if (clients[k].fd >= 0 && clients[k].ready) queue_message(&clients[k], line, (size_t)len, 0);
+        }
+    }
+}
+
+/*
+ * FUNCTION: lat_telemetry_sent
+ * ----------------------------
+ * -L: one telemetry message went out. Records the fan-out time and, for every
+ * motor with an edge newer than the last message, how old that edge now is.
+ */
+void lat_telemetry_sent(int64_t start_us) {
+    int64_t now_us = monotonic_us();
+    lat_record(&lat_hist[LAT_TELEM_SEND], now_us - start_us);
+    for (int i = 0; i < num_motors; i++) {
+        int64_t edge_us = atomic_load_explicit(&motors[i].lat_edge_us, memory_order_relaxed);
+        if (edge_us == 0 || edge_us == motors[i].lat_reported_edge_us) continue;
+        lat_record(&lat_hist[LAT_EDGE_TO_TELEM], now_us - edge_us);
+        motors[i].lat_reported_edge_us = edge_us;
+    }
+}
+
+/*
+ * FUNCTION: send_telemetry
+ * ------------------------
+ * Encodes one message once and fans the same buffer out to every text client
+ * whose policy says it is due (tp_due(); 'event' = pushed by telemetry_events()):
+ * "RPM:<value>\n" for the default motor (what the phone app reads), then
+ * "RPM@<id>:<value>\n" for each other motor, then
+ * "PROFILE:<id>,RUN,<segment>,<percent>\n" for each motor running a profile.
+ */
+void send_telemetry(int event) {
+    char data_str[16 + MAX_MOTORS * 56];
+    ProfileReport prof[MAX_MOTORS];
+    int rpm[MAX_MOTORS];
+    if (telem_tick_us == 0) return;
+    int64_t start_us = monotonic_us();
+
+    for (int i = 0; i < num_motors; i++) rpm[i] = motors[i].rpm_smooth;
+
+    int len = snprintf(data_str, sizeof(data_str), "RPM:%d\n", rpm[0]);
+    for (int i = 1; i < num_motors; i++) {
+        len += snprintf(data_str + len, sizeof(data_str) - (size_t)len, "RPM@%d:%d\n",
+                        motors[i].cfg.id, rpm[i]);
+    }
+    snapshot_profiles(prof);
+    for (int i = 0; i < num_motors; i++) {
+        if (prof[i].state != PROFILE_RUNNING) continue;
+        len += snprintf(data_str + len, sizeof(data_str) - (size_t)len, "PROFILE:%d,RUN,%d,%d\n",
+                        motors[i].cfg.id, prof[i].index, prof[i].progress / 10);
+    }
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        Client *c = &clients[i];
+        if (c->fd < 0 || !c->ready || c->binary) continue;
+
+        int change = 0;
+        for (int j = 0; j < num_motors; j++) {
+            int d = abs(rpm[j] - c->telem_rpm[j]);
+            if (d > change) change = d;
+        }
+        if (!tp_due(&c->telem, start_us - c->telem_sent_us, telem_tick_us / 2, change, event)) continue;
+
+        // Events are extra messages: the heartbeat keeps its schedule
+        if (!event) c->telem_sent_us = start_us;
+        memcpy(c->telem_rpm, rpm, sizeof(rpm));
+        queue_message(c, data_str, (size_t)len, 0);
+    }
+    if (lat_enabled) lat_telemetry_sent(start_us);
+}
+
+/*
+ * FUNCTION: send_frames
+ * ---------------------
+ * Drains the sample ring into binary frames (up to TELEM_MAX_SAMPLES each)
+ * and fans every frame out to the binary subscribers. A client whose backlog
+ * is full misses whole frames, which shows up as a gap in 'seq'.
+ */
+void send_frames() {
+    TelemetrySample batch[TELEM_MAX_SAMPLES];
+    uint8_t frame[TELEM_MAX_FRAME];
+    int count;
+    int64_t start_us = lat_enabled ? monotonic_us() : 0;
+
+    while ((count = telem_ring_pop_batch(&telem_ring, batch, TELEM_MAX_SAMPLES)) > 0) {
+        size_t len = telem_encode_frame(frame, frame_seq++, batch, count);
+        for (int i = 0; i < MAX_CLIENTS; i++) {
+            if (clients[i].fd >= 0 && clients[i].ready && clients[i].binary) queue_message(&clients[i], (const char *)frame, len, 1);
+        }
+        if (lat_enabled) {
+            lat_telemetry_sent(start_us);
+            start_us = monotonic_us();
+        }
+    }
+}
+
+/*
+ * FUNCTION: send_latency_report
+ * -----------------------------
+ * Answers 'L' (any client): one "LAT:<stage>,<count>,<p50>,<p99>,<max>\n" line
+ * per stage (microseconds), then "LAT:END\n", and clears the histograms so the
+ * next 'L' covers a fresh interval. "LAT:OFF\n" without -L.
+ */
+void send_latency_report(Client *c) {
+    char report[LAT_STAGES * (LAT_REPORT_MAX + 6) + 16];
+    int len = 0;
+
+    if (!lat_enabled) {
+        queue_message(c, "LAT:OFF\n", 8, 0);
+        return;
+    }
+    pthread_mutex_lock(&state_lock); // Control-thread stages are written under the lock
+    for (int s = 0; s < LAT_STAGES; s++) {
+        len += snprintf(report + len, sizeof(report) - (size_t)len, "LAT:");
+        len += lat_format(&lat_hist[s], lat_stage_name((LatStage)s), report + len, (int)sizeof(report) - len);
+        report[len++] = '\n';
+    }
+    memset(lat_hist, 0, sizeof(lat_hist));
+    pthread_mutex_unlock(&state_lock);
+
+    len += snprintf(report + len, sizeof(report) - (size_t)len, "LAT:END\n");
+    queue_message(c, report, (size_t)len, 0);
+}
+
+// --- LOOP AND I/O COUNTERS ---
+static PshmCounters stats_last;            // Snapshot of the last STATS_PERIOD_US tick (rates included)
+static int64_t stats_last_us = 0;
+static RpmFilter filter_last[MAX_MOTORS];  // Edge filter counters at the last stats tick
+
+static void hist_summary(const LatHist *h, uint32_t *p50, uint32_t *p99, uint32_t *max) {
+    *p50 = lat_percentile(h, 500);
+    *p99 = lat_percentile(h, 990);
+    *max = h->max;
+}
+
+/*
+ * FUNCTION: collect_counters
+ * --------------------------
+ * Fills 'pc' with the current totals and percentiles. The loop counters are
+ * copied under state_lock and summarized after it is released, so the control
+ * thread waits for a memcpy at most. The per-second rates are the ones
+ * computed at the last stats tick. 'filters' (if not NULL) receives a copy
+ * of every motor's edge filter from the same moment.
+ */
+void collect_counters(PshmCounters *pc, RpmFilter *filters) {
+    LoopStats ls;
+    RpmFilter now[MAX_MOTORS];
+    pthread_mutex_lock(&state_lock);
+    ls = loop_stats;
+    for (int i = 0; i < num_motors; i++) now[i] = motors[i].filter;
+    pthread_mutex_unlock(&state_lock);
+    if (filters != NULL) memcpy(filters, now, sizeof(RpmFilter) * (size_t)num_motors);
+
+    memset(pc, 0, sizeof(*pc));
+    pc->uptime_s = (uint32_t)((monotonic_us() - start_us) / 1000000);
+    pc->control_rate_hz = (uint32_t)control_rate_hz;
+    pc->loops = ls.loops;
+    pc->overruns = ls.overruns;
+    hist_summary(&ls.period, &pc->period_p50_us, &pc->period_p99_us, &pc->period_max_us);
+    hist_summary(&ls.late, &pc->late_p50_us, &pc->late_p99_us, &pc->late_max_us);
+    hist_summary(&ls.step, &pc->step_p50_ns, &pc->step_p99_ns, &pc->step_max_ns);
+    hist_summary(&ls.pid, &pc->pid_p50_ns, &pc->pid_p99_ns, &pc->pid_max_ns);
+    pc->hal_calls = ls.hal.count;
+    hist_summary(&ls.hal, &pc->hal_p50_ns, &pc->hal_p99_ns, &pc->hal_max_ns);
+    pc->commands = ls.commands;
+    for (int i = 0; i < num_motors; i++) pc->filter_rejected += rf_rejected(&now[i]);
+
+    pc->bytes_in = io_stats.bytes_in;
+    pc->bytes_out = io_stats.bytes_out;
+    pc->write_eagain = io_stats.write_eagain;
+    pc->messages_dropped = io_stats.messages_dropped;
+    for (int i = 0; i < num_motors; i++) pc->edges_dropped += edge_ring_dropped(&motors[i].edge_ring);
+    pc->samples_dropped = atomic_load_explicit(&telem_ring.dropped, memory_order_relaxed);
+    pc->log_dropped = log_dropped();
+    pc->idle = (uint32_t)ls.idle;
+    pc->idle_entries = ls.idle_entries;
+    pc->idle_s = (uint32_t)((ls.idle_us + (ls.idle ? monotonic_us() - ls.idle_enter_us : 0)) / 1000000);
+    hist_summary(&ls.wake, &pc->wake_p50_us, &pc->wake_p99_us, &pc->wake_max_us);
+
+    pc->commands_per_s = stats_last.commands_per_s;
+    pc->bytes_in_per_s = stats_last.bytes_in_per_s;
+    pc->bytes_out_per_s = stats_last.bytes_out_per_s;
+    pc->filter_rejected_per_s = stats_last.filter_rejected_per_s;
+}
+
+/*
+ * FUNCTION: send_filter_report
+ * ----------------------------
+ * Once per stats tick, tells every client how the edge filter did over the
+ * last 'secs' seconds. One line per motor that saw any edge:
+ * "FILTER:<id>,<rejects/s>,<accepted/s>,<short>,<long>,<relocks>\n",
+ * the last three as totals. Pulses that get past the HAL glitch filter show
+ * up as short rejects, so a rising rate means GLITCH_FILTER_US ("-S glitch=")
+ * is too low for the wiring; missed edges show up as long rejects.
+ */
+void send_filter_report(const RpmFilter *now, double secs) {
+    char data_str[MAX_MOTORS * 72];
+    int len = 0;
+
+    for (int i = 0; i < num_motors; i++) {
+        const RpmFilter *f = &now[i], *last = &filter_last[i];
+        uint32_t rejected = rf_rejected(f) - rf_rejected(last);
+        uint32_t accepted = f->accepted - last->accepted;
+        if (rejected == 0 && accepted == 0) continue;
+        len += snprintf(data_str + len, sizeof(data_str) - (size_t)len, "FILTER:%d,%u,%u,%u,%u,%u\n",
+                        motors[i].cfg.id, (uint32_t)(rejected / secs + 0.5), (uint32_t)(accepted / secs + 0.5),
+                        f->rejected_short, f->rejected_long, f->relocks);
+    }
+    if (len == 0 || num_clients == 0) return;
+
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        if (clients[i].fd >= 0 && clients[i].ready) queue_message(&clients[i], data_str, (size_t)len, 0);
+    }
+}
+
+/*
+ * FUNCTION: stats_tick
+ * --------------------
+ * Every STATS_PERIOD_US: updates the per-second rates from the change since
+ * the previous tick, publishes the snapshot to shared memory and sends the
+ * edge filter report.
+ */
+void stats_tick() {
+    PshmCounters pc;
+    RpmFilter filters[MAX_MOTORS];
+    collect_counters(&pc, filters);
+
+    int64_t now_us = monotonic_us();
+    if (stats_last_us != 0) {
+        double secs = (now_us - stats_last_us) / 1e6;
+        pc.commands_per_s = (uint32_t)((pc.commands - stats_last.commands) / secs + 0.5);
+        pc.bytes_in_per_s = (uint32_t)((pc.bytes_in - stats_last.bytes_in) / secs + 0.5);
+        pc.bytes_out_per_s = (uint32_t)((pc.bytes_out - stats_last.bytes_out) / secs + 0.5);
+        pc.filter_rejected_per_s = (uint32_t)((pc.filter_rejected - stats_last.filter_rejected) / secs + 0.5);
+        send_filter_report(filters, secs);
+    }
+    memcpy(filter_last, filters, sizeof(RpmFilter) * (size_t)num_motors);
+    stats_last = pc;
+    stats_last_us = now_us;
+    if (shm) pshm_write_counters(shm, &pc);
+}
+
+/*
+ * FUNCTION: idle_changed
+ * ----------------------
+ * IO_EVT_IDLE: the control thread went idle or woke up. Idle: one last
+ * snapshot (showing idle=1) and the stats timer stops, so nothing wakes the
+ * I/O thread but a connection or a signal. Active: the timer runs again; the
+ * first tick after the gap only resets the rate window.
+ */
+void idle_changed() {
+    pthread_mutex_lock(&state_lock);
+    int idle = loop_stats.idle;
+    pthread_mutex_unlock(&state_lock);
+
+    if (idle) {
+        stats_tick();
+        stats_last_us = 0;
+        arm_timer(stats_timer_fd, 0);
+    } else {
+        arm_timer(stats_timer_fd, STATS_PERIOD_US);
+    }
+}
+
+/*
+ * FUNCTION: send_stats
+ * --------------------
+ * Answers '?' (any client) with one line of the counters in parmco_shm.h:
+ * "STATS:up=<s>,hz=<n>,loops=<n>,overruns=<n>,period_us=<p50>/<p99>/<max>,
+ * late_us=..,step_ns=..,pid_ns=..,hal=<calls>,hal_ns=..,cmds=<n>,cmds_s=<n>,
+ * in_s=<bytes/s>,out_s=<bytes/s>,in=<bytes>,out=<bytes>,eagain=<n>,
+ * msg_drop=<n>,edge_drop=<n>,sample_drop=<n>,rejects=<n>,rejects_s=<n>,
+ * log_drop=<n>,idle=<0|1>,idle_n=<n>,idle_s=<s>,wake_us=<p50>/<p99>/<max>\n".
+ */
+void send_stats(Client *c) {
+    PshmCounters pc;
+    char line[768];
+    collect_counters(&pc, NULL);
+
+    int len = snprintf(line, sizeof(line),
+        "STATS:up=%u,hz=%u,loops=%u,overruns=%u,period_us=%u/%u/%u,late_us=%u/%u/%u,"
+        "step_ns=%u/%u/%u,pid_ns=%u/%u/%u,hal=%u,hal_ns=%u/%u/%u,cmds=%u,cmds_s=%u,"
+        "in_s=%u,out_s=%u,in=%llu,out=%llu,eagain=%u,msg_drop=%u,edge_drop=%u,"
+        "sample_drop=%u,rejects=%u,rejects_s=%u,log_drop=%u,idle=%u,idle_n=%u,idle_s=%u,wake_us=%u/%u/%u\n",
+        pc.uptime_s, pc.control_rate_hz, pc.loops, pc.overruns,
+        pc.period_p50_us, pc.period_p99_us, pc.period_max_us,
+        pc.late_p50_us, pc.late_p99_us, pc.late_max_us,
+        pc.step_p50_ns, pc.step_p99_ns, pc.step_max_ns,
+        pc.pid_p50_ns, pc.pid_p99_ns, pc.pid_max_ns,
+        pc.hal_calls, pc.hal_p50_ns, pc.hal_p99_ns, pc.hal_max_ns,
+        pc.commands, pc.commands_per_s, pc.bytes_in_per_s, pc.bytes_out_per_s,
+        (unsigned long long)pc.bytes_in, (unsigned long long)pc.bytes_out,
+        pc.write_eagain, pc.messages_dropped, pc.edges_dropped,
+        pc.samples_dropped, pc.filter_rejected, pc.filter_rejected_per_s, pc.log_dropped,
+        pc.idle, pc.idle_entries, pc.idle_s, pc.wake_p50_us, pc.wake_p99_us, pc.wake_max_us);
+    if (len >= (int)sizeof(line)) len = (int)sizeof(line) - 1;
+    queue_message(c, line, (size_t)len, 0);
+}
+
+/*
+ * FUNCTION: set_client_policy
+ * ---------------------------
+ * "T:<policy>": applies it (an invalid one changes nothing) and answers with
+ * the policy in effect, "TELEM:min=<ms>,max=<ms>,band=<rpm>,events=<0|1>\n".
+ */
+void set_client_policy(Client *c, const char *text) {
+    char msg[8 + TP_TEXT_MAX];
+
+    if (tp_set(&c->telem, text) != 0) {
+        char note[96]; // log_text keeps the first LOG_TEXT_MAX bytes
+        snprintf(note, sizeof(note), "Bad policy T:%.24s (%s)", text, c->addr);
+        log_text(LOG_LVL_WARN, "%s\n", note);
+    }
+    int len = snprintf(msg, sizeof(msg), "TELEM:");
+    len += tp_format(&c->telem, msg + len, sizeof(msg) - (size_t)len - 1);
+    msg[len++] = '\n';
+    queue_message(c, msg, (size_t)len, 0);
+    update_telemetry_timer();
+}
+
+/*
+ * FUNCTION: deliver_input
+ * -----------------------
+ * The shared protocol core: applies protocol bytes from any transport.
+ * The bytes are decoded a batch at a time (cmd_parse); the controller's motor
+ * commands are applied as one transaction per batch under a single state_lock.
+ * Any client may pick its telemetry format ('b' / 't') and policy ('T'), ask for the latency
+ * report ('L') or the counters ('?'), answered after the batch is applied;
+ * read-only clients can only claim a free token ('k'), which ends the batch so
+ * the bytes after it are already the new controller's.
+ * Returns -1 if the client was dropped meanwhile.
+ */
+int deliver_input(Client *c, char *data, int len) {
+    CmdBatch batch;
+    int done = 0;
+
+    while (done < len && c->fd >= 0) {
+        done += cmd_parse(&c->parser, data + done, len - done, &batch);
+
+        if (c == controller && (batch.count > 0 || batch.rejected > 0)) {
+            pthread_mutex_lock(&state_lock);
+            lat_input_us = lat_enabled ? c->read_us : 0;
+            apply_batch(&c->parser, &batch);
+            if (lat_noted_us != 0) {
+                lat_record(&lat_hist[LAT_APPLY], monotonic_us() - lat_noted_us);
+                lat_noted_us = 0;
+            }
+            lat_input_us = 0;
+            pthread_mutex_unlock(&state_lock);
+        }
+
+        for (int i = 0; i < batch.count && c->fd >= 0; i++) {
+            char cmd = batch.ops[i].cmd;
+            if (cmd == TELEM_CMD_BINARY || cmd == TELEM_CMD_TEXT) set_client_binary(c, cmd == TELEM_CMD_BINARY);
+            else if (cmd == LAT_CMD_REPORT) send_latency_report(c);
+            else if (cmd == CMD_STATS) send_stats(c);
+            else if (cmd == TP_CMD) set_client_policy(c, batch.text + batch.ops[i].text);
+            else if (cmd == CMD_TAKE_CONTROL && controller == NULL) grant_control(c);
+        }
+    }
+    return (c->fd >= 0) ? 0 : -1;
+}
+
+/*
+ * FUNCTION: read_client
+ * ---------------------
+ * Drains everything the socket has and hands it to the client's transport.
+ */
+void read_client(Client *c) {
+    char buf[1024];
+
+    while (c->fd >= 0) {
+        int bytes_read = read(c->fd, buf, sizeof(buf));
+        if (bytes_read > 0) {
+            io_stats.bytes_in += (uint64_t)bytes_read;
+            if (lat_enabled) {
+                c->read_us = monotonic_us();
+                lat_record(&lat_hist[LAT_READ], c->read_us - lat_wake_us);
+            }
+            if (c->transport->on_input(c, buf, bytes_read) < 0 && c->fd >= 0) drop_client(c, "Protocol Error");
+        } else if (bytes_read == 0) {
+            drop_client(c, "EOF");
+        } else {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) drop_client(c, "Read Error");
+            break;
+        }
+    }
+}
+
+#ifndef PARMCO_NO_BLUETOOTH
+// --- TRANSPORT: RFCOMM (Bluetooth, the phone app) ---
+/*
+ * FUNCTION: open_rfcomm_listener
+ * ------------------------------
+ * Creates, binds and listens on the RFCOMM server socket. Returns the socket or -1.
+ */
+int open_rfcomm_listener() {
+    struct sockaddr_rc loc_addr = { 0 };
 
     // Create RFCOMM socket
-    server_sock = socket(AF_BLUETOOTH, SOCK_STREAM, BTPROTO_RFCOMM);
+    int sock = socket(AF_BLUETOOTH, SOCK_STREAM, BTPROTO_RFCOMM);
+    if (sock < 0) { perror("RFCOMM socket"); return -1; }
 
     // Bind to local Bluetooth adapter
     loc_addr.rc_family = AF_BLUETOOTH;
     loc_addr.rc_bdaddr = *BDADDR_ANY;
     loc_addr.rc_channel = (uint8_t) RFCOMM_CHANNEL;
-    bind(server_sock, (struct sockaddr *)&loc_addr, sizeof(loc_addr));
+    if (bind(sock, (struct sockaddr *)&loc_addr, sizeof(loc_addr)) < 0 ||
+        listen(sock, LISTEN_BACKLOG) < 0) {
+        perror("RFCOMM bind/listen");
+        close(sock);
+        return -1;
+    }
 
-    // Listen for connections (Queue size 1)
-    listen(server_sock, 1);
+    // NON-BLOCKING: accept() only runs when epoll reports a pending connection
+    fcntl(sock, F_SETFL, O_NONBLOCK);
+    return sock;
+}
+
+int rfcomm_accept(int listen_fd, char *addr, size_t addr_cap) {
+    struct sockaddr_rc rem_addr = { 0 };
+    socklen_t opt = sizeof(rem_addr);
+    char bdaddr[18];
 
-    // Set socket to NON-BLOCKING (Allows loop to run while waiting for connection)
-    fcntl(server_sock, F_SETFL, O_NONBLOCK);
-    printf("Server initialized. Waiting on Channel %d...\n", RFCOMM_CHANNEL);
+    int sock = accept(listen_fd, (struct sockaddr *)&rem_addr, &opt);
+    if (sock < 0) return -1;
+    ba2str(&rem_addr.rc_bdaddr, bdaddr);
+    snprintf(addr, addr_cap, "%s", bdaddr);
+    return sock;
+}
+
+static const Transport transport_rfcomm = {
+    .name = "Bluetooth", .accept = rfcomm_accept, .on_input = deliver_input,
+};
+#endif
+
+// --- TRANSPORT: TCP (same byte protocol as RFCOMM, over Wi-Fi / Ethernet) ---
+
+/*
+ * FUNCTION: open_tcp_listener
+ * ---------------------------
+ * Listens on all IPv4 interfaces on 'port'. Returns the socket or -1.
+ */
+int open_tcp_listener(int port) {
+    struct sockaddr_in loc_addr = { 0 };
+    int one = 1;
+
+    int sock = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (sock < 0) { perror("TCP socket"); return -1; }
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    loc_addr.sin_family = AF_INET;
+    loc_addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    loc_addr.sin_port = htons((uint16_t)port);
+    if (bind(sock, (struct sockaddr *)&loc_addr, sizeof(loc_addr)) < 0 ||
+        listen(sock, LISTEN_BACKLOG) < 0) {
+        perror("TCP bind/listen");
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+int tcp_accept(int listen_fd, char *addr, size_t addr_cap) {
+    struct sockaddr_in rem_addr = { 0 };
+    socklen_t opt = sizeof(rem_addr);
+    char ip[INET_ADDRSTRLEN] = "?";
+    int one = 1;
+
+    int sock = accept(listen_fd, (struct sockaddr *)&rem_addr, &opt);
+    if (sock < 0) return -1;
+    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)); // Small telemetry writes go out at once
+    inet_ntop(AF_INET, &rem_addr.sin_addr, ip, sizeof(ip));
+    snprintf(addr, addr_cap, "%s:%d", ip, ntohs(rem_addr.sin_port));
+    return sock;
+}
+
+static const Transport transport_tcp = {
+    .name = "TCP", .accept = tcp_accept, .on_input = deliver_input,
+};
+
+// --- TRANSPORT: WebSocket (browser dashboards, see websocket.h) ---
+
+/*
+ * FUNCTION: ws_on_input
+ * ---------------------
+ * Completes the HTTP upgrade, then unwraps client frames. Text and binary
+ * message payloads are the same protocol bytes the phone sends.
+ */
+int ws_on_input(Client *c, char *data, int len) {
+    if ((size_t)len > sizeof(c->in_buf) - c->in_len) return -1; // Oversized request or frame
+    memcpy(c->in_buf + c->in_len, data, (size_t)len);
+    c->in_len += (size_t)len;
+
+    if (!c->ready) {
+        char resp[256];
+        size_t resp_len;
+        int used = ws_handshake(c->in_buf, c->in_len, resp, sizeof(resp), &resp_len);
+        if (used == 0) return 0;
+        if (used < 0) {
+            const char *bad = "HTTP/1.1 400 Bad Request\r\nConnection: close\r\n\r\n";
+            queue_raw(c, bad, strlen(bad));
+            return -1;
+        }
+        queue_raw(c, resp, resp_len);
+        c->in_len -= (size_t)used;
+        memmove(c->in_buf, c->in_buf + used, c->in_len);
+        client_ready(c);
+    }
+
+    size_t pos = 0;
+    while (c->fd >= 0 && pos < c->in_len) {
+        WsFrame f;
+        long used = ws_parse_frame((uint8_t *)c->in_buf + pos, c->in_len - pos, sizeof(c->in_buf), &f);
+        if (used == 0) break;
+        if (used < 0) return -1;
+        pos += (size_t)used;
+
+        if (f.opcode == WS_OP_TEXT || f.opcode == WS_OP_BINARY || f.opcode == WS_OP_CONTINUATION) {
+            if (deliver_input(c, (char *)f.payload, (int)f.payload_len) < 0) return 0;
+        } else if (f.opcode == WS_OP_PING) {
+            uint8_t header[WS_MAX_HEADER];
+            size_t hlen = ws_frame_header(header, WS_OP_PONG, f.payload_len);
+            queue_raw(c, header, hlen);
+            queue_raw(c, f.payload, f.payload_len);
+        } else if (f.opcode == WS_OP_CLOSE) {
+            uint8_t header[WS_MAX_HEADER];
+            queue_raw(c, header, ws_frame_header(header, WS_OP_CLOSE, 0));
+            return -1;
+        }
+    }
+    if (c->fd >= 0) {
+        c->in_len -= pos;
+        memmove(c->in_buf, c->in_buf + pos, c->in_len);
+    }
+    return 0;
+}
+
+size_t ws_message_header(uint8_t *out, int binary, size_t len) {
+    return ws_frame_header(out, binary ? WS_OP_BINARY : WS_OP_TEXT, len);
+}
+
+static const Transport transport_ws = {
+    .name = "WebSocket", .accept = tcp_accept, .on_input = ws_on_input,
+    .frame_header = ws_message_header, .handshake = 1,
+};
+
+/*
+ * FUNCTION: add_listener
+ * ----------------------
+ * Registers a listening socket (or does nothing if sock < 0).
+ */
+void add_listener(int sock, const Transport *t) {
+    if (sock < 0 || num_listeners >= MAX_LISTENERS) return;
+    listeners[num_listeners].fd = sock;
+    listeners[num_listeners].transport = t;
+    num_listeners++;
+}
+
+Listener *find_listener(int fd) {
+    for (int i = 0; i < num_listeners; i++) {
+        if (listeners[i].fd == fd) return &listeners[i];
+    }
+    return NULL;
+}
+
+/*
+ * FUNCTION: notify_systemd
+ * ------------------------
+ * Sends a state string ("READY=1", "STOPPING=1", "STATUS=...") to the service
+ * manager over $NOTIFY_SOCKET. This is the whole sd_notify protocol (one
+ * datagram), so libsystemd is not needed. Does nothing outside a Type=notify unit.
+ */
+void notify_systemd(const char *state) {
+    const char *path = getenv("NOTIFY_SOCKET");
+    if (path == NULL || (path[0] != '/' && path[0] != '@')) return;
+
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    size_t len = strlen(path);
+    if (len >= sizeof(addr.sun_path)) return;
+    memcpy(addr.sun_path, path, len);
+    if (addr.sun_path[0] == '@') addr.sun_path[0] = '\0'; // Abstract namespace
+
+    int fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return;
+    if (sendto(fd, state, strlen(state), MSG_NOSIGNAL, (struct sockaddr *)&addr,
+               (socklen_t)(offsetof(struct sockaddr_un, sun_path) + len)) < 0) {
+        perror("sd_notify");
+    }
+    close(fd);
+}
+
+/*
+ * FUNCTION: report_listening
+ * --------------------------
+ * Every listener is bound: logs the time to get here and tells systemd the
+ * server is ready.
+ */
+void report_listening(int tcp_port, int ws_port) {
+    struct timespec boot;
+    clock_gettime(CLOCK_BOOTTIME, &boot);
+    double start_ms = (monotonic_us() - start_us) / 1000.0;
+    double boot_s = boot.tv_sec + boot.tv_nsec / 1e9;
+
+    char state[160];
+#ifndef PARMCO_NO_BLUETOOTH
+    snprintf(state, sizeof(state), "READY=1\nSTATUS=Listening: RFCOMM %d, TCP %d, WebSocket %d (%.0f ms after start)",
+             RFCOMM_CHANNEL, tcp_port, ws_port, start_ms);
+#else
+    snprintf(state, sizeof(state), "READY=1\nSTATUS=Listening: TCP %d, WebSocket %d (%.0f ms after start)",
+             tcp_port, ws_port, start_ms);
+#endif
+    notify_systemd(state);
+    log_info("Listening %.0f ms after start, %.1f s after boot\n", start_ms, boot_s);
+}
+
+/*
+ * FUNCTION: run_event_loop
+ * ------------------------
+ * Single-threaded I/O: blocks in epoll_wait until a connection, client bytes
+ * or writable space, the telemetry or stats timer, a control-thread event or a signal arrives.
+ * Nothing polls, so an idle Pi sleeps here.
+ */
+void run_event_loop(int signal_fd) {
+    struct epoll_event events[MAX_EPOLL_EVENTS];
+    struct epoll_event ev = { .events = EPOLLIN };
+
+    for (int i = 0; i < MAX_CLIENTS; i++) clients[i].fd = -1;
+
+    for (int i = 0; i < num_listeners; i++) {
+        ev.data.fd = listeners[i].fd; epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listeners[i].fd, &ev);
+    }
+    ev.data.fd = telemetry_timer_fd; epoll_ctl(epoll_fd, EPOLL_CTL_ADD, telemetry_timer_fd, &ev);
+    ev.data.fd = frame_timer_fd;     epoll_ctl(epoll_fd, EPOLL_CTL_ADD, frame_timer_fd, &ev);
+    ev.data.fd = stats_timer_fd;     epoll_ctl(epoll_fd, EPOLL_CTL_ADD, stats_timer_fd, &ev);
+    arm_timer(stats_timer_fd, STATS_PERIOD_US);
+    ev.data.fd = io_event_fd;        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, io_event_fd, &ev);
+    ev.data.fd = signal_fd;          epoll_ctl(epoll_fd, EPOLL_CTL_ADD, signal_fd, &ev);
 
-    // --- OUTER LOOP: Connection Management ---
     while (keep_running) {
-        // Accept new connection
-        client_sock = accept(server_sock, (struct sockaddr *)&rem_addr, &opt);
-
-        if (client_sock < 0) {
-            // No connection yet, sleep briefly and retry
-            if (errno == EAGAIN || errno == EWOULDBLOCK) { usleep(100000); continue; }
-            if (keep_running) perror("Accept failed"); continue;
-        }
-
-        // Connection Established
-        ba2str(&rem_addr.rc_bdaddr, buf);
-        printf("Bluetooth Connected: %s\n", buf);
-        fcntl(client_sock, F_SETFL, O_NONBLOCK); // Set Client socket to non-blocking
-
-        current_mode = MANUAL_MODE;
-        stop_all_activity();
-
-        uint32_t last_loop_tick = get_current_tick(pi);
-        uint32_t last_send_tick = get_current_tick(pi);
-
-        // --- INNER LOOP: Active Control & Communication ---
-        while (keep_running) {
-            uint32_t current_tick = get_current_tick(pi);
-
-            // 1. CONTROL LOGIC (Executes once every LOOP_PERIOD / 1.0s)
-            if ((current_tick - last_loop_tick) >= LOOP_PERIOD) {
-                // Calculate RPM
-                double revs = (double)revolution_count / 3.0; // 3 blades on fan/sensor
-                double seconds = (double)LOOP_PERIOD / 1000000.0;
-                int raw_rpm = (int)((revs / seconds) * 60.0);
-
-                // Noise Filtering
-                if (raw_rpm > MAX_PHYSICS_RPM) {
-                     printf("NOISE DETECTED: %d RPM ignored\n", raw_rpm);
-                } else {
-                     rpm = raw_rpm;
-                     // Weighted average smoothing
-                     rpm_smooth = (int)((RPM_SMOOTHING * rpm_smooth) + ((1.0 - RPM_SMOOTHING) * raw_rpm));
-                }
+        int n = epoll_wait(epoll_fd, events, MAX_EPOLL_EVENTS, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            perror("epoll_wait");
+            break;
+        }
+        if (lat_enabled) lat_wake_us = monotonic_us();
 
-                revolution_count = 0; // Reset counter for next second
-                last_loop_tick = current_tick;
+        for (int i = 0; i < n; i++) {
+            int fd = events[i].data.fd;
 
-                // Run PID calculation
-                update_pid_controller();
-            }
+            if (fd == signal_fd) {
+                struct signalfd_siginfo si;
+                while (read(signal_fd, &si, sizeof(si)) == sizeof(si)) handle_signal((int)si.ssi_signo);
+            } else if (fd == telemetry_timer_fd) {
+                uint64_t expirations;
+                if (read(telemetry_timer_fd, &expirations, sizeof(expirations)) > 0) send_telemetry(0);
+            } else if (fd == frame_timer_fd) {
+                uint64_t expirations;
+                if (read(frame_timer_fd, &expirations, sizeof(expirations)) > 0) send_frames();
+            } else if (fd == stats_timer_fd) {
+                uint64_t expirations;
+                if (read(stats_timer_fd, &expirations, sizeof(expirations)) > 0) stats_tick();
+            } else if (fd == io_event_fd) {
+                uint64_t count;
+                if (read(io_event_fd, &count, sizeof(count)) < 0) continue;
+                uint32_t bits = atomic_exchange_explicit(&io_events, 0, memory_order_acquire);
+                if (bits & IO_EVT_PUSH_TELEMETRY) { send_telemetry(1); send_frames(); }
+                if (bits & IO_EVT_PROFILE) send_profile_events();
+                if (bits & IO_EVT_CALIBRATION) send_calibration_events();
+                if (bits & IO_EVT_GAINS) send_gains_events();
+                if (bits & IO_EVT_IDLE) idle_changed();
+            } else if (find_listener(fd) != NULL) {
+                accept_client(find_listener(fd));
+            } else {
+                Client *c = find_client(fd);
+                if (c == NULL) continue; // Dropped earlier in this batch
 
-            // 2. TELEMETRY (Executes every 500ms)
-            if ((current_tick - last_send_tick) >= 500000) {
-                snprintf(data_str, sizeof(data_str), "RPM:%d\n", rpm_smooth);
-                int write_ret = write(client_sock, data_str, strlen(data_str));
-
-                // Detect Disconnection
-                if (write_ret < 0) {
-                     if (errno != EAGAIN && errno != EWOULDBLOCK) {
-                        printf("Client disconnected (Write Error).\n");
-                        close(client_sock); break; // Break to outer loop
-                     }
-                }
-                last_send_tick = current_tick;
+                // Read first so bytes sent just before a hang-up are still applied
+                if (events[i].events & EPOLLIN) read_client(c);
+                if (c->fd >= 0 && (events[i].events & EPOLLOUT)) flush_client(c);
+                if (c->fd >= 0 && (events[i].events & (EPOLLHUP | EPOLLERR))) drop_client(c, "Hang-up");
             }
+        }
+    }
+}
+
+/*
+ * FUNCTION: open_state_shm
+ * ------------------------
+ * Creates (or takes over) the PSHM_NAME segment and initializes the header and
+ * the command ring. Returns NULL on failure; the server runs without it.
+ */
+ParmcoShm *open_state_shm() {
+    int fd = shm_open(PSHM_NAME, O_CREAT | O_RDWR | O_CLOEXEC, 0660);
+    if (fd < 0) { perror("shm_open"); return NULL; }
 
-            // 3. READ INPUT (Non-blocking)
-            int bytes_read = read(client_sock, buf, sizeof(buf) - 1);
-            if (bytes_read > 0) {
-                for (int i = 0; i < bytes_read; i++) {
-                    parse_input_byte(buf[i]); // Feed bytes to state machine
+    if (ftruncate(fd, sizeof(ParmcoShm)) != 0) {
+        perror("shm ftruncate");
+        close(fd);
+        return NULL;
+    }
+    ParmcoShm *seg = mmap(NULL, sizeof(ParmcoShm), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+    close(fd); // The mapping keeps the segment alive
+    if (seg == MAP_FAILED) { perror("shm mmap"); return NULL; }
+
+    memset(seg, 0, sizeof(*seg));
+    for (uint32_t i = 0; i < PSHM_CMD_SLOTS; i++) atomic_store(&seg->cmds[i].seq, i);
+    seg->version = PSHM_VERSION;
+    seg->server_pid = getpid();
+    atomic_thread_fence(memory_order_release);
+    seg->magic = PSHM_MAGIC; // Readers check this last
+    log_info("Shared-memory state: /dev/shm" PSHM_NAME " (%d bytes)\n", (int)sizeof(ParmcoShm));
+    return seg;
+}
+
+void close_state_shm(ParmcoShm *seg) {
+    if (seg == NULL) return;
+    seg->magic = 0; // Tell readers the server is gone
+    munmap(seg, sizeof(*seg));
+    shm_unlink(PSHM_NAME);
+}
+
+// ======================================================================================
+// MAIN FUNCTION
+// ======================================================================================
+int main(int argc, char **argv) {
+    // Parse command line options
+    int opt_c;
+    int log_level = LOG_LVL_INFO;
+    const char *flight_path = FR_DEFAULT_PATH;
+    int tcp_port = 0, ws_port = 0;
+    const char *motor_table = NULL;
+    start_us = monotonic_us();
+    rf_config_default(&rpm_filter_cfg, GLITCH_FILTER_US, MAX_PHYSICS_RPM);
+    while ((opt_c = getopt(argc, argv, "b:Lr:c:i:l:t:f:p:w:m:F:P:S:I:")) != -1) {
+        switch (opt_c) {
+            case 'b':
+                if (strcmp(optarg, "direct") == 0) hal = &hal_direct;
+#ifndef PARMCO_NO_PIGPIOD
+                else if (strcmp(optarg, "pigpiod") == 0) hal = &hal_pigpiod;
+#endif
+                else if (strncmp(optarg, "sim", 3) == 0 && (optarg[3] == '\0' || optarg[3] == ':')) {
+                    if (hal_sim_configure(optarg[3] ? optarg + 4 : "") != 0) return 1;
+                    hal = &hal_sim;
                 }
-            } else if (bytes_read == 0) {
-                printf("Client disconnected (EOF).\n");
-                close(client_sock); break;
-            }
+                else { fprintf(stderr, "Unknown backend '%s'\n", optarg); return 1; }
+                break;
+            case 'L': lat_enabled = 1; break;
+            case 'r': control_rate_hz = atoi(optarg); break;
+            case 'c': control_cpu = atoi(optarg); break;
+#ifndef PARMCO_NO_PIGPIOD
+            case 'i':
+                if (strcmp(optarg, "notify") == 0) hal_ingest_mode = HAL_INGEST_NOTIFY;
+                else if (strcmp(optarg, "callback") == 0) hal_ingest_mode = HAL_INGEST_CALLBACK;
+                else { fprintf(stderr, "Unknown ingest mode '%s'\n", optarg); return 1; }
+                break;
+#endif
+            case 'l': log_level = atoi(optarg); break;
+            case 't': frame_rate_hz = atoi(optarg); break;
+            case 'p': tcp_port = atoi(optarg); break;
+            case 'w': ws_port = atoi(optarg); break;
+            case 'f': flight_path = (strcmp(optarg, "none") == 0) ? NULL : optarg; break;
+            case 'm': motor_table = optarg; break;
+            case 'F': ff_path = (strcmp(optarg, "none") == 0) ? NULL : optarg; break;
+            case 'P':
+                if (strcmp(optarg, "fixed") == 0) pid_fixed = 1;
+                else if (strcmp(optarg, "float") == 0) pid_fixed = 0;
+                else { fprintf(stderr, "Unknown PID mode '%s'\n", optarg); return 1; }
+                break;
+            case 'S': if (rf_configure(&rpm_filter_cfg, optarg) != 0) return 1; break;
+            case 'I': idle_delay_s = atoi(optarg); break;
+            default:
+                fprintf(stderr, "Usage: %s [-b pigpiod|direct|sim[:opts]] [-L] [-r control_rate_hz] [-c control_cpu] [-i callback|notify] [-l level] [-t frame_hz] [-f file|none] [-p tcp_port] [-w ws_port] [-m motor_table] [-F file|none] [-P float|fixed] [-S filter_opts] [-I idle_s]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (control_rate_hz < MIN_CONTROL_RATE_HZ) control_rate_hz = MIN_CONTROL_RATE_HZ;
+    if (control_rate_hz > MAX_CONTROL_RATE_HZ) control_rate_hz = MAX_CONTROL_RATE_HZ;
+    if (frame_rate_hz < MIN_FRAME_RATE_HZ) frame_rate_hz = MIN_FRAME_RATE_HZ;
+    if (frame_rate_hz > MAX_FRAME_RATE_HZ) frame_rate_hz = MAX_FRAME_RATE_HZ;
+    if (idle_delay_s < 0) idle_delay_s = 0;
+    if (idle_delay_s > MAX_IDLE_DELAY_S) idle_delay_s = MAX_IDLE_DELAY_S;
+    if (hal->time_scale != NULL) tick_scale = hal->time_scale();
+
+    // --- MOTOR TABLE ---
+    // Checked against the chosen backend before any pin is touched
+    MotorConfig motor_cfg[MAX_MOTORS];
+    if (motor_table == NULL) {
+        motor_config_default(&motor_cfg[0]);
+        num_motors = 1;
+    } else {
+        num_motors = motor_config_load(motor_table, motor_cfg, MAX_MOTORS);
+        if (num_motors < 0) return 1;
+    }
+    if (motor_config_validate(motor_cfg, num_motors, hal->sw_pwm != NULL) != 0) return 1;
+    for (int i = 0; i < num_motors; i++) {
+        memset(&motors[i], 0, sizeof(motors[i]));
+        motors[i].cfg = motor_cfg[i];
+        motors[i].shadow_master = motors[i].shadow_dir_a = motors[i].shadow_dir_b = -1;
+        motors[i].shadow_duty = -1;
+        pid_tuning_default(&motors[i].tuning);
+    }
+
+    // Block the signals we handle so every thread inherits the mask;
+    // they are delivered to the event loop through a signalfd instead.
+    sigset_t sig_mask;
+    sigemptyset(&sig_mask);
+    sigaddset(&sig_mask, SIGINT);
+    sigaddset(&sig_mask, SIGTERM);
+    sigaddset(&sig_mask, SIGUSR1);
+    sigaddset(&sig_mask, SIGUSR2);
+    pthread_sigmask(SIG_BLOCK, &sig_mask, NULL);
+    int signal_fd = signalfd(-1, &sig_mask, SFD_NONBLOCK | SFD_CLOEXEC);
+
+    // A client that hangs up while telemetry is queued must cost only that
+    // client: write() then fails with EPIPE and the client is dropped
+    signal(SIGPIPE, SIG_IGN);
+
+    // Start the log writer before anything else prints
+    if (log_level < LOG_LVL_DEBUG) log_level = LOG_LVL_DEBUG;
+    if (log_level > LOG_LVL_ERROR) log_level = LOG_LVL_ERROR;
+    if (log_init(log_level) != 0) {
+        fprintf(stderr, "Failed to start log writer\n");
+        return 1;
+    }
+
+    // --- FEEDFORWARD TABLES ---
+    // A missing file or motor just means "not calibrated yet": the PID climbs as before
+    for (int i = 0; i < num_motors && ff_path != NULL; i++) {
+        int r = ff_load(ff_path, motors[i].cfg.id, &motors[i].ff);
+        if (r > 0) log_info("Feedforward table: %d points (motor %d)\n", motors[i].ff.count, motors[i].cfg.id);
+        if (r < 0) log_warn("Feedforward table for motor %d is invalid, ignored (recalibrate with 'C')\n", motors[i].cfg.id);
+    }
+
+    // Lock all pages in RAM so the control thread never takes a page fault
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) perror("Warning: mlockall failed");
+
+    // Priority-inheriting lock so the I/O thread cannot stall the RT thread indefinitely
+    pthread_mutexattr_t lock_attr;
+    pthread_mutexattr_init(&lock_attr);
+    pthread_mutexattr_setprotocol(&lock_attr, PTHREAD_PRIO_INHERIT);
+    pthread_mutex_init(&state_lock, &lock_attr);
 
-            usleep(10000); // Sleep 10ms to save CPU
+    // Event loop file descriptors
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    telemetry_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    frame_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    stats_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    io_event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (signal_fd < 0 || epoll_fd < 0 || telemetry_timer_fd < 0 || frame_timer_fd < 0 || stats_timer_fd < 0 || io_event_fd < 0) {
+        perror("Event loop setup");
+        return 1;
+    }
+
+    // Initialize the hardware backend (pigpio daemon or direct registers)
+    if (hal->init() != 0) {
+        fprintf(stderr, "Failed to initialize '%s' hardware backend.\n", hal->name);
+        return 1;
+    }
+    hal_ready = 1;
+    log_text(LOG_LVL_INFO, "Hardware backend: %s\n", hal->name);
+    if (lat_enabled) log_info("Latency tracing on: 'L' returns the stage histograms\n");
+
+    // --- GPIO SETUP ---
+    for (int i = 0; i < num_motors; i++) {
+        Motor *m = &motors[i];
+        hal->set_output(m->cfg.master_pin);
+        hal->set_output(m->cfg.dir_a_pin);
+        hal->set_output(m->cfg.dir_b_pin);
+        hal->set_output(m->cfg.pwm_pin);
+        sensors[i].gpio = m->cfg.sensor_pin;
+        sensors[i].ctx = m;
+        if (hal == &hal_sim) {
+            hal_sim_bind(m->cfg.sensor_pin, m->cfg.master_pin, m->cfg.dir_a_pin, m->cfg.dir_b_pin,
+                         m->cfg.pwm_pin, m->cfg.edges_per_rev);
+        }
+        if (m->cfg.pwm_mode == PWM_HARDWARE) {
+            log_info("Motor %d: PWM GPIO %d (hardware, %d Hz), sensor GPIO %d\n",
+                     m->cfg.id, m->cfg.pwm_pin, m->cfg.pwm_freq, m->cfg.sensor_pin);
+        } else {
+            log_info("Motor %d: PWM GPIO %d (software, %d Hz), sensor GPIO %d\n",
+                     m->cfg.id, m->cfg.pwm_pin, m->cfg.pwm_freq, m->cfg.sensor_pin);
         }
+    }
 
-        stop_all_activity(); // Safety stop on disconnect
+    stop_all_activity(); // Ensure every motor is off at start
+
+    // --- SENSOR CONFIGURATION ---
+    // Input, Internal Pull-Up and glitch filter; rpm_callback receives each edge with its Motor
+    if (hal->sensor_start(sensors, num_motors, rpm_filter_cfg.glitch_us, rpm_callback) != 0) {
+        fprintf(stderr, "Failed to start sensor edge ingestion\n");
+        hal->shutdown();
+        return 1;
+    }
+    log_info("Edge filter: glitch %d us, accel %.0f RPM/s + %.0f%%, median of %d, alpha %.2f, beta %.3f\n",
+             rpm_filter_cfg.glitch_us, rpm_filter_cfg.accel, rpm_filter_cfg.tol * 100,
+             rpm_filter_cfg.median, rpm_filter_cfg.alpha, rpm_filter_cfg.beta);
+
+    // --- FLIGHT RECORDER ---
+    // Opened after mlockall so the whole mapping is resident; not fatal if it fails
+    if (flight_path != NULL && fr_open(flight_path, FR_DEFAULT_RECORDS) != 0) {
+        log_warn("Flight recorder disabled\n");
+    }
+
+    // --- SHARED-MEMORY STATE ---
+    shm = open_state_shm();
+    if (shm == NULL) log_warn("Shared-memory state disabled\n");
+    else idle_bell = &shm->cmd_bell; // Commands from other processes wake an idle control thread
+
+    // --- CONTROL THREAD ---
+    pthread_t control_tid;
+    if (pthread_create(&control_tid, NULL, control_thread, NULL) != 0) {
+        fprintf(stderr, "Failed to start control thread\n");
+        hal->sensor_stop();
+        hal->shutdown();
+        return 1;
+    }
+
+    // --- BLUETOOTH SOCKET SETUP ---
+    // The phone protocol is served on every enabled transport
+#ifndef PARMCO_NO_BLUETOOTH
+    add_listener(open_rfcomm_listener(), &transport_rfcomm);
+#endif
+    if (tcp_port > 0) add_listener(open_tcp_listener(tcp_port), &transport_tcp);
+    if (ws_port > 0) add_listener(open_tcp_listener(ws_port), &transport_ws);
+
+    if (num_listeners == 0) {
+        keep_running = 0;
+    } else {
+#ifndef PARMCO_NO_BLUETOOTH
+        log_info("Server initialized. RFCOMM channel %d, TCP port %d, WebSocket port %d (0 = off)\n",
+                 RFCOMM_CHANNEL, tcp_port, ws_port);
+#else
+        log_info("Server initialized. TCP port %d, WebSocket port %d (0 = off)\n", tcp_port, ws_port);
+#endif
+        report_listening(tcp_port, ws_port);
+        run_event_loop(signal_fd);
     }
+    keep_running = 0; // Also stops the control thread if the loop exited on an error
+    wake_control();
+    notify_systemd("STOPPING=1");
 
     // --- CLEANUP ---
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        if (clients[i].fd >= 0) close(clients[i].fd);
+    }
+    pthread_join(control_tid, NULL);
+    hal->sensor_stop();
     stop_all_activity();
-    close(server_sock);
-    pigpio_stop(pi);
-    printf("System Shutdown Complete.\n");
+    for (int i = 0; i < num_listeners; i++) close(listeners[i].fd);
+    hal->shutdown();
+    fr_close();
+    close_state_shm(shm);
+    log_info("System Shutdown Complete.\n");
+    log_shutdown();
     return 0;
 }
@@ -0,0 +1,292 @@
+/*
+ * ======================================================================================
+ * PROJECT:       PARMCO (Phone APP RP4 Motor Control)
+ * FILE:          parmco_shm.h
+ * AUTHOR:        Group 1
+ *
+ * DESCRIPTION:
+ * Shared-memory state API for local processes (dashboards, exporters, the web UI
+ * bridge). parmco_server creates the POSIX shared-memory object PSHM_NAME
+ * (/dev/shm/parmco_state) holding:
+ *
+ * 1. STATE (seqlock): The control thread publishes a full PshmState (every
+ *    motor) every loop tick. 'seq' is odd while a write is in progress; a reader copies the state
+ *    and retries if 'seq' was odd or changed. Readers never block the writer,
+ *    and a snapshot costs no syscall.
+ *
+ * 2. COMMAND RING: Bounded multi-producer queue of text commands, in the same
+ *    format the phone sends ("s", "a", "r:1200\n", "@1s", ...). The control thread
+ *    drains it every tick and feeds the bytes through the normal command parser.
+ *    Every command starts on the default motor, so "@<id>" must be in the same command.
+ *    A full ring rejects the command (pshm_send_command returns -1).
+ *    Each command also rings 'cmd_bell', a futex word, so a server whose
+ *    control thread is idle (not ticking) wakes at once instead of polling.
+ *
+ * 3. COUNTERS (seqlock): Loop jitter, overruns, time spent in the PID and the
+ *    HAL, traffic and drop counters (PshmCounters). The I/O thread publishes
+ *    them once per second, the same snapshot the '?' protocol command returns.
+ *    While the server is idle they are not refreshed (the last one says idle=1).
+ *
+ * Readers only need this header:
+ *   int fd = shm_open(PSHM_NAME, O_RDWR, 0);
+ *   ParmcoShm *shm = mmap(NULL, sizeof(ParmcoShm), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+ *   PshmState st;  pshm_read_state(shm, &st);
+ *   PshmCounters pc;  pshm_read_counters(shm, &pc);
+ *   pshm_send_command(shm, "r:1500\n");
+ * (parmco_state.c is a complete example.) The object is created with mode 0660,
+ * so tools must run as root or in the owning group.
+ * ======================================================================================
+ */
+
+#ifndef PARMCO_SHM_H
+#define PARMCO_SHM_H
+
+#include <stdint.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#define PSHM_NAME "/parmco_state"
+#define PSHM_MAGIC 0x4853504Du          // "MPSH"
+#define PSHM_VERSION 8                  // 2: per-motor state (multi-motor server), 3: setpoint profile, 4: feedforward, 5: counters, 6: edge filter, 7: idle mode, 8: command doorbell
+#define PSHM_MAX_MOTORS 8               // Same as MAX_MOTORS in motor_config.h
+#define PSHM_CMD_SLOTS 64               // Must be a power of two
+#define PSHM_CMD_MAX 15                 // Bytes per command (plus terminator)
+
+typedef struct {
+    int32_t  id;                        // Motor ID (motor_config.h)
+    uint32_t edges;                     // Sensor edges counted since start
+    int32_t  rpm;                       // Instantaneous RPM
+    int32_t  rpm_smooth;                // Averaged RPM
+    int32_t  desired_rpm;               // PID target
+    int32_t  speed_percent;             // Applied PWM duty (0-100)
+    int32_t  current_mode;              // 0 = Manual, 1 = Auto, 2 = Calibrating
+    int32_t  motor_running;
+    int32_t  direction;                 // 0 = not set, 1 = clockwise, -1 = counter-clockwise
+    uint32_t duty;                      // PWM duty, 0 - 1,000,000
+    double   pid_duty;                  // PID output (duty %, fractional)
+    double   pid_error;                 // Last PID error (target - rpm_smooth)
+    double   pid_integral;              // I accumulator
+    double   pid_p_term;                // Contributions to the last PID output (PWM % per second)
+    double   pid_i_term;
+    double   pid_d_term;
+    int32_t  profile_state;             // 0 = none, 1 = running, 2 = done, 3 = aborted (setpoint_profile.h)
+    int32_t  profile_segment;           // Current segment
+    int32_t  profile_segments;          // Segments in the profile
+    int32_t  profile_progress;          // Whole profile done, 0.1 % (0 - 1000)
+    double   ff_duty;                   // Feedforward duty for the target (0 without a table)
+    int32_t  ff_points;                 // Points in the feedforward table (0 = not calibrated)
+    int32_t  calibration_state;         // 0 = none, 1 = running, 2 = done, 3 = failed, 4 = aborted (feedforward.h)
+    int32_t  calibration_points;        // Points measured by the last sweep
+    uint32_t filter_accepted;           // Edge filter totals (rpm_filter.h): intervals used,
+    uint32_t filter_short;              // rejected as spurious pulses,
+    uint32_t filter_long;               // rejected as missed edges,
+    uint32_t filter_relocks;            // and re-locks after a run of rejects
+} PshmMotor;
+
+typedef struct {
+    uint32_t tick;                      // Pi tick of the control step that published this
+    uint32_t clients;                   // Connected phone / network clients
+    uint32_t updates;                   // Snapshots published since start
+    uint32_t num_motors;                // Valid entries in motors[]
+    PshmMotor motors[PSHM_MAX_MOTORS];  // In motor table order; motors[0] is the default motor
+} PshmState;
+
+/*
+ * Percentiles are over the whole run (bucket lower bound, see latency.h); the
+ * per-second rates cover the last publication interval. Durations marked _ns
+ * are nanoseconds, the rest microseconds.
+ */
+typedef struct {
+    uint32_t uptime_s;                  // Seconds since the server started
+    uint32_t control_rate_hz;           // Configured control loop rate
+    uint32_t loops;                     // Control loop iterations
+    uint32_t overruns;                  // Iterations that finished after the next deadline (schedule re-based)
+    uint32_t period_p50_us;             // Wake-up to wake-up interval
+    uint32_t period_p99_us;
+    uint32_t period_max_us;
+    uint32_t late_p50_us;               // Wake-up behind the deadline (timer + scheduling latency)
+    uint32_t late_p99_us;
+    uint32_t late_max_us;
+    uint32_t step_p50_ns;               // One control step (every motor, lock held)
+    uint32_t step_p99_ns;
+    uint32_t step_max_ns;
+    uint32_t pid_p50_ns;                // One PID update
+    uint32_t pid_p99_ns;
+    uint32_t pid_max_ns;
+    uint32_t hal_calls;                 // Output writes through the HAL (pigpiod calls with -b pigpiod)
+    uint32_t hal_p50_ns;                // One HAL output write
+    uint32_t hal_p99_ns;
+    uint32_t hal_max_ns;
+    uint32_t commands;                  // Commands applied (clients and the command ring)
+    uint32_t commands_per_s;
+    uint32_t bytes_in_per_s;            // Client traffic, every transport
+    uint32_t bytes_out_per_s;
+    uint64_t bytes_in;
+    uint64_t bytes_out;
+    uint32_t write_eagain;              // Client writes that found the socket buffer full
+    uint32_t messages_dropped;          // Messages dropped for a client with a full backlog
+    uint32_t edges_dropped;             // Sensor edges lost to a full edge ring (all motors)
+    uint32_t samples_dropped;           // Binary telemetry samples lost to a full sample ring
+    uint32_t filter_rejected;           // Sensor intervals rejected by the edge filter (all motors)
+    uint32_t filter_rejected_per_s;
+    uint32_t log_dropped;               // Log records lost to a full log ring
+    uint32_t idle;                      // 1 = the control thread is idle (no clients, motors stopped)
+    uint32_t idle_entries;              // Times it went idle
+    uint32_t idle_s;                    // Total time spent idle
+    uint32_t wake_p50_us;               // Idle to active: wake-up request to sensors and SCHED_FIFO restored
+    uint32_t wake_p99_us;
+    uint32_t wake_max_us;
+} PshmCounters;
+
+typedef struct {
+    _Atomic uint32_t seq;               // Slot state: == pos free for producer, == pos+1 ready
+    char text[PSHM_CMD_MAX + 1];
+} PshmCmdSlot;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    int32_t  server_pid;
+    _Atomic uint32_t state_seq;         // Seqlock sequence (odd = write in progress)
+    PshmState state;
+    char pad[64];                       // Keep the command ring off the state's cache lines
+    _Atomic uint32_t cmd_head;          // Next slot to claim (producers)
+    uint32_t cmd_tail;                  // Next slot to read (server only)
+    _Atomic uint32_t cmd_rejected;      // Commands refused because the ring was full
+    _Atomic uint32_t cmd_bell;          // Futex word, bumped after every queued command (pshm_ring_bell)
+    PshmCmdSlot cmds[PSHM_CMD_SLOTS];
+    char pad2[64];                      // Keep the counters off the ring's cache lines
+    _Atomic uint32_t counters_seq;      // Seqlock sequence of 'counters'
+    PshmCounters counters;
+} ParmcoShm;
+
+/*
+ * FUNCTION: pshm_read_state
+ * -------------------------
+ * Takes a consistent snapshot. Retries while the writer is mid-update, which
+ * lasts well under a microsecond, so the loop practically never spins twice.
+ */
+static inline void pshm_read_state(const ParmcoShm *shm, PshmState *out) {
+    uint32_t before, after;
+    do {
+        before = atomic_load_explicit(&shm->state_seq, memory_order_acquire);
+        memcpy(out, (const void *)&shm->state, sizeof(*out));
+        atomic_thread_fence(memory_order_acquire);
+        after = atomic_load_explicit(&shm->state_seq, memory_order_relaxed);
+    } while ((before & 1) || before != after);
+}
+
+/*
+ * FUNCTION: pshm_write_state
+ * --------------------------
+ * Single writer (the server's control thread).
+ */
+static inline void pshm_write_state(ParmcoShm *shm, const PshmState *in) {
+    uint32_t seq = atomic_load_explicit(&shm->state_seq, memory_order_relaxed);
+    atomic_store_explicit(&shm->state_seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    memcpy(&shm->state, in, sizeof(*in));
+    atomic_store_explicit(&shm->state_seq, seq + 2, memory_order_release);
+}
+
+/*
+ * FUNCTION: pshm_read_counters
+ * ----------------------------
+ * Same seqlock protocol as pshm_read_state, for the counters block.
+ */
+static inline void pshm_read_counters(const ParmcoShm *shm, PshmCounters *out) {
+    uint32_t before, after;
+    do {
+        before = atomic_load_explicit(&shm->counters_seq, memory_order_acquire);
+        memcpy(out, (const void *)&shm->counters, sizeof(*out));
+        atomic_thread_fence(memory_order_acquire);
+        after = atomic_load_explicit(&shm->counters_seq, memory_order_relaxed);
+    } while ((before & 1) || before != after);
+}
+
+/*
+ * FUNCTION: pshm_write_counters
+ * -----------------------------
+ * Single writer (the server's I/O thread).
+ */
+static inline void pshm_write_counters(ParmcoShm *shm, const PshmCounters *in) {
+    uint32_t seq = atomic_load_explicit(&shm->counters_seq, memory_order_relaxed);
+    atomic_store_explicit(&shm->counters_seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    memcpy(&shm->counters, in, sizeof(*in));
+    atomic_store_explicit(&shm->counters_seq, seq + 2, memory_order_release);
+}
+
+/*
+ * FUNCTION: pshm_ring_bell / pshm_wait_bell
+ * -----------------------------------------
+ * A futex doorbell (also usable on a word outside the segment). ring bumps
+ * the word and wakes a waiter. wait sleeps while the word still holds
+ * 'seen', which the waiter reads BEFORE it checks for work, so a ring in
+ * between is never lost. The segment is MAP_SHARED, so the futex is shared
+ * (not FUTEX_PRIVATE) and works across processes.
+ */
+static inline void pshm_ring_bell(_Atomic uint32_t *bell) {
+    atomic_fetch_add(bell, 1);
+    syscall(SYS_futex, (uint32_t *)bell, FUTEX_WAKE, 1, NULL, NULL, 0);
+}
+
+static inline void pshm_wait_bell(_Atomic uint32_t *bell, uint32_t seen) {
+    syscall(SYS_futex, (uint32_t *)bell, FUTEX_WAIT, seen, NULL, NULL, 0);
+}
+
+/*
+ * FUNCTION: pshm_send_command
+ * ---------------------------
+ * Queues one command string (up to PSHM_CMD_MAX bytes). Any number of
+ * processes may call this at once. Returns 0 if queued, -1 if the ring is full.
+ */
+static inline int pshm_send_command(ParmcoShm *shm, const char *text) {
+    uint32_t pos = atomic_load_explicit(&shm->cmd_head, memory_order_relaxed);
+
+    while (1) {
+        PshmCmdSlot *slot = &shm->cmds[pos & (PSHM_CMD_SLOTS - 1)];
+        uint32_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        int32_t diff = (int32_t)(seq - pos);
+
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&shm->cmd_head, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                strncpy(slot->text, text, PSHM_CMD_MAX);
+                slot->text[PSHM_CMD_MAX] = '\0';
+                atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);
+                pshm_ring_bell(&shm->cmd_bell);
+                return 0;
+            }
+        } else if (diff < 0) {
+            atomic_fetch_add_explicit(&shm->cmd_rejected, 1, memory_order_relaxed);
+            return -1;
+        } else {
+            pos = atomic_load_explicit(&shm->cmd_head, memory_order_relaxed);
+        }
+    }
+}
+
+/*
+ * FUNCTION: pshm_next_command
+ * ---------------------------
+ * Consumer side (server only). Returns the oldest queued command, or NULL.
+ * The slot stays owned by the caller until pshm_release_command().
+ */
+static inline const char *pshm_next_command(ParmcoShm *shm) {
+    PshmCmdSlot *slot = &shm->cmds[shm->cmd_tail & (PSHM_CMD_SLOTS - 1)];
+    uint32_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+    if ((int32_t)(seq - (shm->cmd_tail + 1)) < 0) return NULL;
+    return slot->text;
+}
+
+static inline void pshm_release_command(ParmcoShm *shm) {
+    PshmCmdSlot *slot = &shm->cmds[shm->cmd_tail & (PSHM_CMD_SLOTS - 1)];
+    atomic_store_explicit(&slot->seq, shm->cmd_tail + PSHM_CMD_SLOTS, memory_order_release);
+    shm->cmd_tail++;
+}
+
+#endif // PARMCO_SHM_H
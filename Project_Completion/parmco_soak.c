@@ -0,0 +1,609 @@
+/*
+ * ======================================================================================
+ * PROJECT:       PARMCO (Phone APP RP4 Motor Control)
+ * FILE:          parmco_soak.c
+ * AUTHOR:        Group 1
+ *
+ * DESCRIPTION:
+ * Load generator and soak tester for parmco_server. Opens N connections over
+ * TCP or RFCOMM: the first one takes the control token and sends a weighted
+ * random command mix at a target rate, the others are telemetry subscribers
+ * (alternately binary and text). Every command is followed by a '?', and the
+ * STATS reply is its acknowledgement: the server answers it only after the
+ * batch the command came in has been applied, so this is the round trip
+ * through the whole command path. It records:
+ * - ack:          command written -> its STATS reply arrived
+ * - text_gap:     time between "RPM:" lines on a text subscriber (nominal 500 ms)
+ * - frame_gap:    time between binary frames on a binary subscriber (nominal 1 / -t)
+ * - connect:      connect() -> the CTRL: line that every new client gets
+ * plus lost binary frames (sequence gaps), CRC errors, ack timeouts,
+ * unexpected disconnects (each one is reconnected, so a soak survives a
+ * server restart) and the planned reconnects of -c.
+ * A one-line summary of the last interval is printed every -i seconds, and
+ * the totals with the server's own counters when the run ends (-d or Ctrl-C).
+ *
+ * LOAD SHAPES:
+ * - Command flood: -r 1000 -M 'f d + -'
+ * - Reconnect storm: -n 16 -c 200 (every subscriber reconnects about every 200 ms)
+ * - Slow readers: -s 4 (the last 4 subscribers read 256 bytes a second, so
+ *   their server backlog overflows; the others must not notice). Their own
+ *   gaps and lost frames are expected and left out of the figures.
+ * The mix is a space-separated list of protocol commands, each with an
+ * optional "*<weight>". "r" alone sends a random target (500 - 3000 RPM);
+ * "r:", "p:" and "g:" commands get their newline added, e.g.
+ * -M 'f*3 d*3 r*2 p:l1500,500;s0,500 g:'. The default mix spins the motor up
+ * and down in both modes; against real hardware, make sure it may run.
+ *
+ * COMPILE INSTRUCTIONS:
+ * gcc -o parmco_soak parmco_soak.c latency.c -lbluetooth -Wall
+ * Without BlueZ (TCP only): add -DPARMCO_NO_BLUETOOTH and drop -lbluetooth
+ *
+ * USAGE:
+ * parmco_soak [-H <host>] [-p <tcp_port>] [-B <bdaddr>] [-n <conns>] [-r <cmds_per_s>] [-M <mix>]
+ *             [-d <seconds>] [-i <seconds>] [-c <ms>] [-C] [-s <slow>]
+ *   -H  Server address (default 127.0.0.1)
+ *   -p  Server TCP port (parmco_server -p, default 5000)
+ *   -B  Connect over RFCOMM (channel 22) to this Bluetooth address instead of TCP
+ *   -n  Connections, the controller included (default 4, max 64)
+ *   -r  Controller commands per second (default 20, max 1000, 0 = subscribers only)
+ *   -M  Command mix (default "f*2 d*2 r*2 + - a m")
+ *   -d  Run time in seconds (default 60, 0 = until Ctrl-C)
+ *   -i  Summary interval in seconds (default 10)
+ *   -c  Subscribers reconnect after about this many ms (default 0 = stay connected)
+ *   -C  With -c, the controller reconnects too (exercises the token hand-over)
+ *   -s  Number of slow-reader subscribers (default 0)
+ *
+ * Exit status: 0, 1 if the run could not start, 2 if it saw unexpected
+ * disconnects, ack timeouts or CRC errors.
+ * ======================================================================================
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <poll.h>
+#include <netdb.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#ifndef PARMCO_NO_BLUETOOTH
+#include <bluetooth/bluetooth.h>
+#include <bluetooth/rfcomm.h>
+#endif
+#include "telemetry.h"
+#include "latency.h"
+
+
+#define RFCOMM_CHANNEL 22          // Must match parmco_server
+#define MAX_CONNS 64
+#define MAX_RATE 1000
+#define MAX_MIX 32
+#define MIX_TEXT_MAX 400           // One mix command ("p:" + a 384-byte profile + '\n')
+#define RX_BUF 16384
+#define STATS_LINE_MAX 512
+#define ACK_RING 2048              // Outstanding acks (MAX_RATE * ACK_TIMEOUT_MS fits)
+#define ACK_TIMEOUT_MS 2000        // A command with no STATS reply by then counts as a timeout
+#define TOKEN_RETRY_MS 500         // Controller without the token sends 'k' this often
+#define RECONNECT_DELAY_MS 200     // After a disconnect, planned or not
+#define CONNECT_RETRY_MS 1000      // After a failed connect()
+#define SLOW_READ_MS 1000          // Slow readers read once a second...
+#define SLOW_READ_BYTES 256        // ...this much,
+#define SLOW_RCVBUF 4096           // with a small socket buffer, so the server's backlog fills
+#define TICK_MS 100                // Longest poll() sleep
+#define TARGET_MIN 500             // "r" mix entry: random target range
+#define TARGET_MAX 3000
+
+typedef enum { ROLE_CONTROLLER, ROLE_BINARY, ROLE_TEXT } Role;
+
+typedef struct {
+    char text[MIX_TEXT_MAX];
+    int weight;
+    int random_target;             // "r": pick a target per command
+} MixEntry;
+
+typedef struct {
+    int index;
+    Role role;
+    int slow;
+    int sock;                      // -1 = disconnected
+    uint8_t rx[RX_BUF];
+    size_t rx_len;
+
+    int has_token;                 // Last CTRL: line was CTRL:1
+    int greeted;                   // A CTRL: line arrived since connect()
+    int64_t connect_ns;            // connect() started
+    int64_t reconnect_ns;          // While disconnected: when to connect again
+    int64_t drop_ns;               // -c: planned disconnect (0 = none)
+    int64_t next_cmd_ns;           // Controller: next command
+    int64_t next_token_ns;         // Controller without the token: next 'k'
+    int64_t next_read_ns;          // Slow reader: next read()
+    int64_t last_line_ns;          // Last "RPM:" line (0 = none since connect)
+    int64_t last_frame_ns;         // Last binary frame (0 = none since connect)
+    uint32_t next_seq;
+
+    int64_t ack_sent[ACK_RING];    // Send times of the commands still waiting for their STATS reply
+    unsigned ack_head, ack_tail;
+} Conn;
+
+// --- TALLIES (whole run, and the current summary interval) ---
+enum { H_ACK, H_TEXT_GAP, H_FRAME_GAP, H_CONNECT, H_COUNT };
+static const char *hist_names[H_COUNT] = { "ack", "text_gap", "frame_gap", "connect" };
+
+enum {
+    C_CMDS, C_ACKS, C_ACK_TIMEOUTS, C_LINES, C_FRAMES, C_FRAMES_LOST, C_CRC_ERRORS,
+    C_DISCONNECTS, C_RECONNECTS, C_CONNECT_FAILS, C_TOKEN_LOST, C_SEND_STALLS, C_COUNT
+};
+static const char *count_names[C_COUNT] = {
+    "commands", "acks", "ack_timeouts", "rpm_lines", "frames", "frames_lost", "crc_errors",
+    "disconnects", "reconnects", "connect_fails", "token_lost", "send_stalls"
+};
+
+typedef struct {
+    LatHist hist[H_COUNT];         // us
+    uint64_t count[C_COUNT];
+} Tally;
+
+static Tally total, window;
+
+static void record(int h, int64_t us) {
+    lat_record(&total.hist[h], us);
+    lat_record(&window.hist[h], us);
+}
+
+static void count(int c, uint64_t n) {
+    total.count[c] += n;
+    window.count[c] += n;
+}
+
+// --- OPTIONS AND RUN STATE ---
+static const char *host = "127.0.0.1", *port = "5000", *bdaddr = NULL;
+static int rate = 20, churn_ms = 0, churn_controller = 0, num_slow = 0;
+static int run_rate;                       // -r as given (rate drops to 0 for the final STATS)
+static MixEntry mix[MAX_MIX];
+static int mix_count = 0, mix_weight = 0;
+
+static Conn conns[MAX_CONNS];
+static int num_conns = 4;
+static int64_t start_ns;
+static char last_stats[STATS_LINE_MAX]; // Newest STATS reply (the server's counters)
+static int stats_seen = 0;
+static volatile sig_atomic_t stop_requested = 0;
+
+static int64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static double elapsed_s(int64_t now) { return (now - start_ns) / 1e9; }
+
+static void on_signal(int sig) { stop_requested = 1; }
+
+/*
+ * FUNCTION: parse_mix
+ * -------------------
+ * Fills mix[] from the -M list. Returns 0, or -1 (message printed).
+ */
+static int parse_mix(const char *spec) {
+    const char *s = spec;
+
+    mix_count = mix_weight = 0;
+    while (*s != '\0') {
+        size_t len = strcspn(s, " ");
+        if (len > 0) {
+            const char *star = memchr(s, '*', len);
+            size_t cmd_len = star ? (size_t)(star - s) : len;
+            MixEntry *e = &mix[mix_count];
+
+            if (mix_count == MAX_MIX) { fprintf(stderr, "mix: more than %d commands\n", MAX_MIX); return -1; }
+            if (cmd_len == 0 || cmd_len + 2 > sizeof(e->text)) { fprintf(stderr, "mix: bad command '%.*s'\n", (int)len, s); return -1; }
+            e->weight = star ? atoi(star + 1) : 1;
+            if (e->weight < 1) { fprintf(stderr, "mix: bad weight in '%.*s'\n", (int)len, s); return -1; }
+
+            memcpy(e->text, s, cmd_len);
+            e->text[cmd_len] = '\0';
+            e->random_target = (strcmp(e->text, "r") == 0);
+            if (cmd_len > 1 && e->text[1] == ':' && strchr("rpg", e->text[0]) != NULL) strcat(e->text, "\n");
+            mix_weight += e->weight;
+            mix_count++;
+        }
+        s += len;
+        if (*s == ' ') s++;
+    }
+    if (mix_count == 0) { fprintf(stderr, "mix: empty\n"); return -1; }
+    return 0;
+}
+
+// --- CONNECTIONS ---
+
+static int connect_tcp(void) {
+    struct addrinfo hints = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM }, *res;
+    int err = getaddrinfo(host, port, &hints, &res);
+    if (err != 0) { fprintf(stderr, "%s: %s\n", host, gai_strerror(err)); return -1; }
+
+    int sock = -1;
+    for (struct addrinfo *ai = res; ai != NULL && sock < 0; ai = ai->ai_next) {
+        sock = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (sock >= 0 && connect(sock, ai->ai_addr, ai->ai_addrlen) != 0) { close(sock); sock = -1; }
+    }
+    freeaddrinfo(res);
+    if (sock < 0) return -1;
+
+    int one = 1;
+    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)); // One command, one segment
+    return sock;
+}
+
+#ifndef PARMCO_NO_BLUETOOTH
+static int connect_rfcomm(void) {
+    struct sockaddr_rc addr = { 0 };
+    int sock = socket(AF_BLUETOOTH, SOCK_STREAM, BTPROTO_RFCOMM);
+    if (sock < 0) return -1;
+
+    addr.rc_family = AF_BLUETOOTH;
+    addr.rc_channel = (uint8_t)RFCOMM_CHANNEL;
+    str2ba(bdaddr, &addr.rc_bdaddr);
+    if (connect(sock, (struct sockaddr *)&addr, sizeof(addr)) != 0) { close(sock); return -1; }
+    return sock;
+}
+#endif
+
+static int send_text(Conn *c, const char *text, size_t len) {
+    ssize_t n = send(c->sock, text, len, MSG_DONTWAIT | MSG_NOSIGNAL);
+    if (n == (ssize_t)len) return 0;
+    if (n >= 0 || errno == EAGAIN || errno == EWOULDBLOCK) { count(C_SEND_STALLS, 1); return 0; }
+    return -1;
+}
+
+static void close_conn(Conn *c, int64_t now, int planned) {
+    close(c->sock);
+    c->sock = -1;
+    c->reconnect_ns = now + (int64_t)RECONNECT_DELAY_MS * 1000000;
+    if (planned) {
+        count(C_RECONNECTS, 1);
+    } else {
+        count(C_DISCONNECTS, 1);
+        fprintf(stderr, "[%7.1f s] connection %d lost\n", elapsed_s(now), c->index);
+    }
+}
+
+/*
+ * FUNCTION: open_conn
+ * -------------------
+ * (Re)connects 'c' and resets its per-connection state. A binary subscriber
+ * asks for frames at once; with -c the planned disconnect is 0.5 - 1.5 x
+ * churn_ms away, so the reconnects of many connections spread out.
+ */
+static void open_conn(Conn *c, int64_t now) {
+#ifndef PARMCO_NO_BLUETOOTH
+    c->sock = (bdaddr != NULL) ? connect_rfcomm() : connect_tcp();
+#else
+    c->sock = connect_tcp();
+#endif
+    if (c->sock < 0) {
+        count(C_CONNECT_FAILS, 1);
+        c->reconnect_ns = now + (int64_t)CONNECT_RETRY_MS * 1000000;
+        return;
+    }
+    if (c->slow) {
+        int size = SLOW_RCVBUF;
+        setsockopt(c->sock, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+    }
+
+    c->rx_len = 0;
+    c->has_token = c->greeted = 0;
+    c->connect_ns = now;
+    c->next_read_ns = now;
+    c->next_token_ns = now + (int64_t)TOKEN_RETRY_MS * 1000000;
+    c->last_line_ns = c->last_frame_ns = 0;
+    c->ack_head = c->ack_tail = 0;
+    c->drop_ns = 0;
+    if (churn_ms > 0 && (c->role != ROLE_CONTROLLER || churn_controller)) {
+        c->drop_ns = now + (int64_t)(churn_ms * (0.5 + (double)rand() / RAND_MAX)) * 1000000;
+    }
+    if (c->role == ROLE_BINARY && send_text(c, "b", 1) != 0) close_conn(c, now, 0);
+}
+
+// --- RECEIVE ---
+
+static void on_line(Conn *c, char *line, int64_t now) {
+    if (strncmp(line, "CTRL:", 5) == 0) {
+        int token = (line[5] == '1');
+        if (!c->greeted && !c->slow) record(H_CONNECT, (now - c->connect_ns) / 1000);
+        c->greeted = 1;
+        if (c->has_token && !token) count(C_TOKEN_LOST, 1);
+        if (c->role == ROLE_CONTROLLER && token && !c->has_token) {
+            // Taking the token leaves every motor stopped in Manual mode: start the default one again
+            c->next_cmd_ns = now;
+            if (rate > 0 && send_text(c, "s", 1) != 0) { close_conn(c, now, 0); return; }
+        }
+        c->has_token = token;
+    } else if (strncmp(line, "RPM:", 4) == 0) {
+        if (c->last_line_ns != 0 && !c->slow) record(H_TEXT_GAP, (now - c->last_line_ns) / 1000);
+        c->last_line_ns = now;
+        count(C_LINES, 1);
+    } else if (strncmp(line, "STATS:", 6) == 0 && c->role == ROLE_CONTROLLER) {
+        if (c->ack_tail != c->ack_head) {
+            record(H_ACK, (now - c->ack_sent[c->ack_tail % ACK_RING]) / 1000);
+            c->ack_tail++;
+            count(C_ACKS, 1);
+        }
+        snprintf(last_stats, sizeof(last_stats), "%s", line);
+        stats_seen = 1;
+    }
+}
+
+static void on_frame(Conn *c, const uint8_t *frame, int64_t now) {
+    uint32_t seq = telem_get32(frame + 4);
+
+    if (c->last_frame_ns != 0 && !c->slow) {
+        record(H_FRAME_GAP, (now - c->last_frame_ns) / 1000);
+        if (seq != c->next_seq && seq - c->next_seq < 0x80000000u) count(C_FRAMES_LOST, seq - c->next_seq);
+    }
+    c->next_seq = seq + 1;
+    c->last_frame_ns = now;
+    count(C_FRAMES, 1);
+}
+
+/*
+ * FUNCTION: parse_rx
+ * ------------------
+ * Splits the receive buffer into binary frames (CRC checked) and text lines,
+ * the same way the phone app does.
+ */
+static void parse_rx(Conn *c, int64_t now) {
+    size_t pos = 0;
+    while (pos < c->rx_len && c->sock >= 0) {
+        uint8_t *p = c->rx + pos;
+        size_t avail = c->rx_len - pos;
+
+        if (p[0] == TELEM_MAGIC0) {
+            if (avail < TELEM_HEADER_SIZE) break;
+            size_t len = TELEM_HEADER_SIZE + (size_t)p[3] * TELEM_SAMPLE_SIZE + TELEM_CRC_SIZE;
+            if (p[1] != TELEM_MAGIC1 || p[3] == 0 || p[3] > TELEM_MAX_SAMPLES) { pos++; continue; }
+            if (avail < len) break;
+            if (telem_crc16(p + 2, len - 2 - TELEM_CRC_SIZE) == telem_get16(p + len - TELEM_CRC_SIZE)) {
+                on_frame(c, p, now);
+                pos += len;
+            } else {
+                count(C_CRC_ERRORS, 1);
+                pos++; // Resynchronize
+            }
+            continue;
+        }
+
+        uint8_t *nl = memchr(p, '\n', avail);
+        if (nl == NULL) break;
+        *nl = '\0';
+        on_line(c, (char *)p, now);
+        pos += (size_t)(nl - p) + 1;
+    }
+    if (c->sock < 0) return;
+    memmove(c->rx, c->rx + pos, c->rx_len - pos);
+    c->rx_len -= pos;
+    if (c->rx_len == RX_BUF) c->rx_len = 0; // Garbage without a newline: drop it
+}
+
+static void read_conn(Conn *c, int64_t now) {
+    size_t room = RX_BUF - c->rx_len;
+    if (c->slow && room > SLOW_READ_BYTES) room = SLOW_READ_BYTES;
+
+    ssize_t n = recv(c->sock, c->rx + c->rx_len, room, MSG_DONTWAIT);
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) return;
+    if (n <= 0) { close_conn(c, now, 0); return; }
+    c->rx_len += (size_t)n;
+    parse_rx(c, now);
+}
+
+// --- SEND ---
+
+/*
+ * FUNCTION: send_commands
+ * -----------------------
+ * Controller: sends the commands that are due, each followed by '?' in the
+ * same write, and expires acks older than ACK_TIMEOUT_MS. Falls back to
+ * the current time if it is more than a second behind (the server stalled).
+ */
+static void send_commands(Conn *c, int64_t now) {
+    int64_t period_ns = 1000000000 / rate;
+
+    while (c->ack_tail != c->ack_head && now - c->ack_sent[c->ack_tail % ACK_RING] > (int64_t)ACK_TIMEOUT_MS * 1000000) {
+        c->ack_tail++;
+        count(C_ACK_TIMEOUTS, 1);
+    }
+    if (now - c->next_cmd_ns > 1000000000) c->next_cmd_ns = now;
+
+    while (now >= c->next_cmd_ns && c->sock >= 0) {
+        char text[MIX_TEXT_MAX + 16];
+        int pick = rand() % mix_weight, i = 0;
+        while (pick >= mix[i].weight) pick -= mix[i++].weight;
+
+        int len = mix[i].random_target ? snprintf(text, sizeof(text), "r:%d\n", TARGET_MIN + rand() % (TARGET_MAX - TARGET_MIN + 1))
+                                       : snprintf(text, sizeof(text), "%s", mix[i].text);
+        if (c->ack_head - c->ack_tail < ACK_RING) {
+            text[len++] = '?';
+            c->ack_sent[c->ack_head++ % ACK_RING] = now;
+        }
+        if (send_text(c, text, (size_t)len) != 0) { close_conn(c, now, 0); return; }
+        count(C_CMDS, 1);
+        c->next_cmd_ns += period_ns;
+    }
+}
+
+// --- EVENT LOOP ---
+
+/*
+ * FUNCTION: service
+ * -----------------
+ * Runs every connection's timers (connect, planned drop, token claim,
+ * commands, slow reads), then waits for input until the next one is due
+ * (at most TICK_MS) and reads it.
+ */
+static void service(void) {
+    struct pollfd fds[MAX_CONNS];
+    Conn *polled[MAX_CONNS];
+    int64_t now = now_ns(), next = now + (int64_t)TICK_MS * 1000000;
+    nfds_t nfds = 0;
+
+    for (int i = 0; i < num_conns; i++) {
+        Conn *c = &conns[i];
+        if (c->sock < 0) {
+            if (now >= c->reconnect_ns) open_conn(c, now);
+            if (c->sock < 0) { if (c->reconnect_ns < next) next = c->reconnect_ns; continue; }
+        }
+        if (c->drop_ns != 0 && now >= c->drop_ns) { close_conn(c, now, 1); continue; }
+        if (c->drop_ns != 0 && c->drop_ns < next) next = c->drop_ns;
+
+        if (c->role == ROLE_CONTROLLER) {
+            if (!c->has_token && c->greeted && now >= c->next_token_ns) {
+                if (send_text(c, "k", 1) != 0) { close_conn(c, now, 0); continue; }
+                c->next_token_ns = now + (int64_t)TOKEN_RETRY_MS * 1000000;
+            }
+            if (c->has_token && rate > 0) {
+                send_commands(c, now);
+                if (c->sock < 0) continue;
+                if (c->next_cmd_ns < next) next = c->next_cmd_ns;
+            }
+        }
+        if (c->slow) {
+            if (now >= c->next_read_ns) {
+                read_conn(c, now);
+                if (c->sock < 0) continue;
+                c->next_read_ns = now + (int64_t)SLOW_READ_MS * 1000000;
+            }
+            if (c->next_read_ns < next) next = c->next_read_ns;
+        }
+
+        fds[nfds].fd = c->sock;
+        fds[nfds].events = c->slow ? 0 : POLLIN; // Slow readers still see POLLHUP / POLLERR
+        polled[nfds++] = c;
+    }
+
+    int64_t wait_ns = next - now;
+    if (wait_ns < 0) wait_ns = 0;
+    if (poll(fds, nfds, (int)((wait_ns + 999999) / 1000000)) <= 0) return;
+
+    now = now_ns();
+    for (nfds_t i = 0; i < nfds; i++) {
+        if (fds[i].revents) read_conn(polled[i], now);
+    }
+}
+
+// --- REPORT ---
+
+static void print_row(const char *name, uint32_t count, uint32_t p50, uint32_t p99, uint32_t max) {
+    printf("  %-16s %8u %8u %8u %8u\n", name, count, p50, p99, max);
+}
+
+static void print_summary(int64_t now) {
+    const Tally *w = &window;
+    printf("[%7.1f s] cmds=%llu ack_us=%u/%u/%u timeouts=%llu frames=%llu lost=%llu frame_gap_us=%u/%u "
+           "text_gap_us=%u/%u disc=%llu reconn=%llu stalls=%llu\n",
+           elapsed_s(now), (unsigned long long)w->count[C_CMDS],
+           lat_percentile(&w->hist[H_ACK], 500), lat_percentile(&w->hist[H_ACK], 990), w->hist[H_ACK].max,
+           (unsigned long long)w->count[C_ACK_TIMEOUTS], (unsigned long long)w->count[C_FRAMES],
+           (unsigned long long)w->count[C_FRAMES_LOST],
+           lat_percentile(&w->hist[H_FRAME_GAP], 990), w->hist[H_FRAME_GAP].max,
+           lat_percentile(&w->hist[H_TEXT_GAP], 990), w->hist[H_TEXT_GAP].max,
+           (unsigned long long)w->count[C_DISCONNECTS], (unsigned long long)w->count[C_RECONNECTS],
+           (unsigned long long)w->count[C_SEND_STALLS]);
+    fflush(stdout);
+}
+
+static void print_report(int64_t now) {
+    printf("parmco_soak: %.1f s, %d connections (%d slow), %d cmds/s, %s%s (latencies in us)\n",
+           elapsed_s(now), num_conns, num_slow, run_rate, bdaddr ? "RFCOMM " : "TCP ", bdaddr ? bdaddr : port);
+    printf("  %-16s %8s %8s %8s %8s\n", "stage", "count", "p50", "p99", "max");
+    for (int h = 0; h < H_COUNT; h++) {
+        const LatHist *l = &total.hist[h];
+        print_row(hist_names[h], l->count, lat_percentile(l, 500), lat_percentile(l, 990), l->max);
+    }
+    for (int k = 0; k < C_COUNT; k++) printf("  %-16s %llu\n", count_names[k], (unsigned long long)total.count[k]);
+    if (last_stats[0] != '\0') printf("  server: %s\n", last_stats);
+}
+
+int main(int argc, char **argv) {
+    const char *mix_spec = "f*2 d*2 r*2 + - a m";
+    int duration_s = 60, report_s = 10, opt_c;
+
+    while ((opt_c = getopt(argc, argv, "H:p:B:n:r:M:d:i:c:Cs:")) != -1) {
+        switch (opt_c) {
+            case 'H': host = optarg; break;
+            case 'p': port = optarg; break;
+            case 'B': bdaddr = optarg; break;
+            case 'n': num_conns = atoi(optarg); break;
+            case 'r': rate = atoi(optarg); break;
+            case 'M': mix_spec = optarg; break;
+            case 'd': duration_s = atoi(optarg); break;
+            case 'i': report_s = atoi(optarg); break;
+            case 'c': churn_ms = atoi(optarg); break;
+            case 'C': churn_controller = 1; break;
+            case 's': num_slow = atoi(optarg); break;
+            default:
+                fprintf(stderr, "Usage: %s [-H host] [-p tcp_port] [-B bdaddr] [-n conns] [-r cmds_per_s] [-M mix] "
+                                "[-d seconds] [-i seconds] [-c ms] [-C] [-s slow]\n", argv[0]);
+                return 1;
+        }
+    }
+#ifdef PARMCO_NO_BLUETOOTH
+    if (bdaddr != NULL) { fprintf(stderr, "Built without Bluetooth (PARMCO_NO_BLUETOOTH): use TCP\n"); return 1; }
+#endif
+    if (num_conns < 1 || num_conns > MAX_CONNS) { fprintf(stderr, "-n: 1 - %d connections\n", MAX_CONNS); return 1; }
+    if (rate < 0 || rate > MAX_RATE) { fprintf(stderr, "-r: 0 - %d commands per second\n", MAX_RATE); return 1; }
+    if (num_slow < 0 || num_slow > num_conns - 1) { fprintf(stderr, "-s: at most %d slow readers\n", num_conns - 1); return 1; }
+    if (churn_ms < 0 || duration_s < 0) { fprintf(stderr, "-c and -d must not be negative\n"); return 1; }
+    if (report_s < 1) report_s = 1;
+    if (parse_mix(mix_spec) != 0) return 1;
+    run_rate = rate;
+
+    for (int i = 0; i < num_conns; i++) {
+        conns[i].index = i;
+        conns[i].role = (i == 0) ? ROLE_CONTROLLER : (i % 2 == 1) ? ROLE_BINARY : ROLE_TEXT;
+        conns[i].slow = (i >= num_conns - num_slow);
+        conns[i].sock = -1;
+    }
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+    start_ns = now_ns();
+    srand(1); // Same mix and reconnect pattern every run
+
+    // The controller goes first, so it is the one that finds the token free
+    open_conn(&conns[0], start_ns);
+    if (conns[0].sock < 0) { perror("connect"); return 1; }
+    int64_t deadline = now_ns() + 2000000000LL;
+    while (!conns[0].greeted && conns[0].sock >= 0 && now_ns() < deadline) service();
+    if (!conns[0].has_token) fprintf(stderr, "Another client holds the control token: retrying 'k' every %d ms\n", TOKEN_RETRY_MS);
+
+    int64_t end_ns = start_ns + (int64_t)duration_s * 1000000000;
+    int64_t next_report_ns = start_ns + (int64_t)report_s * 1000000000;
+    while (!stop_requested && (duration_s == 0 || now_ns() < end_ns)) {
+        service();
+        int64_t now = now_ns();
+        if (now >= next_report_ns) {
+            print_summary(now);
+            memset(&window, 0, sizeof(window));
+            next_report_ns += (int64_t)report_s * 1000000000;
+        }
+    }
+
+    // Stop the motor and fetch the server's counters
+    Conn *ctl = &conns[0];
+    if (ctl->sock >= 0 && ctl->has_token) {
+        stats_seen = 0;
+        rate = 0;
+        if (send_text(ctl, "x?", 2) == 0) {
+            deadline = now_ns() + 1000000000;
+            while (!stats_seen && ctl->sock >= 0 && now_ns() < deadline) service();
+        }
+    }
+    print_report(now_ns());
+
+    for (int i = 0; i < num_conns; i++) if (conns[i].sock >= 0) close(conns[i].sock);
+    int trouble = total.count[C_DISCONNECTS] + total.count[C_ACK_TIMEOUTS] + total.count[C_CRC_ERRORS] > 0;
+    return trouble ? 2 : 0;
+}
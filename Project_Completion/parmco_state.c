@@ -0,0 +1,197 @@
+/*
+ * ======================================================================================
+ * PROJECT:       PARMCO (Phone APP RP4 Motor Control)
+ * FILE:          parmco_state.c
+ * AUTHOR:        Group 1
+ *
+ * DESCRIPTION:
+ * Command-line client for the parmco_server shared-memory API (parmco_shm.h).
+ * Prints consistent snapshots of the live motor state (every motor) or of the
+ * loop / I/O counters, and queues commands, without going through Bluetooth or the journal.
+ *
+ * COMPILE INSTRUCTIONS:
+ * gcc -o parmco_state parmco_state.c -lrt -Wall
+ *
+ * USAGE:
+ * parmco_state [-w <hz>] [-j] [-s] [-m <motor_id>] [-c <command>]...
+ *   (none) Print one snapshot
+ *   -w     Keep printing snapshots at <hz> until Ctrl+C
+ *   -j     One JSON object per line instead of text
+ *   -s     Print the counters (loop jitter, overruns, PID / HAL time, traffic,
+ *          drops) instead of the motor state. The server updates them once per second.
+ *   -m     Send the following -c commands to this motor (adds "@<id>"), and
+ *          only print this motor. Default: the server's default motor, print all.
+ *   -c     Queue a command, same syntax as the phone ("s", "a", "r:1500\n" ...).
+ *          A trailing newline is added to "r:<n>" if missing. May be repeated.
+ *
+ * EXAMPLE:
+ * parmco_state -m 2 -c a -c r:1500 -w 10 -j
+ * ======================================================================================
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/mman.h>
+#include "parmco_shm.h"
+
+#define MAX_COMMANDS 16
+
+static const char *profile_state_name(int32_t state) {
+    static const char *names[] = { "none", "running", "done", "aborted" };
+    return (state >= 0 && state < 4) ? names[state] : "?";
+}
+
+static const char *mode_name(int32_t mode) {
+    static const char *names[] = { "manual", "auto", "calibrating" };
+    return (mode >= 0 && mode < 3) ? names[mode] : "?";
+}
+
+static void print_text(const PshmState *st, int motor_id) {
+    for (uint32_t i = 0; i < st->num_motors && i < PSHM_MAX_MOTORS; i++) {
+        const PshmMotor *m = &st->motors[i];
+        if (motor_id >= 0 && m->id != motor_id) continue;
+        printf("motor=%d rpm=%d smooth=%d target=%d speed=%d%% mode=%s running=%d dir=%d "
+               "pid[duty=%.2f err=%.1f int=%.3f p=%.3f i=%.3f d=%.3f] profile[%s seg=%d/%d %.1f%%] ff[duty=%.2f points=%d] "
+               "filter[ok=%u short=%u long=%u relock=%u] clients=%u\n",
+               m->id, m->rpm, m->rpm_smooth, m->desired_rpm, m->speed_percent,
+               mode_name(m->current_mode), m->motor_running, m->direction,
+               m->pid_duty, m->pid_error, m->pid_integral, m->pid_p_term, m->pid_i_term, m->pid_d_term,
+               profile_state_name(m->profile_state), m->profile_segment, m->profile_segments,
+               m->profile_progress / 10.0, m->ff_duty, m->ff_points,
+               m->filter_accepted, m->filter_short, m->filter_long, m->filter_relocks, st->clients);
+    }
+}
+
+static void print_json(const PshmState *st, int motor_id) {
+    printf("{\"tick\":%u,\"clients\":%u,\"updates\":%u,\"motors\":[", st->tick, st->clients, st->updates);
+    int first = 1;
+    for (uint32_t i = 0; i < st->num_motors && i < PSHM_MAX_MOTORS; i++) {
+        const PshmMotor *m = &st->motors[i];
+        if (motor_id >= 0 && m->id != motor_id) continue;
+        printf("%s{\"id\":%d,\"edges\":%u,\"rpm\":%d,\"rpm_smooth\":%d,\"desired_rpm\":%d,"
+               "\"speed_percent\":%d,\"mode\":\"%s\",\"motor_running\":%d,\"direction\":%d,\"duty\":%u,"
+               "\"pid\":{\"duty\":%.3f,\"error\":%.2f,\"integral\":%.4f,\"p\":%.4f,\"i\":%.4f,\"d\":%.4f},"
+               "\"profile\":{\"state\":\"%s\",\"segment\":%d,\"segments\":%d,\"progress\":%.1f},"
+               "\"feedforward\":{\"duty\":%.3f,\"points\":%d,\"calibration\":%d,\"measured\":%d},"
+               "\"filter\":{\"accepted\":%u,\"short\":%u,\"long\":%u,\"relocks\":%u}}",
+               first ? "" : ",", m->id, m->edges, m->rpm, m->rpm_smooth, m->desired_rpm,
+               m->speed_percent, mode_name(m->current_mode), m->motor_running, m->direction, m->duty,
+               m->pid_duty, m->pid_error, m->pid_integral, m->pid_p_term, m->pid_i_term, m->pid_d_term,
+               profile_state_name(m->profile_state), m->profile_segment, m->profile_segments,
+               m->profile_progress / 10.0, m->ff_duty, m->ff_points, m->calibration_state, m->calibration_points,
+               m->filter_accepted, m->filter_short, m->filter_long, m->filter_relocks);
+        first = 0;
+    }
+    printf("]}\n");
+}
+
+static void print_counters_text(const PshmCounters *c) {
+    printf("up=%us rate=%uHz loops=%u overruns=%u period_us[p50=%u p99=%u max=%u] late_us[p50=%u p99=%u max=%u] "
+           "step_ns[p50=%u p99=%u max=%u] pid_ns[p50=%u p99=%u max=%u] hal[calls=%u p50=%uns p99=%uns max=%uns] "
+           "commands=%u (%u/s) in=%llu (%u B/s) out=%llu (%u B/s) eagain=%u "
+           "dropped[messages=%u edges=%u samples=%u log=%u] filter_rejected=%u (%u/s) "
+           "idle[now=%u entries=%u total=%us wake_us p50=%u p99=%u max=%u]\n",
+           c->uptime_s, c->control_rate_hz, c->loops, c->overruns,
+           c->period_p50_us, c->period_p99_us, c->period_max_us, c->late_p50_us, c->late_p99_us, c->late_max_us,
+           c->step_p50_ns, c->step_p99_ns, c->step_max_ns, c->pid_p50_ns, c->pid_p99_ns, c->pid_max_ns,
+           c->hal_calls, c->hal_p50_ns, c->hal_p99_ns, c->hal_max_ns,
+           c->commands, c->commands_per_s, (unsigned long long)c->bytes_in, c->bytes_in_per_s,
+           (unsigned long long)c->bytes_out, c->bytes_out_per_s, c->write_eagain,
+           c->messages_dropped, c->edges_dropped, c->samples_dropped, c->log_dropped, c->filter_rejected, c->filter_rejected_per_s,
+           c->idle, c->idle_entries, c->idle_s, c->wake_p50_us, c->wake_p99_us, c->wake_max_us);
+}
+
+static void print_counters_json(const PshmCounters *c) {
+    printf("{\"uptime_s\":%u,\"control_rate_hz\":%u,\"loops\":%u,\"overruns\":%u,"
+           "\"period_us\":{\"p50\":%u,\"p99\":%u,\"max\":%u},\"late_us\":{\"p50\":%u,\"p99\":%u,\"max\":%u},"
+           "\"step_ns\":{\"p50\":%u,\"p99\":%u,\"max\":%u},\"pid_ns\":{\"p50\":%u,\"p99\":%u,\"max\":%u},"
+           "\"hal\":{\"calls\":%u,\"p50_ns\":%u,\"p99_ns\":%u,\"max_ns\":%u},"
+           "\"commands\":%u,\"commands_per_s\":%u,\"bytes_in\":%llu,\"bytes_in_per_s\":%u,"
+           "\"bytes_out\":%llu,\"bytes_out_per_s\":%u,\"write_eagain\":%u,"
+           "\"dropped\":{\"messages\":%u,\"edges\":%u,\"samples\":%u,\"log\":%u},"
+           "\"filter_rejected\":%u,\"filter_rejected_per_s\":%u,"
+           "\"idle\":{\"now\":%u,\"entries\":%u,\"total_s\":%u,\"wake_us\":{\"p50\":%u,\"p99\":%u,\"max\":%u}}}\n",
+           c->uptime_s, c->control_rate_hz, c->loops, c->overruns,
+           c->period_p50_us, c->period_p99_us, c->period_max_us, c->late_p50_us, c->late_p99_us, c->late_max_us,
+           c->step_p50_ns, c->step_p99_ns, c->step_max_ns, c->pid_p50_ns, c->pid_p99_ns, c->pid_max_ns,
+           c->hal_calls, c->hal_p50_ns, c->hal_p99_ns, c->hal_max_ns,
+           c->commands, c->commands_per_s, (unsigned long long)c->bytes_in, c->bytes_in_per_s,
+           (unsigned long long)c->bytes_out, c->bytes_out_per_s, c->write_eagain,
+           c->messages_dropped, c->edges_dropped, c->samples_dropped, c->log_dropped, c->filter_rejected, c->filter_rejected_per_s,
+           c->idle, c->idle_entries, c->idle_s, c->wake_p50_us, c->wake_p99_us, c->wake_max_us);
+}
+
+int main(int argc, char **argv) {
+    const char *commands[MAX_COMMANDS];
+    int num_commands = 0, json = 0, counters = 0, motor_id = -1;
+    double watch_hz = 0;
+    int opt_c;
+
+    while ((opt_c = getopt(argc, argv, "w:jsm:c:")) != -1) {
+        switch (opt_c) {
+            case 'w': watch_hz = atof(optarg); break;
+            case 'j': json = 1; break;
+            case 's': counters = 1; break;
+            case 'm': motor_id = atoi(optarg); break;
+            case 'c':
+                if (num_commands < MAX_COMMANDS) commands[num_commands++] = optarg;
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-w hz] [-j] [-s] [-m motor_id] [-c command]...\n", argv[0]);
+                return 1;
+        }
+    }
+
+    int fd = shm_open(PSHM_NAME, O_RDWR, 0);
+    if (fd < 0) { perror("shm_open " PSHM_NAME " (is parmco_server running?)"); return 1; }
+    ParmcoShm *shm = mmap(NULL, sizeof(ParmcoShm), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (shm == MAP_FAILED) { perror("mmap"); return 1; }
+    if (shm->magic != PSHM_MAGIC || shm->version != PSHM_VERSION) {
+        fprintf(stderr, "Shared-memory segment is not ready (or a different version)\n");
+        return 1;
+    }
+
+    // --- COMMANDS ---
+    for (int i = 0; i < num_commands; i++) {
+        char text[PSHM_CMD_MAX + 1];
+        int prefix = (motor_id >= 0) ? snprintf(text, sizeof(text), "@%d", motor_id) : 0;
+        snprintf(text + prefix, sizeof(text) - (size_t)prefix, "%s", commands[i]);
+        size_t len = strlen(text);
+        // The parser ends a number at the next non-digit, so terminate "r:<n>" for the user
+        if (text[prefix] == 'r' && len < PSHM_CMD_MAX && text[len - 1] != '\n') strcat(text, "\n");
+        if (pshm_send_command(shm, text) != 0) {
+            fprintf(stderr, "Command ring full, '%s' not sent\n", commands[i]);
+            return 1;
+        }
+    }
+
+    // --- SNAPSHOTS ---
+    struct timespec period = { 0 };
+    if (watch_hz > 0) {
+        long ns = (long)(1e9 / watch_hz);
+        period.tv_sec = ns / 1000000000L;
+        period.tv_nsec = ns % 1000000000L;
+    }
+    if (num_commands > 0 && watch_hz <= 0) return 0; // Commands only
+
+    do {
+        if (shm->magic != PSHM_MAGIC) { fprintf(stderr, "parmco_server exited\n"); return 1; }
+        if (counters) {
+            PshmCounters pc;
+            pshm_read_counters(shm, &pc);
+            if (json) print_counters_json(&pc); else print_counters_text(&pc);
+        } else {
+            PshmState st;
+            pshm_read_state(shm, &st);
+            if (json) print_json(&st, motor_id); else print_text(&st, motor_id);
+        }
+        fflush(stdout);
+        if (watch_hz > 0) nanosleep(&period, NULL);
+    } while (watch_hz > 0);
+    return 0;
+}
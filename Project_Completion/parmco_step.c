@@ -0,0 +1,467 @@
+/*
+ * ======================================================================================
+ * PROJECT:       PARMCO (Phone APP RP4 Motor Control)
+ * FILE:          parmco_step.c
+ * AUTHOR:        Group 1
+ *
+ * DESCRIPTION:
+ * Offline step-response analyzer. Reads a recorded session, cuts it into
+ * steps wherever the target jumps, and prints the response to every step as
+ * JSON, with a per-motor summary at the end, so two gain sets (or two
+ * firmware builds) can be compared by numbers instead of by eye.
+ *
+ * INPUT (mapped read-only, one sequential pass, no per-sample allocation):
+ *   - The flight recorder file (flight_recorder.h), checked record by record
+ *     like parmco_frdump, so it is safe to run while the server is writing.
+ *   - A CSV file with a header row: the phone's rpm_log_*.txt
+ *     ("time(ms),RPM,target") or parmco_frdump output (tick, motor,
+ *     rpm_smooth, target, mode, running). Columns are found by name; rows
+ *     with an unknown target (-1, text telemetry) are skipped. Without mode
+ *     and running columns every row counts as Auto, so a stop ('x') shows as
+ *     a step to 0.
+ *
+ * STEPS:
+ * A step starts when the target moves by at least -d RPM while the motor is
+ * running in Auto mode, or when Auto starts that far from the target. It
+ * ends at the next target change (a ramp of small changes is no step), when
+ * the motor leaves Auto or stops, at a gap of over MAX_GAP_US, at a new
+ * server session, or at the end of the file. For every step:
+ *   rise_s         10 % -> 90 % of the way from the starting RPM to the target
+ *   settle_s       From the step until the RPM stays within the band (-b
+ *                  percent of the step, at least BAND_MIN_RPM) for good; null
+ *                  if it was not inside for at least -H ms at the end
+ *   overshoot_pct  Largest excursion past the target, percent of the step
+ *   sse_rpm        Mean target - RPM once settled (steady-state error)
+ *   noise_rpm      Standard deviation of the RPM once settled (noise floor)
+ * 'time_s' is Unix time for the flight recorder and seconds from the first
+ * row for a CSV file.
+ *
+ * COMPILE INSTRUCTIONS:
+ * gcc -O2 -o parmco_step parmco_step.c -lm -Wall
+ *
+ * USAGE:
+ * parmco_step [-f <file>] [-m <motor_id>] [-S] [-d <rpm>] [-b <pct>] [-H <ms>]
+ *   -f  Flight recorder or CSV file (default FR_DEFAULT_PATH)
+ *   -m  Only this motor
+ *   -S  Only the most recent server session (flight recorder)
+ *   -d  Smallest target change that counts as a step (default 50 RPM)
+ *   -b  Settling band, percent of the step (default 5)
+ *   -H  Time the RPM must stay in the band to count as settled (default 500 ms)
+ *
+ * EXAMPLE:
+ * parmco_step -S -m 0 > gains_b.json
+ * ======================================================================================
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <math.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "flight_recorder.h"
+
+#define MAX_MOTOR_IDS 256          // FrRecord.motor is a uint8_t
+#define MAX_GAP_US 1000000         // Longer without a sample ends the step
+#define BAND_MIN_RPM 10            // Settling band floor (the RPM estimate is not finer than this)
+#define MODE_AUTO 1                // ControlMode AUTO_MODE in parmco_server.c
+#define CSV_MAX_COLUMNS 32
+
+// --- OPTIONS ---
+static int motor_filter = -1;
+static int min_step = 50;
+static double band_pct = 5;
+static int64_t hold_us = 500000;
+
+// One sample, whatever the source
+typedef struct {
+    int64_t t_us;
+    int motor;
+    int rpm;
+    int target;
+    int active;                    // Running in Auto mode
+    int boundary;                  // First sample of a server session
+} Sample;
+
+/*
+ * STEP STATE:
+ * Per motor, updated sample by sample. The settled tail (samples since the
+ * RPM last left the band) is kept as running sums, so the steady-state
+ * figures are ready whenever the step ends.
+ */
+typedef struct {
+    int seen;
+    int64_t last_t;
+    int last_target;
+    int last_active;
+
+    int in_step;
+    int64_t t0;                    // Step start
+    int from, to, y0;
+    int dir;                       // +1 up, -1 down
+    double size;                   // |to - y0|
+    double band;
+    int64_t t10, t90;              // -1 = not reached yet
+    double peak;                   // Largest dir * (rpm - to)
+    int64_t tail_t;                // First sample of the in-band tail (-1 = out of band now)
+    uint64_t tail_n;
+    double tail_mean, tail_m2;     // Welford
+
+    // Summary
+    uint32_t steps, settled, rose;
+    double sum_rise, sum_settle, sum_overshoot, sum_abs_sse, sum_noise;
+} StepState;
+
+static StepState states[MAX_MOTOR_IDS];
+static uint64_t samples_used = 0, samples_skipped = 0;
+static uint32_t steps_total = 0;
+
+// --- JSON OUTPUT ---
+
+static void put_number(const char *key, double v, int valid, int last) {
+    if (valid) printf("\"%s\":%.3f%s", key, v, last ? "" : ",");
+    else printf("\"%s\":null%s", key, last ? "" : ",");
+}
+
+/*
+ * FUNCTION: put_string
+ * --------------------
+ * Prints 'text' as a JSON string: quotes, backslashes and control
+ * characters escaped (a file name may contain any of them).
+ */
+static void put_string(const char *text) {
+    putchar('"');
+    for (const unsigned char *c = (const unsigned char *)text; *c; c++) {
+        if (*c == '"' || *c == '\\') printf("\\%c", *c);
+        else if (*c < 0x20) printf("\\u%04x", *c);
+        else putchar(*c);
+    }
+    putchar('"');
+}
+
+/*
+ * FUNCTION: end_step
+ * ------------------
+ * Prints the step in progress and adds it to the motor's summary.
+ */
+static void end_step(StepState *s, int motor, const char *reason) {
+    if (!s->in_step) return;
+    s->in_step = 0;
+
+    int rose = (s->t10 >= 0 && s->t90 >= 0);
+    int settled = (s->tail_t >= 0 && s->last_t - s->tail_t >= hold_us && s->tail_n > 0);
+    double rise = rose ? (s->t90 - s->t10) / 1e6 : 0;
+    double settle = settled ? (s->tail_t - s->t0) / 1e6 : 0;
+    double overshoot = (s->size > 0 && s->peak > 0) ? 100.0 * s->peak / s->size : 0;
+    double sse = settled ? s->to - s->tail_mean : 0;
+    double noise = (settled && s->tail_n > 1) ? sqrt(s->tail_m2 / (double)(s->tail_n - 1)) : 0;
+
+    printf("%s\n    {\"motor\":%d,", steps_total++ ? "," : "", motor);
+    put_number("time_s", s->t0 / 1e6, 1, 0);
+    printf("\"from\":%d,\"to\":%d,\"start_rpm\":%d,", s->from, s->to, s->y0);
+    put_number("duration_s", (s->last_t - s->t0) / 1e6, 1, 0);
+    put_number("rise_s", rise, rose, 0);
+    put_number("settle_s", settle, settled, 0);
+    put_number("overshoot_pct", overshoot, 1, 0);
+    put_number("sse_rpm", sse, settled, 0);
+    put_number("noise_rpm", noise, settled && s->tail_n > 1, 0);
+    printf("\"end\":\"%s\"}", reason);
+
+    s->steps++;
+    s->sum_overshoot += overshoot;
+    if (rose) { s->rose++; s->sum_rise += rise; }
+    if (settled) {
+        s->settled++;
+        s->sum_settle += settle;
+        s->sum_abs_sse += fabs(sse);
+        s->sum_noise += noise;
+    }
+}
+
+static void start_step(StepState *s, const Sample *x, int from) {
+    s->in_step = 1;
+    s->t0 = x->t_us;
+    s->from = from;
+    s->to = x->target;
+    s->y0 = x->rpm;
+    s->dir = (x->target >= x->rpm) ? 1 : -1;
+    s->size = fabs((double)x->target - x->rpm);
+    s->band = s->size * band_pct / 100;
+    if (s->band < BAND_MIN_RPM) s->band = BAND_MIN_RPM;
+    s->t10 = s->t90 = -1;
+    s->peak = -1e9;
+    s->tail_t = -1;
+    s->tail_n = 0;
+}
+
+/*
+ * FUNCTION: add_sample
+ * --------------------
+ * One sample through its motor's step state machine (constant work per
+ * sample, nothing stored).
+ */
+static void add_sample(const Sample *x) {
+    if (x->motor < 0 || x->motor >= MAX_MOTOR_IDS || (motor_filter >= 0 && x->motor != motor_filter)) return;
+    StepState *s = &states[x->motor];
+    samples_used++;
+
+    // Boundaries end the step before this sample is looked at
+    if (s->seen && (x->boundary || x->t_us - s->last_t > MAX_GAP_US || x->t_us < s->last_t)) {
+        end_step(s, x->motor, x->boundary ? "session" : "gap");
+        s->seen = 0; // What comes next is judged like the start of the file
+    }
+    if (s->in_step && !x->active) end_step(s, x->motor, "stop");
+    if (s->in_step && x->target != s->to) end_step(s, x->motor, "target");
+
+    if (x->active && !s->in_step) {
+        int jumped = s->seen && s->last_active && abs(x->target - s->last_target) >= min_step;
+        int started = s->seen && !s->last_active && abs(x->target - x->rpm) >= min_step;
+        if (jumped || started) start_step(s, x, started ? 0 : s->last_target);
+    }
+    s->seen = 1;
+    s->last_t = x->t_us;
+    s->last_target = x->target;
+    s->last_active = x->active;
+    if (!s->in_step) return;
+
+    // Rise, overshoot
+    double progress = s->size > 0 ? s->dir * ((double)x->rpm - s->y0) / s->size : 1;
+    if (s->t10 < 0 && progress >= 0.1) s->t10 = x->t_us;
+    if (s->t90 < 0 && progress >= 0.9) s->t90 = x->t_us;
+    double past = s->dir * ((double)x->rpm - s->to);
+    if (past > s->peak) s->peak = past;
+
+    // Settled tail
+    if (fabs((double)x->rpm - s->to) > s->band) {
+        s->tail_t = -1;
+        return;
+    }
+    if (s->tail_t < 0) {
+        s->tail_t = x->t_us;
+        s->tail_n = 0;
+        s->tail_mean = s->tail_m2 = 0;
+    }
+    double delta = x->rpm - s->tail_mean;
+    s->tail_mean += delta / (double)++s->tail_n;
+    s->tail_m2 += delta * (x->rpm - s->tail_mean);
+}
+
+// --- FLIGHT RECORDER ---
+
+/*
+ * FUNCTION: read_record
+ * ---------------------
+ * Copies record 'seq' out of the mapping. Returns 0 if the slot does not hold
+ * that record (never written, overwritten, or torn) before or after the copy.
+ */
+static int read_record(const FrRecord *records, uint32_t capacity, uint64_t seq, FrRecord *out) {
+    const FrRecord *slot = &records[(seq - 1) % capacity];
+
+    if (atomic_load_explicit(&slot->seq, memory_order_acquire) != seq) return 0;
+    memcpy(out, (const void *)slot, sizeof(*out));
+    atomic_thread_fence(memory_order_acquire);
+    return atomic_load_explicit(&slot->seq, memory_order_relaxed) == seq;
+}
+
+static int analyze_recorder(const uint8_t *map, size_t size, const char *path, int last_session) {
+    const FrHeader *hdr = (const FrHeader *)map;
+    const FrRecord *records = (const FrRecord *)(map + FR_HEADER_SIZE);
+    if (hdr->version != FR_VERSION || hdr->record_size != sizeof(FrRecord) ||
+        size < FR_HEADER_SIZE + (size_t)hdr->capacity * sizeof(FrRecord)) {
+        fprintf(stderr, "%s: a different flight recorder version\n", path);
+        return -1;
+    }
+
+    uint32_t capacity = hdr->capacity;
+    uint64_t head = atomic_load_explicit(&hdr->head, memory_order_acquire);
+    uint64_t first = (head > capacity) ? head - capacity + 1 : 1;
+    FrRecord r;
+
+    if (last_session) {
+        for (uint64_t n = head; n >= first && n > 0; n--) {
+            if (read_record(records, capacity, n, &r) && (r.flags & FR_FLAG_SESSION_START)) { first = n; break; }
+        }
+    }
+
+    for (uint64_t n = first; n <= head; n++) {
+        if (!read_record(records, capacity, n, &r)) { samples_skipped++; continue; }
+        Sample x = {
+            .t_us = r.time_us, .motor = r.motor, .rpm = r.rpm_smooth, .target = r.target,
+            .active = (r.mode == MODE_AUTO && (r.flags & FR_FLAG_RUNNING)),
+            .boundary = (r.flags & FR_FLAG_SESSION_START) != 0,
+        };
+        add_sample(&x);
+    }
+    return 0;
+}
+
+// --- CSV ---
+
+/*
+ * FUNCTION: parse_int
+ * -------------------
+ * Leading integer of a field (a fraction is ignored). Returns 0 if the field
+ * does not start with a number.
+ */
+static int parse_int(const char *p, const char *end, long long *out) {
+    int neg = 0;
+    long long v = 0;
+    if (p < end && *p == '-') { neg = 1; p++; }
+    if (p >= end || *p < '0' || *p > '9') return 0;
+    while (p < end && *p >= '0' && *p <= '9') v = v * 10 + (*p++ - '0');
+    *out = neg ? -v : v;
+    return 1;
+}
+
+static int column_is(const char *p, size_t len, const char *name) {
+    return len == strlen(name) && memcmp(p, name, len) == 0;
+}
+
+/*
+ * FUNCTION: analyze_csv
+ * ---------------------
+ * Walks the mapped CSV once, splitting fields in place. Time comes from
+ * "time(ms)", or "tick" (microseconds, wraps every ~72 minutes).
+ */
+static int analyze_csv(const char *p, const char *end, const char *path) {
+    enum { COL_NONE, COL_TIME_MS, COL_TICK, COL_MOTOR, COL_RPM, COL_TARGET, COL_MODE, COL_RUNNING };
+    int role[CSV_MAX_COLUMNS] = { 0 };
+    int have[COL_RUNNING + 1] = { 0 };
+    int columns = 0;
+
+    // Header row
+    const char *eol = memchr(p, '\n', (size_t)(end - p));
+    if (eol == NULL) eol = end;
+    while (p < eol && columns < CSV_MAX_COLUMNS) {
+        const char *comma = memchr(p, ',', (size_t)(eol - p));
+        const char *stop = comma ? comma : eol;
+        size_t len = (size_t)(stop - p);
+        if (len > 0 && p[len - 1] == '\r') len--;
+        int c = COL_NONE;
+        if (column_is(p, len, "time(ms)")) c = COL_TIME_MS;
+        else if (column_is(p, len, "tick")) c = COL_TICK;
+        else if (column_is(p, len, "motor")) c = COL_MOTOR;
+        else if (column_is(p, len, "rpm_smooth") || column_is(p, len, "RPM")) c = COL_RPM;
+        else if (column_is(p, len, "target")) c = COL_TARGET;
+        else if (column_is(p, len, "mode")) c = COL_MODE;
+        else if (column_is(p, len, "running")) c = COL_RUNNING;
+        if (have[c] && c != COL_NONE) c = COL_NONE; // First one wins
+        role[columns++] = c;
+        have[c] = 1;
+        p = comma ? comma + 1 : eol;
+    }
+    if (!(have[COL_TIME_MS] || have[COL_TICK]) || !have[COL_RPM] || !have[COL_TARGET]) {
+        fprintf(stderr, "%s: needs a time(ms) or tick, an RPM or rpm_smooth and a target column\n", path);
+        return -1;
+    }
+
+    int64_t t_us = 0, first_ms = -1;
+    uint32_t last_tick = 0;
+    int have_tick = 0;
+    p = (eol < end) ? eol + 1 : end;
+
+    while (p < end) {
+        eol = memchr(p, '\n', (size_t)(end - p));
+        if (eol == NULL) eol = end;
+
+        long long v[COL_RUNNING + 1] = { 0 };
+        int got[COL_RUNNING + 1] = { 0 };
+        for (int c = 0; c < columns && p <= eol; c++) {
+            const char *comma = memchr(p, ',', (size_t)(eol - p));
+            const char *stop = comma ? comma : eol;
+            if (role[c] != COL_NONE) got[role[c]] = parse_int(p, stop, &v[role[c]]);
+            p = comma ? comma + 1 : eol + 1;
+        }
+        p = eol + 1;
+
+        if (!(got[COL_TIME_MS] || got[COL_TICK]) || !got[COL_RPM] || !got[COL_TARGET] || v[COL_TARGET] < 0) {
+            samples_skipped++;
+            continue;
+        }
+        if (got[COL_TIME_MS]) {
+            if (first_ms < 0) first_ms = v[COL_TIME_MS];
+            t_us = (v[COL_TIME_MS] - first_ms) * 1000;
+        } else {
+            uint32_t tick = (uint32_t)v[COL_TICK];
+            if (have_tick) t_us += (uint32_t)(tick - last_tick);
+            last_tick = tick;
+            have_tick = 1;
+        }
+        Sample x = {
+            .t_us = t_us, .motor = got[COL_MOTOR] ? (int)v[COL_MOTOR] : 0,
+            .rpm = (int)v[COL_RPM], .target = (int)v[COL_TARGET],
+            .active = (!have[COL_MODE] || v[COL_MODE] == MODE_AUTO) && (!have[COL_RUNNING] || v[COL_RUNNING] != 0),
+        };
+        add_sample(&x);
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    const char *path = FR_DEFAULT_PATH;
+    int last_session = 0;
+    int opt_c;
+
+    while ((opt_c = getopt(argc, argv, "f:m:Sd:b:H:")) != -1) {
+        switch (opt_c) {
+            case 'f': path = optarg; break;
+            case 'm': motor_filter = atoi(optarg); break;
+            case 'S': last_session = 1; break;
+            case 'd': min_step = atoi(optarg); break;
+            case 'b': band_pct = atof(optarg); break;
+            case 'H': hold_us = atoll(optarg) * 1000; break;
+            default:
+                fprintf(stderr, "Usage: %s [-f file] [-m motor_id] [-S] [-d rpm] [-b pct] [-H ms]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (min_step < 1 || band_pct <= 0 || band_pct > 100 || hold_us < 0) {
+        fprintf(stderr, "-d must be at least 1, -b between 0 and 100, -H not negative\n");
+        return 1;
+    }
+
+    // --- MAP THE FILE (read-only) ---
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) { perror(path); return 1; }
+    if (st.st_size == 0) { fprintf(stderr, "%s: empty\n", path); return 1; }
+
+    const uint8_t *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) { perror("mmap"); return 1; }
+    madvise((void *)map, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+    static char out_buf[1 << 16];
+    setvbuf(stdout, out_buf, _IOFBF, sizeof(out_buf));
+
+    int recorder = (size_t)st.st_size >= FR_HEADER_SIZE && memcmp(map, FR_MAGIC, 8) == 0;
+    printf("{\"file\":");
+    put_string(path);
+    printf(",\"format\":\"%s\",\"min_step_rpm\":%d,\"band_pct\":%g,\"hold_ms\":%lld,\n  \"steps\":[",
+           recorder ? "recorder" : "csv", min_step, band_pct, (long long)(hold_us / 1000));
+
+    int r = recorder ? analyze_recorder(map, (size_t)st.st_size, path, last_session)
+                     : analyze_csv((const char *)map, (const char *)map + st.st_size, path);
+    if (r != 0) return 1;
+    for (int m = 0; m < MAX_MOTOR_IDS; m++) end_step(&states[m], m, "end");
+
+    // --- SUMMARY (means over the steps that have the figure) ---
+    printf("],\n  \"samples\":%llu,\"skipped\":%llu,\n  \"motors\":[",
+           (unsigned long long)samples_used, (unsigned long long)samples_skipped);
+    int first = 1;
+    for (int m = 0; m < MAX_MOTOR_IDS; m++) {
+        const StepState *s = &states[m];
+        if (!s->seen) continue;
+        printf("%s\n    {\"motor\":%d,\"steps\":%u,\"settled\":%u,", first ? "" : ",", m, s->steps, s->settled);
+        put_number("rise_s", s->rose ? s->sum_rise / s->rose : 0, s->rose > 0, 0);
+        put_number("settle_s", s->settled ? s->sum_settle / s->settled : 0, s->settled > 0, 0);
+        put_number("overshoot_pct", s->steps ? s->sum_overshoot / s->steps : 0, s->steps > 0, 0);
+        put_number("abs_sse_rpm", s->settled ? s->sum_abs_sse / s->settled : 0, s->settled > 0, 0);
+        put_number("noise_rpm", s->settled ? s->sum_noise / s->settled : 0, s->settled > 0, 1);
+        printf("}");
+        first = 0;
+    }
+    printf("]\n}\n");
+    return 0;
+}
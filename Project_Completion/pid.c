@@ -0,0 +1,245 @@
+/*
+ * ======================================================================================
+ * PROJECT:       PARMCO (Phone APP RP4 Motor Control)
+ * FILE:          pid.c
+ * AUTHOR:        Group 1
+ *
+ * DESCRIPTION:
+ * Runtime tuning, gain schedule and the floating-point / fixed-point
+ * controller steps (see pid.h).
+ * ======================================================================================
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "pid.h"
+
+#define PID_MAX_GAIN 10.0
+#define PID_MAX_KD 1.0                // Keeps the fixed-point D product inside 64 bits
+#define PID_FIXED_MAX_ERROR 100000    // Keeps error * kp_q32 inside 64 bits (kp 10 at 10 Hz)
+#define PID_MAX_INTEGRAL_LIMIT 10000.0
+#define PID_MAX_SLEW 1000.0
+#define PID_MAX_FILTER_HZ 1000.0
+#define Q16 65536.0
+#define Q32 4294967296.0
+#define PPM_PER_PERCENT 10000.0
+
+// --- TUNING ---
+
+void pid_tuning_default(PidTuning *t) {
+    memset(t, 0, sizeof(*t));
+    t->gains.kp = PID_KP;
+    t->gains.ki = PID_KI;
+    t->gains.kd = PID_KD;
+    t->i_min = PID_MIN_INTEGRAL;
+    t->i_max = PID_MAX_INTEGRAL;
+    t->slew = MAX_CHANGE_PER_SEC;
+    t->d_filter_hz = PID_D_FILTER_HZ;
+}
+
+PidGains pid_gains_at(const PidTuning *t, int target_rpm) {
+    const PidScheduleRow *row = t->schedule;
+    int n = t->schedule_count;
+
+    if (n == 0) return t->gains;
+    if (target_rpm <= row[0].rpm) return row[0].gains;
+    if (target_rpm >= row[n - 1].rpm) return row[n - 1].gains;
+
+    int i = 1;
+    while (row[i].rpm <= target_rpm) i++;
+    double frac = (double)(target_rpm - row[i - 1].rpm) / (row[i].rpm - row[i - 1].rpm);
+    PidGains g = {
+        row[i - 1].gains.kp + frac * (row[i].gains.kp - row[i - 1].gains.kp),
+        row[i - 1].gains.ki + frac * (row[i].gains.ki - row[i - 1].gains.ki),
+        row[i - 1].gains.kd + frac * (row[i].gains.kd - row[i - 1].gains.kd),
+    };
+    return g;
+}
+
+/*
+ * FUNCTION: parse_number
+ * ----------------------
+ * Strict strtod over [s, end): the whole range must be one number in [lo, hi].
+ */
+static int parse_number(const char *s, const char *end, double lo, double hi, double *out) {
+    char buf[32], *stop;
+    size_t len = (size_t)(end - s);
+    if (len == 0 || len >= sizeof(buf)) return -1;
+    memcpy(buf, s, len);
+    buf[len] = '\0';
+    double v = strtod(buf, &stop);
+    if (*stop != '\0' || !isfinite(v) || v < lo || v > hi) return -1;
+    *out = v;
+    return 0;
+}
+
+static int parse_gains(const char *s, const char *end, PidGains *g) {
+    const char *slash1 = memchr(s, '/', (size_t)(end - s));
+    if (slash1 == NULL) return -1;
+    const char *slash2 = memchr(slash1 + 1, '/', (size_t)(end - slash1 - 1));
+    if (slash2 == NULL) return -1;
+    return (parse_number(s, slash1, 0, PID_MAX_GAIN, &g->kp) == 0 &&
+            parse_number(slash1 + 1, slash2, 0, PID_MAX_GAIN, &g->ki) == 0 &&
+            parse_number(slash2 + 1, end, 0, PID_MAX_KD, &g->kd) == 0) ? 0 : -1;
+}
+
+/*
+ * FUNCTION: parse_schedule
+ * ------------------------
+ * "<rpm>/<kp>/<ki>/<kd>;..." into t->schedule. An empty string clears it.
+ */
+static int parse_schedule(PidTuning *t, const char *s, const char *end) {
+    t->schedule_count = 0;
+    while (s < end) {
+        const char *row_end = memchr(s, ';', (size_t)(end - s));
+        if (row_end == NULL) row_end = end;
+        const char *slash = memchr(s, '/', (size_t)(row_end - s));
+        double rpm;
+        PidScheduleRow *row = &t->schedule[t->schedule_count];
+
+        if (t->schedule_count == PID_SCHEDULE_MAX || slash == NULL) return -1;
+        if (parse_number(s, slash, 0, 100000, &rpm) != 0 || rpm != floor(rpm)) return -1;
+        if (parse_gains(slash + 1, row_end, &row->gains) != 0) return -1;
+        row->rpm = (int)rpm;
+        if (t->schedule_count > 0 && row->rpm <= row[-1].rpm) return -1; // Must ascend
+        t->schedule_count++;
+        s = (row_end < end) ? row_end + 1 : end;
+    }
+    return 0;
+}
+
+int pid_tuning_set(PidTuning *t, const char *text) {
+    PidTuning next = *t;
+    const char *s = text, *end = text + strlen(text);
+
+    while (s < end) {
+        const char *item_end = strchr(s, ',');
+        if (item_end == NULL) item_end = end;
+        const char *eq = memchr(s, '=', (size_t)(item_end - s));
+        if (eq == NULL) return -1;
+        size_t key_len = (size_t)(eq - s);
+        const char *v = eq + 1;
+        int r;
+
+#define KEY(name) (key_len == sizeof(name) - 1 && memcmp(s, name, key_len) == 0)
+        if (KEY("kp")) r = parse_number(v, item_end, 0, PID_MAX_GAIN, &next.gains.kp);
+        else if (KEY("ki")) r = parse_number(v, item_end, 0, PID_MAX_GAIN, &next.gains.ki);
+        else if (KEY("kd")) r = parse_number(v, item_end, 0, PID_MAX_KD, &next.gains.kd);
+        else if (KEY("imin")) r = parse_number(v, item_end, -PID_MAX_INTEGRAL_LIMIT, 0, &next.i_min);
+        else if (KEY("imax")) r = parse_number(v, item_end, 0, PID_MAX_INTEGRAL_LIMIT, &next.i_max);
+        else if (KEY("slew")) r = parse_number(v, item_end, 0.001, PID_MAX_SLEW, &next.slew);
+        else if (KEY("dfilt")) r = parse_number(v, item_end, 0, PID_MAX_FILTER_HZ, &next.d_filter_hz);
+        else if (KEY("sched")) r = parse_schedule(&next, v, item_end);
+        else r = -1;
+#undef KEY
+        if (r != 0) return -1;
+        s = (item_end < end) ? item_end + 1 : end;
+    }
+    *t = next;
+    return 0;
+}
+
+int pid_tuning_format(const PidTuning *t, char *out, size_t cap) {
+    int len = snprintf(out, cap, "kp=%g,ki=%g,kd=%g,imin=%g,imax=%g,slew=%g,dfilt=%g,sched=",
+                       t->gains.kp, t->gains.ki, t->gains.kd, t->i_min, t->i_max, t->slew, t->d_filter_hz);
+    for (int i = 0; i < t->schedule_count && len < (int)cap; i++) {
+        const PidScheduleRow *row = &t->schedule[i];
+        len += snprintf(out + len, cap - (size_t)len, "%s%d/%g/%g/%g", i ? ";" : "",
+                        row->rpm, row->gains.kp, row->gains.ki, row->gains.kd);
+    }
+    return (len < (int)cap) ? len : (int)cap - 1;
+}
+
+// --- CONTROLLER ---
+
+void pid_reset(PidState *s) {
+    memset(s, 0, sizeof(*s));
+}
+
+double pid_step_float(PidState *s, const PidTuning *t, int target_rpm, int rpm, double dt) {
+    PidGains g = pid_gains_at(t, target_rpm);
+
+    // 1. Calculate Error
+    s->error = (double)target_rpm - (double)rpm;
+
+    // 2. Calculate Integral (Accumulated Error) with Anti-Windup Clamping
+    s->integral += s->error * dt;
+    if (s->integral > t->i_max) s->integral = t->i_max;
+    if (s->integral < t->i_min) s->integral = t->i_min;
+
+    // 3. Derivative on the measurement (no kick on target steps), low-pass filtered
+    double slope = s->have_meas ? (rpm - s->last_meas) / dt : 0;
+    double alpha = (t->d_filter_hz > 0) ? dt / (dt + 1.0 / (2 * M_PI * t->d_filter_hz)) : 1.0;
+    s->d_filt += alpha * (slope - s->d_filt);
+    s->last_meas = rpm;
+    s->have_meas = 1;
+
+    // 4. Compute Output (P + I + D), in PWM % per second
+    s->p_term = g.kp * s->error;
+    s->i_term = g.ki * s->integral;
+    s->d_term = -g.kd * s->d_filt;
+    double output = s->p_term + s->i_term + s->d_term;
+
+    // 5. Limit the rate of change (prevents motor jerking)
+    double change = output * dt;
+    double max_change = t->slew * dt;
+    if (change > max_change) change = max_change;
+    if (change < -max_change) change = -max_change;
+    return change;
+}
+
+void pid_fixed_coeffs(const PidTuning *t, uint32_t tuning_gen, int target_rpm, int rate_hz, PidFixedCoeffs *c) {
+    PidGains g = pid_gains_at(t, target_rpm);
+    double dt = 1.0 / rate_hz;
+    double alpha = (t->d_filter_hz > 0) ? dt / (dt + 1.0 / (2 * M_PI * t->d_filter_hz)) : 1.0;
+
+    // % per second -> ppm per tick is * PPM_PER_PERCENT * dt
+    c->kp_q32 = llround(g.kp * PPM_PER_PERCENT * dt * Q32);
+    c->ki_q32 = llround(g.ki * PPM_PER_PERCENT * dt * dt * Q32);   // Integral is kept in RPM * ticks
+    c->kd_q16 = llround(g.kd * PPM_PER_PERCENT * Q16);             // Slope per tick * rate * dt cancels
+    c->i_min_ticks = llround(t->i_min * rate_hz);
+    c->i_max_ticks = llround(t->i_max * rate_hz);
+    c->slew_q32 = llround(t->slew * PPM_PER_PERCENT * dt * Q32);
+    c->d_alpha_q16 = llround(alpha * Q16);
+    c->target_rpm = target_rpm;
+    c->rate_hz = rate_hz;
+    c->tuning_gen = tuning_gen;
+    c->valid = 1;
+}
+
+int64_t pid_step_fixed(PidState *s, const PidFixedCoeffs *c, int target_rpm, int rpm) {
+    int64_t error = (int64_t)target_rpm - rpm;
+    if (error > PID_FIXED_MAX_ERROR) error = PID_FIXED_MAX_ERROR;
+    if (error < -PID_FIXED_MAX_ERROR) error = -PID_FIXED_MAX_ERROR;
+
+    s->integral_ticks += error;
+    if (s->integral_ticks > c->i_max_ticks) s->integral_ticks = c->i_max_ticks;
+    if (s->integral_ticks < c->i_min_ticks) s->integral_ticks = c->i_min_ticks;
+
+    int64_t slope = s->have_meas ? (int64_t)rpm - s->last_meas : 0;
+    s->d_filt_q16 += (((slope << 16) - s->d_filt_q16) * c->d_alpha_q16) >> 16;
+    s->last_meas = rpm;
+    s->have_meas = 1;
+
+    s->p_q32 = error * c->kp_q32;
+    s->i_q32 = s->integral_ticks * c->ki_q32;
+    s->d_q32 = -(s->d_filt_q16 * c->kd_q16);
+    s->last_error = (int)error;
+
+    int64_t change = s->p_q32 + s->i_q32 + s->d_q32;
+    if (change > c->slew_q32) change = c->slew_q32;
+    if (change < -c->slew_q32) change = -c->slew_q32;
+    return change;
+}
+
+void pid_export_fixed(PidState *s, int rate_hz) {
+    double to_pct_per_sec = rate_hz / (PPM_PER_PERCENT * Q32);
+    s->error = s->last_error;
+    s->integral = (double)s->integral_ticks / rate_hz;
+    s->d_filt = s->d_filt_q16 * rate_hz / Q16;
+    s->p_term = s->p_q32 * to_pct_per_sec;
+    s->i_term = s->i_q32 * to_pct_per_sec;
+    s->d_term = s->d_q32 * to_pct_per_sec;
+}
@@ -0,0 +1,165 @@
+/*
+ * ======================================================================================
+ * PROJECT:       PARMCO (Phone APP RP4 Motor Control)
+ * FILE:          pid.h
+ * AUTHOR:        Group 1
+ *
+ * DESCRIPTION:
+ * Speed controller for parmco_server. The output is a rate of change of the
+ * PWM duty (% per second) that the server integrates into the duty:
+ *
+ *   output = Kp * error + Ki * integral(error) - Kd * d(rpm)/dt
+ *
+ * The derivative acts on the measurement, not the error, so a target step
+ * gives no kick; it is low-pass filtered at 'd_filter_hz'.
+ *
+ * TUNING
+ * Gains, integral clamp and slew limit are set per motor at runtime ("g:"
+ * command, pid_tuning_set). A gain schedule of up to PID_SCHEDULE_MAX rows
+ * (target RPM -> Kp/Ki/Kd) replaces the single gain set when it has rows;
+ * gains are interpolated linearly between rows and held beyond the ends.
+ * Assignments (comma separated, applied all or nothing):
+ *   kp=<v> ki=<v> kd=<v>        Gains of the single set (0 - 10, Kd 0 - 1)
+ *   imin=<v> imax=<v>           Integral clamp in RPM*s (|v| <= 10000)
+ *   slew=<v>                    Max duty change in % per second (0 - 1000)
+ *   dfilt=<hz>                  Derivative filter corner, 0 = unfiltered
+ *   sched=<rpm>/<kp>/<ki>/<kd>;...   Schedule rows, ascending RPM ("sched=" clears)
+ *
+ * FIXED-POINT PATH
+ * pid_step_fixed() is the same controller in integer math: the duty is kept in
+ * Q32 parts per million, and gains are folded into per-tick Q32 coefficients
+ * (pid_fixed_coeffs) that are only recomputed when the tuning changes, or with a
+ * gain schedule the target. Each tick is then a handful of 64-bit multiplies
+ * and adds; pid_export_fixed() makes the floating-point copies for readers.
+ * ======================================================================================
+ */
+
+#ifndef PID_H
+#define PID_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Defaults (the original compile-time tuning)
+#define PID_KP 0.01           // Proportional Gain (Reaction to current error)
+#define PID_KI 0.005          // Integral Gain (Reaction to accumulated error)
+#define PID_KD 0.0            // Derivative Gain (Reaction to rate of change - off by default)
+#define PID_MAX_INTEGRAL 50.0 // Anti-Windup: Max accumulated error positive
+#define PID_MIN_INTEGRAL -50.0// Anti-Windup: Max accumulated error negative
+#define MAX_CHANGE_PER_SEC 5.0 // Safety: Max PWM % change allowed per second
+#define PID_D_FILTER_HZ 5.0   // Derivative low-pass corner
+
+#define PID_SCHEDULE_MAX 8
+#define PID_TEXT_MAX 512      // Longest pid_tuning_format() output
+
+typedef struct { double kp, ki, kd; } PidGains;
+
+typedef struct {
+    int rpm;                           // Target RPM this row applies at
+    PidGains gains;
+} PidScheduleRow;
+
+typedef struct {
+    PidGains gains;                    // Used while the schedule is empty
+    PidScheduleRow schedule[PID_SCHEDULE_MAX];
+    int schedule_count;
+    double i_min, i_max;               // Integral clamp (RPM * s)
+    double slew;                       // Max duty change, % per second
+    double d_filter_hz;                // Derivative filter corner (0 = off)
+} PidTuning;
+
+// Per-tick coefficients for the fixed-point path (duty unit: ppm, Q32)
+typedef struct {
+    int valid;
+    int target_rpm, rate_hz;           // What they were computed for
+    uint32_t tuning_gen;
+    int64_t kp_q32;                    // ppm per tick per RPM of error
+    int64_t ki_q32;                    // ppm per tick per RPM*tick of integral
+    int64_t kd_q16;                    // ppm per tick per RPM/tick of measurement slope (Q16)
+    int64_t i_min_ticks, i_max_ticks;  // Integral clamp in RPM*ticks
+    int64_t slew_q32;                  // Max duty change per tick
+    int64_t d_alpha_q16;               // Derivative filter coefficient
+} PidFixedCoeffs;
+
+typedef struct {
+    double error;                      // Last error (target - measurement)
+    double integral;                   // RPM * s
+    double d_filt;                     // Filtered measurement slope, RPM/s
+    double p_term, i_term, d_term;     // Last contributions, % per second
+    int last_meas, have_meas;
+
+    // Fixed-point path
+    int64_t integral_ticks;            // RPM * ticks
+    int64_t d_filt_q16;                // RPM per tick, Q16
+    int64_t p_q32, i_q32, d_q32;       // Last contributions, ppm per tick Q32
+    int last_error;
+} PidState;
+
+/*
+ * FUNCTION: pid_tuning_default
+ * ----------------------------
+ * The original tuning: PID_KP/KI/KD, no schedule.
+ */
+void pid_tuning_default(PidTuning *t);
+
+/*
+ * FUNCTION: pid_gains_at
+ * ----------------------
+ * Gains for 'target_rpm': the schedule (interpolated) or the single set.
+ */
+PidGains pid_gains_at(const PidTuning *t, int target_rpm);
+
+/*
+ * FUNCTION: pid_tuning_set
+ * ------------------------
+ * Applies "key=value,key=value" (see TUNING). Nothing changes unless every
+ * assignment is valid. Returns 0, or -1.
+ */
+int pid_tuning_set(PidTuning *t, const char *text);
+
+/*
+ * FUNCTION: pid_tuning_format
+ * ---------------------------
+ * The tuning in the pid_tuning_set() syntax. Returns the length.
+ */
+int pid_tuning_format(const PidTuning *t, char *out, size_t cap);
+
+/*
+ * FUNCTION: pid_reset
+ * -------------------
+ * Clears the integral, the derivative filter and the last measurement.
+ */
+void pid_reset(PidState *s);
+
+/*
+ * FUNCTION: pid_step_float
+ * ------------------------
+ * One controller update. Returns the duty change for this tick in %, slew limited.
+ */
+double pid_step_float(PidState *s, const PidTuning *t, int target_rpm, int rpm, double dt);
+
+/*
+ * FUNCTION: pid_fixed_coeffs
+ * --------------------------
+ * Computes the fixed-point coefficients for 'target_rpm' at 'rate_hz'.
+ */
+void pid_fixed_coeffs(const PidTuning *t, uint32_t tuning_gen, int target_rpm, int rate_hz, PidFixedCoeffs *c);
+
+/*
+ * FUNCTION: pid_step_fixed
+ * ------------------------
+ * pid_step_float() in integer math. Returns the duty change for this tick
+ * in ppm, Q32, slew limited. The error saturates at +-100,000 RPM, which
+ * keeps every product inside 64 bits whatever the caller passes.
+ */
+int64_t pid_step_fixed(PidState *s, const PidFixedCoeffs *c, int target_rpm, int rpm);
+
+/*
+ * FUNCTION: pid_export_fixed
+ * --------------------------
+ * Fills the floating-point fields of 's' (error, integral, terms) from the
+ * fixed-point state, for the snapshot, the recorder and the log.
+ */
+void pid_export_fixed(PidState *s, int rate_hz);
+
+#endif // PID_H
@@ -0,0 +1,259 @@
+/*
+ * ======================================================================================
+ * PROJECT:       PARMCO (Phone APP RP4 Motor Control)
+ * FILE:          rpm_filter.c
+ * AUTHOR:        Group 1
+ *
+ * DESCRIPTION:
+ * Interval gate, median and alpha-beta estimator (see rpm_filter.h).
+ * ======================================================================================
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "rpm_filter.h"
+
+#define RF_TEXT_MAX 16
+
+// --- OPTIONS ---
+
+void rf_config_default(RpmFilterConfig *c, unsigned glitch_us, double max_rpm) {
+    c->glitch_us = glitch_us;
+    c->max_rpm = max_rpm;
+    c->accel = 30000;
+    c->tol = 0.15;
+    c->median = 3;
+    c->alpha = 0.25;
+    c->beta = 0.02;
+}
+
+int rf_configure(RpmFilterConfig *c, const char *opts) {
+    RpmFilterConfig next = *c;
+    const char *s = opts;
+
+    while (*s != '\0') {
+        char key[RF_TEXT_MAX], *stop;
+        size_t len = strcspn(s, ",");
+        const char *eq = memchr(s, '=', len);
+        if (eq == NULL || (size_t)(eq - s) >= sizeof(key)) {
+            fprintf(stderr, "filter: expected key=value in '%.*s'\n", (int)len, s);
+            return -1;
+        }
+        memcpy(key, s, (size_t)(eq - s));
+        key[eq - s] = '\0';
+        double v = strtod(eq + 1, &stop);
+        if (stop != s + len || stop == eq + 1 || !isfinite(v)) {
+            fprintf(stderr, "filter: bad value for '%s'\n", key);
+            return -1;
+        }
+
+        int ok;
+        if (strcmp(key, "glitch") == 0) ok = (v >= 0 && v <= 10000 && v == floor(v)) && (next.glitch_us = (unsigned)v, 1);
+        else if (strcmp(key, "maxrpm") == 0) ok = (v >= 100 && v <= 100000) && (next.max_rpm = v, 1);
+        else if (strcmp(key, "accel") == 0) ok = (v > 0 && v <= 1e7) && (next.accel = v, 1);
+        else if (strcmp(key, "tol") == 0) ok = (v >= 0 && v <= 100) && (next.tol = v / 100, 1);
+        else if (strcmp(key, "median") == 0) ok = (v >= 1 && v <= RF_MAX_MEDIAN && v == floor(v) && ((int)v % 2) == 1) && (next.median = (int)v, 1);
+        else if (strcmp(key, "alpha") == 0) ok = (v > 0 && v <= 1) && (next.alpha = v, 1);
+        else if (strcmp(key, "beta") == 0) ok = (v >= 0 && v < 1) && (next.beta = v, 1);
+        else { fprintf(stderr, "filter: unknown option '%s'\n", key); return -1; }
+        if (!ok) { fprintf(stderr, "filter: '%s' out of range\n", key); return -1; }
+
+        s += len;
+        if (*s == ',') s++;
+    }
+    *c = next;
+    return 0;
+}
+
+// --- FILTER ---
+
+/*
+ * FUNCTION: window_median
+ * -----------------------
+ * Median of the accepted intervals in the window (insertion sort of at most
+ * RF_MAX_MEDIAN values). With an even fill during start-up the lower middle
+ * value is used.
+ */
+static uint32_t window_median(const RpmFilter *f) {
+    uint32_t v[RF_MAX_MEDIAN];
+    int n = f->window_fill;
+
+    for (int i = 0; i < n; i++) {
+        uint32_t x = f->window[i];
+        int j = i;
+        while (j > 0 && v[j - 1] > x) { v[j] = v[j - 1]; j--; }
+        v[j] = x;
+    }
+    return v[(n - 1) / 2];
+}
+
+/*
+ * FUNCTION: set_anchor
+ * --------------------
+ * Takes 'tick' as the new reference edge and restarts the estimate from the
+ * next two intervals (after a stop, or a run of rejects).
+ */
+static void set_anchor(RpmFilter *f, uint32_t tick) {
+    f->have_anchor = 1;
+    f->anchor_tick = tick;
+    f->last_interval = 0;
+    f->reject_run = 0;
+    f->bridged = 0;
+    f->split_run = 0;
+    f->seeding = RF_SEED_FIRST;
+    f->window_fill = 0;
+    f->window_idx = 0;
+}
+
+/*
+ * FUNCTION: even_split
+ * --------------------
+ * 1 if the f->bridged edges rejected as too short since the anchor cut
+ * 'interval' into equal parts (within 'tol'). Those edges were real and the
+ * estimate is a fraction (1/2, 1/3, ...) of the true speed: a glitch lands
+ * anywhere in the period, the next real edge of a faster motor always
+ * lands on the grid.
+ */
+static int even_split(const RpmFilter *f, double tol, uint32_t interval) {
+    double part = (double)interval / (f->bridged + 1);
+    double first = (double)(uint32_t)(f->bridged_first - f->anchor_tick);
+    double last = (double)(uint32_t)(f->bridged_last - f->anchor_tick);
+    return fabs(first - part) <= tol * part && fabs(last - f->bridged * part) <= tol * part;
+}
+
+int rf_add_edge(RpmFilter *f, const RpmFilterConfig *c, uint32_t tick, int edges_per_rev) {
+    uint32_t interval = tick - f->anchor_tick; // Unsigned math handles the 72 min tick wrap
+
+    if (!f->have_anchor || interval > RF_TIMEOUT_US || interval == 0) {
+        // Motor was stopped: the gap is not a real period
+        set_anchor(f, tick);
+        f->valid = 0;
+        return RF_ANCHOR;
+    }
+
+    double dt = interval / 1e6;
+    double measured = 60.0 / (dt * edges_per_rev);
+
+    // 1. GATE: against the estimate, or while seeding against the first interval
+    int verdict = RF_ACCEPTED;
+    if (measured > c->max_rpm) {
+        verdict = RF_REJECT_SHORT;
+    } else if (f->seeding != RF_SEED_FIRST) {
+        double predicted = (f->seeding == RF_SEED_CONFIRM) ? f->raw : f->rpm + f->rate * dt;
+        double limit = c->accel * dt + c->tol * predicted;
+        double high = predicted + limit, low = predicted - limit;
+        if (f->last_interval > 0) {
+            // The estimate lags a fast spin-up: a speed the motor can reach from the last good interval is plausible too
+            double last = 60e6 / ((double)f->last_interval * edges_per_rev);
+            double last_limit = c->accel * dt + c->tol * last;
+            if (last + last_limit > high) high = last + last_limit;
+            if (last - last_limit < low) low = last - last_limit;
+        }
+        if (measured > high) verdict = RF_REJECT_SHORT;
+        else if (measured < low) verdict = RF_REJECT_LONG;
+    }
+
+    if (verdict != RF_ACCEPTED) {
+        if (verdict == RF_REJECT_SHORT) {
+            f->rejected_short++; // Keep the anchor: the next interval spans the glitch
+            if (f->bridged++ == 0) f->bridged_first = tick;
+            f->bridged_last = tick;
+        } else {
+            f->rejected_long++;
+            f->anchor_tick = tick;
+            f->bridged = 0;
+            f->split_run = 0;
+            if (f->seeding == RF_SEED_CONFIRM) {
+                // The first interval was the odd one out (a glitch at standstill): start over from here
+                set_anchor(f, tick);
+                return verdict;
+            }
+        }
+        if (++f->reject_run >= RF_MAX_REJECT_RUN) {
+            // The estimate itself is off (or the speed really jumped): lock on to the new rate
+            f->relocks++;
+            set_anchor(f, tick);
+        }
+        return verdict;
+    }
+
+    // Locked on every second (third, ...) edge: the rejected edges were the real ones.
+    // A glitch can split one period evenly by chance, so it takes two in a row.
+    f->split_run = (f->bridged > 0 && even_split(f, c->tol, interval)) ? f->split_run + 1 : 0;
+    if (f->split_run >= RF_SPLIT_RUN) {
+        f->relocks++;
+        set_anchor(f, tick);
+        return RF_ANCHOR;
+    }
+
+    // 2. MEDIAN
+    f->window[f->window_idx] = interval;
+    f->window_idx = (f->window_idx + 1) % c->median;
+    if (f->window_fill < c->median) f->window_fill++;
+    f->raw = 60e6 / ((double)window_median(f) * edges_per_rev);
+
+    // 3. ESTIMATOR (a restart waits until the median window is full of intervals that agree)
+    if (f->seeding == RF_SEED_FIRST) {
+        f->seeding = RF_SEED_CONFIRM;
+    } else if (f->seeding == RF_SEED_CONFIRM) {
+        if (f->window_fill >= c->median) {
+            f->rpm = f->raw;
+            f->rate = 0;
+            f->seeding = RF_SEED_DONE;
+            f->valid = 1;
+        }
+    } else {
+        double predicted = f->rpm + f->rate * dt;
+        double residual = f->raw - predicted;
+        f->rpm = predicted + c->alpha * residual;
+        f->rate += c->beta * residual / dt;
+        if (f->rate > c->accel) f->rate = c->accel;
+        if (f->rate < -c->accel) f->rate = -c->accel;
+        if (f->rpm < 0) f->rpm = 0;
+    }
+
+    f->anchor_tick = tick;
+    f->last_interval = interval;
+    f->reject_run = 0;
+    f->bridged = 0;
+    f->accepted++;
+    return RF_ACCEPTED;
+}
+
+/*
+ * FUNCTION: rpm_at
+ * ----------------
+ * 'rpm' (the value at the last good edge) carried forward to 'now_tick':
+ * 0 after RF_TIMEOUT_US, and never faster than one edge in the time
+ * since the last edge.
+ */
+static int rpm_at(const RpmFilter *f, double rpm, uint32_t now_tick, int edges_per_rev) {
+    int32_t since_edge = (int32_t)(now_tick - f->anchor_tick);
+
+    // now_tick is an estimate and can land slightly before the newest edge
+    if (since_edge < 0) since_edge = 0;
+
+    if (!f->valid || since_edge > RF_TIMEOUT_US) return 0;
+    if (since_edge > 0) {
+        double bound = 60e6 / ((double)since_edge * edges_per_rev);
+        if (rpm > bound) rpm = bound;
+    }
+    return (int)(rpm + 0.5);
+}
+
+int rf_rpm(const RpmFilter *f, uint32_t now_tick, int edges_per_rev) {
+    // Follow the trend for at most one period past the last edge
+    int32_t since_edge = (int32_t)(now_tick - f->anchor_tick);
+    if (since_edge < 0) since_edge = 0;
+    if ((uint32_t)since_edge > f->last_interval) since_edge = (int32_t)f->last_interval;
+
+    double rpm = f->rpm + f->rate * (since_edge / 1e6);
+    if (rpm < 0) rpm = 0;
+    return rpm_at(f, rpm, now_tick, edges_per_rev);
+}
+
+int rf_raw_rpm(const RpmFilter *f, uint32_t now_tick, int edges_per_rev) {
+    return rpm_at(f, f->raw, now_tick, edges_per_rev);
+}
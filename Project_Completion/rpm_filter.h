@@ -0,0 +1,144 @@
+/*
+ * ======================================================================================
+ * PROJECT:       PARMCO (Phone APP RP4 Motor Control)
+ * FILE:          rpm_filter.h
+ * AUTHOR:        Group 1
+ *
+ * DESCRIPTION:
+ * Per-edge RPM filter for parmco_server. It sits between edge ingestion and
+ * the PID and works on the stream of edge-to-edge intervals, so a bad edge
+ * costs one interval instead of a whole reading. Every rising edge goes
+ * through three stages:
+ *
+ *   1. GATE: an interval is rejected if the speed it implies is above max_rpm,
+ *      or differs from the current estimate by more than the motor can
+ *      accelerate in that time (accel * interval, plus 'tol' percent for timing
+ *      jitter). The estimate lags a fast spin-up, so a speed within the same
+ *      limit of the last good interval passes too. A too-short interval is a
+ *      spurious pulse: the edge is dropped and the next interval is measured
+ *      from the last good edge, so the glitch is bridged. A too-long one is a
+ *      missed edge: the edge is kept as the new reference, only the interval
+ *      is dropped. After RF_MAX_REJECT_RUN rejects in a row the filter
+ *      re-locks on the new rate. It also re-locks once the dropped edges have
+ *      split RF_SPLIT_RUN bridged intervals in a row evenly, since then they
+ *      were real and the estimate had locked on every second (third, ...) edge.
+ *      After a stop or a re-lock, the estimate restarts once two intervals
+ *      agree, so a pair of glitches at standstill rarely fakes a speed.
+ *   2. MEDIAN: median of the last 'median' accepted intervals (odd, 1 = off).
+ *      With 3 blades a median of 3 also hides blade-spacing errors.
+ *   3. ESTIMATOR: an alpha-beta tracker of RPM and its rate of change, updated
+ *      per edge. 'alpha' weights the new measurement, 'beta' the trend; the
+ *      trend lets the estimate follow a ramp with no steady lag.
+ *
+ * A zeroed RpmFilter is ready to use. The control thread owns the filter
+ * state. The reject counters are plain totals read under state_lock; the
+ * rates are taken by the I/O thread.
+ *
+ * OPTIONS (-S key=value,...):
+ *   glitch=<us>    HAL glitch filter, pulses shorter than this never arrive (default 100)
+ *   maxrpm=<rpm>   Intervals faster than this are always rejected (default 12000)
+ *   accel=<rpm/s>  Largest physical change of speed (default 30000)
+ *   tol=<pct>      Extra tolerance for jitter, percent of the estimate (default 15)
+ *   median=<n>     Median window, odd, 1 - 9 (default 3)
+ *   alpha=<a>      Estimator gain, 0 < a <= 1 (default 0.25, 1 = no smoothing)
+ *   beta=<b>       Trend gain, 0 <= b < 1 (default 0.02, 0 = plain exponential filter)
+ * ======================================================================================
+ */
+
+#ifndef RPM_FILTER_H
+#define RPM_FILTER_H
+
+#include <stdint.h>
+
+#define RF_MAX_MEDIAN 9
+#define RF_MAX_REJECT_RUN 6           // Rejects in a row before the filter re-locks
+#define RF_SPLIT_RUN 2                // Evenly split bridged intervals in a row before the filter re-locks
+#define RF_TIMEOUT_US 500000          // No edge for this long means stopped (~40 RPM floor)
+
+// rf_add_edge() results
+#define RF_ACCEPTED     0             // Interval went into the estimate
+#define RF_ANCHOR       1             // First edge after a stop or a re-lock (no interval yet)
+#define RF_REJECT_SHORT 2             // Faster than possible: spurious pulse, edge dropped
+#define RF_REJECT_LONG  3             // Slower than possible: missed edge, interval dropped
+
+// RpmFilter.seeding
+#define RF_SEED_DONE    0             // Tracking
+#define RF_SEED_FIRST   1             // Waiting for the first interval after the anchor
+#define RF_SEED_CONFIRM 2             // Waiting for a second interval that agrees with it
+
+typedef struct {
+    unsigned glitch_us;
+    double max_rpm;
+    double accel;                     // RPM per second
+    double tol;                       // Fraction of the estimate
+    int median;
+    double alpha, beta;
+} RpmFilterConfig;
+
+typedef struct {
+    int have_anchor;
+    uint32_t anchor_tick;             // Last good edge; intervals are measured from here
+    uint32_t last_interval;           // Last accepted interval (0 = none since the anchor)
+    int reject_run;
+    int bridged;                      // Edges rejected as too short since the anchor
+    uint32_t bridged_first;           // Their first and last tick (even split check)
+    uint32_t bridged_last;
+    int split_run;                    // Bridged intervals in a row that the rejected edges split evenly
+    int seeding;                      // RF_SEED_*: restarting the estimate after a stop or a re-lock
+
+    uint32_t window[RF_MAX_MEDIAN];   // Accepted intervals for the median
+    int window_idx, window_fill;
+
+    int valid;                        // rpm / rate hold an estimate (kept through a re-lock)
+    double raw;                       // Median-filtered RPM at the last accepted edge
+    double rpm;                       // Estimated RPM at the last accepted edge
+    double rate;                      // Estimated change, RPM per second
+
+    uint32_t accepted;                // Totals since start
+    uint32_t rejected_short;
+    uint32_t rejected_long;
+    uint32_t relocks;
+} RpmFilter;
+
+/*
+ * FUNCTION: rf_config_default
+ * ---------------------------
+ * The defaults listed under OPTIONS, with the server's glitch filter and
+ * speed limit (GLITCH_FILTER_US, MAX_PHYSICS_RPM).
+ */
+void rf_config_default(RpmFilterConfig *c, unsigned glitch_us, double max_rpm);
+
+/*
+ * FUNCTION: rf_configure
+ * ----------------------
+ * Parses the "-S" options into 'c' (all or nothing).
+ * Returns 0, or -1 (message printed).
+ */
+int rf_configure(RpmFilterConfig *c, const char *opts);
+
+/*
+ * FUNCTION: rf_add_edge
+ * ---------------------
+ * Feeds one rising edge at 'tick' (microseconds, wraps). Returns RF_*.
+ */
+int rf_add_edge(RpmFilter *f, const RpmFilterConfig *c, uint32_t tick, int edges_per_rev);
+
+/*
+ * FUNCTION: rf_rpm / rf_raw_rpm
+ * -----------------------------
+ * Filtered (estimator) and unfiltered (median only) RPM at 'now_tick'.
+ * Both are 0 once no edge has arrived for RF_TIMEOUT_US. If the time since
+ * the last edge is already longer than the period, the motor is slowing down
+ * and that elapsed time bounds the reading.
+ */
+int rf_rpm(const RpmFilter *f, uint32_t now_tick, int edges_per_rev);
+int rf_raw_rpm(const RpmFilter *f, uint32_t now_tick, int edges_per_rev);
+
+/*
+ * FUNCTION: rf_rejected
+ * ---------------------
+ * Total rejected intervals (short + long).
+ */
+static inline uint32_t rf_rejected(const RpmFilter *f) { return f->rejected_short + f->rejected_long; }
+
+#endif
@@ -0,0 +1,95 @@
+/*
+ * ======================================================================================
+ * PROJECT:       PARMCO (Phone APP RP4 Motor Control)
+ * FILE:          rpm_filter_check.c
+ * AUTHOR:        Group 1
+ *
+ * DESCRIPTION:
+ * Regression check for the edge filter (rpm_filter.h), no hardware needed.
+ * It feeds rf_add_edge() the rising edges of a clean first-order spin-up
+ * (the plant model of hal_sim.c, tau 0.3 s, 3 blades) and checks that every
+ * interval is accepted and the estimate ends at the plant speed. A spin-up
+ * stays below the default accel limit, so any reject there is a false one;
+ * a filter locked on every second edge reports half speed. Last, it checks
+ * that such a lock (forced by an instant doubling of the edge rate) re-locks
+ * on the real rate.
+ *
+ * USAGE:
+ * make filter-check       (exit status 1 if a case fails)
+ * ======================================================================================
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "rpm_filter.h"
+
+#define EDGES_PER_REV 3
+#define PLANT_TAU_S 0.3
+#define RUN_US 3000000               // Long enough to settle (10 tau)
+#define RPM_TOLERANCE 5              // Final estimate vs plant speed
+
+static RpmFilterConfig cfg;
+static int failures = 0;
+
+static void report(const char *name, int ok, int rpm, int expect, const RpmFilter *f) {
+    printf("%-4s %-28s rpm %5d (plant %5d) accepted %u short %u long %u relocks %u\n",
+           ok ? "ok" : "FAIL", name, rpm, expect, f->accepted, f->rejected_short, f->rejected_long, f->relocks);
+    if (!ok) failures++;
+}
+
+/*
+ * FUNCTION: check_spin_up
+ * -----------------------
+ * Integrates the shaft angle in 1 us steps from 'from' toward 'to' RPM and
+ * emits an edge every 1/EDGES_PER_REV revolution.
+ */
+static void check_spin_up(double from, double to) {
+    RpmFilter f = {0};
+    double angle = 0, next_edge = 1.0 / EDGES_PER_REV;
+    char name[40];
+    uint32_t t;
+
+    for (t = 1; t <= RUN_US; t++) {
+        double rpm = to + (from - to) * exp(-(t / 1e6) / PLANT_TAU_S);
+        angle += rpm / 60e6;
+        if (angle >= next_edge) {
+            next_edge += 1.0 / EDGES_PER_REV;
+            rf_add_edge(&f, &cfg, t, EDGES_PER_REV);
+        }
+    }
+    int rpm = rf_rpm(&f, t, EDGES_PER_REV);
+    snprintf(name, sizeof(name), "spin-up %.0f -> %.0f", from, to);
+    report(name, rf_rejected(&f) == 0 && f.relocks == 0 && abs(rpm - (int)to) <= RPM_TOLERANCE, rpm, (int)to, &f);
+}
+
+/*
+ * FUNCTION: check_double_rate
+ * ---------------------------
+ * Steady 3000 RPM, then the edge rate doubles at once (faster than 'accel'
+ * allows), so every real edge is a short reject and the bridged intervals
+ * match the old estimate. The filter has to re-lock on 6000 RPM.
+ */
+static void check_double_rate(void) {
+    RpmFilter f = {0};
+    uint32_t t = 1000;
+
+    for (int i = 0; i < 300; i++) { t += 6667; rf_add_edge(&f, &cfg, t, EDGES_PER_REV); }
+    for (int i = 0; i < 30; i++) { t += 3333; rf_add_edge(&f, &cfg, t, EDGES_PER_REV); }
+    int rpm = rf_rpm(&f, t, EDGES_PER_REV);
+    report("edge rate doubles 3000", f.relocks > 0 && abs(rpm - 6000) <= RPM_TOLERANCE, rpm, 6000, &f);
+}
+
+int main(void) {
+    rf_config_default(&cfg, 100, 12000);
+
+    check_spin_up(0, 1000);
+    check_spin_up(0, 6000);
+    check_spin_up(0, 9000);
+    check_spin_up(3000, 9000);
+    check_spin_up(9000, 3000);
+    check_double_rate();
+
+    if (failures > 0) printf("%d case(s) failed\n", failures);
+    return failures > 0 ? 1 : 0;
+}
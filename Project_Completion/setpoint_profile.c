@@ -0,0 +1,112 @@
+/*
+ * ======================================================================================
+ * PROJECT:       PARMCO (Phone APP RP4 Motor Control)
+ * FILE:          setpoint_profile.c
+ * AUTHOR:        Group 1
+ *
+ * DESCRIPTION:
+ * Setpoint profile parser and stepper (see setpoint_profile.h). Parsing runs on
+ * whichever thread received the "p:" command; stepping runs on the control thread.
+ * ======================================================================================
+ */
+
+#include <stdlib.h>
+#include <math.h>
+#include "setpoint_profile.h"
+
+int profile_parse(const char *text, int max_rpm, Profile *p) {
+    const char *s = text;
+    int count = 0;
+
+    while (*s) {
+        char *end;
+        if (count == PROFILE_MAX_SEGMENTS) return -1;
+        ProfileSegment *seg = &p->seg[count];
+
+        seg->type = *s++;
+        if (seg->type != 's' && seg->type != 'l' && seg->type != 'e') return -1;
+
+        if (*s < '0' || *s > '9') return -1;
+        long rpm = strtol(s, &end, 10);
+        if (*end != ',' || rpm > max_rpm) return -1;
+        s = end + 1;
+
+        if (*s < '0' || *s > '9') return -1;
+        long ms = strtol(s, &end, 10);
+        if (ms > PROFILE_MAX_DURATION_MS || (*end != ';' && *end != '\0')) return -1;
+        s = (*end == ';') ? end + 1 : end;
+
+        seg->target_rpm = (int)rpm;
+        seg->duration_ms = (uint32_t)ms;
+        count++;
+    }
+    if (count == 0) return -1;
+    p->count = count;
+    return 0;
+}
+
+static uint32_t segment_ticks(const ProfileSegment *seg, int rate_hz) {
+    uint32_t ticks = (uint32_t)(((uint64_t)seg->duration_ms * (uint64_t)rate_hz) / 1000);
+    return ticks ? ticks : 1;
+}
+
+/*
+ * FUNCTION: begin_segment
+ * -----------------------
+ * Precomputes everything the per-tick step needs for segment 'i'.
+ */
+static void begin_segment(Profile *p, int i, int rate_hz) {
+    const ProfileSegment *seg = &p->seg[i];
+
+    p->index = i;
+    p->seg_tick = 0;
+    p->seg_ticks = segment_ticks(seg, rate_hz);
+    p->start_rpm = p->setpoint;
+    p->slope = (seg->target_rpm - p->start_rpm) / p->seg_ticks;
+    if (seg->type == 's') p->setpoint = seg->target_rpm;
+}
+
+void profile_start(Profile *p, double current_rpm, int rate_hz) {
+    p->total_ticks = 0;
+    for (int i = 0; i < p->count; i++) p->total_ticks += segment_ticks(&p->seg[i], rate_hz);
+    p->done_ticks = 0;
+    p->setpoint = current_rpm;
+    p->state = PROFILE_RUNNING;
+    p->run++;
+    begin_segment(p, 0, rate_hz);
+}
+
+int profile_step(Profile *p, int rate_hz) {
+    if (p->state != PROFILE_RUNNING) return PROFILE_STEP_HOLD;
+
+    const ProfileSegment *seg = &p->seg[p->index];
+    p->seg_tick++;
+    p->done_ticks++;
+
+    switch (seg->type) {
+        case 'l':
+            p->setpoint = p->start_rpm + p->slope * p->seg_tick;
+            break;
+        case 'e':
+            p->setpoint = p->start_rpm + (seg->target_rpm - p->start_rpm) *
+                          (1.0 - cos(M_PI * p->seg_tick / p->seg_ticks)) / 2.0;
+            break;
+        default: // 's': already at the target
+            break;
+    }
+    if (p->seg_tick < p->seg_ticks) return PROFILE_STEP_HOLD;
+
+    p->setpoint = seg->target_rpm; // Land exactly on the target
+    if (p->index + 1 < p->count) {
+        begin_segment(p, p->index + 1, rate_hz);
+        return PROFILE_STEP_SEGMENT;
+    }
+    p->state = PROFILE_DONE;
+    return PROFILE_STEP_DONE;
+}
+
+int profile_progress(const Profile *p) {
+    if (p->state == PROFILE_DONE) return 1000;
+    if (p->total_ticks == 0) return 0;
+    return (int)(((uint64_t)p->done_ticks * 1000) / p->total_ticks);
+}
@@ -0,0 +1,93 @@
+/*
+ * ======================================================================================
+ * PROJECT:       PARMCO (Phone APP RP4 Motor Control)
+ * FILE:          setpoint_profile.h
+ * AUTHOR:        Group 1
+ *
+ * DESCRIPTION:
+ * Setpoint profiles for parmco_server: a list of segments uploaded once
+ * ("p:" command) and then walked by the control thread, one step per loop
+ * tick, so ramp timing no longer depends on the phone or the radio.
+ *
+ * TEXT FORMAT (what follows "p:", up to PROFILE_TEXT_MAX bytes):
+ *   <type><target_rpm>,<duration_ms>[;<type><target_rpm>,<duration_ms>]...
+ *   type  s = step:   jump to the target, then hold it for the duration
+ *         l = linear: ramp in a straight line from the previous setpoint
+ *         e = ease:   cosine S-curve from the previous setpoint (flat at both ends)
+ *   Example: "l1500,2000;s1500,5000;e0,3000" = ramp to 1500 in 2 s, hold 5 s,
+ *            ease down to 0 in 3 s.
+ * The last target is held after the profile completes.
+ *
+ * Segment lengths are converted to loop ticks when the segment starts, and the
+ * per-tick increment of a linear ramp is computed once, so each control step
+ * is one multiply-add (or one cosine for 'e').
+ * ======================================================================================
+ */
+
+#ifndef SETPOINT_PROFILE_H
+#define SETPOINT_PROFILE_H
+
+#include <stdint.h>
+
+#define PROFILE_MAX_SEGMENTS 32
+#define PROFILE_TEXT_MAX 384          // Longest "p:" payload accepted
+#define PROFILE_MAX_DURATION_MS 3600000 // One hour per segment
+
+typedef enum { PROFILE_IDLE, PROFILE_RUNNING, PROFILE_DONE, PROFILE_ABORTED } ProfileState;
+
+// profile_step() results
+#define PROFILE_STEP_HOLD    0        // Same segment
+#define PROFILE_STEP_SEGMENT 1        // A new segment started this tick
+#define PROFILE_STEP_DONE    2        // The last segment just finished
+
+typedef struct {
+    char type;                        // 's', 'l' or 'e'
+    int target_rpm;
+    uint32_t duration_ms;
+} ProfileSegment;
+
+typedef struct {
+    ProfileSegment seg[PROFILE_MAX_SEGMENTS];
+    int count;
+
+    // Run state (control thread)
+    ProfileState state;
+    uint32_t run;                     // +1 every time a profile is started
+    int index;                        // Current segment
+    uint32_t seg_tick, seg_ticks;     // Ticks done / total in the current segment
+    uint32_t done_ticks, total_ticks; // Ticks done / total over the whole profile
+    double start_rpm;                 // Setpoint when the segment started
+    double slope;                     // Linear: RPM added per tick
+    double setpoint;
+} Profile;
+
+/*
+ * FUNCTION: profile_parse
+ * -----------------------
+ * Parses the text format above into p->seg / p->count (the run state is not
+ * touched). Targets must be 0 - max_rpm. Returns 0, or -1 if the text is invalid.
+ */
+int profile_parse(const char *text, int max_rpm, Profile *p);
+
+/*
+ * FUNCTION: profile_start
+ * -----------------------
+ * Starts the parsed profile from 'current_rpm' at 'rate_hz' control steps per second.
+ */
+void profile_start(Profile *p, double current_rpm, int rate_hz);
+
+/*
+ * FUNCTION: profile_step
+ * ----------------------
+ * Advances one control tick and updates p->setpoint. Returns PROFILE_STEP_*.
+ */
+int profile_step(Profile *p, int rate_hz);
+
+/*
+ * FUNCTION: profile_progress
+ * --------------------------
+ * Completed share of the whole profile in 0.1 % (0 - 1000).
+ */
+int profile_progress(const Profile *p);
+
+#endif // SETPOINT_PROFILE_H
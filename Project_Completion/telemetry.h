@@ -0,0 +1,178 @@
+/*
+ * ======================================================================================
+ * PROJECT:       PARMCO (Phone APP RP4 Motor Control)
+ * FILE:          telemetry.h
+ * AUTHOR:        Group 1
+ *
+ * DESCRIPTION:
+ * Binary telemetry frames. A client that sends TELEM_CMD_BINARY receives these
+ * frames instead of the "RPM:<value>\n" text lines; each frame carries every
+ * control-loop sample taken since the previous frame.
+ *
+ * FRAME LAYOUT (all fields little-endian, no padding):
+ *   offset  size  field
+ *   0       1     magic0   0xA5 (never a valid ASCII byte, so text lines and frames
+ *   1       1     magic1   0x5A  can share one stream)
+ *   2       1     version  TELEM_VERSION
+ *   3       1     count    number of samples that follow (1 - TELEM_MAX_SAMPLES)
+ *   4       4     seq      frame sequence number (+1 per frame, a gap = frames lost)
+ *   8       16*N  samples  TelemetrySample[count]
+ *   8+16*N  2     crc      CRC-16/CCITT-FALSE over bytes 2 .. 8+16*N-1
+ *
+ * SAMPLE LAYOUT (16 bytes):
+ *   0   u32  tick        Pi tick when the sample was taken (microseconds, wraps)
+ *   4   i16  rpm_raw     Instantaneous RPM from the edge period
+ *   6   i16  rpm_smooth  Smoothed RPM (what "RPM:" reports)
+ *   8   i16  target      Desired RPM
+ *   10  u16  duty        PWM duty in 0.01 % (0 - 10000)
+ *   12  i16  error       PID error (target - rpm_smooth), 0 outside Auto mode
+ *   14  u8   flags       TELEM_FLAG_*
+ *   15  u8   motor       Motor ID (motor_config.h); one sample per motor per loop tick
+ *
+ * The control thread pushes samples into a TelemetryRing (SPSC, same scheme as
+ * edge_ring.h); the I/O thread pops them in batches and encodes frames.
+ * ======================================================================================
+ */
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+
+#define TELEM_MAGIC0 0xA5
+#define TELEM_MAGIC1 0x5A
+#define TELEM_VERSION 1
+#define TELEM_HEADER_SIZE 8
+#define TELEM_SAMPLE_SIZE 16
+#define TELEM_CRC_SIZE 2
+#define TELEM_MAX_SAMPLES 64   // Per frame (1034 bytes max)
+#define TELEM_MAX_FRAME (TELEM_HEADER_SIZE + TELEM_MAX_SAMPLES * TELEM_SAMPLE_SIZE + TELEM_CRC_SIZE)
+
+#define TELEM_FLAG_RUNNING  (1u << 0)  // Motor master power on
+#define TELEM_FLAG_AUTO     (1u << 1)  // PID (Auto) mode
+#define TELEM_FLAG_REVERSE  (1u << 2)  // Counter-clockwise
+#define TELEM_FLAG_PROFILE  (1u << 3)  // Target comes from a running setpoint profile
+
+// Commands a client sends to pick its telemetry format (any client, not only the controller)
+#define TELEM_CMD_BINARY 'b'
+#define TELEM_CMD_TEXT   't'
+
+typedef struct {
+    uint32_t tick;
+    int16_t  rpm_raw;
+    int16_t  rpm_smooth;
+    int16_t  target;
+    uint16_t duty;
+    int16_t  error;
+    uint8_t  flags;
+    uint8_t  motor;
+} TelemetrySample;
+
+// --- SAMPLE RING (control thread -> I/O thread) ---
+#define TELEM_RING_SIZE 1024   // Must be a power of two (~10 s at 100 Hz with one motor)
+#define TELEM_RING_MASK (TELEM_RING_SIZE - 1)
+
+typedef struct {
+    _Atomic uint32_t head;               // Next slot to write (control thread)
+    char pad_head[64 - sizeof(uint32_t)];
+    _Atomic uint32_t tail;               // Next slot to read (I/O thread)
+    char pad_tail[64 - sizeof(uint32_t)];
+    _Atomic uint32_t dropped;            // Samples lost because the ring was full
+    TelemetrySample samples[TELEM_RING_SIZE];
+} TelemetryRing;
+
+static inline int telem_ring_push(TelemetryRing *r, const TelemetrySample *s) {
+    uint32_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+
+    if (head - tail >= TELEM_RING_SIZE) {
+        atomic_fetch_add_explicit(&r->dropped, 1, memory_order_relaxed);
+        return 0;
+    }
+    r->samples[head & TELEM_RING_MASK] = *s;
+    atomic_store_explicit(&r->head, head + 1, memory_order_release);
+    return 1;
+}
+
+static inline int telem_ring_pop_batch(TelemetryRing *r, TelemetrySample *out, int max) {
+    uint32_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&r->head, memory_order_acquire);
+    uint32_t avail = head - tail;
+    int n = (avail < (uint32_t)max) ? (int)avail : max;
+
+    for (int i = 0; i < n; i++) out[i] = r->samples[(tail + i) & TELEM_RING_MASK];
+    atomic_store_explicit(&r->tail, tail + n, memory_order_release);
+    return n;
+}
+
+// --- ENCODING ---
+
+/*
+ * FUNCTION: telem_crc16
+ * ---------------------
+ * CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF), bitwise. A frame is at most
+ * ~1 KB and is encoded once for all clients, so a table is not worth the cache.
+ */
+static inline uint16_t telem_crc16(const uint8_t *data, size_t len) {
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (int b = 0; b < 8; b++) crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+    }
+    return crc;
+}
+
+static inline void telem_put16(uint8_t *p, uint16_t v) { p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); }
+static inline void telem_put32(uint8_t *p, uint32_t v) { telem_put16(p, (uint16_t)v); telem_put16(p + 2, (uint16_t)(v >> 16)); }
+static inline uint16_t telem_get16(const uint8_t *p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+static inline uint32_t telem_get32(const uint8_t *p) { return telem_get16(p) | ((uint32_t)telem_get16(p + 2) << 16); }
+
+/*
+ * FUNCTION: telem_encode_frame
+ * ----------------------------
+ * Writes one frame for 'count' samples (1 - TELEM_MAX_SAMPLES) into 'out'
+ * (at least TELEM_MAX_FRAME bytes). Returns the frame length.
+ */
+static inline size_t telem_encode_frame(uint8_t *out, uint32_t seq, const TelemetrySample *s, int count) {
+    uint8_t *p = out + TELEM_HEADER_SIZE;
+
+    out[0] = TELEM_MAGIC0;
+    out[1] = TELEM_MAGIC1;
+    out[2] = TELEM_VERSION;
+    out[3] = (uint8_t)count;
+    telem_put32(out + 4, seq);
+
+    for (int i = 0; i < count; i++, p += TELEM_SAMPLE_SIZE) {
+        telem_put32(p, s[i].tick);
+        telem_put16(p + 4, (uint16_t)s[i].rpm_raw);
+        telem_put16(p + 6, (uint16_t)s[i].rpm_smooth);
+        telem_put16(p + 8, (uint16_t)s[i].target);
+        telem_put16(p + 10, s[i].duty);
+        telem_put16(p + 12, (uint16_t)s[i].error);
+        p[14] = s[i].flags;
+        p[15] = s[i].motor;
+    }
+    telem_put16(p, telem_crc16(out + 2, (size_t)(p - (out + 2))));
+    return (size_t)(p - out) + TELEM_CRC_SIZE;
+}
+
+/*
+ * FUNCTION: telem_decode_sample
+ * -----------------------------
+ * Reads sample 'i' of a frame that already passed the CRC check (for tools).
+ */
+static inline void telem_decode_sample(const uint8_t *frame, int i, TelemetrySample *s) {
+    const uint8_t *p = frame + TELEM_HEADER_SIZE + i * TELEM_SAMPLE_SIZE;
+    s->tick = telem_get32(p);
+    s->rpm_raw = (int16_t)telem_get16(p + 4);
+    s->rpm_smooth = (int16_t)telem_get16(p + 6);
+    s->target = (int16_t)telem_get16(p + 8);
+    s->duty = telem_get16(p + 10);
+    s->error = (int16_t)telem_get16(p + 12);
+    s->flags = p[14];
+    s->motor = p[15];
+}
+
+#endif // TELEMETRY_H
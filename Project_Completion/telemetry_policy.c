@@ -0,0 +1,75 @@
+/*
+ * ======================================================================================
+ * PROJECT:       PARMCO (Phone APP RP4 Motor Control)
+ * FILE:          telemetry_policy.c
+ * AUTHOR:        Group 1
+ *
+ * DESCRIPTION:
+ * Text telemetry policy: parsing, formatting and the send decision
+ * (see telemetry_policy.h).
+ * ======================================================================================
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "telemetry_policy.h"
+
+void tp_default(TelemPolicy *p, uint32_t period_ms) {
+    p->min_ms = period_ms;
+    p->max_ms = period_ms;
+    p->band = 0;
+    p->events = 0;
+}
+
+/*
+ * FUNCTION: parse_int
+ * -------------------
+ * Whole-number value between 'v' and 'end', within [lo, hi]. Returns 0, or -1.
+ */
+static int parse_int(const char *v, const char *end, long lo, long hi, long *out) {
+    char *stop;
+    if (v == end) return -1;
+    long x = strtol(v, &stop, 10);
+    if (stop != end || x < lo || x > hi) return -1;
+    *out = x;
+    return 0;
+}
+
+int tp_set(TelemPolicy *p, const char *text) {
+    TelemPolicy next = *p;
+    const char *s = text, *end = text + strlen(text);
+
+    while (s < end) {
+        const char *item_end = strchr(s, ',');
+        if (item_end == NULL) item_end = end;
+        const char *eq = memchr(s, '=', (size_t)(item_end - s));
+        if (eq == NULL) return -1;
+        size_t key_len = (size_t)(eq - s);
+        const char *v = eq + 1;
+        long x;
+
+#define KEY(name) (key_len == sizeof(name) - 1 && memcmp(s, name, key_len) == 0)
+        if (KEY("min") && parse_int(v, item_end, TP_MIN_MS, TP_MAX_MS, &x) == 0) next.min_ms = (uint32_t)x;
+        else if (KEY("max") && parse_int(v, item_end, TP_MIN_MS, TP_MAX_MS, &x) == 0) next.max_ms = (uint32_t)x;
+        else if (KEY("band") && parse_int(v, item_end, 0, TP_MAX_BAND, &x) == 0) next.band = (int)x;
+        else if (KEY("events") && parse_int(v, item_end, 0, 1, &x) == 0) next.events = (int)x;
+        else return -1;
+#undef KEY
+        s = (item_end < end) ? item_end + 1 : end;
+    }
+    if (next.min_ms > next.max_ms) return -1;
+    *p = next;
+    return 0;
+}
+
+int tp_format(const TelemPolicy *p, char *out, size_t cap) {
+    int len = snprintf(out, cap, "min=%u,max=%u,band=%d,events=%d", p->min_ms, p->max_ms, p->band, p->events);
+    return (len < (int)cap) ? len : (int)cap - 1;
+}
+
+int tp_due(const TelemPolicy *p, int64_t elapsed_us, int64_t slack_us, int change, int event) {
+    if (event) return p->events; // Event pushes never stand in for the timed stream
+    if (elapsed_us + slack_us >= (int64_t)p->max_ms * 1000) return 1;
+    return elapsed_us + slack_us >= (int64_t)p->min_ms * 1000 && change > p->band;
+}
@@ -0,0 +1,82 @@
+/*
+ * ======================================================================================
+ * PROJECT:       PARMCO (Phone APP RP4 Motor Control)
+ * FILE:          telemetry_policy.h
+ * AUTHOR:        Group 1
+ *
+ * DESCRIPTION:
+ * Per-subscriber policy for the "RPM:" text telemetry of parmco_server.
+ * Instead of a message every 500 ms whether or not anything changed, each
+ * text client gets one when its policy says so:
+ *   - 'max' has passed since its last message (heartbeat), or
+ *   - 'min' has passed and some motor's RPM moved more than 'band' since the
+ *     RPMs that message carried (deadband), or
+ *   - an event happened (with events=1): a motor started or stopped, changed
+ *     mode, reached its target, a burst of edge noise began, or an output
+ *     write failed. Events go out at once, ignoring 'min'.
+ * At steady state a client only sees heartbeats; during a transient it gets a
+ * message every 'min'. The default (min = max = 500 ms, band 0, events 0) is
+ * the old fixed stream, so a client that never sends 'T' sees no change.
+ *
+ * PROTOCOL (any client, best sent right after connecting):
+ *   T:<key>=<value>,...\n   keys: min=<ms>, max=<ms>, band=<rpm>, events=0|1
+ *                           (all or nothing; missing keys keep their value)
+ *   T:\n                    only reports
+ * The reply is "TELEM:min=<ms>,max=<ms>,band=<rpm>,events=<0|1>\n", to that
+ * client only.
+ * ======================================================================================
+ */
+
+#ifndef TELEMETRY_POLICY_H
+#define TELEMETRY_POLICY_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define TP_CMD 'T'
+#define TP_MIN_MS 20                  // Fastest 'min' (and the fastest evaluation tick)
+#define TP_MAX_MS 60000               // Slowest heartbeat
+#define TP_MAX_BAND 10000
+#define TP_TEXT_MAX 64                // Longest tp_format() output
+
+typedef struct {
+    uint32_t min_ms;                  // Never closer than this, except for events
+    uint32_t max_ms;                  // Heartbeat: never further apart than this
+    int band;                         // RPM change that counts as a change (0 = any)
+    int events;                       // 1 = events push at once
+} TelemPolicy;
+
+/*
+ * FUNCTION: tp_default
+ * --------------------
+ * The fixed stream: min = max = 'period_ms', band 0, events off.
+ */
+void tp_default(TelemPolicy *p, uint32_t period_ms);
+
+/*
+ * FUNCTION: tp_set
+ * ----------------
+ * Applies "key=value,..." (see PROTOCOL). Nothing changes unless every
+ * assignment is valid and min <= max. Returns 0, or -1.
+ */
+int tp_set(TelemPolicy *p, const char *text);
+
+/*
+ * FUNCTION: tp_format
+ * -------------------
+ * The policy in the tp_set() syntax. Returns the length.
+ */
+int tp_format(const TelemPolicy *p, char *out, size_t cap);
+
+/*
+ * FUNCTION: tp_due
+ * ----------------
+ * Whether a client with this policy gets the current message. 'elapsed_us'
+ * is the time since its last message, 'change' the largest RPM difference
+ * from that message, 'event' 1 if an event is being pushed. An event push
+ * goes to events=1 clients only; heartbeat and deadband are judged on the
+ * timer ticks, where deadlines within 'slack_us' count as reached.
+ */
+int tp_due(const TelemPolicy *p, int64_t elapsed_us, int64_t slack_us, int change, int event);
+
+#endif
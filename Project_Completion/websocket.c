@@ -0,0 +1,178 @@
+/*
+ * ======================================================================================
+ * PROJECT:       PARMCO (Phone APP RP4 Motor Control)
+ * FILE:          websocket.c
+ * AUTHOR:        Group 1
+ *
+ * DESCRIPTION:
+ * Implementation of the WebSocket codec (see websocket.h). The handshake needs
+ * SHA-1 and Base64; both are included here so the server does not pull in a
+ * crypto library for one hash per connection.
+ * ======================================================================================
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include "websocket.h"
+
+#define WS_GUID "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+
+// --- SHA-1 (FIPS 180-4), only used for Sec-WebSocket-Accept ---
+static uint32_t rol32(uint32_t v, int n) { return (v << n) | (v >> (32 - n)); }
+
+static void sha1_block(uint32_t h[5], const uint8_t *p) {
+    uint32_t w[80];
+    for (int i = 0; i < 16; i++) w[i] = (uint32_t)p[4 * i] << 24 | p[4 * i + 1] << 16 | p[4 * i + 2] << 8 | p[4 * i + 3];
+    for (int i = 16; i < 80; i++) w[i] = rol32(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+    for (int i = 0; i < 80; i++) {
+        uint32_t f, k;
+        if (i < 20)      { f = (b & c) | (~b & d);          k = 0x5A827999; }
+        else if (i < 40) { f = b ^ c ^ d;                   k = 0x6ED9EBA1; }
+        else if (i < 60) { f = (b & c) | (b & d) | (c & d); k = 0x8F1BBCDC; }
+        else             { f = b ^ c ^ d;                   k = 0xCA62C1D6; }
+        uint32_t t = rol32(a, 5) + f + e + k + w[i];
+        e = d; d = c; c = rol32(b, 30); b = a; a = t;
+    }
+    h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e;
+}
+
+static void sha1(const uint8_t *data, size_t len, uint8_t out[20]) {
+    uint32_t h[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+    uint8_t block[64];
+    size_t i;
+
+    for (i = 0; i + 64 <= len; i += 64) sha1_block(h, data + i);
+
+    // Padding: 0x80, zeros, 64-bit big-endian bit length
+    size_t rest = len - i;
+    memset(block, 0, sizeof(block));
+    memcpy(block, data + i, rest);
+    block[rest] = 0x80;
+    if (rest >= 56) { sha1_block(h, block); memset(block, 0, sizeof(block)); }
+    uint64_t bits = (uint64_t)len * 8;
+    for (int b = 0; b < 8; b++) block[63 - b] = (uint8_t)(bits >> (8 * b));
+    sha1_block(h, block);
+
+    for (int b = 0; b < 20; b++) out[b] = (uint8_t)(h[b / 4] >> (24 - 8 * (b % 4)));
+}
+
+static size_t base64(const uint8_t *in, size_t len, char *out) {
+    static const char tbl[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    size_t o = 0;
+    for (size_t i = 0; i < len; i += 3) {
+        uint32_t v = (uint32_t)in[i] << 16 | (i + 1 < len ? in[i + 1] << 8 : 0) | (i + 2 < len ? in[i + 2] : 0);
+        out[o++] = tbl[(v >> 18) & 63];
+        out[o++] = tbl[(v >> 12) & 63];
+        out[o++] = (i + 1 < len) ? tbl[(v >> 6) & 63] : '=';
+        out[o++] = (i + 2 < len) ? tbl[v & 63] : '=';
+    }
+    out[o] = '\0';
+    return o;
+}
+
+/*
+ * FUNCTION: find_header
+ * ---------------------
+ * Case-insensitive lookup of "Name:" in the request head. Copies the trimmed
+ * value into 'out'. Returns 0 if found.
+ */
+static int find_header(const char *head, size_t len, const char *name, char *out, size_t cap) {
+    size_t nlen = strlen(name);
+    const char *end = head + len;
+
+    for (const char *line = head; line < end; ) {
+        const char *eol = memchr(line, '\n', (size_t)(end - line));
+        if (eol == NULL) eol = end;
+        if ((size_t)(eol - line) > nlen && strncasecmp(line, name, nlen) == 0 && line[nlen] == ':') {
+            const char *v = line + nlen + 1;
+            while (v < eol && (*v == ' ' || *v == '\t')) v++;
+            const char *ve = eol;
+            while (ve > v && (ve[-1] == '\r' || ve[-1] == ' ')) ve--;
+            size_t vlen = (size_t)(ve - v);
+            if (vlen >= cap) return -1;
+            memcpy(out, v, vlen);
+            out[vlen] = '\0';
+            return 0;
+        }
+        line = eol + 1;
+    }
+    return -1;
+}
+
+int ws_handshake(const char *req, size_t len, char *resp, size_t resp_cap, size_t *resp_len) {
+    char key[64], upgrade[32], concat[128], accept[32];
+    uint8_t digest[20];
+
+    const char *term = NULL;
+    for (size_t i = 0; i + 3 < len; i++) {
+        if (memcmp(req + i, "\r\n\r\n", 4) == 0) { term = req + i; break; }
+    }
+    if (term == NULL) return 0;
+    size_t head_len = (size_t)(term - req) + 4;
+
+    if (strncmp(req, "GET ", 4) != 0) return -1;
+    if (find_header(req, head_len, "Upgrade", upgrade, sizeof(upgrade)) != 0 || strcasecmp(upgrade, "websocket") != 0) return -1;
+    if (find_header(req, head_len, "Sec-WebSocket-Key", key, sizeof(key)) != 0) return -1;
+
+    snprintf(concat, sizeof(concat), "%s%s", key, WS_GUID);
+    sha1((const uint8_t *)concat, strlen(concat), digest);
+    base64(digest, sizeof(digest), accept);
+
+    int n = snprintf(resp, resp_cap,
+                     "HTTP/1.1 101 Switching Protocols\r\n"
+                     "Upgrade: websocket\r\n"
+                     "Connection: Upgrade\r\n"
+                     "Sec-WebSocket-Accept: %s\r\n\r\n", accept);
+    if (n < 0 || (size_t)n >= resp_cap) return -1;
+    *resp_len = (size_t)n;
+    return (int)head_len;
+}
+
+long ws_parse_frame(uint8_t *buf, size_t len, size_t max_payload, WsFrame *f) {
+    if (len < 2) return 0;
+
+    f->fin = (buf[0] & 0x80) != 0;
+    f->opcode = buf[0] & 0x0F;
+    if (!(buf[1] & 0x80)) return -1; // Clients must mask
+
+    size_t pos = 2;
+    uint64_t plen = buf[1] & 0x7F;
+    if (plen == 126) {
+        if (len < 4) return 0;
+        plen = (uint64_t)buf[2] << 8 | buf[3];
+        pos = 4;
+    } else if (plen == 127) {
+        if (len < 10) return 0;
+        plen = 0;
+        for (int i = 0; i < 8; i++) plen = plen << 8 | buf[2 + i];
+        pos = 10;
+    }
+    if (plen > max_payload) return -1;
+    if (len < pos + 4 + plen) return 0;
+
+    const uint8_t *mask = buf + pos;
+    f->payload = buf + pos + 4;
+    f->payload_len = (size_t)plen;
+    for (size_t i = 0; i < f->payload_len; i++) f->payload[i] ^= mask[i & 3];
+    return (long)(pos + 4 + plen);
+}
+
+size_t ws_frame_header(uint8_t *out, int opcode, size_t payload_len) {
+    out[0] = (uint8_t)(0x80 | opcode);
+    if (payload_len < 126) {
+        out[1] = (uint8_t)payload_len;
+        return 2;
+    }
+    if (payload_len <= 0xFFFF) {
+        out[1] = 126;
+        out[2] = (uint8_t)(payload_len >> 8);
+        out[3] = (uint8_t)payload_len;
+        return 4;
+    }
+    out[1] = 127;
+    for (int i = 0; i < 8; i++) out[2 + i] = (uint8_t)((uint64_t)payload_len >> (56 - 8 * i));
+    return 10;
+}
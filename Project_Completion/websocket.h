@@ -0,0 +1,64 @@
+/*
+ * ======================================================================================
+ * PROJECT:       PARMCO (Phone APP RP4 Motor Control)
+ * FILE:          websocket.h
+ * AUTHOR:        Group 1
+ *
+ * DESCRIPTION:
+ * Minimal RFC 6455 WebSocket codec for the parmco_server WebSocket transport.
+ * It only handles what a browser dashboard needs: the HTTP upgrade handshake,
+ * unfragmented or fragmented client frames (masked), ping/pong and close, and
+ * unmasked server frames. No extensions, no subprotocols.
+ * There are no sockets in here; parmco_server does all the I/O.
+ * ======================================================================================
+ */
+
+#ifndef WEBSOCKET_H
+#define WEBSOCKET_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define WS_OP_CONTINUATION 0x0
+#define WS_OP_TEXT         0x1
+#define WS_OP_BINARY       0x2
+#define WS_OP_CLOSE        0x8
+#define WS_OP_PING         0x9
+#define WS_OP_PONG         0xA
+
+#define WS_MAX_HEADER 10                   // Largest server frame header (64-bit length)
+
+typedef struct {
+    int opcode;
+    int fin;
+    uint8_t *payload;                      // Points into the caller's buffer (already unmasked)
+    size_t payload_len;
+} WsFrame;
+
+/*
+ * FUNCTION: ws_handshake
+ * ----------------------
+ * Looks for a complete HTTP upgrade request in 'req' (len bytes).
+ * Returns 0 if the request is not complete yet, -1 if it is not a valid
+ * WebSocket upgrade, otherwise the number of request bytes consumed; the
+ * "101 Switching Protocols" reply is written to 'resp' and its length to *resp_len.
+ */
+int ws_handshake(const char *req, size_t len, char *resp, size_t resp_cap, size_t *resp_len);
+
+/*
+ * FUNCTION: ws_parse_frame
+ * ------------------------
+ * Decodes one client frame at the start of 'buf' and unmasks its payload in place.
+ * Returns the frame's total size, 0 if more bytes are needed, or -1 for a
+ * protocol error (unmasked client frame, or payload larger than max_payload).
+ */
+long ws_parse_frame(uint8_t *buf, size_t len, size_t max_payload, WsFrame *f);
+
+/*
+ * FUNCTION: ws_frame_header
+ * -------------------------
+ * Writes the header of a final, unmasked server frame. Returns its length (2 - 10).
+ */
+size_t ws_frame_header(uint8_t *out, int opcode, size_t payload_len);
+
+#endif // WEBSOCKET_H